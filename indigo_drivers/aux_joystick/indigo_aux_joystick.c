@@ -23,7 +23,7 @@
  \file indigo_aux_joystick.c
  */
 
-#define DRIVER_VERSION 0x0002
+#define DRIVER_VERSION 0x0003
 #define DRIVER_NAME "indigo_joystick"
 
 #include <stdlib.h>
@@ -52,11 +52,17 @@
 #include <dirent.h>
 #include <float.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
 #include <linux/joystick.h>
 
 #define MAX_BUTTONS	64
 #define MAX_AXES		16
 
+#define AXIS_UPDATE_INTERVAL	0.05
+
 #endif
 
 #include "indigo_driver_xml.h"
@@ -134,9 +140,10 @@ typedef struct {
 	indigo_property *mount_tracking_property;
 #ifdef INDIGO_LINUX
 	int fd;
-	pthread_t thread;
 	bool last_button_state[MAX_BUTTONS];
 	int last_axis_value[MAX_AXES];
+	unsigned int pending_axes;
+	double last_axis_update;
 #endif
 } joystick_private_data;
 
@@ -333,6 +340,8 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 
 static indigo_result aux_detach(indigo_device *device) {
 	assert(device != NULL);
+	if (CONNECTION_CONNECTED_ITEM->sw.value)
+		indigo_device_disconnect(NULL, device->name);
 	indigo_release_property(JOYSTICK_AXES_PROPERTY);
 	indigo_release_property(JOYSTICK_BUTTONS_PROPERTY);
 	indigo_release_property(JOYSTICK_MAPPING_PROPERTY);
@@ -343,8 +352,6 @@ static indigo_result aux_detach(indigo_device *device) {
 	indigo_release_property(MOUNT_MOTION_RA_PROPERTY);
 	indigo_release_property(MOUNT_TRACKING_PROPERTY);
 	indigo_release_property(MOUNT_ABORT_MOTION_PROPERTY);
-	if (CONNECTION_CONNECTED_ITEM->sw.value)
-		indigo_device_disconnect(NULL, device->name);
 	INDIGO_DEVICE_DETACH_LOG(DRIVER_NAME, device->name);
 	return indigo_aux_detach(device);
 }
@@ -698,39 +705,54 @@ static void close_joystick(indigo_device *device) {
 
 static indigo_device *devices[MAX_DEVICES];
 
-static void *poll(indigo_device *device) {
-	INDIGO_DRIVER_LOG(DRIVER_NAME, "Joystick #%ld poll thread started", PRIVATE_DATA->index);
-	char path[128];
-	sprintf(path, "/dev/input/js%ld", PRIVATE_DATA->index);
-	if ((PRIVATE_DATA->fd = open(path, O_RDONLY)) == -1) {
-		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Can't access %s (%s)", path, strerror(errno));
-	} else {
-		int joy_fd, axis_count=0, button_count=0;
-		struct js_event js;
-		ioctl(joy_fd, JSIOCGAXES, &axis_count);
-		ioctl(joy_fd, JSIOCGBUTTONS, &button_count);
-		fcntl(PRIVATE_DATA->fd, F_SETFL, O_NONBLOCK);
-		while (PRIVATE_DATA->fd) {
-			while (read(PRIVATE_DATA->fd, &js, sizeof(struct js_event)) != -1) {
-				switch (js.type & ~JS_EVENT_INIT) {
-					case JS_EVENT_AXIS:
-						if (js.number < MAX_AXES && PRIVATE_DATA->last_axis_value[js.number] != js.value) {
-							event_axis(device, js.number, 2 * js.value);
-							PRIVATE_DATA->last_axis_value[js.number] = js.value;
-						}
-						break;
-					case JS_EVENT_BUTTON:
-						if (js.number < MAX_BUTTONS && PRIVATE_DATA->last_button_state[js.number] != js.value) {
-							event_button(device, js.number, js.value);
-							PRIVATE_DATA->last_button_state[js.number] = js.value;
-						}
-						break;
-				}
+// All joysticks share one epoll thread, /dev/input is watched by inotify for hotplug. Axis events are coalesced
+// and forwarded to mount mapping at most once per AXIS_UPDATE_INTERVAL, the first change is forwarded immediately.
+
+static int epoll_fd = -1;
+static int inotify_fd = -1;
+static int wakeup_fd = -1;
+static pthread_t event_thread;
+
+static double monotonic_time() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void flush_axes(indigo_device *device, double now) {
+	for (int i = 0; i < MAX_AXES; i++) {
+		if (PRIVATE_DATA->pending_axes & (1 << i))
+			event_axis(device, i, 2 * PRIVATE_DATA->last_axis_value[i]);
+	}
+	PRIVATE_DATA->pending_axes = 0;
+	PRIVATE_DATA->last_axis_update = now;
+}
+
+static void read_joystick(indigo_device *device) {
+	struct js_event events[32];
+	ssize_t size;
+	while (PRIVATE_DATA->fd >= 0 && (size = read(PRIVATE_DATA->fd, events, sizeof(events))) > 0) {
+		for (int i = 0; i < size / sizeof(struct js_event); i++) {
+			struct js_event *js = events + i;
+			switch (js->type & ~JS_EVENT_INIT) {
+				case JS_EVENT_AXIS:
+					if (js->number < MAX_AXES && PRIVATE_DATA->last_axis_value[js->number] != js->value) {
+						PRIVATE_DATA->last_axis_value[js->number] = js->value;
+						PRIVATE_DATA->pending_axes |= 1 << js->number;
+					}
+					break;
+				case JS_EVENT_BUTTON:
+					if (js->number < MAX_BUTTONS && PRIVATE_DATA->last_button_state[js->number] != js->value) {
+						PRIVATE_DATA->last_button_state[js->number] = js->value;
+						event_button(device, js->number, js->value);
+					}
+					break;
 			}
-			usleep(100000);
 		}
 	}
-	INDIGO_DRIVER_LOG(DRIVER_NAME, "Joystick #%ld poll thread finished", PRIVATE_DATA->index);
+	double now = monotonic_time();
+	if (PRIVATE_DATA->pending_axes && now - PRIVATE_DATA->last_axis_update >= AXIS_UPDATE_INTERVAL)
+		flush_axes(device, now);
 }
 
 static void rescan() {
@@ -745,18 +767,21 @@ static void rescan() {
 		found[i] = false;
 	while ((dir = readdir(dev_input)) != NULL) {
 		int index = 0;
-		if (sscanf(dir->d_name, "js%d", &index) == 1) {
-			found[index] = true;
-			if (devices[index])
+		if (sscanf(dir->d_name, "js%d", &index) == 1 && index >= 0 && index < MAX_DEVICES) {
+			if (devices[index]) {
+				found[index] = true;
 				continue;
+			}
 			int joy_fd, axis_count=0, button_count=0;
 			char name[512];
 			memset(name, 0, sizeof(name));
 			snprintf(name, sizeof(name), "/dev/input/%s", dir->d_name);
 			if ((joy_fd = open(name, O_RDONLY)) == -1) {
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "Can't access %s (%s)", name, strerror(errno));
-				return;
+				// udev may not have set permissions yet, IN_ATTRIB will trigger another rescan
+				INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Can't access %s (%s)", name, strerror(errno));
+				continue;
 			}
+			found[index] = true;
 			ioctl(joy_fd, JSIOCGAXES, &axis_count);
 			ioctl(joy_fd, JSIOCGBUTTONS, &button_count);
 			ioctl(joy_fd, JSIOCGNAME(80), &name);
@@ -764,6 +789,7 @@ static void rescan() {
 			devices[index] = allocate_device(name, index, button_count, axis_count, 0);
 		}
 	}
+	closedir(dev_input);
 	for (int i = 0; i < MAX_DEVICES; i++) {
 		if (devices[i] && !found[i]) {
 			release_device(devices[i]);
@@ -772,40 +798,165 @@ static void rescan() {
 	}
 }
 
-static void shutdown() {
+static bool read_inotify() {
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	bool joystick_changed = false;
+	ssize_t size;
+	while ((size = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+		for (char *ptr = buffer; ptr < buffer + size; ptr += sizeof(struct inotify_event) + ((struct inotify_event *)ptr)->len) {
+			struct inotify_event *event = (struct inotify_event *)ptr;
+			if (event->len > 0 && !strncmp(event->name, "js", 2))
+				joystick_changed = true;
+		}
+	}
+	return joystick_changed;
+}
+
+static void *event_loop(void *arg) {
+	INDIGO_DRIVER_LOG(DRIVER_NAME, "Event thread started");
+	struct epoll_event events[MAX_DEVICES + 2];
+	bool running = true;
+	while (running) {
+		int timeout = -1;
+		double now = monotonic_time();
+		for (int i = 0; i < MAX_DEVICES; i++) {
+			indigo_device *device = devices[i];
+			if (device && PRIVATE_DATA->pending_axes) {
+				int remaining = (int)ceil((PRIVATE_DATA->last_axis_update + AXIS_UPDATE_INTERVAL - now) * 1000);
+				if (remaining < 0)
+					remaining = 0;
+				if (timeout < 0 || remaining < timeout)
+					timeout = remaining;
+			}
+		}
+		int count = epoll_wait(epoll_fd, events, MAX_DEVICES + 2, timeout);
+		if (count < 0 && errno != EINTR) {
+			INDIGO_DRIVER_ERROR(DRIVER_NAME, "epoll_wait() failed (%s)", strerror(errno));
+			break;
+		}
+		bool joystick_changed = false;
+		for (int i = 0; i < count; i++) {
+			if (events[i].data.ptr == &wakeup_fd) {
+				running = false;
+			} else if (events[i].data.ptr == &inotify_fd) {
+				joystick_changed |= read_inotify();
+			} else {
+				indigo_device *device = events[i].data.ptr;
+				read_joystick(device);
+				if (events[i].events & (EPOLLERR | EPOLLHUP) && PRIVATE_DATA->fd >= 0) {
+					INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Joystick #%ld lost", PRIVATE_DATA->index);
+					epoll_ctl(epoll_fd, EPOLL_CTL_DEL, PRIVATE_DATA->fd, NULL);
+					close(PRIVATE_DATA->fd);
+					PRIVATE_DATA->fd = -1;
+				}
+			}
+		}
+		if (!running)
+			break;
+		now = monotonic_time();
+		for (int i = 0; i < MAX_DEVICES; i++) {
+			indigo_device *device = devices[i];
+			if (device && PRIVATE_DATA->pending_axes && now - PRIVATE_DATA->last_axis_update >= AXIS_UPDATE_INTERVAL && IS_CONNECTED)
+				flush_axes(device, now);
+		}
+		// devices are released only after all events of the batch were dispatched
+		if (joystick_changed)
+			rescan();
+	}
+	INDIGO_DRIVER_LOG(DRIVER_NAME, "Event thread finished");
+	return NULL;
+}
+
+static bool start_event_loop() {
+	if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "epoll_create1() failed (%s)", strerror(errno));
+		return false;
+	}
+	wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (wakeup_fd == -1 || inotify_fd == -1) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Can't create event descriptors (%s)", strerror(errno));
+		return false;
+	}
+	if (inotify_add_watch(inotify_fd, "/dev/input", IN_CREATE | IN_DELETE | IN_ATTRIB) == -1)
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Can't watch /dev/input (%s)", strerror(errno));
+	struct epoll_event event = { EPOLLIN };
+	event.data.ptr = &wakeup_fd;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event);
+	event.data.ptr = &inotify_fd;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &event);
+	rescan();
+	if (pthread_create(&event_thread, NULL, event_loop, NULL) != 0) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Can't start event thread");
+		return false;
+	}
+	return true;
+}
+
+static void stop_event_loop() {
+	if (wakeup_fd != -1) {
+		uint64_t value = 1;
+		if (write(wakeup_fd, &value, sizeof(value)) == sizeof(value))
+			pthread_join(event_thread, NULL);
+	}
 	for (int i = 0; i < MAX_DEVICES; i++) {
 		if (devices[i]) {
 			release_device(devices[i]);
 			devices[i] = NULL;
 		}
 	}
+	if (inotify_fd != -1)
+		close(inotify_fd);
+	if (wakeup_fd != -1)
+		close(wakeup_fd);
+	if (epoll_fd != -1)
+		close(epoll_fd);
+	epoll_fd = inotify_fd = wakeup_fd = -1;
 }
 
 static bool open_joystick(indigo_device *device) {
-	indigo_async((void *(*)(void *))poll, device);
+	char path[128];
+	sprintf(path, "/dev/input/js%ld", PRIVATE_DATA->index);
+	if ((PRIVATE_DATA->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC)) == -1) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Can't access %s (%s)", path, strerror(errno));
+		return false;
+	}
+	PRIVATE_DATA->pending_axes = 0;
+	PRIVATE_DATA->last_axis_update = 0;
+	struct epoll_event event = { EPOLLIN };
+	event.data.ptr = device;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, PRIVATE_DATA->fd, &event) == -1) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "epoll_ctl() failed (%s)", strerror(errno));
+		close(PRIVATE_DATA->fd);
+		PRIVATE_DATA->fd = -1;
+		return false;
+	}
 	return true;
 }
 
 static void close_joystick(indigo_device *device) {
-	close(PRIVATE_DATA->fd);
-	PRIVATE_DATA->fd = 0;
+	int fd = PRIVATE_DATA->fd;
+	PRIVATE_DATA->fd = -1;
+	PRIVATE_DATA->pending_axes = 0;
+	if (fd >= 0) {
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+		close(fd);
+	}
 }
 
 #endif
 
-static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
 #ifdef INDIGO_MACOS
+
+static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
 	[DDHidJoystickWrapper rescan];
-#endif
-#ifdef INDIGO_LINUX
-	usleep(500000);
-	rescan();
-#endif
 	return 0;
 };
 
 static libusb_hotplug_callback_handle callback_handle;
 
+#endif
+
 indigo_result indigo_aux_joystick(indigo_driver_action action, indigo_driver_info *info) {
 	static indigo_driver_action last_action = INDIGO_DRIVER_SHUTDOWN;
 
@@ -819,24 +970,28 @@ indigo_result indigo_aux_joystick(indigo_driver_action action, indigo_driver_inf
 		last_action = action;
 #ifdef INDIGO_MACOS
 		[DDHidJoystickWrapper rescan];
-#endif
-#ifdef INDIGO_LINUX
-			rescan();
-#endif
 		indigo_start_usb_event_handler();
 		int rc = libusb_hotplug_register_callback(NULL, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, LIBUSB_HOTPLUG_NO_FLAGS, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplug_callback, NULL, &callback_handle);
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_register_callback ->  %s", rc < 0 ? libusb_error_name(rc) : "OK");
 		return rc >= 0 ? INDIGO_OK : INDIGO_FAILED;
+#endif
+#ifdef INDIGO_LINUX
+		if (!start_event_loop()) {
+			stop_event_loop();
+			return INDIGO_FAILED;
+		}
+		return INDIGO_OK;
+#endif
 
 	case INDIGO_DRIVER_SHUTDOWN:
 		last_action = action;
+#ifdef INDIGO_MACOS
 		libusb_hotplug_deregister_callback(NULL, callback_handle);
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
-#ifdef INDIGO_MACOS
 		[DDHidJoystickWrapper shutdown];
 #endif
 #ifdef INDIGO_LINUX
-			shutdown();
+		stop_event_loop();
 #endif
 		break;
 
@@ -23,7 +23,7 @@
  \file indigo_aux_upb.c
  */
 
-#define DRIVER_VERSION 0x0009
+#define DRIVER_VERSION 0x000B
 #define DRIVER_NAME "indigo_aux_upb"
 
 #include <stdlib.h>
@@ -143,6 +143,8 @@ typedef struct {
 	pthread_mutex_t port_mutex;
 	indigo_timer *aux_timer;
 	indigo_timer *focuser_timer;
+	indigo_poll_policy aux_poll_policy;
+	indigo_poll_policy focuser_poll_policy;
 	indigo_property *outlet_names_property;
 	indigo_property *power_outlet_property;
 	indigo_property *power_outlet_state_property;
@@ -162,18 +164,16 @@ typedef struct {
 } upb_private_data;
 
 static bool upb_command(indigo_device *device, char *command, char *response, int max) {
-	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	tcflush(PRIVATE_DATA->handle, TCIOFLUSH);
-	indigo_write(PRIVATE_DATA->handle, command, strlen(command));
-	indigo_write(PRIVATE_DATA->handle, "\n", 1);
-	if (response != NULL) {
-		if (indigo_read_line(PRIVATE_DATA->handle, response, max) == -1) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> no response", command);
-			return false;
-		}
+	static const indigo_transaction transaction = { "\n", 3000, 0, 0, 0 };
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "%s\n", command);
+	int length = indigo_transact(PRIVATE_DATA->handle, &PRIVATE_DATA->port_mutex, &transaction, buffer, response, max);
+	if (length < 0) {
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> no response", command);
+		return false;
 	}
-	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
+	if (length > 0 && response[length - 1] == '\r')
+		response[length - 1] = 0;
 	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> %s", command, response != NULL ? response : "NULL");
 	return true;
 }
@@ -461,7 +461,7 @@ static void aux_timer_callback(indigo_device *device) {
 		AUX_USB_PORT_STATE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, AUX_USB_PORT_STATE_PROPERTY, NULL);
 	}
-	indigo_reschedule_timer(device, 2, &PRIVATE_DATA->aux_timer);
+	indigo_poll_policy_reschedule(device, &PRIVATE_DATA->aux_poll_policy, &PRIVATE_DATA->aux_timer);
 }
 
 static indigo_result aux_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property);
@@ -795,6 +795,16 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 					}
 				}
 				libusb_free_device_list(usb_devices, 1);
+				// analog readings are updated on every poll but only switchable states drive the backoff
+				indigo_init_poll_policy(&PRIVATE_DATA->aux_poll_policy, 0.5, 2, 10);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->aux_poll_policy, AUX_POWER_OUTLET_PROPERTY);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->aux_poll_policy, AUX_POWER_OUTLET_STATE_PROPERTY);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->aux_poll_policy, AUX_HEATER_OUTLET_PROPERTY);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->aux_poll_policy, AUX_HEATER_OUTLET_STATE_PROPERTY);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->aux_poll_policy, AUX_DEW_CONTROL_PROPERTY);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->aux_poll_policy, X_AUX_HUB_PROPERTY);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->aux_poll_policy, AUX_USB_PORT_PROPERTY);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->aux_poll_policy, AUX_USB_PORT_STATE_PROPERTY);
 				PRIVATE_DATA->aux_timer = indigo_set_timer(device, 0, aux_timer_callback);
 				CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 			} else {
@@ -913,6 +923,7 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 			upb_command(device, AUX_POWER_OUTLET_4_ITEM->sw.value ? "P4:1" : "P4:0", response, sizeof(response));
 			AUX_POWER_OUTLET_PROPERTY->state = INDIGO_OK_STATE;
 			indigo_update_property(device, AUX_POWER_OUTLET_PROPERTY, NULL);
+			indigo_poll_policy_refresh(device, &PRIVATE_DATA->aux_poll_policy, &PRIVATE_DATA->aux_timer);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(AUX_HEATER_OUTLET_PROPERTY, property)) {
@@ -925,6 +936,7 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 			upb_command(device, command, response, sizeof(response));
 			AUX_HEATER_OUTLET_PROPERTY->state = INDIGO_OK_STATE;
 			indigo_update_property(device, AUX_HEATER_OUTLET_PROPERTY, NULL);
+			indigo_poll_policy_refresh(device, &PRIVATE_DATA->aux_poll_policy, &PRIVATE_DATA->aux_timer);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(AUX_DEW_CONTROL_PROPERTY, property)) {
@@ -934,6 +946,7 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 			upb_command(device, AUX_DEW_CONTROL_AUTOMATIC_ITEM->sw.value ? "PD:1" : "PD:0", response, sizeof(response));
 			AUX_DEW_CONTROL_PROPERTY->state = INDIGO_OK_STATE;
 			indigo_update_property(device, AUX_DEW_CONTROL_PROPERTY, NULL);
+			indigo_poll_policy_refresh(device, &PRIVATE_DATA->aux_poll_policy, &PRIVATE_DATA->aux_timer);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(AUX_USB_PORT_PROPERTY, property)) {
@@ -969,6 +982,7 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 				AUX_USB_PORT_PROPERTY->state = INDIGO_ALERT_STATE;
 			}
 			indigo_update_property(device, AUX_USB_PORT_PROPERTY, NULL);
+			indigo_poll_policy_refresh(device, &PRIVATE_DATA->aux_poll_policy, &PRIVATE_DATA->aux_timer);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(X_AUX_HUB_PROPERTY, property)) {
@@ -978,6 +992,7 @@ static indigo_result aux_change_property(indigo_device *device, indigo_client *c
 			upb_command(device, X_AUX_HUB_ENABLED_ITEM->sw.value ? "PU:1" : "PU:0", response, sizeof(response));
 			X_AUX_HUB_PROPERTY->state = INDIGO_OK_STATE;
 			indigo_update_property(device, X_AUX_HUB_PROPERTY, NULL);
+			indigo_poll_policy_refresh(device, &PRIVATE_DATA->aux_poll_policy, &PRIVATE_DATA->aux_timer);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(X_AUX_REBOOT_PROPERTY, property)) {
@@ -1062,7 +1077,7 @@ static void focuser_timer_callback(indigo_device *device) {
 		indigo_update_property(device, FOCUSER_POSITION_PROPERTY, NULL);
 		indigo_update_property(device, FOCUSER_STEPS_PROPERTY, NULL);
 	}
-	indigo_reschedule_timer(device, 0.5, &PRIVATE_DATA->focuser_timer);
+	indigo_poll_policy_reschedule(device, &PRIVATE_DATA->focuser_poll_policy, &PRIVATE_DATA->focuser_timer);
 }
 
 static indigo_result focuser_attach(indigo_device *device) {
@@ -1179,6 +1194,8 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 					FOCUSER_SPEED_ITEM->number.value = atol(response);
 				}
 				upb_command(device, "PL:1", response, sizeof(response));
+				indigo_init_poll_policy(&PRIVATE_DATA->focuser_poll_policy, 0.5, 1, 5);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->focuser_poll_policy, FOCUSER_POSITION_PROPERTY);
 				PRIVATE_DATA->focuser_timer = indigo_set_timer(device, 0, focuser_timer_callback);
 				CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 			} else {
@@ -1225,6 +1242,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 		}
 		indigo_update_property(device, FOCUSER_POSITION_PROPERTY, NULL);
 		indigo_update_property(device, FOCUSER_STEPS_PROPERTY, NULL);
+		indigo_poll_policy_refresh(device, &PRIVATE_DATA->focuser_poll_policy, &PRIVATE_DATA->focuser_timer);
 		return INDIGO_OK;
 	} else if (indigo_property_match(FOCUSER_POSITION_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- FOCUSER_POSITION
@@ -1240,6 +1258,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 			}
 			indigo_update_property(device, FOCUSER_STEPS_PROPERTY, NULL);
 			indigo_update_property(device, FOCUSER_POSITION_PROPERTY, NULL);
+			indigo_poll_policy_refresh(device, &PRIVATE_DATA->focuser_poll_policy, &PRIVATE_DATA->focuser_timer);
 		} else if (FOCUSER_ON_POSITION_SET_SYNC_ITEM->sw.value) {
 			snprintf(command, sizeof(command), "SC:%d", (int)FOCUSER_POSITION_ITEM->number.value);
 			if (upb_command(device, command,  response, sizeof(response))) {
@@ -1261,6 +1280,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 				FOCUSER_STEPS_PROPERTY->state = INDIGO_ALERT_STATE;
 				indigo_update_property(device, FOCUSER_POSITION_PROPERTY, NULL);
 				indigo_update_property(device, FOCUSER_STEPS_PROPERTY, NULL);
+				indigo_poll_policy_refresh(device, &PRIVATE_DATA->focuser_poll_policy, &PRIVATE_DATA->focuser_timer);
 			} else {
 				FOCUSER_ABORT_MOTION_PROPERTY->state = INDIGO_ALERT_STATE;
 			}
@@ -24,7 +24,7 @@
  \file indigo_ccd_apogee.cpp
  */
 
-#define DRIVER_VERSION 0x0005
+#define DRIVER_VERSION 0x0006
 #define DRIVER_NAME	   "indigo_ccd_apogee"
 
 #include <stdlib.h>
@@ -1443,25 +1443,12 @@ static void process_unplug_event(indigo_device *unused) {
 }
 
 
-static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
-
-	struct libusb_device_descriptor descriptor;
-
-	switch (event) {
-		case LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED: {
-			libusb_get_device_descriptor(dev, &descriptor);
-			if (descriptor.idVendor != UsbFrmwr::APOGEE_VID)
-				break;
-			indigo_set_timer(NULL, 0.5, process_plug_event);
-			break;
-		}
-		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
-			indigo_set_timer(NULL, 0.5, process_unplug_event);
-			break;
-		}
-	}
-	return 0;
-};
+static void hotplug_callback(bool arrived, struct libusb_device **devices, int count) {
+	if (arrived)
+		process_plug_event(NULL);
+	else
+		process_unplug_event(NULL);
+}
 
 
 static void remove_all_devices() {
@@ -1479,7 +1466,7 @@ static void remove_all_devices() {
 }
 
 
-static libusb_hotplug_callback_handle callback_handle;
+static int hotplug_handle = -1;
 
 extern char apogee_sysconfdir[2048];
 
@@ -1517,15 +1504,11 @@ indigo_result indigo_ccd_apogee(indigo_driver_action action, indigo_driver_info
 				apogee_ethernet->private_data = NULL;
 				indigo_attach_device(apogee_ethernet);
 
-				indigo_start_usb_event_handler();
-				int rc = libusb_hotplug_register_callback(NULL, (libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT), LIBUSB_HOTPLUG_ENUMERATE, UsbFrmwr::APOGEE_VID, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplug_callback, NULL, &callback_handle);
-				INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_register_callback ->  %s", rc < 0 ? libusb_error_name(rc) : "OK");
-				return rc >= 0 ? INDIGO_OK : INDIGO_FAILED;
+				return indigo_add_usb_hotplug_handler(DRIVER_NAME, UsbFrmwr::APOGEE_VID, NULL, 0, hotplug_callback, &hotplug_handle);
 			}
 			case INDIGO_DRIVER_SHUTDOWN: {
 				last_action = action;
-				libusb_hotplug_deregister_callback(NULL, callback_handle);
-				INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+				indigo_remove_usb_hotplug_handler(hotplug_handle);
 				remove_all_devices();
 				indigo_detach_device(apogee_ethernet);
 				free(apogee_ethernet);
@@ -24,7 +24,7 @@
  \file indigo_ccd_fli.c
  */
 
-#define DRIVER_VERSION 0x0008
+#define DRIVER_VERSION 0x0009
 #define DRIVER_NAME		"indigo_ccd_fli"
 
 #include <stdlib.h>
@@ -1060,25 +1060,14 @@ static void process_unplug_event(indigo_device *unused) {
 	pthread_mutex_unlock(&device_mutex);
 }
 
-static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
-
-	struct libusb_device_descriptor descriptor;
-
-	switch (event) {
-		case LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED: {
-			libusb_get_device_descriptor(dev, &descriptor);
-			if (descriptor.idVendor != FLI_VENDOR_ID)
-				break;
-			indigo_set_timer(NULL, 0.5, process_plug_event);
-			break;
-		}
-		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
-			indigo_set_timer(NULL, 0.5, process_unplug_event);
-			break;
-		}
+static void hotplug_callback(bool arrived, struct libusb_device **devices, int count) {
+	if (arrived) {
+		for (int i = 0; i < count; i++)
+			process_plug_event(NULL);
+	} else {
+		process_unplug_event(NULL);
 	}
-	return 0;
-};
+}
 
 static void remove_all_devices() {
 	int i;
@@ -1095,7 +1084,7 @@ static void remove_all_devices() {
 	}
 }
 
-static libusb_hotplug_callback_handle callback_handle;
+static int hotplug_handle = -1;
 
 extern void (*debug_ext)(int level, char *format, va_list arg);
 
@@ -1120,15 +1109,11 @@ indigo_result indigo_ccd_fli(indigo_driver_action action, indigo_driver_info *in
 		debug_ext = _debug_ext;
 		FLISetDebugLevel(NULL, FLIDEBUG_ALL);
 		last_action = action;
-		indigo_start_usb_event_handler();
-		int rc = libusb_hotplug_register_callback(NULL, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, LIBUSB_HOTPLUG_ENUMERATE, FLI_VENDOR_ID, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplug_callback, NULL, &callback_handle);
-		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_register_callback ->  %s", rc < 0 ? libusb_error_name(rc) : "OK");
-		return rc >= 0 ? INDIGO_OK : INDIGO_FAILED;
+		return indigo_add_usb_hotplug_handler(DRIVER_NAME, FLI_VENDOR_ID, NULL, 0, hotplug_callback, &hotplug_handle);
 
 	case INDIGO_DRIVER_SHUTDOWN:
 		last_action = action;
-		libusb_hotplug_deregister_callback(NULL, callback_handle);
-		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+		indigo_remove_usb_hotplug_handler(hotplug_handle);
 		remove_all_devices();
 		break;
 
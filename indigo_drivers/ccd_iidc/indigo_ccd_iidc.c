@@ -23,7 +23,7 @@
  \file indigo_ccd_iidc.c
  */
 
-#define DRIVER_VERSION 0x0005
+#define DRIVER_VERSION 0x0006
 #define DRIVER_NAME "indigo_ccd_iidc"
 
 #include <stdlib.h>
@@ -116,7 +116,6 @@ typedef struct {
 	dc1394bool_t temperature_is_present, gain_is_present, gamma_is_present;
 	indigo_timer *exposure_timer, *temperture_timer;
 	pthread_mutex_t mutex;
-	unsigned char *buffer;
 } iidc_private_data;
 
 static void stop_camera(indigo_device *device) {
@@ -197,6 +196,28 @@ static bool setup_feature(indigo_device *device, indigo_item *item, dc1394featur
 
 // -------------------------------------------------------------------------------- INDIGO CCD device implementation
 
+// Frame is converted from DMA ring directly to pooled image buffer, the ring slot is re-enqueued once conversion is done
+
+static void process_frame(indigo_device *device, dc1394video_frame_t *frame) {
+	assert(frame->image != NULL);
+	int width = frame->size[0];
+	int height = frame->size[1];
+	int bpp = frame->data_depth;
+	bool little_endian = frame->little_endian;
+	unsigned char *buffer;
+	if (frame->color_coding == DC1394_COLOR_CODING_YUV411 || frame->color_coding == DC1394_COLOR_CODING_YUV422 || frame->color_coding == DC1394_COLOR_CODING_YUV444) {
+		buffer = indigo_frame_buffer(device, NULL, 3UL * width * height);
+		dc1394_convert_to_RGB8(frame->image, buffer + FITS_HEADER_SIZE, width, height, frame->yuv_byte_order, frame->color_coding, 0);
+		bpp = 24;
+	} else {
+		buffer = indigo_frame_buffer(device, NULL, frame->image_bytes);
+		memcpy(buffer + FITS_HEADER_SIZE, frame->image, frame->image_bytes);
+	}
+	dc1394error_t err = dc1394_capture_enqueue(PRIVATE_DATA->camera, frame);
+	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "dc1394_capture_enqueue() -> %s", dc1394_error_get_string(err));
+	indigo_process_image(device, buffer, width, height, bpp, little_endian, true, NULL);
+}
+
 static void exposure_timer_callback(indigo_device *device) {
 	PRIVATE_DATA->exposure_timer = NULL;
 	if (!CONNECTION_CONNECTED_ITEM->sw.value) return;
@@ -211,21 +232,7 @@ static void exposure_timer_callback(indigo_device *device) {
 			err = dc1394_capture_dequeue(PRIVATE_DATA->camera, DC1394_CAPTURE_POLICY_WAIT, &frame);
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "dc1394_capture_dequeue() -> %s", dc1394_error_get_string(err));
 			if (err == DC1394_SUCCESS) {
-        void *data = frame->image;
-        assert(data != NULL);
-        int width = frame->size[0];
-        int height = frame->size[1];
-        int size = frame->image_bytes;
-				int bpp = frame->data_depth;
-        if (frame->color_coding == DC1394_COLOR_CODING_YUV411 || frame->color_coding == DC1394_COLOR_CODING_YUV422 || frame->color_coding == DC1394_COLOR_CODING_YUV444) {
-          dc1394_convert_to_RGB8(data, PRIVATE_DATA->buffer + FITS_HEADER_SIZE, width, height, frame->yuv_byte_order, frame->color_coding, 0);
-					bpp = 24;
-        } else {
-          memcpy(PRIVATE_DATA->buffer + FITS_HEADER_SIZE, data, size);
-        }
-        err = dc1394_capture_enqueue(PRIVATE_DATA->camera, frame);
-        INDIGO_DRIVER_DEBUG(DRIVER_NAME, "dc1394_capture_enqueue() -> %s", dc1394_error_get_string(err));
-        indigo_process_image(device, PRIVATE_DATA->buffer, width, height, bpp, frame->little_endian, true, NULL);
+				process_frame(device, frame);
 				CCD_EXPOSURE_PROPERTY->state = INDIGO_OK_STATE;
 				indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
 			} else {
@@ -257,21 +264,7 @@ static void streaming_timer_callback(indigo_device *device) {
 			err = dc1394_capture_dequeue(PRIVATE_DATA->camera, DC1394_CAPTURE_POLICY_WAIT, &frame);
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "dc1394_capture_dequeue() -> %s", dc1394_error_get_string(err));
 			if (err == DC1394_SUCCESS) {
-        void *data = frame->image;
-        assert(data != NULL);
-        int width = frame->size[0];
-        int height = frame->size[1];
-        int size = frame->image_bytes;
-				int bpp = frame->data_depth;
-        if (frame->color_coding == DC1394_COLOR_CODING_YUV411 || frame->color_coding == DC1394_COLOR_CODING_YUV422 || frame->color_coding == DC1394_COLOR_CODING_YUV444) {
-          dc1394_convert_to_RGB8(data, PRIVATE_DATA->buffer + FITS_HEADER_SIZE, width, height, frame->yuv_byte_order, frame->color_coding, 0);
-					bpp = 24;
-        } else {
-          memcpy(PRIVATE_DATA->buffer + FITS_HEADER_SIZE, data, size);
-        }
-        err = dc1394_capture_enqueue(PRIVATE_DATA->camera, frame);
-        INDIGO_DRIVER_DEBUG(DRIVER_NAME, "dc1394_capture_enqueue() -> %s", dc1394_error_get_string(err));
-        indigo_process_image(device, PRIVATE_DATA->buffer, width, height, bpp, frame->little_endian, true, NULL);
+				process_frame(device, frame);
 			} else {
         if (frame != NULL) {
           err = dc1394_capture_enqueue(PRIVATE_DATA->camera, frame);
@@ -437,18 +430,12 @@ static indigo_result ccd_change_property(indigo_device *device, indigo_client *c
 		// -------------------------------------------------------------------------------- CONNECTION -> CCD_INFO, CCD_COOLER, CCD_TEMPERATURE
 		indigo_property_copy_values(CONNECTION_PROPERTY, property, false);
 		if (CONNECTION_CONNECTED_ITEM->sw.value) {
-			PRIVATE_DATA->buffer = indigo_alloc_blob_buffer(FITS_HEADER_SIZE + 2 * 3 * (CCD_INFO_WIDTH_ITEM->number.value + 8) * (CCD_INFO_HEIGHT_ITEM->number.value + 8));
-			assert(PRIVATE_DATA->buffer != NULL);
 			if (PRIVATE_DATA->temperature_is_present) {
 				PRIVATE_DATA->temperture_timer = indigo_set_timer(device, 0, ccd_temperature_callback);
 			}
 		} else {
 			indigo_cancel_timer(device, &PRIVATE_DATA->temperture_timer);
 			stop_camera(device);
-			if (PRIVATE_DATA->buffer != NULL) {
-				free(PRIVATE_DATA->buffer);
-				PRIVATE_DATA->buffer = NULL;
-			}
 		}
 		CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 	} else if (indigo_property_match(CCD_BIN_PROPERTY, property)) {
@@ -717,8 +704,6 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 						INDIGO_DRIVER_LOG(DRIVER_NAME, "Camera %s removed", private_data->camera->model);
 						indigo_detach_device(device);
 						dc1394_camera_free(private_data->camera);
-						if (private_data->buffer)
-							free(private_data->buffer);
 						free(private_data);
 						free(device);
 						devices[j] = NULL;
@@ -860,8 +845,6 @@ indigo_result indigo_ccd_iidc(indigo_driver_action action, indigo_driver_info *i
 			indigo_device *device = devices[j];
 			if (device != NULL) {
 				if (PRIVATE_DATA != NULL) {
-					if (PRIVATE_DATA->buffer)
-						free(PRIVATE_DATA->buffer);
 					free(PRIVATE_DATA);
 				}
 				indigo_detach_device(device);
@@ -24,7 +24,7 @@
  \file indigo_ccd_qsi.cpp
  */
 
-#define DRIVER_VERSION 0x0003
+#define DRIVER_VERSION 0x0004
 #define DRIVER_NAME		"indigo_ccd_qsi"
 
 #include <stdlib.h>
@@ -571,23 +571,12 @@ static void process_unplug_event(indigo_device *unused) {
 	pthread_mutex_unlock(&device_mutex);
 }
 
-static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
-	struct libusb_device_descriptor descriptor;
-	libusb_get_device_descriptor(dev, &descriptor);
-	switch (event) {
-		case LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED: {
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Hot-plug: vid=%x pid=%x", descriptor.idVendor, descriptor.idProduct);
-			indigo_set_timer(NULL, 0.5, process_plug_event);
-			break;
-		}
-		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Hot-unplug: vid=%x pid=%x", descriptor.idVendor, descriptor.idProduct);
-			indigo_set_timer(NULL, 0.5, process_unplug_event);
-			break;
-		}
-	}
-	return 0;
-};
+static void hotplug_callback(bool arrived, struct libusb_device **devices, int count) {
+	if (arrived)
+		process_plug_event(NULL);
+	else
+		process_unplug_event(NULL);
+}
 
 static void remove_all_devices() {
 	for (int i = 0; i < QSICamera::MAXCAMERAS; i++) {
@@ -603,7 +592,8 @@ static void remove_all_devices() {
 	}
 }
 
-static libusb_hotplug_callback_handle callback_handle;
+static int qsi_products[] = { QSI_PRODUCT_ID };
+static int hotplug_handle = -1;
 
 indigo_result indigo_ccd_qsi(indigo_driver_action action, indigo_driver_info *info) {
 	static indigo_driver_action last_action = INDIGO_DRIVER_SHUTDOWN;
@@ -622,15 +612,11 @@ indigo_result indigo_ccd_qsi(indigo_driver_action action, indigo_driver_info *in
 			cam.get_DriverInfo(info);
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "QSIAPI version: %s", info.c_str());
 			last_action = action;
-			indigo_start_usb_event_handler();
-			int rc = libusb_hotplug_register_callback(NULL, (libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT), LIBUSB_HOTPLUG_ENUMERATE, QSI_VENDOR_ID, QSI_PRODUCT_ID, LIBUSB_HOTPLUG_MATCH_ANY, hotplug_callback, NULL, &callback_handle);
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_register_callback ->  %s", rc < 0 ? libusb_error_name(rc) : "OK");
-			return rc >= 0 ? INDIGO_OK : INDIGO_FAILED;
+			return indigo_add_usb_hotplug_handler(DRIVER_NAME, QSI_VENDOR_ID, qsi_products, 1, hotplug_callback, &hotplug_handle);
 		}
 		case INDIGO_DRIVER_SHUTDOWN: {
 			last_action = action;
-			libusb_hotplug_deregister_callback(NULL, callback_handle);
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+			indigo_remove_usb_hotplug_handler(hotplug_handle);
 			remove_all_devices();
 			break;
 		}
@@ -23,15 +23,18 @@
  \file indigo_ccd_simulator.c
  */
 
-#define DRIVER_VERSION 0x0005
+#define DRIVER_VERSION 0x0006
 #define DRIVER_NAME	"indigo_ccd_simulator"
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
+#include <time.h>
 #include <assert.h>
 #include <pthread.h>
+#include <sys/time.h>
 
 #include "indigo_driver_xml.h"
 
@@ -46,11 +49,14 @@
 #define GUIDER_COS					0.5403023058681398
 #define AO_SIN							0.529919264233205
 #define AO_COS							0.848048096156426
+#define MAX_SENSOR_PIXELS		100000000
+#define STREAMING_SLICE			0.1
 
 // gp_bits is used as boolean
 #define is_connected                     gp_bits
 
 #define PRIVATE_DATA								((simulator_private_data *)device->private_data)
+#define RENDER_CONTEXT							(device == PRIVATE_DATA->guider ? &PRIVATE_DATA->guider_render : (device == PRIVATE_DATA->dslr ? &PRIVATE_DATA->dslr_render : &PRIVATE_DATA->imager_render))
 #define DSLR_PROGRAM_PROPERTY				PRIVATE_DATA->dslr_program_property
 #define DSLR_CAPTURE_MODE_PROPERTY	PRIVATE_DATA->dslr_capture_mode_property
 #define DSLR_APERTURE_PROPERTY			PRIVATE_DATA->dslr_aperture_property
@@ -63,9 +69,31 @@
 #define GUIDER_MODE_SUN_ITEM				(GUIDER_MODE_PROPERTY->items + 1)
 #define GUIDER_MODE_ECLIPSE_ITEM		(GUIDER_MODE_PROPERTY->items + 2)
 
+#define SIMULATOR_SETUP_PROPERTY_NAME		"SIMULATOR_SETUP"
+#define SIMULATOR_SETUP_WIDTH_ITEM_NAME		"WIDTH"
+#define SIMULATOR_SETUP_HEIGHT_ITEM_NAME	"HEIGHT"
+#define SIMULATOR_SETUP_FPS_ITEM_NAME			"FPS"
+
+#define SIMULATOR_SETUP_PROPERTY		PRIVATE_DATA->simulator_setup_property
+#define SIMULATOR_SETUP_WIDTH_ITEM	(SIMULATOR_SETUP_PROPERTY->items + 0)
+#define SIMULATOR_SETUP_HEIGHT_ITEM	(SIMULATOR_SETUP_PROPERTY->items + 1)
+#define SIMULATOR_SETUP_FPS_ITEM		(SIMULATOR_SETUP_PROPERTY->items + 2)
+
 extern unsigned short indigo_ccd_simulator_raw_image[];
 extern unsigned char indigo_ccd_simulator_rgb_image[];
 
+typedef struct {
+	uint32_t rng[4];
+	unsigned short gamma_lut[65536];
+	bool gamma_lut_valid;
+	int gamma_lut_gain, gamma_lut_offset;
+	double gamma_lut_gamma;
+	unsigned short *blur_buffer;
+	uint32_t *blur_sums;
+	long blur_size;
+	int blur_width;
+} simulator_render_context;
+
 typedef struct {
 	indigo_device *imager, *guider, *dslr;
 	indigo_property *dslr_program_property;
@@ -75,11 +103,14 @@ typedef struct {
 	indigo_property *dslr_compression_property;
 	indigo_property *dslr_iso_property;
 	indigo_property *guider_mode_property;
+	indigo_property *simulator_setup_property;
 
 	int star_x[STARS], star_y[STARS], star_a[STARS];
-	char imager_image[FITS_HEADER_SIZE + 3 * WIDTH * HEIGHT + 2880];
+	char *imager_image;
+	long imager_image_size;
 	char guider_image[FITS_HEADER_SIZE + 3 * WIDTH * HEIGHT + 2880];
 	char dslr_image[FITS_HEADER_SIZE + 3 * WIDTH * HEIGHT + 2880];
+	simulator_render_context imager_render, guider_render, dslr_render;
 	pthread_mutex_t image_mutex;
 	double target_temperature, current_temperature;
 	int current_slot;
@@ -93,68 +124,134 @@ typedef struct {
 
 // -------------------------------------------------------------------------------- INDIGO CCD device implementation
 
+// xoshiro128** by David Blackman and Sebastiano Vigna, per device state seeded by splitmix64, replaces locked rand()
+
+static inline uint32_t rotl(const uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t xoshiro_next(uint32_t *s) {
+	const uint32_t result = rotl(s[1] * 5, 7) * 9;
+	const uint32_t t = s[1] << 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+	return result;
+}
+
+static void xoshiro_seed(uint32_t *s, uint64_t seed) {
+	for (int i = 0; i < 4; i++) {
+		uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		s[i] = (uint32_t)((z ^ (z >> 31)) >> 32);
+	}
+}
+
+static double random_offset(simulator_render_context *render) {
+	return xoshiro_next(render->rng) / (double)UINT32_MAX / 10 - 0.1;
+}
+
+static double time_now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// gain, offset and gamma are applied through a table rebuilt only if any of them changes
+
+static unsigned short *gamma_lut(simulator_render_context *render, int gain, int offset, double gamma) {
+	if (!render->gamma_lut_valid || render->gamma_lut_gain != gain || render->gamma_lut_offset != offset || render->gamma_lut_gamma != gamma) {
+		for (int i = 0; i < 65536; i++) {
+			double value = i - offset;
+			if (value < 0)
+				value = 0;
+			value = gain * pow(value, gamma);
+			if (value > 65535)
+				value = 65535;
+			render->gamma_lut[i] = (unsigned short)value;
+		}
+		render->gamma_lut_gain = gain;
+		render->gamma_lut_offset = offset;
+		render->gamma_lut_gamma = gamma;
+		render->gamma_lut_valid = true;
+	}
+	return render->gamma_lut;
+}
+
 // gausian blur algorithm is based on the paper http://blog.ivank.net/fastest-gaussian-blur.html by Ivan Kuckir
+// division is replaced by 32.32 fixed point reciprocal and vertical pass runs over whole rows, so compiler can vectorise it
+
+#define BLUR_DIVIDE(value, reciprocal) ((unsigned short)(((uint64_t)(value) * (reciprocal) + 0x80000000ULL) >> 32))
 
-static void box_blur_h(unsigned short *scl, unsigned short *tcl, int w, int h, double r) {
-	double iarr = 1 / (r + r + 1);
+static void box_blur_h(const unsigned short *scl, unsigned short *tcl, int w, int h, int r, uint64_t reciprocal) {
 	for (int i = 0; i < h; i++) {
-		int ti = i * w, li = ti, ri = ti + r;
-		int fv = scl[ti], lv = scl[ti + w - 1], val = (r + 1) * fv;
-		for (int j = 0; j < r; j++)
-			val += scl[ti + j];
-		for (int j = 0  ; j <= r ; j++) {
-			val += scl[ri++] - fv;
-			tcl[ti++] = round(val * iarr);
+		const unsigned short *src = scl + (long)i * w;
+		unsigned short *dst = tcl + (long)i * w;
+		int li = 0, ri = r, j = 0;
+		int fv = src[0], lv = src[w - 1], val = (r + 1) * fv;
+		for (int k = 0; k < r; k++)
+			val += src[k];
+		for (; j <= r; j++) {
+			val += src[ri++] - fv;
+			dst[j] = BLUR_DIVIDE(val, reciprocal);
 		}
-		for (int j = r + 1; j < w-r; j++) {
-			val += scl[ri++] - scl[li++];
-			tcl[ti++] = round(val * iarr);
+		for (; j < w - r; j++) {
+			val += src[ri++] - src[li++];
+			dst[j] = BLUR_DIVIDE(val, reciprocal);
 		}
-		for (int j = w - r; j < w  ; j++) {
-			val += lv - scl[li++];
-			tcl[ti++] = round(val * iarr);
+		for (; j < w; j++) {
+			val += lv - src[li++];
+			dst[j] = BLUR_DIVIDE(val, reciprocal);
 		}
 	}
 }
 
-static void box_blur_t(unsigned short *scl, unsigned short *tcl, int w, int h, double r) {
-	double iarr = 1 / ( r + r + 1);
-	for (int i = 0; i < w; i++) {
-		int ti = i, li = ti, ri = ti + r * w;
-		int fv = scl[ti], lv = scl[ti + w * (h - 1)], val = (r + 1) * fv;
-		for (int j = 0; j < r; j++)
-			val += scl[ti + j * w];
-		for (int j = 0  ; j <= r ; j++) {
-			val += scl[ri] - fv;
-			tcl[ti] = round(val * iarr);
-			ri += w;
-			ti += w;
-		}
-		for (int j = r + 1; j<h-r; j++) {
-			val += scl[ri] - scl[li];
-			tcl[ti] = round(val*iarr);
-			li += w;
-			ri += w;
-			ti += w;
-		}
-		for (int j = h - r; j < h  ; j++) {
-			val += lv - scl[li];
-			tcl[ti] = round(val * iarr);
-			li += w;
-			ti += w;
+static void box_blur_t(const unsigned short *scl, unsigned short *tcl, uint32_t *sums, int w, int h, int r, uint64_t reciprocal) {
+	for (int x = 0; x < w; x++)
+		sums[x] = (r + 1) * scl[x];
+	for (int k = 0; k < r; k++) {
+		const unsigned short *row = scl + (long)(k < h ? k : h - 1) * w;
+		for (int x = 0; x < w; x++)
+			sums[x] += row[x];
+	}
+	for (int y = 0; y < h; y++) {
+		const unsigned short *add = scl + (long)(y + r < h ? y + r : h - 1) * w;
+		const unsigned short *sub = scl + (long)(y - r - 1 > 0 ? y - r - 1 : 0) * w;
+		unsigned short *dst = tcl + (long)y * w;
+		for (int x = 0; x < w; x++) {
+			sums[x] += add[x] - sub[x];
+			dst[x] = BLUR_DIVIDE(sums[x], reciprocal);
 		}
 	}
 }
 
-static void box_blur(unsigned short *scl, unsigned short *tcl, int w, int h, double r) {
-	int length = w * h;
-	for (int i = 0; i < length; i++)
-		tcl[i] = scl[i];
-	box_blur_h(tcl, scl, w, h, r);
-	box_blur_t(scl, tcl, w, h, r);
+static void box_blur(unsigned short *data, simulator_render_context *render, int w, int h, int r) {
+	int max_r = ((w < h ? w : h) - 1) / 2;
+	if (r > max_r)
+		r = max_r;
+	if (r <= 0)
+		return;
+	uint64_t reciprocal = ((1ULL << 32) + 2 * r) / (2 * r + 1);
+	box_blur_h(data, render->blur_buffer, w, h, r, reciprocal);
+	box_blur_t(render->blur_buffer, data, render->blur_sums, w, h, r, reciprocal);
 }
 
-static void gauss_blur(unsigned short *scl, unsigned short *tcl, int w, int h, double r) {
+static void gauss_blur(unsigned short *data, simulator_render_context *render, int w, int h, double r) {
+	long size = (long)w * h;
+	if (size > render->blur_size) {
+		render->blur_buffer = realloc(render->blur_buffer, size * sizeof(unsigned short));
+		assert(render->blur_buffer != NULL);
+		render->blur_size = size;
+	}
+	if (w > render->blur_width) {
+		render->blur_sums = realloc(render->blur_sums, w * sizeof(uint32_t));
+		assert(render->blur_sums != NULL);
+		render->blur_width = w;
+	}
 	double ideal = sqrt((12 * r * r / 3) + 1);
 	int wl = floor(ideal);
 	if (wl % 2 == 0)
@@ -162,147 +259,238 @@ static void gauss_blur(unsigned short *scl, unsigned short *tcl, int w, int h, d
 	int wu = wl + 2;
 	ideal = (12 * r * r - 3 * wl * wl - 12 * wl - 9)/(-4 * wl - 4);
 	int m = round(ideal);
-	int sizes[3];
 	for (int i = 0; i < 3; i++)
-		sizes[i] = i < m ? wl : wu;
-	box_blur(scl, tcl, w, h, (sizes[0] - 1) / 2);
-	box_blur(tcl, scl, w, h, (sizes[1] - 1) / 2);
-	box_blur(scl, tcl, w, h, (sizes[2] - 1) / 2);
+		box_blur(data, render, w, h, ((i < m ? wl : wu) - 1) / 2);
 }
 
-static void exposure_timer_callback(indigo_device *device) {
-	pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
-	if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE) {
-		CCD_EXPOSURE_ITEM->number.value = 0;
-		indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
-		simulator_private_data *private_data = PRIVATE_DATA;
-		if (device == PRIVATE_DATA->dslr) {
-			unsigned char *raw = (unsigned char *)(private_data->dslr_image+FITS_HEADER_SIZE);
-			int size = WIDTH * HEIGHT * 3;
-			for (int i = 0; i < size; i++) {
-				int rgb = indigo_ccd_simulator_rgb_image[i];
-				if (rgb < 0xF0)
-					raw[i] = rgb  + (rand() & 0x0F);
-				else
-					raw[i] = rgb;
-			}
-			indigo_process_image(device, private_data->dslr_image, WIDTH, HEIGHT, 24, true, true, NULL);
-		} else {
-			unsigned short *raw = (unsigned short *)((device == PRIVATE_DATA->guider ? private_data->guider_image : private_data->imager_image) + FITS_HEADER_SIZE);
-			int horizontal_bin = (int)CCD_BIN_HORIZONTAL_ITEM->number.value;
-			int vertical_bin = (int)CCD_BIN_VERTICAL_ITEM->number.value;
-			int frame_left = (int)CCD_FRAME_LEFT_ITEM->number.value / horizontal_bin;
-			int frame_top = (int)CCD_FRAME_TOP_ITEM->number.value / vertical_bin;
-			int frame_width = (int)CCD_FRAME_WIDTH_ITEM->number.value / horizontal_bin;
-			int frame_height = (int)CCD_FRAME_HEIGHT_ITEM->number.value / vertical_bin;
-			int size = frame_width * frame_height;
-			int gain = (int)(CCD_GAIN_ITEM->number.value / 100);
-			int offset = (int)CCD_OFFSET_ITEM->number.value;
-			double gamma = CCD_GAMMA_ITEM->number.value;
-			bool light_frame = CCD_FRAME_TYPE_LIGHT_ITEM->sw.value || CCD_FRAME_TYPE_FLAT_ITEM->sw.value;
-
-			if (device == PRIVATE_DATA->imager && light_frame) {
-				for (int j = 0; j < frame_height; j++) {
-					int jj = (frame_top + j) * vertical_bin;
-					for (int i = 0; i < frame_width; i++) {
-						raw[j * frame_width + i] = indigo_ccd_simulator_raw_image[jj * WIDTH + (frame_left + i) * horizontal_bin] + (rand() & 0x7F);
-					}
+static void release_render_context(simulator_render_context *render) {
+	if (render->blur_buffer != NULL)
+		free(render->blur_buffer);
+	if (render->blur_sums != NULL)
+		free(render->blur_sums);
+	render->blur_buffer = NULL;
+	render->blur_sums = NULL;
+	render->blur_size = 0;
+	render->blur_width = 0;
+}
+
+static void render_dslr_image(indigo_device *device) {
+	simulator_private_data *private_data = PRIVATE_DATA;
+	uint32_t *rng = private_data->dslr_render.rng;
+	unsigned char *raw = (unsigned char *)(private_data->dslr_image + FITS_HEADER_SIZE);
+	int size = WIDTH * HEIGHT * 3;
+	uint32_t noise = 0;
+	for (int i = 0; i < size; i++) {
+		if ((i & 7) == 0)
+			noise = xoshiro_next(rng);
+		int rgb = indigo_ccd_simulator_rgb_image[i];
+		if (rgb < 0xF0)
+			raw[i] = rgb + (noise & 0x0F);
+		else
+			raw[i] = rgb;
+		noise >>= 4;
+	}
+	indigo_process_image(device, private_data->dslr_image, WIDTH, HEIGHT, 24, true, true, NULL);
+}
+
+static void render_ccd_image(indigo_device *device) {
+	simulator_private_data *private_data = PRIVATE_DATA;
+	simulator_render_context *render = RENDER_CONTEXT;
+	char *image = device == private_data->guider ? private_data->guider_image : private_data->imager_image;
+	if (image == NULL)
+		return;
+	unsigned short *raw = (unsigned short *)(image + FITS_HEADER_SIZE);
+	int horizontal_bin = (int)CCD_BIN_HORIZONTAL_ITEM->number.value;
+	int vertical_bin = (int)CCD_BIN_VERTICAL_ITEM->number.value;
+	int frame_left = (int)CCD_FRAME_LEFT_ITEM->number.value / horizontal_bin;
+	int frame_top = (int)CCD_FRAME_TOP_ITEM->number.value / vertical_bin;
+	int frame_width = (int)CCD_FRAME_WIDTH_ITEM->number.value / horizontal_bin;
+	int frame_height = (int)CCD_FRAME_HEIGHT_ITEM->number.value / vertical_bin;
+	long size = (long)frame_width * frame_height;
+	bool light_frame = CCD_FRAME_TYPE_LIGHT_ITEM->sw.value || CCD_FRAME_TYPE_FLAT_ITEM->sw.value;
+	unsigned short *lut = gamma_lut(render, (int)(CCD_GAIN_ITEM->number.value / 100), (int)CCD_OFFSET_ITEM->number.value, CCD_GAMMA_ITEM->number.value);
+	uint32_t noise = 0;
+	if (device == private_data->imager) {
+		// sensors larger than the template image are tiled with it, noise and gamma table are applied in the same pass
+		for (int j = 0; j < frame_height; j++) {
+			unsigned short *dst = raw + (long)j * frame_width;
+			if (light_frame) {
+				const unsigned short *src = indigo_ccd_simulator_raw_image + ((frame_top + j) * vertical_bin % HEIGHT) * WIDTH;
+				int x = frame_left * horizontal_bin % WIDTH;
+				for (int i = 0; i < frame_width; i++) {
+					if ((i & 3) == 0)
+						noise = xoshiro_next(render->rng);
+					dst[i] = lut[(unsigned short)(src[x] + (noise & 0x7F))];
+					noise >>= 8;
+					if ((x += horizontal_bin) >= WIDTH)
+						x -= WIDTH;
 				}
 			} else {
-				for (int i = 0; i < size; i++)
-					raw[i] = (rand() & 0x7F);
+				for (int i = 0; i < frame_width; i++) {
+					if ((i & 3) == 0)
+						noise = xoshiro_next(render->rng);
+					dst[i] = lut[noise & 0x7F];
+					noise >>= 8;
+				}
 			}
-
-			if (device == PRIVATE_DATA->guider && light_frame) {
-				double x_offset = PRIVATE_DATA->guider_ra_offset * GUIDER_COS - PRIVATE_DATA->guider_dec_offset * GUIDER_SIN + PRIVATE_DATA->ao_ra_offset * AO_COS - PRIVATE_DATA->ao_dec_offset * AO_SIN + rand() / (double)RAND_MAX/10 - 0.1;
-				double y_offset = PRIVATE_DATA->guider_ra_offset * GUIDER_SIN + PRIVATE_DATA->guider_dec_offset * GUIDER_COS + PRIVATE_DATA->ao_ra_offset * AO_SIN + PRIVATE_DATA->ao_dec_offset * AO_COS + rand() / (double)RAND_MAX/10 - 0.1;
-				if (GUIDER_MODE_STARS_ITEM->sw.value) {
-					for (int i = 0; i < STARS; i++) {
-						double center_x = (private_data->star_x[i] + x_offset) / horizontal_bin;
-						if (center_x < 0)
-							center_x += WIDTH;
-						if (center_x >= WIDTH)
-							center_x -= WIDTH;
-						double center_y = (private_data->star_y[i] + y_offset) / vertical_bin;
-						if (center_y < 0)
-							center_y += HEIGHT;
-						if (center_y >= HEIGHT)
-							center_y -= HEIGHT;
-						center_x -= frame_left;
-						center_y -= frame_top;
-						int a = private_data->star_a[i];
-						int xMax = (int)round(center_x) + 4 / horizontal_bin;
-						int yMax = (int)round(center_y) + 4 / vertical_bin;
-						for (int y = yMax - 8 / vertical_bin; y <= yMax; y++) {
-							if (y < 0 || y >= frame_height)
-								continue;
-							int yw = y * frame_width;
-							double yy = center_y - y;
-							for (int x = xMax - 8 / horizontal_bin; x <= xMax; x++) {
-								if (x < 0 || x >= frame_width)
-									continue;
-								double xx = center_x - x;
-								double v = a * exp(-(xx * xx / 2.0 + yy * yy / 2.0));
-								raw[yw + x] += (unsigned short)v;
-							}
-						}
-					}
-				} else {
-					double center_x = (WIDTH / 2 + x_offset) / horizontal_bin - frame_left;
-					double center_y = (HEIGHT / 2 + y_offset) / vertical_bin - frame_top;
-					double eclipse_x = (WIDTH / 2 + PRIVATE_DATA->eclipse + x_offset) / horizontal_bin - frame_left;
-					double eclipse_y = (HEIGHT / 2 + PRIVATE_DATA->eclipse + y_offset) / vertical_bin - frame_top;
-					for (int y = 0; y <= HEIGHT / vertical_bin; y++) {
+		}
+	} else {
+		for (long i = 0; i < size; i++) {
+			if ((i & 3) == 0)
+				noise = xoshiro_next(render->rng);
+			raw[i] = noise & 0x7F;
+			noise >>= 8;
+		}
+		if (light_frame) {
+			double x_offset = private_data->guider_ra_offset * GUIDER_COS - private_data->guider_dec_offset * GUIDER_SIN + private_data->ao_ra_offset * AO_COS - private_data->ao_dec_offset * AO_SIN + random_offset(render);
+			double y_offset = private_data->guider_ra_offset * GUIDER_SIN + private_data->guider_dec_offset * GUIDER_COS + private_data->ao_ra_offset * AO_SIN + private_data->ao_dec_offset * AO_COS + random_offset(render);
+			if (GUIDER_MODE_STARS_ITEM->sw.value) {
+				for (int i = 0; i < STARS; i++) {
+					double center_x = (private_data->star_x[i] + x_offset) / horizontal_bin;
+					if (center_x < 0)
+						center_x += WIDTH;
+					if (center_x >= WIDTH)
+						center_x -= WIDTH;
+					double center_y = (private_data->star_y[i] + y_offset) / vertical_bin;
+					if (center_y < 0)
+						center_y += HEIGHT;
+					if (center_y >= HEIGHT)
+						center_y -= HEIGHT;
+					center_x -= frame_left;
+					center_y -= frame_top;
+					int a = private_data->star_a[i];
+					int xMax = (int)round(center_x) + 4 / horizontal_bin;
+					int yMax = (int)round(center_y) + 4 / vertical_bin;
+					for (int y = yMax - 8 / vertical_bin; y <= yMax; y++) {
 						if (y < 0 || y >= frame_height)
 							continue;
 						int yw = y * frame_width;
-						double yy = (center_y - y) * vertical_bin;
-						double eclipse_yy = (eclipse_y - y) * vertical_bin;
-						for (int x = 0; x <= WIDTH / horizontal_bin; x++) {
+						double yy = center_y - y;
+						for (int x = xMax - 8 / horizontal_bin; x <= xMax; x++) {
 							if (x < 0 || x >= frame_width)
 								continue;
-							double xx = (center_x - x) * horizontal_bin;
-							double eclipse_xx = (eclipse_x - x) * horizontal_bin;
-							double value = 500000 * exp(-((xx * xx + yy * yy) / 20000.0));
-							if (GUIDER_MODE_ECLIPSE_ITEM->sw.value && eclipse_xx*eclipse_xx+eclipse_yy*eclipse_yy < 50000)
-								value = 0;
-							if (value < 65535)
-								raw[yw + x] += (unsigned short)value;
-							else
-								raw[yw + x] = 65535;
+							double xx = center_x - x;
+							double v = a * exp(-(xx * xx / 2.0 + yy * yy / 2.0));
+							raw[yw + x] += (unsigned short)v;
 						}
 					}
-					if (GUIDER_MODE_ECLIPSE_ITEM->sw.value) {
-						PRIVATE_DATA->eclipse++;
-						if (PRIVATE_DATA->eclipse > ECLIPSE)
-							PRIVATE_DATA->eclipse = -ECLIPSE;
+				}
+			} else {
+				double center_x = (WIDTH / 2 + x_offset) / horizontal_bin - frame_left;
+				double center_y = (HEIGHT / 2 + y_offset) / vertical_bin - frame_top;
+				double eclipse_x = (WIDTH / 2 + private_data->eclipse + x_offset) / horizontal_bin - frame_left;
+				double eclipse_y = (HEIGHT / 2 + private_data->eclipse + y_offset) / vertical_bin - frame_top;
+				for (int y = 0; y <= HEIGHT / vertical_bin; y++) {
+					if (y < 0 || y >= frame_height)
+						continue;
+					int yw = y * frame_width;
+					double yy = (center_y - y) * vertical_bin;
+					double eclipse_yy = (eclipse_y - y) * vertical_bin;
+					for (int x = 0; x <= WIDTH / horizontal_bin; x++) {
+						if (x < 0 || x >= frame_width)
+							continue;
+						double xx = (center_x - x) * horizontal_bin;
+						double eclipse_xx = (eclipse_x - x) * horizontal_bin;
+						double value = 500000 * exp(-((xx * xx + yy * yy) / 20000.0));
+						if (GUIDER_MODE_ECLIPSE_ITEM->sw.value && eclipse_xx*eclipse_xx+eclipse_yy*eclipse_yy < 50000)
+							value = 0;
+						if (value < 65535)
+							raw[yw + x] += (unsigned short)value;
+						else
+							raw[yw + x] = 65535;
 					}
-
+				}
+				if (GUIDER_MODE_ECLIPSE_ITEM->sw.value) {
+					private_data->eclipse++;
+					if (private_data->eclipse > ECLIPSE)
+						private_data->eclipse = -ECLIPSE;
 				}
 			}
-			for (int i = 0; i < size; i++) {
-				double value = raw[i] - offset;
-				if (value < 0)
-					value = 0;
-				value = gain * pow(value, gamma);
-				if (value > 65535)
-					value = 65535;
-				raw[i] = (unsigned short)value;
-			}
-			if (private_data->current_position != 0) {
-				unsigned short *tmp = malloc(2 * size);
-				gauss_blur(raw, tmp, frame_width, frame_height, private_data->current_position);
-				memcpy(raw, tmp, 2 * size);
-				free(tmp);
-			}
-			indigo_process_image(device, device == PRIVATE_DATA->guider ? private_data->guider_image : private_data->imager_image, frame_width, frame_height, 16, true, true, NULL);
 		}
+		for (long i = 0; i < size; i++)
+			raw[i] = lut[raw[i]];
+	}
+	if (private_data->current_position != 0)
+		gauss_blur(raw, render, frame_width, frame_height, private_data->current_position);
+	indigo_process_image(device, image, frame_width, frame_height, 16, true, true, NULL);
+}
+
+static void exposure_timer_callback(indigo_device *device) {
+	pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
+	if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE) {
+		CCD_EXPOSURE_ITEM->number.value = 0;
+		indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
+		if (device == PRIVATE_DATA->dslr)
+			render_dslr_image(device);
+		else
+			render_ccd_image(device);
 		CCD_EXPOSURE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
 	}
 	pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
 }
 
+// frames are delivered on a fixed schedule given by streaming exposure or SIMULATOR_SETUP.FPS, whichever is slower
+
+static void streaming_timer_callback(indigo_device *device) {
+	double period = CCD_STREAMING_EXPOSURE_ITEM->number.value;
+	if (device == PRIVATE_DATA->imager && SIMULATOR_SETUP_FPS_ITEM->number.value > 0 && 1 / SIMULATOR_SETUP_FPS_ITEM->number.value > period)
+		period = 1 / SIMULATOR_SETUP_FPS_ITEM->number.value;
+	double deadline = time_now();
+	while (CCD_STREAMING_COUNT_ITEM->number.value != 0 && IS_CONNECTED) {
+		deadline += period;
+		double delay;
+		while ((delay = deadline - time_now()) > 0 && CCD_STREAMING_COUNT_ITEM->number.value != 0)
+			usleep(1000000 * (delay < STREAMING_SLICE ? delay : STREAMING_SLICE));
+		if (CCD_STREAMING_COUNT_ITEM->number.value == 0)
+			break;
+		pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
+		if (device == PRIVATE_DATA->dslr)
+			render_dslr_image(device);
+		else
+			render_ccd_image(device);
+		pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
+		if (CCD_STREAMING_PROPERTY->state != INDIGO_BUSY_STATE)
+			break;
+		if (CCD_STREAMING_COUNT_ITEM->number.value > 0)
+			CCD_STREAMING_COUNT_ITEM->number.value -= 1;
+		indigo_update_property(device, CCD_STREAMING_PROPERTY, NULL);
+		// don't burst frames to catch up if rendering is slower than requested rate
+		if (time_now() > deadline + period)
+			deadline = time_now();
+	}
+	CCD_STREAMING_COUNT_ITEM->number.value = 0;
+	if (CCD_STREAMING_PROPERTY->state == INDIGO_BUSY_STATE)
+		CCD_STREAMING_PROPERTY->state = INDIGO_OK_STATE;
+	indigo_update_property(device, CCD_STREAMING_PROPERTY, NULL);
+}
+
+// imager sensor geometry follows SIMULATOR_SETUP, image buffer is reallocated under image mutex
+
+static bool setup_imager_sensor(indigo_device *device, int width, int height) {
+	long size = FITS_HEADER_SIZE + 2L * width * height + 2880;
+	pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
+	if (size > PRIVATE_DATA->imager_image_size) {
+		char *image = indigo_alloc_blob_buffer(size);
+		if (image == NULL) {
+			pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
+			return false;
+		}
+		if (PRIVATE_DATA->imager_image != NULL)
+			free(PRIVATE_DATA->imager_image);
+		PRIVATE_DATA->imager_image = image;
+		PRIVATE_DATA->imager_image_size = size;
+	}
+	CCD_INFO_WIDTH_ITEM->number.value = CCD_FRAME_WIDTH_ITEM->number.max = CCD_FRAME_LEFT_ITEM->number.max = CCD_FRAME_WIDTH_ITEM->number.value = width;
+	CCD_INFO_HEIGHT_ITEM->number.value = CCD_FRAME_HEIGHT_ITEM->number.max = CCD_FRAME_TOP_ITEM->number.max = CCD_FRAME_HEIGHT_ITEM->number.value = height;
+	CCD_FRAME_LEFT_ITEM->number.value = CCD_FRAME_TOP_ITEM->number.value = 0;
+	sprintf(CCD_MODE_ITEM->label, "RAW %dx%d", width, height);
+	sprintf((CCD_MODE_ITEM + 1)->label, "RAW %dx%d", width / 2, height / 2);
+	sprintf((CCD_MODE_ITEM + 2)->label, "RAW %dx%d", width / 4, height / 4);
+	pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
+	return true;
+}
+
 static void ccd_temperature_callback(indigo_device *device) {
 	double diff = PRIVATE_DATA->current_temperature - PRIVATE_DATA->target_temperature;
 	if (diff > 0) {
@@ -357,6 +545,9 @@ static indigo_result ccd_attach(indigo_device *device) {
 		SIMULATION_PROPERTY->perm = INDIGO_RO_PERM;
 		SIMULATION_ENABLED_ITEM->sw.value = true;
 		SIMULATION_DISABLED_ITEM->sw.value = false;
+		xoshiro_seed(RENDER_CONTEXT->rng, (uint64_t)time(NULL) ^ (uintptr_t)device);
+		// -------------------------------------------------------------------------------- CCD_STREAMING
+		CCD_STREAMING_PROPERTY->hidden = false;
 		if (device == PRIVATE_DATA->dslr) {
 			DSLR_PROGRAM_PROPERTY = indigo_init_switch_property(NULL, device->name, DSLR_PROGRAM_PROPERTY_NAME, "DSLR", "Program mode", INDIGO_OK_STATE, INDIGO_RO_PERM, INDIGO_ONE_OF_MANY_RULE, 1);
 			indigo_init_switch_item(DSLR_PROGRAM_PROPERTY->items + 0, "M", "Manual", true);
@@ -422,6 +613,15 @@ static indigo_result ccd_attach(indigo_device *device) {
 			indigo_init_switch_item(CCD_MODE_ITEM+1, "BIN_2x2", name, false);
 			sprintf(name, "RAW %dx%d", WIDTH/4, HEIGHT/4);
 			indigo_init_switch_item(CCD_MODE_ITEM+2, "BIN_4x4", name, false);
+			if (device == PRIVATE_DATA->imager) {
+				// -------------------------------------------------------------------------------- SIMULATOR_SETUP
+				SIMULATOR_SETUP_PROPERTY = indigo_init_number_property(NULL, device->name, SIMULATOR_SETUP_PROPERTY_NAME, MAIN_GROUP, "Simulator setup", INDIGO_OK_STATE, INDIGO_RW_PERM, 3);
+				indigo_init_number_item(SIMULATOR_SETUP_WIDTH_ITEM, SIMULATOR_SETUP_WIDTH_ITEM_NAME, "Sensor width (px)", 64, 20000, 1, WIDTH);
+				indigo_init_number_item(SIMULATOR_SETUP_HEIGHT_ITEM, SIMULATOR_SETUP_HEIGHT_ITEM_NAME, "Sensor height (px)", 64, 20000, 1, HEIGHT);
+				indigo_init_number_item(SIMULATOR_SETUP_FPS_ITEM, SIMULATOR_SETUP_FPS_ITEM_NAME, "Streaming rate limit (fps, 0 = exposure)", 0, 1000, 1, 0);
+				if (!setup_imager_sensor(device, WIDTH, HEIGHT))
+					return INDIGO_FAILED;
+			}
 			CCD_INFO_PIXEL_SIZE_ITEM->number.value = 5.2;
 			CCD_INFO_PIXEL_WIDTH_ITEM->number.value = 5.2;
 			CCD_INFO_PIXEL_HEIGHT_ITEM->number.value = 5.2;
@@ -476,6 +676,10 @@ indigo_result ccd_enumerate_properties(indigo_device *device, indigo_client *cli
 			if (indigo_property_match(GUIDER_MODE_PROPERTY, property))
 				indigo_define_property(device, GUIDER_MODE_PROPERTY, NULL);
 		}
+		if (device == PRIVATE_DATA->imager) {
+			if (indigo_property_match(SIMULATOR_SETUP_PROPERTY, property))
+				indigo_define_property(device, SIMULATOR_SETUP_PROPERTY, NULL);
+		}
 	}
 	return result;
 }
@@ -524,13 +728,30 @@ static indigo_result ccd_change_property(indigo_device *device, indigo_client *c
 		}
 	} else if (indigo_property_match(CCD_EXPOSURE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CCD_EXPOSURE
-		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE)
+		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE || CCD_STREAMING_PROPERTY->state == INDIGO_BUSY_STATE)
 			return INDIGO_OK;
 		indigo_property_copy_values(CCD_EXPOSURE_PROPERTY, property, false);
 		indigo_use_shortest_exposure_if_bias(device);
 		CCD_EXPOSURE_PROPERTY->state = INDIGO_BUSY_STATE;
 		indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
 		PRIVATE_DATA->exposure_timer = indigo_set_timer(device, CCD_EXPOSURE_ITEM->number.value > 0 ? CCD_EXPOSURE_ITEM->number.value : 0.1, exposure_timer_callback);
+	} else if (indigo_property_match(CCD_STREAMING_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_STREAMING
+		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE || CCD_STREAMING_PROPERTY->state == INDIGO_BUSY_STATE)
+			return INDIGO_OK;
+		indigo_property_copy_values(CCD_STREAMING_PROPERTY, property, false);
+		indigo_use_shortest_exposure_if_bias(device);
+		CCD_STREAMING_PROPERTY->state = INDIGO_BUSY_STATE;
+		indigo_update_property(device, CCD_STREAMING_PROPERTY, NULL);
+		if (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value) {
+			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_BUSY_STATE;
+			indigo_update_property(device, CCD_IMAGE_FILE_PROPERTY, NULL);
+		} else {
+			CCD_IMAGE_PROPERTY->state = INDIGO_BUSY_STATE;
+			indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
+		}
+		PRIVATE_DATA->exposure_timer = indigo_set_timer(device, 0, streaming_timer_callback);
+		return INDIGO_OK;
 	} else if (indigo_property_match(CCD_ABORT_EXPOSURE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CCD_ABORT_EXPOSURE
 		indigo_property_copy_values(CCD_ABORT_EXPOSURE_PROPERTY, property, false);
@@ -602,6 +823,36 @@ static indigo_result ccd_change_property(indigo_device *device, indigo_client *c
 		GUIDER_MODE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, GUIDER_MODE_PROPERTY, NULL);
 		return INDIGO_OK;
+	} else if (SIMULATOR_SETUP_PROPERTY && indigo_property_match(SIMULATOR_SETUP_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- SIMULATOR_SETUP
+		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE || CCD_STREAMING_PROPERTY->state == INDIGO_BUSY_STATE) {
+			SIMULATOR_SETUP_PROPERTY->state = INDIGO_ALERT_STATE;
+			indigo_update_property(device, SIMULATOR_SETUP_PROPERTY, "Sensor can't be changed during exposure");
+			return INDIGO_OK;
+		}
+		int width = SIMULATOR_SETUP_WIDTH_ITEM->number.value;
+		int height = SIMULATOR_SETUP_HEIGHT_ITEM->number.value;
+		indigo_property_copy_values(SIMULATOR_SETUP_PROPERTY, property, false);
+		SIMULATOR_SETUP_PROPERTY->state = INDIGO_OK_STATE;
+		if (width != (int)SIMULATOR_SETUP_WIDTH_ITEM->number.value || height != (int)SIMULATOR_SETUP_HEIGHT_ITEM->number.value) {
+			if (SIMULATOR_SETUP_WIDTH_ITEM->number.value * SIMULATOR_SETUP_HEIGHT_ITEM->number.value > MAX_SENSOR_PIXELS || !setup_imager_sensor(device, SIMULATOR_SETUP_WIDTH_ITEM->number.value, SIMULATOR_SETUP_HEIGHT_ITEM->number.value)) {
+				SIMULATOR_SETUP_WIDTH_ITEM->number.value = width;
+				SIMULATOR_SETUP_HEIGHT_ITEM->number.value = height;
+				SIMULATOR_SETUP_PROPERTY->state = INDIGO_ALERT_STATE;
+				indigo_update_property(device, SIMULATOR_SETUP_PROPERTY, "Sensor size is limited to %d MP", MAX_SENSOR_PIXELS / 1000000);
+				return INDIGO_OK;
+			}
+			if (IS_CONNECTED) {
+				indigo_delete_property(device, CCD_INFO_PROPERTY, NULL);
+				indigo_delete_property(device, CCD_FRAME_PROPERTY, NULL);
+				indigo_delete_property(device, CCD_MODE_PROPERTY, NULL);
+				indigo_define_property(device, CCD_INFO_PROPERTY, NULL);
+				indigo_define_property(device, CCD_FRAME_PROPERTY, NULL);
+				indigo_define_property(device, CCD_MODE_PROPERTY, NULL);
+			}
+		}
+		indigo_update_property(device, SIMULATOR_SETUP_PROPERTY, NULL);
+		return INDIGO_OK;
 		// --------------------------------------------------------------------------------
 	}
 	return indigo_ccd_change_property(device, client, property);
@@ -622,7 +873,18 @@ static indigo_result ccd_detach(indigo_device *device) {
 		indigo_release_property(DSLR_ISO_PROPERTY);
 	} else if (device == PRIVATE_DATA->guider) {
 		indigo_release_property(GUIDER_MODE_PROPERTY);
+	} else if (device == PRIVATE_DATA->imager) {
+		indigo_release_property(SIMULATOR_SETUP_PROPERTY);
+		SIMULATOR_SETUP_PROPERTY = NULL;
 	}
+	pthread_mutex_lock(&PRIVATE_DATA->image_mutex);
+	if (device == PRIVATE_DATA->imager && PRIVATE_DATA->imager_image != NULL) {
+		free(PRIVATE_DATA->imager_image);
+		PRIVATE_DATA->imager_image = NULL;
+		PRIVATE_DATA->imager_image_size = 0;
+	}
+	release_render_context(RENDER_CONTEXT);
+	pthread_mutex_unlock(&PRIVATE_DATA->image_mutex);
 	INDIGO_DEVICE_DETACH_LOG(DRIVER_NAME, device->name);
 	return indigo_ccd_detach(device);
 }
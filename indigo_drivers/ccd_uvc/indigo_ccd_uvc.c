@@ -23,7 +23,7 @@
  \file indigo_ccd_uvc.c
  */
 
-#define DRIVER_VERSION 0x0001
+#define DRIVER_VERSION 0x0002
 #define DRIVER_NAME "indigo_ccd_uvc"
 
 #include <stdlib.h>
@@ -60,25 +60,57 @@ typedef struct {
 	enum uvc_frame_format format;
 	uvc_stream_ctrl_t ctrl;
 	uvc_stream_handle_t *strmhp;
-	char *buffer;
 } uvc_private_data;
 
 // -------------------------------------------------------------------------------- INDIGO CCD device implementation
 
+// MJPEG frames may omit Huffman tables (libuvc inserts the default ones while decoding), such frames are not valid JPEG files
+
+static bool has_huffman_tables(unsigned char *data, size_t size) {
+	if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+		return false;
+	size_t i = 2;
+	while (i + 4 <= size && data[i] == 0xFF) {
+		unsigned char marker = data[i + 1];
+		if (marker == 0xC4)
+			return true;
+		if (marker == 0xDA)
+			return false;
+		i += 2 + (data[i + 2] << 8 | data[i + 3]);
+	}
+	return false;
+}
+
 static void exposure_timer_callback(indigo_device *device) {
 	uvc_frame_t *frame;
 	uvc_error_t res = uvc_stream_get_frame(PRIVATE_DATA->strmhp, &frame, 0);
 	if (res != UVC_SUCCESS) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "uvc_stream_get_frame() -> %s", uvc_strerror(res));
 		CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
+	} else if (frame->frame_format == UVC_FRAME_FORMAT_MJPEG && indigo_ccd_jpeg_passthrough(device) && has_huffman_tables(frame->data, frame->data_bytes)) {
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "uvc_stream_get_frame() -> %s, passing %ld bytes of MJPEG frame through", uvc_strerror(res), (long)frame->data_bytes);
+		void *jpeg = indigo_frame_buffer(device, NULL, frame->data_bytes);
+		memcpy(jpeg, frame->data, frame->data_bytes);
+		indigo_process_dslr_image(device, jpeg, (int)frame->data_bytes, ".jpeg");
+		CCD_EXPOSURE_PROPERTY->state = INDIGO_OK_STATE;
 	} else {
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "uvc_stream_get_frame() -> %s", uvc_strerror(res));
-		uvc_frame_t *rgb = uvc_allocate_frame(3 * frame->width + frame->height);
-		res = uvc_any2rgb(frame, rgb);
-		memcpy(PRIVATE_DATA->buffer + FITS_HEADER_SIZE, rgb->data, 3 * frame->width * frame->height);
-		uvc_free_frame(rgb);
-		indigo_process_image(device, PRIVATE_DATA->buffer, rgb->width, rgb->height, 24, true, true, NULL);
-		CCD_EXPOSURE_PROPERTY->state = INDIGO_OK_STATE;
+		// convert directly from stream buffer to pooled image buffer
+		uvc_frame_t rgb = { 0 };
+		rgb.data_bytes = 3 * frame->width * frame->height;
+		rgb.data = (char *)indigo_frame_buffer(device, NULL, rgb.data_bytes) + FITS_HEADER_SIZE;
+		rgb.library_owns_data = 0;
+		if (frame->frame_format == UVC_FRAME_FORMAT_MJPEG)
+			res = uvc_mjpeg2rgb(frame, &rgb);
+		else
+			res = uvc_any2rgb(frame, &rgb);
+		if (res != UVC_SUCCESS) {
+			INDIGO_DRIVER_ERROR(DRIVER_NAME, "uvc_any2rgb() -> %s", uvc_strerror(res));
+			CCD_EXPOSURE_PROPERTY->state = INDIGO_ALERT_STATE;
+		} else {
+			indigo_process_image(device, (char *)rgb.data - FITS_HEADER_SIZE, rgb.width, rgb.height, 24, true, true, NULL);
+			CCD_EXPOSURE_PROPERTY->state = INDIGO_OK_STATE;
+		}
 	}
 	indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
 	uvc_stream_close(PRIVATE_DATA->strmhp);
@@ -118,6 +150,7 @@ static struct {
 	{ UVC_FRAME_FORMAT_SGBRG8, "GBRG", "RGB24  %dx%d" },
 	{ UVC_FRAME_FORMAT_SRGGB8, "RGGB", "RGB24  %dx%d" },
 	{ UVC_FRAME_FORMAT_SBGGR8, "BGGR", "RGB24  %dx%d" },
+	{ UVC_FRAME_FORMAT_MJPEG, "MJPG", "MJPEG %dx%d" },
 	{ UVC_FRAME_FORMAT_ANY, "    ", "%dx%d" }
 };
 
@@ -148,10 +181,10 @@ static indigo_result ccd_change_property(indigo_device *device, indigo_client *c
 								break;
 							}
 						}
-						if (format->bDescriptorSubtype == UVC_VS_FORMAT_UNCOMPRESSED) {
+						if (format->bDescriptorSubtype == UVC_VS_FORMAT_UNCOMPRESSED || format->bDescriptorSubtype == UVC_VS_FORMAT_MJPEG) {
 							uvc_frame_desc_t *frame = format->frame_descs;
 							while (frame) {
-								if (frame->bDescriptorSubtype == UVC_VS_FRAME_UNCOMPRESSED) {
+								if (frame->bDescriptorSubtype == UVC_VS_FRAME_UNCOMPRESSED || frame->bDescriptorSubtype == UVC_VS_FRAME_MJPEG) {
 									if (CCD_INFO_WIDTH_ITEM->number.value < frame->wWidth)
 										CCD_INFO_WIDTH_ITEM->number.value = frame->wWidth;
 									if (CCD_INFO_HEIGHT_ITEM->number.value < frame->wHeight)
@@ -175,7 +208,6 @@ static indigo_result ccd_change_property(indigo_device *device, indigo_client *c
 						}
 						format = format->next;
 					}
-					PRIVATE_DATA->buffer = malloc(FITS_HEADER_SIZE + (int)CCD_INFO_WIDTH_ITEM->number.value * (int)CCD_INFO_HEIGHT_ITEM->number.value * 3);
 				}
 			}
 		} else {
@@ -183,9 +215,6 @@ static indigo_result ccd_change_property(indigo_device *device, indigo_client *c
 				uvc_close(PRIVATE_DATA->handle);
 				INDIGO_DRIVER_DEBUG(DRIVER_NAME, "uvc_close() -> %s");
 				PRIVATE_DATA->handle = 0;
-				if (PRIVATE_DATA->buffer)
-					free(PRIVATE_DATA->buffer);
-				PRIVATE_DATA->buffer = NULL;
 			}
 		}
 	} else if (indigo_property_match(CCD_MODE_PROPERTY, property)) {
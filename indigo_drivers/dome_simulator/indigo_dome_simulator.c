@@ -23,7 +23,7 @@
  \file indigo_dome_simulator.c
  */
 
-#define DRIVER_VERSION 0x0001
+#define DRIVER_VERSION 0x0002
 #define DRIVER_NAME	"indigo_dome_simulator"
 
 #include <stdlib.h>
@@ -52,6 +52,10 @@ static void dome_timer_callback(indigo_device *device) {
 		indigo_update_property(device, DOME_HORIZONTAL_COORDINATES_PROPERTY, NULL);
 		DOME_STEPS_PROPERTY->state = INDIGO_ALERT_STATE;
 		indigo_update_property(device, DOME_STEPS_PROPERTY, NULL);
+		if (DOME_EQUATORIAL_COORDINATES_PROPERTY->state == INDIGO_BUSY_STATE) {
+			DOME_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
+			indigo_update_property(device, DOME_EQUATORIAL_COORDINATES_PROPERTY, NULL);
+		}
 	} else {
 		if (DOME_PARK_PROPERTY->state != INDIGO_BUSY_STATE && DOME_PARK_PARKED_ITEM->sw.value) {
 			indigo_set_switch(DOME_PARK_PROPERTY, DOME_PARK_UNPARKED_ITEM, true);
@@ -86,6 +90,10 @@ static void dome_timer_callback(indigo_device *device) {
 			indigo_update_property(device, DOME_HORIZONTAL_COORDINATES_PROPERTY, NULL);
 			DOME_STEPS_PROPERTY->state = INDIGO_OK_STATE;
 			indigo_update_property(device, DOME_STEPS_PROPERTY, NULL);
+			if (DOME_EQUATORIAL_COORDINATES_PROPERTY->state == INDIGO_BUSY_STATE) {
+				DOME_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
+				indigo_update_property(device, DOME_EQUATORIAL_COORDINATES_PROPERTY, NULL);
+			}
 			if (DOME_PARK_PROPERTY->state == INDIGO_BUSY_STATE) {
 				DOME_PARK_PROPERTY->state = INDIGO_OK_STATE;
 				indigo_update_property(device, DOME_PARK_PROPERTY, "Parked");
@@ -136,6 +144,12 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 		indigo_property_copy_values(DOME_EQUATORIAL_COORDINATES_PROPERTY, property, false);
 		double alt, az;
 		if (indigo_fix_dome_coordinates(device, DOME_EQUATORIAL_COORDINATES_RA_ITEM->number.value, DOME_EQUATORIAL_COORDINATES_DEC_ITEM->number.value, &alt, &az) == INDIGO_OK) {
+			if ((int)az == PRIVATE_DATA->target_position) {
+				// dome is already there or on the way, timer completes the move
+				DOME_EQUATORIAL_COORDINATES_PROPERTY->state = PRIVATE_DATA->current_position == PRIVATE_DATA->target_position ? INDIGO_OK_STATE : INDIGO_BUSY_STATE;
+				indigo_update_property(device, DOME_EQUATORIAL_COORDINATES_PROPERTY, NULL);
+				return INDIGO_OK;
+			}
 			PRIVATE_DATA->target_position = DOME_HORIZONTAL_COORDINATES_AZ_ITEM->number.target = az;
 			int dif = (int)(PRIVATE_DATA->target_position - PRIVATE_DATA->current_position + 360) % 360;
 			if (dif < 180) {
@@ -151,7 +165,7 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 			indigo_update_property(device, DOME_STEPS_PROPERTY, NULL);
 			DOME_HORIZONTAL_COORDINATES_PROPERTY->state = INDIGO_BUSY_STATE;
 			indigo_update_property(device, DOME_HORIZONTAL_COORDINATES_PROPERTY, NULL);
-			DOME_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
+			DOME_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_BUSY_STATE;
 			indigo_update_property(device, DOME_EQUATORIAL_COORDINATES_PROPERTY, NULL);
 			indigo_set_timer(device, 0.5, dome_timer_callback);
 		} else {
@@ -23,7 +23,7 @@
  \file indigo_ccd_sx.c
  */
 
-#define DRIVER_VERSION 0x0001
+#define DRIVER_VERSION 0x0002
 #define DRIVER_NAME "indigo_focuser_moonlite"
 
 #include <stdlib.h>
@@ -52,6 +52,7 @@ typedef struct {
 	int handle;
 	pthread_mutex_t port_mutex;
 	indigo_timer *timer;
+	indigo_poll_policy poll_policy;
 	indigo_property *stepping_mode_property;
 } moonlite_private_data;
 
@@ -136,7 +137,7 @@ static void timer_callback(indigo_device *device) {
 		indigo_update_property(device, FOCUSER_POSITION_PROPERTY, NULL);
 		indigo_update_property(device, FOCUSER_STEPS_PROPERTY, NULL);
 	}
-	indigo_reschedule_timer(device, FOCUSER_POSITION_PROPERTY->state == INDIGO_BUSY_STATE ? 0.2 : 1.0, &PRIVATE_DATA->timer);
+	indigo_poll_policy_reschedule(device, &PRIVATE_DATA->poll_policy, &PRIVATE_DATA->timer);
 }
 
 static indigo_result focuser_attach(indigo_device *device) {
@@ -248,6 +249,8 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 			if (PRIVATE_DATA->handle > 0) {
 				indigo_define_property(device, X_FOCUSER_STEPPING_MODE_PROPERTY, NULL);
 				INDIGO_DRIVER_LOG(DRIVER_NAME, "Connected to %s", DEVICE_PORT_ITEM->text.value);
+				indigo_init_poll_policy(&PRIVATE_DATA->poll_policy, 0.2, 1.0, 8.0);
+				indigo_poll_policy_add_property(&PRIVATE_DATA->poll_policy, FOCUSER_POSITION_PROPERTY);
 				PRIVATE_DATA->timer = indigo_set_timer(device, 0, timer_callback);
 				CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 			} else {
@@ -296,6 +299,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 		}
 		indigo_update_property(device, FOCUSER_STEPS_PROPERTY, NULL);
 		indigo_update_property(device, FOCUSER_POSITION_PROPERTY, NULL);
+		indigo_poll_policy_refresh(device, &PRIVATE_DATA->poll_policy, &PRIVATE_DATA->timer);
 		return INDIGO_OK;
 	} else if (indigo_property_match(FOCUSER_POSITION_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- FOCUSER_POSITION
@@ -310,6 +314,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 		}
 		indigo_update_property(device, FOCUSER_POSITION_PROPERTY, NULL);
 		indigo_update_property(device, FOCUSER_STEPS_PROPERTY, NULL);
+		indigo_poll_policy_refresh(device, &PRIVATE_DATA->poll_policy, &PRIVATE_DATA->timer);
 		return INDIGO_OK;
 	} else if (indigo_property_match(FOCUSER_ABORT_MOTION_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- FOCUSER_ABORT_MOTION
@@ -325,6 +330,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 			} else {
 				FOCUSER_ABORT_MOTION_PROPERTY->state = INDIGO_ALERT_STATE;
 			}
+			indigo_poll_policy_refresh(device, &PRIVATE_DATA->poll_policy, &PRIVATE_DATA->timer);
 		}
 		indigo_update_property(device, FOCUSER_ABORT_MOTION_PROPERTY, NULL);
 		return INDIGO_OK;
@@ -24,7 +24,7 @@
  \file indigo_guider_asi.c
  */
 
-#define DRIVER_VERSION 0x0002
+#define DRIVER_VERSION 0x0004
 #define DRIVER_NAME "indigo_guider_asi"
 
 #include <stdlib.h>
@@ -65,7 +65,6 @@
 
 typedef struct {
 	int dev_id;
-	indigo_timer *guider_timer_ra, *guider_timer_dec;
 	bool guide_relays[4];
 	pthread_mutex_t usb_mutex;
 } asi_private_data;
@@ -106,50 +105,38 @@ static void asi_close(indigo_device *device) {
 }
 
 
-static void guider_timer_callback_ra(indigo_device *device) {
-	PRIVATE_DATA->guider_timer_ra = NULL;
+static bool guider_pulse_output(indigo_device *device, int directions) {
+	static const struct {
+		int mask;
+		USB2ST4_DIRECTION direction;
+	} relays[] = {
+		{ INDIGO_GUIDE_NORTH, USB2ST4_NORTH },
+		{ INDIGO_GUIDE_SOUTH, USB2ST4_SOUTH },
+		{ INDIGO_GUIDE_EAST, USB2ST4_EAST },
+		{ INDIGO_GUIDE_WEST, USB2ST4_WEST }
+	};
 	int id = PRIVATE_DATA->dev_id;
-
-	if (!CONNECTION_CONNECTED_ITEM->sw.value) return;
-
+	bool result = true;
 	pthread_mutex_lock(&PRIVATE_DATA->usb_mutex);
-	USB2ST4PulseGuide(id, USB2ST4_EAST, false);
-	USB2ST4PulseGuide(id, USB2ST4_WEST, false);
-	pthread_mutex_unlock(&PRIVATE_DATA->usb_mutex);
-
-	if (PRIVATE_DATA->guide_relays[USB2ST4_EAST] || PRIVATE_DATA->guide_relays[USB2ST4_WEST]) {
-		GUIDER_GUIDE_EAST_ITEM->number.value = 0;
-		GUIDER_GUIDE_WEST_ITEM->number.value = 0;
-		GUIDER_GUIDE_RA_PROPERTY->state = INDIGO_OK_STATE;
-		indigo_update_property(device, GUIDER_GUIDE_RA_PROPERTY, NULL);
+	// release relays first, so edges of both axes are as close as possible
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < 4; i++) {
+			bool set = (directions & relays[i].mask) != 0;
+			if (set != (pass == 1) || PRIVATE_DATA->guide_relays[relays[i].direction] == set)
+				continue;
+			USB2ST4_ERROR_CODE res = USB2ST4PulseGuide(id, relays[i].direction, set);
+			if (res) {
+				INDIGO_DRIVER_ERROR(DRIVER_NAME, "USB2ST4PulseGuide(%d, %d, %d) = %d", id, relays[i].direction, set, res);
+				result = false;
+			} else {
+				PRIVATE_DATA->guide_relays[relays[i].direction] = set;
+			}
+		}
 	}
-	PRIVATE_DATA->guide_relays[USB2ST4_EAST] = false;
-	PRIVATE_DATA->guide_relays[USB2ST4_WEST] = false;
-}
-
-
-static void guider_timer_callback_dec(indigo_device *device) {
-	PRIVATE_DATA->guider_timer_dec = NULL;
-	int id = PRIVATE_DATA->dev_id;
-
-	if (!CONNECTION_CONNECTED_ITEM->sw.value) return;
-
-	pthread_mutex_lock(&PRIVATE_DATA->usb_mutex);
-	USB2ST4PulseGuide(id, USB2ST4_SOUTH, false);
-	USB2ST4PulseGuide(id, USB2ST4_NORTH, false);
 	pthread_mutex_unlock(&PRIVATE_DATA->usb_mutex);
-
-	if (PRIVATE_DATA->guide_relays[USB2ST4_NORTH] || PRIVATE_DATA->guide_relays[USB2ST4_SOUTH]) {
-		GUIDER_GUIDE_NORTH_ITEM->number.value = 0;
-		GUIDER_GUIDE_SOUTH_ITEM->number.value = 0;
-		GUIDER_GUIDE_DEC_PROPERTY->state = INDIGO_OK_STATE;
-		indigo_update_property(device, GUIDER_GUIDE_DEC_PROPERTY, NULL);
-	}
-	PRIVATE_DATA->guide_relays[USB2ST4_SOUTH] = false;
-	PRIVATE_DATA->guide_relays[USB2ST4_NORTH] = false;
+	return result;
 }
 
-
 // -------------------------------------------------------------------------------- INDIGO guider device implementation
 
 static indigo_result guider_attach(indigo_device *device) {
@@ -165,9 +152,6 @@ static indigo_result guider_change_property(indigo_device *device, indigo_client
 	assert(device != NULL);
 	assert(DEVICE_CONTEXT != NULL);
 	assert(property != NULL);
-	USB2ST4_ERROR_CODE res;
-	int id = PRIVATE_DATA->dev_id;
-
 	if (indigo_property_match(CONNECTION_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CONNECTION
 		indigo_property_copy_values(CONNECTION_PROPERTY, property, false);
@@ -178,6 +162,7 @@ static indigo_result guider_change_property(indigo_device *device, indigo_client
 					GUIDER_GUIDE_DEC_PROPERTY->hidden = false;
 					GUIDER_GUIDE_RA_PROPERTY->hidden = false;
 					device->is_connected = true;
+					indigo_guider_start_pulse_engine(device, guider_pulse_output);
 				} else {
 					CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
 					indigo_set_switch(CONNECTION_PROPERTY, CONNECTION_DISCONNECTED_ITEM, true);
@@ -185,77 +170,12 @@ static indigo_result guider_change_property(indigo_device *device, indigo_client
 			}
 		} else {
 			if (device->is_connected) {
+				indigo_guider_stop_pulse_engine(device);
 				asi_close(device);
 				device->is_connected = false;
 				CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 			}
 		}
-	} else if (indigo_property_match(GUIDER_GUIDE_DEC_PROPERTY, property)) {
-		// -------------------------------------------------------------------------------- GUIDER_GUIDE_DEC
-		indigo_property_copy_values(GUIDER_GUIDE_DEC_PROPERTY, property, false);
-		indigo_cancel_timer(device, &PRIVATE_DATA->guider_timer_dec);
-		int duration = GUIDER_GUIDE_NORTH_ITEM->number.value;
-		if (duration > 0) {
-			pthread_mutex_lock(&PRIVATE_DATA->usb_mutex);
-			res = USB2ST4PulseGuide(id, USB2ST4_NORTH, true);
-			pthread_mutex_unlock(&PRIVATE_DATA->usb_mutex);
-
-			if (res) INDIGO_DRIVER_ERROR(DRIVER_NAME, "USB2ST4PulseGuide(%d, USB2ST4_NORTH) = %d", id, res);
-			PRIVATE_DATA->guider_timer_dec = indigo_set_timer(device, duration/1000.0, guider_timer_callback_dec);
-			PRIVATE_DATA->guide_relays[USB2ST4_NORTH] = true;
-		} else {
-			int duration = GUIDER_GUIDE_SOUTH_ITEM->number.value;
-			if (duration > 0) {
-				pthread_mutex_lock(&PRIVATE_DATA->usb_mutex);
-				res = USB2ST4PulseGuide(id, USB2ST4_SOUTH, true);
-				pthread_mutex_unlock(&PRIVATE_DATA->usb_mutex);
-
-				if (res) INDIGO_DRIVER_ERROR(DRIVER_NAME, "USB2ST4PulseGuide(%d, USB2ST4_SOUTH) = %d", id, res);
-				PRIVATE_DATA->guider_timer_dec = indigo_set_timer(device, duration/1000.0, guider_timer_callback_dec);
-				PRIVATE_DATA->guide_relays[USB2ST4_SOUTH] = true;
-			}
-		}
-
-		if (PRIVATE_DATA->guide_relays[USB2ST4_SOUTH] || PRIVATE_DATA->guide_relays[USB2ST4_NORTH])
-			GUIDER_GUIDE_DEC_PROPERTY->state = INDIGO_BUSY_STATE;
-		else
-			GUIDER_GUIDE_DEC_PROPERTY->state = INDIGO_OK_STATE;
-
-		indigo_update_property(device, GUIDER_GUIDE_DEC_PROPERTY, NULL);
-		return INDIGO_OK;
-	} else if (indigo_property_match(GUIDER_GUIDE_RA_PROPERTY, property)) {
-		// -------------------------------------------------------------------------------- GUIDER_GUIDE_RA
-		indigo_property_copy_values(GUIDER_GUIDE_RA_PROPERTY, property, false);
-		indigo_cancel_timer(device, &PRIVATE_DATA->guider_timer_ra);
-		int duration = GUIDER_GUIDE_EAST_ITEM->number.value;
-		if (duration > 0) {
-			pthread_mutex_lock(&PRIVATE_DATA->usb_mutex);
-			res = USB2ST4PulseGuide(id, USB2ST4_EAST, true);
-			pthread_mutex_unlock(&PRIVATE_DATA->usb_mutex);
-
-			if (res) INDIGO_DRIVER_ERROR(DRIVER_NAME, "USB2ST4PulseGuide(%d, USB2ST4_EAST) = %d", id, res);
-			PRIVATE_DATA->guider_timer_ra = indigo_set_timer(device, duration/1000.0, guider_timer_callback_ra);
-			PRIVATE_DATA->guide_relays[USB2ST4_EAST] = true;
-		} else {
-			int duration = GUIDER_GUIDE_WEST_ITEM->number.value;
-			if (duration > 0) {
-				pthread_mutex_lock(&PRIVATE_DATA->usb_mutex);
-				res = USB2ST4PulseGuide(id, USB2ST4_WEST, true);
-				pthread_mutex_unlock(&PRIVATE_DATA->usb_mutex);
-
-				if (res) INDIGO_DRIVER_ERROR(DRIVER_NAME, "USB2ST4PulseGuide(%d, USB2ST4_WEST) = %d", id, res);
-				PRIVATE_DATA->guider_timer_ra = indigo_set_timer(device, duration/1000.0, guider_timer_callback_ra);
-				PRIVATE_DATA->guide_relays[USB2ST4_WEST] = true;
-			}
-		}
-
-		if (PRIVATE_DATA->guide_relays[USB2ST4_EAST] || PRIVATE_DATA->guide_relays[USB2ST4_WEST])
-			GUIDER_GUIDE_RA_PROPERTY->state = INDIGO_BUSY_STATE;
-		else
-			GUIDER_GUIDE_RA_PROPERTY->state = INDIGO_OK_STATE;
-
-		indigo_update_property(device, GUIDER_GUIDE_RA_PROPERTY, NULL);
-		return INDIGO_OK;
 		// --------------------------------------------------------------------------------
 	}
 	return indigo_guider_change_property(device, client, property);
@@ -428,24 +348,13 @@ static void process_unplug_event(indigo_device *unused) {
 	pthread_mutex_unlock(&device_mutex);
 }
 
-static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
-	struct libusb_device_descriptor descriptor;
-	switch (event) {
-		case LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED: {
-			libusb_get_device_descriptor(dev, &descriptor);
-			for (int i = 0; i < asi_id_count; i++) {
-				if (descriptor.idVendor != ASI_VENDOR_ID || asi_products[i] != descriptor.idProduct)
-					continue;
-				indigo_set_timer(NULL, 0.5, process_plug_event);
-			}
-			break;
-		}
-		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
-			indigo_set_timer(NULL, 0.5, process_unplug_event);
-			break;
-		}
+static void hotplug_callback(bool arrived, struct libusb_device **devices, int count) {
+	if (arrived) {
+		for (int i = 0; i < count; i++)
+			process_plug_event(NULL);
+	} else {
+		process_unplug_event(NULL);
 	}
-	return 0;
 }
 
 
@@ -468,7 +377,7 @@ static void remove_all_devices() {
 		connected_ids[i] = false;
 }
 
-static libusb_hotplug_callback_handle callback_handle;
+static int hotplug_handle = -1;
 
 indigo_result indigo_guider_asi(indigo_driver_action action, indigo_driver_info *info) {
 	static indigo_driver_action last_action = INDIGO_DRIVER_SHUTDOWN;
@@ -486,15 +395,11 @@ indigo_result indigo_guider_asi(indigo_driver_action action, indigo_driver_info
 				INDIGO_DRIVER_ERROR(DRIVER_NAME, "Can not get the list of supported IDs.");
 				return INDIGO_FAILED;
 			}
-			indigo_start_usb_event_handler();
-			int rc = libusb_hotplug_register_callback(NULL, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, LIBUSB_HOTPLUG_ENUMERATE, ASI_VENDOR_ID, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplug_callback, NULL, &callback_handle);
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_register_callback ->  %s", rc < 0 ? libusb_error_name(rc) : "OK");
-			return rc >= 0 ? INDIGO_OK : INDIGO_FAILED;
+			return indigo_add_usb_hotplug_handler(DRIVER_NAME, ASI_VENDOR_ID, asi_products, asi_id_count, hotplug_callback, &hotplug_handle);
 
 		case INDIGO_DRIVER_SHUTDOWN:
 			last_action = action;
-			libusb_hotplug_deregister_callback(NULL, callback_handle);
-			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+			indigo_remove_usb_hotplug_handler(hotplug_handle);
 			remove_all_devices();
 			break;
 
@@ -23,7 +23,7 @@
  \file indigo_guider_gpusb.c
  */
 
-#define DRIVER_VERSION 0x0001
+#define DRIVER_VERSION 0x0002
 #define DRIVER_NAME "indigo_guider_gpusb"
 
 #include <stdlib.h>
@@ -46,30 +46,21 @@
 typedef struct {
 	libusb_device *dev;
 	libgpusb_device_context *device_context;
-	indigo_timer *guider_timer;
-	unsigned short relay_mask;
 } gpusb_private_data;
 
 // -------------------------------------------------------------------------------- INDIGO guider device implementation
 
-static void guider_timer_callback(indigo_device *device) {
-	PRIVATE_DATA->guider_timer = NULL;
-	if (!CONNECTION_CONNECTED_ITEM->sw.value)
-		return;
-	libgpusb_set(PRIVATE_DATA->device_context, 0);
-	if (PRIVATE_DATA->relay_mask & (GPUSB_DEC_NORTH | GPUSB_DEC_SOUTH)) {
-		GUIDER_GUIDE_NORTH_ITEM->number.value = 0;
-		GUIDER_GUIDE_SOUTH_ITEM->number.value = 0;
-		GUIDER_GUIDE_DEC_PROPERTY->state = INDIGO_OK_STATE;
-		indigo_update_property(device, GUIDER_GUIDE_DEC_PROPERTY, NULL);
-	}
-	if (PRIVATE_DATA->relay_mask & (GPUSB_RA_WEST | GPUSB_RA_EAST)) {
-		GUIDER_GUIDE_EAST_ITEM->number.value = 0;
-		GUIDER_GUIDE_WEST_ITEM->number.value = 0;
-		GUIDER_GUIDE_RA_PROPERTY->state = INDIGO_OK_STATE;
-		indigo_update_property(device, GUIDER_GUIDE_RA_PROPERTY, NULL);
-	}
-	PRIVATE_DATA->relay_mask = 0;
+static bool guider_pulse_output(indigo_device *device, int directions) {
+	unsigned short relay_mask = 0;
+	if (directions & INDIGO_GUIDE_NORTH)
+		relay_mask |= GPUSB_DEC_NORTH;
+	if (directions & INDIGO_GUIDE_SOUTH)
+		relay_mask |= GPUSB_DEC_SOUTH;
+	if (directions & INDIGO_GUIDE_EAST)
+		relay_mask |= GPUSB_RA_EAST;
+	if (directions & INDIGO_GUIDE_WEST)
+		relay_mask |= GPUSB_RA_WEST;
+	return libgpusb_set(PRIVATE_DATA->device_context, relay_mask);
 }
 
 static indigo_result guider_attach(indigo_device *device) {
@@ -95,55 +86,17 @@ static indigo_result guider_change_property(indigo_device *device, indigo_client
 		indigo_property_copy_values(CONNECTION_PROPERTY, property, false);
 		if (CONNECTION_CONNECTED_ITEM->sw.value) {
 			if (libgpusb_open(PRIVATE_DATA->dev, &PRIVATE_DATA->device_context)) {
+				indigo_guider_start_pulse_engine(device, guider_pulse_output);
 				CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 			} else {
 				CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
 				indigo_set_switch(CONNECTION_PROPERTY, CONNECTION_DISCONNECTED_ITEM, true);
 			}
 		} else {
+			indigo_guider_stop_pulse_engine(device);
 			libgpusb_close(PRIVATE_DATA->device_context);
 			CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 		}
-	} else if (indigo_property_match(GUIDER_GUIDE_DEC_PROPERTY, property)) {
-		// -------------------------------------------------------------------------------- GUIDER_GUIDE_DEC
-		indigo_property_copy_values(GUIDER_GUIDE_DEC_PROPERTY, property, false);
-		indigo_cancel_timer(device, &PRIVATE_DATA->guider_timer);
-		PRIVATE_DATA->relay_mask &= ~(GPUSB_DEC_NORTH | GPUSB_DEC_SOUTH);
-		int duration = GUIDER_GUIDE_NORTH_ITEM->number.value;
-		if (duration > 0) {
-			PRIVATE_DATA->relay_mask |= GPUSB_DEC_NORTH;
-			PRIVATE_DATA->guider_timer = indigo_set_timer(device, duration/1000.0, guider_timer_callback);
-		} else {
-			int duration = GUIDER_GUIDE_SOUTH_ITEM->number.value;
-			if (duration > 0) {
-				PRIVATE_DATA->relay_mask |= GPUSB_DEC_SOUTH;
-				PRIVATE_DATA->guider_timer = indigo_set_timer(device, duration/1000.0, guider_timer_callback);
-			}
-		}
-		libgpusb_set(PRIVATE_DATA->device_context, PRIVATE_DATA->relay_mask);
-		GUIDER_GUIDE_DEC_PROPERTY->state = PRIVATE_DATA->relay_mask & (GPUSB_DEC_NORTH | GPUSB_DEC_SOUTH) ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
-		indigo_update_property(device, GUIDER_GUIDE_DEC_PROPERTY, NULL);
-		return INDIGO_OK;
-	} else if (indigo_property_match(GUIDER_GUIDE_RA_PROPERTY, property)) {
-		// -------------------------------------------------------------------------------- GUIDER_GUIDE_RA
-		indigo_property_copy_values(GUIDER_GUIDE_RA_PROPERTY, property, false);
-		indigo_cancel_timer(device, &PRIVATE_DATA->guider_timer);
-		PRIVATE_DATA->relay_mask &= ~(GPUSB_RA_EAST | GPUSB_RA_WEST);
-		int duration = GUIDER_GUIDE_EAST_ITEM->number.value;
-		if (duration > 0) {
-			PRIVATE_DATA->relay_mask |= GPUSB_RA_EAST;
-			PRIVATE_DATA->guider_timer = indigo_set_timer(device, duration/1000.0, guider_timer_callback);
-		} else {
-			int duration = GUIDER_GUIDE_WEST_ITEM->number.value;
-			if (duration > 0) {
-				PRIVATE_DATA->relay_mask |= GPUSB_RA_WEST;
-				PRIVATE_DATA->guider_timer = indigo_set_timer(device, duration/1000.0, guider_timer_callback);
-			}
-		}
-		libgpusb_set(PRIVATE_DATA->device_context, PRIVATE_DATA->relay_mask);
-		GUIDER_GUIDE_RA_PROPERTY->state = PRIVATE_DATA->relay_mask & (GPUSB_RA_WEST | GPUSB_RA_EAST) ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
-		indigo_update_property(device, GUIDER_GUIDE_RA_PROPERTY, NULL);
-		return INDIGO_OK;
 		// --------------------------------------------------------------------------------
 	}
 	return indigo_guider_change_property(device, client, property);
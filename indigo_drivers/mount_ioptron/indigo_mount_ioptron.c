@@ -23,7 +23,7 @@
  \file indigo_mount_ioptron.c
  */
 
-#define DRIVER_VERSION 0x0007
+#define DRIVER_VERSION 0x0008
 #define DRIVER_NAME	"indigo_mount_ioptron"
 
 #include <stdlib.h>
@@ -62,71 +62,51 @@ typedef struct {
 	unsigned protocol;
 } ioptron_private_data;
 
-static bool ieq_command(indigo_device *device, char *command, char *response, int max) {
-	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	char c;
-	struct timeval tv;
-	tv.tv_sec = 0;
-	tv.tv_usec = 10000;
-		// flush
-	while (true) {
-		fd_set readout;
-		FD_ZERO(&readout);
-		FD_SET(PRIVATE_DATA->handle, &readout);
-		long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-		if (result == 0)
-			break;
-		if (result < 0) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return false;
-		}
-		result = read(PRIVATE_DATA->handle, &c, 1);
-		if (result < 1) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return false;
-		}
-	}
-		// write command
-	indigo_write(PRIVATE_DATA->handle, command, strlen(command));
-		// read response
+static const indigo_transaction ieq_transaction = { "#", 500, 500, 0, 0 };
+
+static void ieq_normalize(char *response) {
 	if (response != NULL) {
-		int index = 0;
-		while (index < max) {
-			tv.tv_usec = 500000;
-			tv.tv_sec = 0;
-			fd_set readout;
-			FD_ZERO(&readout);
-			FD_SET(PRIVATE_DATA->handle, &readout);
-			long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-			if (result <= 0)
-				break;
-			result = read(PRIVATE_DATA->handle, &c, 1);
-			if (result < 1) {
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
-				pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-				return false;
-			}
-			if (c < 0)
-				c = ':';
-			if (c == '#')
-				break;
-			response[index++] = c;
-		}
-		response[index] = 0;
+		for (char *c = response; *c; c++)
+			if (*c < 0)
+				*c = ':';
 	}
-	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
+}
+
+static bool ieq_command(indigo_device *device, char *command, char *response, int max) {
+	// timeout is not an error, some commands have no or unterminated response, partial response is kept as before
+	if (indigo_transact(PRIVATE_DATA->handle, &PRIVATE_DATA->port_mutex, &ieq_transaction, command, response, max + 1) < 0 && errno != ETIMEDOUT) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
+		return false;
+	}
+	ieq_normalize(response);
 	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command '%s' -> '%s'", command, response != NULL ? response : "NULL");
 	return true;
 }
 
+static bool ieq_batch(indigo_device *device, indigo_batch_command *commands, int count) {
+	int completed = indigo_transact_batch(PRIVATE_DATA->handle, &PRIVATE_DATA->port_mutex, &ieq_transaction, commands, count);
+	for (int i = 0; i < completed; i++) {
+		ieq_normalize(commands[i].response);
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command '%s' -> '%s'", commands[i].command, commands[i].response != NULL ? commands[i].response : "NULL");
+	}
+	if (completed < count) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
+		return false;
+	}
+	return true;
+}
+
 static void ieq_get_coords(indigo_device *device) {
 	char response[128];
 	MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 	if (PRIVATE_DATA->protocol == 0x0100 || PRIVATE_DATA->protocol == 0x0104) {
-		if (ieq_command(device, ":GR#", response, sizeof(response)))
+		char dec[128];
+		indigo_batch_command commands[2] = { { ":GR#", response, sizeof(response) }, { ":GD#", dec, sizeof(dec) } };
+		ieq_batch(device, commands, 2);
+		if (commands[0].result >= 0)
 			PRIVATE_DATA->currentRA = indigo_stod(response);
-		if (ieq_command(device, ":GD#", response, sizeof(response)))
-			PRIVATE_DATA->currentDec = indigo_stod(response);
+		if (commands[1].result >= 0)
+			PRIVATE_DATA->currentDec = indigo_stod(dec);
 		MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
 	} else if (PRIVATE_DATA->protocol == 0x0200) {
 		long ra, dec;
@@ -23,7 +23,7 @@
  \file indigo_mount_lx200.c
  */
 
-#define DRIVER_VERSION 0x0002
+#define DRIVER_VERSION 0x0003
 #define DRIVER_NAME	"indigo_mount_lx200"
 
 #include <stdlib.h>
@@ -115,62 +115,16 @@ static bool meade_open(indigo_device *device) {
 }
 
 static bool meade_command(indigo_device *device, char *command, char *response, int max, int sleep) {
-	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	char c;
-	struct timeval tv;
-	// flush
-	while (true) {
-		fd_set readout;
-		FD_ZERO(&readout);
-		FD_SET(PRIVATE_DATA->handle, &readout);
-		tv.tv_sec = 0;
-		tv.tv_usec = 100000;
-		long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-		if (result == 0)
-			break;
-		if (result < 0) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return false;
-		}
-		result = read(PRIVATE_DATA->handle, &c, 1);
-		if (result < 1) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return false;
-		}
+	indigo_transaction transaction = { "#", 3000, 100, sleep, 0 };
+	if (indigo_transact(PRIVATE_DATA->handle, &PRIVATE_DATA->port_mutex, &transaction, command, response, max + 1) < 0) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
+		return false;
 	}
-	// write command
-	indigo_write(PRIVATE_DATA->handle, command, strlen(command));
-	if (sleep > 0)
-		usleep(sleep);
-	// read response
 	if (response != NULL) {
-		int index = 0;
-		int timeout = 3;
-		while (index < max) {
-			fd_set readout;
-			FD_ZERO(&readout);
-			FD_SET(PRIVATE_DATA->handle, &readout);
-			tv.tv_sec = timeout;
-			tv.tv_usec = 100000;
-			timeout = 0;
-			long result = select(PRIVATE_DATA->handle+1, &readout, NULL, NULL, &tv);
-			if (result <= 0)
-				break;
-			result = read(PRIVATE_DATA->handle, &c, 1);
-			if (result < 1) {
-				INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
-				pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-				return false;
-			}
-			if (c < 0)
-				c = ':';
-			if (c == '#')
-				break;
-			response[index++] = c;
-		}
-		response[index] = 0;
+		for (char *c = response; *c; c++)
+			if (*c < 0)
+				*c = ':';
 	}
-	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
 	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> %s", command, response != NULL ? response : "NULL");
 	return true;
 }
@@ -194,34 +148,61 @@ static void meade_close(indigo_device *device) {
 	}
 }
 
+static bool meade_batch(indigo_device *device, indigo_batch_command *commands, int count) {
+	static const indigo_transaction transaction = { "#", 3000, 100, 0, 0 };
+	int completed = indigo_transact_batch(PRIVATE_DATA->handle, &PRIVATE_DATA->port_mutex, &transaction, commands, count);
+	for (int i = 0; i < completed; i++) {
+		if (commands[i].response != NULL) {
+			for (char *c = commands[i].response; *c; c++)
+				if (*c < 0)
+					*c = ':';
+		}
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Command %s -> %s", commands[i].command, commands[i].response != NULL ? commands[i].response : "NULL");
+	}
+	if (completed < count) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Failed to read from %s -> %s (%d)", DEVICE_PORT_ITEM->text.value, strerror(errno), errno);
+		return false;
+	}
+	return true;
+}
+
 static void meade_get_coords(indigo_device *device) {
-	char response[128];
-	if (meade_command(device, ":GR#", response, sizeof(response), 0)) {
-		if (strlen(response) < 8) {
+	char ra[128], dec[128], state[128];
+	indigo_batch_command commands[3] = { { ":GR#", ra, sizeof(ra) }, { ":GD#", dec, sizeof(dec) } };
+	int count = 2;
+	if (MOUNT_TYPE_MEADE_ITEM->sw.value || MOUNT_TYPE_10MICRONS_ITEM->sw.value)
+		commands[count++] = (indigo_batch_command){ ":D#", state, sizeof(state) };
+	else if (MOUNT_TYPE_GEMINI_ITEM->sw.value)
+		commands[count++] = (indigo_batch_command){ ":Gv#", state, 2 };
+	else if (MOUNT_TYPE_AVALON_ITEM->sw.value)
+		commands[count++] = (indigo_batch_command){ ":X34#", state, sizeof(state) };
+	meade_batch(device, commands, count);
+	if (commands[0].result >= 0) {
+		if (strlen(ra) < 8) {
 			if (MOUNT_TYPE_MEADE_ITEM->sw.value) {
-				meade_command(device, ":P#", response, sizeof(response), 0);
-				meade_command(device, ":GR#", response, sizeof(response), 0);
+				meade_command(device, ":P#", ra, sizeof(ra), 0);
+				meade_command(device, ":GR#", ra, sizeof(ra), 0);
 			} else if (MOUNT_TYPE_10MICRONS_ITEM->sw.value) {
 				meade_command(device, ":U1#", NULL, 0, 0);
-				meade_command(device, ":GR#", response, sizeof(response), 0);
+				meade_command(device, ":GR#", ra, sizeof(ra), 0);
 			} else if (MOUNT_TYPE_GEMINI_ITEM->sw.value || MOUNT_TYPE_AP_ITEM->sw.value) {
 				meade_command(device, ":U#", NULL, 0, 0);
-				meade_command(device, ":GR#", response, sizeof(response), 0);
+				meade_command(device, ":GR#", ra, sizeof(ra), 0);
 			}
 		}
-		MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = indigo_stod(response);
+		MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = indigo_stod(ra);
 	}
-	if (meade_command(device, ":GD#", response, sizeof(response), 0))
-		MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = indigo_stod(response);
+	if (commands[1].result >= 0)
+		MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = indigo_stod(dec);
 	if (MOUNT_TYPE_MEADE_ITEM->sw.value || MOUNT_TYPE_10MICRONS_ITEM->sw.value) {
-		if (meade_command(device, ":D#", response, sizeof(response), 0))
-			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = *response ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
+		if (commands[2].result >= 0)
+			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = *state ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
 	} else if (MOUNT_TYPE_GEMINI_ITEM->sw.value) {
-		if (meade_command(device, ":Gv#", response, sizeof(response), 0))
-			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = (*response == 'S' || *response == 'C') ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
+		if (commands[2].result >= 0)
+			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = (*state == 'S' || *state == 'C') ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
 	} else if (MOUNT_TYPE_AVALON_ITEM->sw.value) {
-		if (meade_command(device, ":X34#", response, sizeof(response), 0))
-			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = (response[1] == '5' || response[2] == '5') ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
+		if (commands[2].result >= 0)
+			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = (state[1] == '5' || state[2] == '5') ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
 	} else {
 		if (fabs(MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value - MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.target) < 1.0/3600.0 && fabs(MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value - MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.target) < 1.0/3600.0)
 			MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
@@ -233,20 +214,22 @@ static void meade_get_coords(indigo_device *device) {
 static void meade_get_utc(indigo_device *device) {
 	if (MOUNT_TYPE_MEADE_ITEM->sw.value || MOUNT_TYPE_GEMINI_ITEM->sw.value || MOUNT_TYPE_10MICRONS_ITEM->sw.value || MOUNT_TYPE_AP_ITEM->sw.value) {
 		struct tm tm;
-		char response[128];
+		char date[128], local_time[128], offset[128];
+		indigo_batch_command commands[3] = { { ":GC#", date, sizeof(date) }, { ":GL#", local_time, sizeof(local_time) }, { ":GG#", offset, sizeof(offset) } };
 		memset(&tm, 0, sizeof(tm));
 		MOUNT_UTC_TIME_PROPERTY->state = INDIGO_ALERT_STATE;
 		char separator[2];
-		if (meade_command(device, ":GC#", response, sizeof(response), 0) && sscanf(response, "%d%c%d%c%d", &tm.tm_mon, separator, &tm.tm_mday, separator, &tm.tm_year) == 5) {
-			if (meade_command(device, ":GL#", response, sizeof(response), 0) && sscanf(response, "%d%c%d%c%d", &tm.tm_hour, separator, &tm.tm_min, separator, &tm.tm_sec) == 5) {
+		meade_batch(device, commands, 3);
+		if (commands[0].result >= 0 && sscanf(date, "%d%c%d%c%d", &tm.tm_mon, separator, &tm.tm_mday, separator, &tm.tm_year) == 5) {
+			if (commands[1].result >= 0 && sscanf(local_time, "%d%c%d%c%d", &tm.tm_hour, separator, &tm.tm_min, separator, &tm.tm_sec) == 5) {
 				tm.tm_year += 100; // TODO: To be fixed in year 2100 :)
 				tm.tm_mon -= 1;
-				if (meade_command(device, ":GG#", response, sizeof(response), 0)) {
+				if (commands[2].result >= 0) {
 					tm.tm_isdst = -1;
-					tm.tm_gmtoff = atoi(response) * 3600;
+					tm.tm_gmtoff = atoi(offset) * 3600;
 					time_t secs = mktime(&tm);
 					indigo_timetoiso(secs, MOUNT_UTC_ITEM->text.value, INDIGO_VALUE_SIZE);
-					sprintf(MOUNT_UTC_OFFEST_ITEM->text.value, "%g", atof(response));
+					sprintf(MOUNT_UTC_OFFEST_ITEM->text.value, "%g", atof(offset));
 					MOUNT_UTC_TIME_PROPERTY->state = INDIGO_OK_STATE;
 				}
 			}
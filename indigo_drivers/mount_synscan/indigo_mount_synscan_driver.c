@@ -687,11 +687,11 @@ void coords_aa_to_encoder2(indigo_device* device, double az, double alt, double
 void synscan_get_coords(indigo_device *device) {
 	long haPos, decPos;
 	//  Get the DEC first since we want the HA position to be changing as little as possible till
-	//  we combine it with LST to get RA
-	if (synscan_axis_position(device, kAxisDEC, &decPos))
+	//  we combine it with LST to get RA, both are queried in one round trip
+	if (synscan_axis_positions(device, &haPos, &decPos)) {
 		PRIVATE_DATA->decPosition = dec_steps_to_position(device, decPos);
-	if (synscan_axis_position(device, kAxisRA, &haPos))
 		PRIVATE_DATA->raPosition = ha_steps_to_position(device, haPos);
+	}
 	//INDIGO_DRIVER_DEBUG(DRIVER_NAME, "POS DEBUG:  HA %ld   DEC %ld (steps)\n", haPos, decPos);
 }
 
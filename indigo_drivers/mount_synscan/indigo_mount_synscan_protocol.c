@@ -88,111 +88,66 @@ static long hexResponseToLong(const char* b) {
 	return num;
 }
 
+static const indigo_transaction synscan_transaction = { "\r", 1000, 0, 0, 1 };
+
 static bool synscan_flush(indigo_device* device) {
-	unsigned char c;
-	struct timeval tv;
-	while (true) {
-		fd_set readout;
-		FD_ZERO(&readout);
-		FD_SET(PRIVATE_DATA->handle, &readout);
-		tv.tv_sec = 0;
-		tv.tv_usec = 100000;
-		long result = select(1, &readout, NULL, NULL, &tv);
-		if (result == 0)
-			break;
-		if (result < 0) {
-			INDIGO_DRIVER_ERROR(DRIVER_NAME, "SELECT FAIL 1");
-			return false;
-		}
-		result = read(PRIVATE_DATA->handle, &c, 1);
-		if (result < 1) {
-			INDIGO_DRIVER_ERROR(DRIVER_NAME, "READ FAIL 1");
-			return false;
-		}
+	if (!indigo_drain(PRIVATE_DATA->handle)) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Flushing input failed");
+		return false;
 	}
 	return true;
 }
 
 static bool synscan_command_unlocked(indigo_device* device, const char* cmd) {
 	//  Send the command to the port
+	char buffer[20];
 	INDIGO_DRIVER_TRACE(DRIVER_NAME, "CMD: [%s]", cmd);
-	if (!indigo_write(PRIVATE_DATA->handle, cmd, strlen(cmd))) {
+	snprintf(buffer, sizeof(buffer), "%s\r", cmd);
+	if (!indigo_write(PRIVATE_DATA->handle, buffer, strlen(buffer))) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Sending command failed");
 		return false;
 	}
-	if (!indigo_write(PRIVATE_DATA->handle, "\r", 1)) {
-		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Sending command terminator failed");
+	return true;
+}
+
+static bool synscan_parse_response(indigo_device* device, const char* resp, char* r) {
+	//  Check response syntax =...
+	size_t len = strlen(resp);
+	if (len < 1 || resp[0] != '=') {
+		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "RESPONSE: [%s] - error", resp);
 		return false;
+	} else {
+		INDIGO_DRIVER_TRACE(DRIVER_NAME, "RESPONSE: [%s]", resp);
 	}
+
+	//  Extract response payload, return
+	if (r)
+		memmove(r, resp + 1, len);
 	return true;
 }
 
 static bool synscan_read_response(indigo_device* device, char* r) {
 	//  Read a response
-	char c;
 	char resp[20];
-	long total_bytes = 0;
-	while (total_bytes < sizeof(resp)) {
-		long bytes_read = read(PRIVATE_DATA->handle, &c, 1);
-		if (bytes_read == 0) {
-			INDIGO_DRIVER_ERROR(DRIVER_NAME, "SYNSCAN_TIMEOUT");
-			break;
-		}
-		if (bytes_read > 0) {
-			resp[total_bytes++] = c;
-			if (c == '\r')
-				break;
-		}
-	}
-	resp[total_bytes] = 0;
-	if (total_bytes <= 0) {
+	if (indigo_read_response(PRIVATE_DATA->handle, resp, sizeof(resp), synscan_transaction.terminators, synscan_transaction.timeout, synscan_transaction.byte_timeout) < 0) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Reading response failed");
 		return false;
 	}
-	
-	//  Check response syntax =...<cr>, if invalid retry
-	size_t len = strlen(resp);
-	if (len < 2 || resp[0] != '=' || resp[len - 1] != '\r') {
-		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "RESPONSE: [%.*s] - error", len - 1, resp);
-		return false;
-	} else {
-		INDIGO_DRIVER_TRACE(DRIVER_NAME, "RESPONSE: [%.*s]", len - 1, resp);
-	}
-	
-	//  Extract response payload, return
-	if (r) {
-		strncpy(r, resp+1, len-2);
-		r[len-2] = 0;
-	}
-	return true;
+	return synscan_parse_response(device, resp, r);
 }
 
 //  GENERIC SYNSCAN COMMAND
 
 static bool synscan_command(indigo_device* device, const char* cmd, char* r) {
-	pthread_mutex_lock(&PRIVATE_DATA->port_mutex);
-	int nretries = 0;
-	while (nretries < 2) {
-		nretries++;
-
-		//  Flush input
-		if (!synscan_flush(device))
-			continue;
-
-		//  Send the command to the port
-		if (!synscan_command_unlocked(device, cmd))
-			continue;
-
-		//  Read a response
-		if (synscan_read_response(device, r)) {
-			pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-			return true;
-		}
+	char buffer[20], resp[20];
+	snprintf(buffer, sizeof(buffer), "%s\r", cmd);
+	INDIGO_DRIVER_TRACE(DRIVER_NAME, "CMD: [%s]", cmd);
+	if (indigo_transact(PRIVATE_DATA->handle, &PRIVATE_DATA->port_mutex, &synscan_transaction, buffer, resp, sizeof(resp)) < 0) {
+		//  Mount command failed
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "Reading response failed");
+		return false;
 	}
-
-	//  Mount command failed
-	pthread_mutex_unlock(&PRIVATE_DATA->port_mutex);
-	return false;
+	return synscan_parse_response(device, resp, r);
 }
 
 static bool synscan_command_with_long_result(indigo_device* device, char* cmd, long* val) {
@@ -265,6 +220,23 @@ bool synscan_axis_position(indigo_device* device, enum AxisID axis, long* v) {
 	return synscan_command_with_long_result(device, buffer, v);
 }
 
+//  Read back both motor positions with one round trip
+bool synscan_axis_positions(indigo_device* device, long* raPos, long* decPos) {
+	char dec[20], ra[20];
+	indigo_batch_command commands[2] = { { ":j2\r", dec, sizeof(dec) }, { ":j1\r", ra, sizeof(ra) } };
+	indigo_transact_batch(PRIVATE_DATA->handle, &PRIVATE_DATA->port_mutex, &synscan_transaction, commands, 2);
+	bool ok = true;
+	if (commands[0].result >= 0 && synscan_parse_response(device, dec, dec))
+		*decPos = hexResponseToLong(dec);
+	else
+		ok = false;
+	if (commands[1].result >= 0 && synscan_parse_response(device, ra, ra))
+		*raPos = hexResponseToLong(ra);
+	else
+		ok = false;
+	return ok;
+}
+
 //  Set the encoder reference position for a given axis
 bool synscan_init_axis_position(indigo_device* device, enum AxisID axis, long pos) {
 	char buffer[11];
@@ -56,6 +56,7 @@ bool synscan_step_timer_frequency(indigo_device* device, enum AxisID axis, long*
 bool synscan_high_speed_ratio(indigo_device* device, enum AxisID axis, long* v);
 bool synscan_motor_status(indigo_device* device, enum AxisID axis, long* v);
 bool synscan_axis_position(indigo_device* device, enum AxisID axis, long* v);
+bool synscan_axis_positions(indigo_device* device, long* raPos, long* decPos);
 bool synscan_init_axis_position(indigo_device* device, enum AxisID axis, long pos);
 bool synscan_init_axis(indigo_device* device, enum AxisID axis);
 bool synscan_stop_axis(indigo_device* device, enum AxisID axis);
@@ -24,7 +24,7 @@
  \file indigo_system_ascol.c
  */
 
-#define DRIVER_VERSION 0x0002
+#define DRIVER_VERSION 0x0003
 #define DRIVER_NAME	"indigo_system_ascol"
 
 #include <stdlib.h>
@@ -33,6 +33,8 @@
 #include <pthread.h>
 #include <math.h>
 #include <assert.h>
+#include <errno.h>
+#include <time.h>
 
 #include "indigo_driver_xml.h"
 
@@ -42,7 +44,8 @@
 #define h2d(h) (h * 15.0)
 #define d2h(d) (d / 15.0)
 
-#define REFRESH_SECONDS (1.5)
+#define REFRESH_FAST_SECONDS (0.5)
+#define REFRESH_SLOW_SECONDS (3.0)
 
 #define PRIVATE_DATA                    ((ascol_private_data *)device->private_data)
 
@@ -277,11 +280,17 @@ typedef struct {
 	ascol_glst_t glst;
 	ascol_oimv_t oimv;
 	ascol_glme_t glme;
+	ascol_state_t state;
 
 	pthread_mutex_t net_mutex;
 
 	// Panel
-	indigo_timer *panel_timer;
+	pthread_t refresh_thread;
+	pthread_mutex_t refresh_mutex;
+	pthread_cond_t refresh_cond;
+	bool refresh_running;
+	bool refresh_requested;
+	bool panel_update_all, mount_update_all, guider_update_all, dome_update_all, focus_update_all;
 	indigo_property *alarm_property;
 	indigo_property *glme_property;
 
@@ -339,6 +348,15 @@ static indigo_device *mount_guider = NULL;
 static indigo_device *focuser = NULL;
 static indigo_device *dome = NULL;
 
+/* Wake the panel refresh thread after a command, the next refresh is done REFRESH_FAST_SECONDS later
+   so the controller has time to change its state */
+static void panel_request_refresh(indigo_device *device) {
+	pthread_mutex_lock(&PRIVATE_DATA->refresh_mutex);
+	PRIVATE_DATA->refresh_requested = true;
+	pthread_cond_signal(&PRIVATE_DATA->refresh_cond);
+	pthread_mutex_unlock(&PRIVATE_DATA->refresh_mutex);
+}
+
 
 // -------------------------------------------------------------------------------- INDIGO MOUNT device implementation
 static indigo_result ascol_mount_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
@@ -919,8 +937,7 @@ static void mount_update_state() {
 
 	static ascol_glst_t prev_glst = {0};
 	static ascol_oimv_t prev_oimv = {0};
-	static ascol_glme_t prev_glme = {0};
-	static bool update_all = true;
+	bool update_all = PRIVATE_DATA->mount_update_all;
 
 	char *descr, *descrs;
 	int index;
@@ -1149,9 +1166,9 @@ static void mount_update_state() {
 		indigo_update_property(device, FLAP_COUDE_PROPERTY, NULL);
 	}
 
-	pthread_mutex_lock(&PRIVATE_DATA->net_mutex);
-	int res = ascol_OIMV(PRIVATE_DATA->dev_id, &PRIVATE_DATA->oimv);
-	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
+	int res = PRIVATE_DATA->state.result[ASCOL_STATE_OIMV];
+	if (res == ASCOL_OK)
+		PRIVATE_DATA->oimv = PRIVATE_DATA->state.oimv;
 	if (res != ASCOL_OK) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_OIMV(%d) = %d", PRIVATE_DATA->dev_id, res);
 		OIMV_PROPERTY->state = INDIGO_BUSY_STATE;
@@ -1166,50 +1183,47 @@ static void mount_update_state() {
 		prev_oimv = PRIVATE_DATA->oimv;
 	}
 
-	char west;
-	double ra, ha, dec;
+	indigo_property_state coordinates_state = INDIGO_BUSY_STATE;
 	if ((PRIVATE_DATA->glst.telescope_state >= TE_STATE_INIT) &&
 	    (PRIVATE_DATA->glst.telescope_state <= TE_STATE_OFF_REQ)) {
-		MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
-		HADEC_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
-		HADEC_RELATIVE_MOVE_PROPERTY->state = INDIGO_OK_STATE;
-		RADEC_RELATIVE_MOVE_PROPERTY->state = INDIGO_OK_STATE;
-	} else {
-		MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_BUSY_STATE;
-		HADEC_COORDINATES_PROPERTY->state = INDIGO_BUSY_STATE;
-		HADEC_RELATIVE_MOVE_PROPERTY->state = INDIGO_BUSY_STATE;
-		RADEC_RELATIVE_MOVE_PROPERTY->state = INDIGO_BUSY_STATE;
+		coordinates_state = INDIGO_OK_STATE;
+	}
+	if (update_all || (HADEC_RELATIVE_MOVE_PROPERTY->state != coordinates_state)) {
+		HADEC_RELATIVE_MOVE_PROPERTY->state = coordinates_state;
+		indigo_update_property(device, HADEC_RELATIVE_MOVE_PROPERTY, NULL);
+	}
+	if (update_all || (RADEC_RELATIVE_MOVE_PROPERTY->state != coordinates_state)) {
+		RADEC_RELATIVE_MOVE_PROPERTY->state = coordinates_state;
+		indigo_update_property(device, RADEC_RELATIVE_MOVE_PROPERTY, NULL);
 	}
-	indigo_update_property(device, HADEC_RELATIVE_MOVE_PROPERTY, NULL);
-	indigo_update_property(device, RADEC_RELATIVE_MOVE_PROPERTY, NULL);
 
-	pthread_mutex_lock(&PRIVATE_DATA->net_mutex);
-	res = ascol_TRRD(PRIVATE_DATA->dev_id, &ra, &dec, &west);
-	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
+	/* coordinates are published only if they or the motion state changed, indigo_update_coordinates()
+	   publishes MOUNT_EQUATORIAL_COORDINATES and the derived horizontal coordinates */
+	res = PRIVATE_DATA->state.result[ASCOL_STATE_TRRD];
 	if (res != ASCOL_OK) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_TRRD(%d) = %d", PRIVATE_DATA->dev_id, res);
 		MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_BUSY_STATE;
 		indigo_update_coordinates(device, NULL);
-		indigo_update_property(device, MOUNT_EQUATORIAL_COORDINATES_PROPERTY, NULL);
-	} else {
-		MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = d2h(ra);
-		MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = dec;
+	} else if (update_all || (MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state != coordinates_state) ||
+	          (MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value != d2h(PRIVATE_DATA->state.ra)) ||
+	          (MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value != PRIVATE_DATA->state.ra_de)) {
+		MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = coordinates_state;
+		MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = d2h(PRIVATE_DATA->state.ra);
+		MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = PRIVATE_DATA->state.ra_de;
 		indigo_update_coordinates(device, NULL);
-		indigo_update_property(device, MOUNT_EQUATORIAL_COORDINATES_PROPERTY, NULL);
 	}
 
-	pthread_mutex_lock(&PRIVATE_DATA->net_mutex);
-	res = ascol_TRHD(PRIVATE_DATA->dev_id, &ha, &dec);
-	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
+	res = PRIVATE_DATA->state.result[ASCOL_STATE_TRHD];
 	if (res != ASCOL_OK) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_TRHD(%d) = %d", PRIVATE_DATA->dev_id, res);
 		HADEC_COORDINATES_PROPERTY->state = INDIGO_BUSY_STATE;
-		indigo_update_coordinates(device, NULL);
 		indigo_update_property(device, HADEC_COORDINATES_PROPERTY, NULL);
-	} else {
-		HADEC_COORDINATES_HA_ITEM->number.value = ha;
-		HADEC_COORDINATES_DEC_ITEM->number.value = dec;
-		indigo_update_coordinates(device, NULL);
+	} else if (update_all || (HADEC_COORDINATES_PROPERTY->state != coordinates_state) ||
+	          (HADEC_COORDINATES_HA_ITEM->number.value != PRIVATE_DATA->state.ha) ||
+	          (HADEC_COORDINATES_DEC_ITEM->number.value != PRIVATE_DATA->state.ha_de)) {
+		HADEC_COORDINATES_PROPERTY->state = coordinates_state;
+		HADEC_COORDINATES_HA_ITEM->number.value = PRIVATE_DATA->state.ha;
+		HADEC_COORDINATES_DEC_ITEM->number.value = PRIVATE_DATA->state.ha_de;
 		indigo_update_property(device, HADEC_COORDINATES_PROPERTY, NULL);
 	}
 
@@ -1234,7 +1248,7 @@ static void mount_update_state() {
 	/* should be copied every time as there are several properties
 	   relaying on this and we have no track which one changed */
 	prev_glst = PRIVATE_DATA->glst;
-	update_all = false;
+	PRIVATE_DATA->mount_update_all = false;
 }
 
 
@@ -1498,6 +1512,8 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 					indigo_define_property(device, T3_SPEED_PROPERTY, NULL);
 
 					device->is_connected = true;
+					PRIVATE_DATA->mount_update_all = true;
+					panel_request_refresh(device);
 				} else {
 					CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
 					indigo_set_switch(CONNECTION_PROPERTY, CONNECTION_DISCONNECTED_ITEM, true);
@@ -1549,6 +1565,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(OIL_POWER_PROPERTY, property, false);
 			mount_handle_oil_power(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(TELESCOPE_POWER_PROPERTY, property)) {
@@ -1556,6 +1573,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(TELESCOPE_POWER_PROPERTY, property, false);
 			mount_handle_telescope_power(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(RA_CALIBRATION_PROPERTY, property)) {
@@ -1563,6 +1581,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(RA_CALIBRATION_PROPERTY, property, false);
 			mount_handle_ra_calibration(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(DEC_CALIBRATION_PROPERTY, property)) {
@@ -1570,6 +1589,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(DEC_CALIBRATION_PROPERTY, property, false);
 			mount_handle_dec_calibration(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(ABERRATION_PROPERTY, property)) {
@@ -1577,6 +1597,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(ABERRATION_PROPERTY, property, false);
 			mount_handle_aberration(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(PRECESSION_PROPERTY, property)) {
@@ -1584,6 +1605,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(PRECESSION_PROPERTY, property, false);
 			mount_handle_precession(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(REFRACTION_PROPERTY, property)) {
@@ -1591,6 +1613,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(REFRACTION_PROPERTY, property, false);
 			mount_handle_refraction(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(ERROR_CORRECTION_PROPERTY, property)) {
@@ -1598,6 +1621,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(ERROR_CORRECTION_PROPERTY, property, false);
 			mount_handle_error_correction(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(CORRECTION_MODEL_PROPERTY, property)) {
@@ -1605,6 +1629,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(CORRECTION_MODEL_PROPERTY, property, false);
 			mount_handle_correction_model(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(GUIDE_MODE_PROPERTY, property)) {
@@ -1612,6 +1637,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(GUIDE_MODE_PROPERTY, property, false);
 			mount_handle_guide_mode(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(FLAP_TUBE_PROPERTY, property)) {
@@ -1619,6 +1645,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(FLAP_TUBE_PROPERTY, property, false);
 			mount_handle_flap_tube(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(FLAP_COUDE_PROPERTY, property)) {
@@ -1626,6 +1653,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(FLAP_COUDE_PROPERTY, property, false);
 			mount_handle_flap_coude(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 
@@ -1641,6 +1669,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value = ra;
 		MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value = dec;
 		mount_handle_eq_coordinates(device);
+		panel_request_refresh(device);
 		return INDIGO_OK;
 	} else if (indigo_property_match(HADEC_COORDINATES_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- HADEC_COORDINATES
@@ -1654,6 +1683,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		HADEC_COORDINATES_HA_ITEM->number.value = ha;
 		HADEC_COORDINATES_DEC_ITEM->number.value = dec;
 		mount_handle_hadec_coordinates(device);
+		panel_request_refresh(device);
 		return INDIGO_OK;
 	} else if (indigo_property_match(HADEC_RELATIVE_MOVE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- HADEC_RELATIVE_MOVE
@@ -1663,6 +1693,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		}
 		indigo_property_copy_values(HADEC_RELATIVE_MOVE_PROPERTY, property, false);
 		mount_handle_hadec_relative_move(device);
+		panel_request_refresh(device);
 		return INDIGO_OK;
 	} else if (indigo_property_match(RADEC_RELATIVE_MOVE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- RADEC_RELATIVE_MOVE
@@ -1672,6 +1703,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		}
 		indigo_property_copy_values(RADEC_RELATIVE_MOVE_PROPERTY, property, false);
 		mount_handle_radec_relative_move(device);
+		panel_request_refresh(device);
 		return INDIGO_OK;
 	} else if (indigo_property_match(MOUNT_TRACKING_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- MOUNT_TRACKING
@@ -1681,6 +1713,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		//}
 		indigo_property_copy_values(MOUNT_TRACKING_PROPERTY, property, false);
 		mount_handle_tracking(device);
+		panel_request_refresh(device);
 		return INDIGO_OK;
 	} else if (indigo_property_match(MOUNT_SLEW_RATE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- MOUNT_SLEW_RATE
@@ -1697,6 +1730,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		}
 		indigo_property_copy_values(MOUNT_MOTION_DEC_PROPERTY, property, false);
 		mount_handle_motion_ns(device);
+		panel_request_refresh(device);
 		return INDIGO_OK;
 	} else if (indigo_property_match(MOUNT_MOTION_RA_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- MOUNT_MOTION_WE
@@ -1706,11 +1740,13 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		}
 		indigo_property_copy_values(MOUNT_MOTION_RA_PROPERTY, property, false);
 		mount_handle_motion_ne(device);
+		panel_request_refresh(device);
 		return INDIGO_OK;
 	} else if (indigo_property_match(MOUNT_PARK_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- MOUNT_PARK
 		indigo_property_copy_values(MOUNT_PARK_PROPERTY, property, false);
 		mount_handle_park(device);
+		panel_request_refresh(device);
 		indigo_update_property(device, MOUNT_PARK_PROPERTY, NULL);
 		return INDIGO_OK;
 	} else if (indigo_property_match(MOUNT_ABORT_MOTION_PROPERTY, property)) {
@@ -1718,6 +1754,7 @@ static indigo_result mount_change_property(indigo_device *device, indigo_client
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(MOUNT_ABORT_MOTION_PROPERTY, property, false);
 			mount_handle_abort_motion(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 		// --------------------------------------------------------------------------------
@@ -1794,13 +1831,11 @@ static void guider_update_state() {
 	indigo_device *device = mount_guider;
 	if ((device == NULL) || (!IS_CONNECTED)) return;
 
-	double ra_corr, dec_corr;
+	double ra_corr = PRIVATE_DATA->state.ra_gv, dec_corr = PRIVATE_DATA->state.de_gv;
 	static double prev_ra_corr, prev_dec_corr;
-	static bool update_all = true;
+	bool update_all = PRIVATE_DATA->guider_update_all;
 
-	pthread_mutex_lock(&PRIVATE_DATA->net_mutex);
-	int res = ascol_TRGV(PRIVATE_DATA->dev_id, &ra_corr, &dec_corr);
-	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
+	int res = PRIVATE_DATA->state.result[ASCOL_STATE_TRGV];
 	if (res != ASCOL_OK) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_TRGV(%d) = %d", PRIVATE_DATA->dev_id, res);
 		GUIDE_CORRECTION_PROPERTY->state = INDIGO_ALERT_STATE;
@@ -1815,7 +1850,7 @@ static void guider_update_state() {
 	}
 	prev_ra_corr = ra_corr;
 	prev_dec_corr = dec_corr;
-	update_all = false;
+	PRIVATE_DATA->guider_update_all = false;
 }
 
 
@@ -1859,6 +1894,8 @@ static indigo_result guider_change_property(indigo_device *device, indigo_client
 					PRIVATE_DATA->guider_timer_dec = NULL;
 					CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 					indigo_define_property(device, GUIDE_CORRECTION_PROPERTY, NULL);
+					PRIVATE_DATA->guider_update_all = true;
+					panel_request_refresh(device);
 				} else {
 					CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
 					indigo_set_switch(CONNECTION_PROPERTY, CONNECTION_DISCONNECTED_ITEM, true);
@@ -1990,7 +2027,7 @@ static void dome_update_state() {
 	if ((device == NULL) || (!IS_CONNECTED)) return;
 
 	static ascol_glst_t prev_glst = {0};
-	static bool update_all = true;
+	bool update_all = PRIVATE_DATA->dome_update_all;
 	static bool update_horizontal = false;
 	static double prev_dome_az = 0;
 	char *descrs, *descr;
@@ -2078,9 +2115,9 @@ static void dome_update_state() {
 		indigo_update_property(device, DOME_SHUTTER_PROPERTY, NULL);
 	}
 
-	pthread_mutex_lock(&PRIVATE_DATA->net_mutex);
-	int res = ascol_DOPO(PRIVATE_DATA->dev_id, &DOME_HORIZONTAL_COORDINATES_AZ_ITEM->number.value);
-	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
+	int res = PRIVATE_DATA->state.result[ASCOL_STATE_DOPO];
+	if (res == ASCOL_OK)
+		DOME_HORIZONTAL_COORDINATES_AZ_ITEM->number.value = PRIVATE_DATA->state.dome_pos;
 	if (res != ASCOL_OK) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_DOPO(%d) = %d", PRIVATE_DATA->dev_id, res);
 		DOME_HORIZONTAL_COORDINATES_PROPERTY->state = INDIGO_BUSY_STATE;
@@ -2100,7 +2137,7 @@ static void dome_update_state() {
 	   relaying on this and we have no track which one changed */
 	prev_glst = PRIVATE_DATA->glst;
 
-	update_all = false;
+	PRIVATE_DATA->dome_update_all = false;
 	prev_dome_az = DOME_HORIZONTAL_COORDINATES_AZ_ITEM->number.value;
 }
 
@@ -2320,6 +2357,8 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 					indigo_define_property(device, DOME_STATE_PROPERTY, NULL);
 					indigo_define_property(device, DOME_SHUTTER_STATE_PROPERTY, NULL);
 					device->is_connected = true;
+					PRIVATE_DATA->dome_update_all = true;
+					panel_request_refresh(device);
 				} else {
 					CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
 					indigo_set_switch(CONNECTION_PROPERTY, CONNECTION_DISCONNECTED_ITEM, true);
@@ -2340,6 +2379,7 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(DOME_POWER_PROPERTY, property, false);
 			dome_handle_power(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(DOME_AUTO_SYNC_PROPERTY, property)) {
@@ -2347,6 +2387,7 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(DOME_AUTO_SYNC_PROPERTY, property, false);
 			dome_handle_auto_mode(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(DOME_STEPS_PROPERTY, property)) {
@@ -2354,6 +2395,7 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(DOME_STEPS_PROPERTY, property, false);
 			dome_handle_steps(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(DOME_HORIZONTAL_COORDINATES_PROPERTY, property)) {
@@ -2361,6 +2403,7 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(DOME_HORIZONTAL_COORDINATES_PROPERTY, property, false);
 			dome_handle_coordinates(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(DOME_ABORT_MOTION_PROPERTY, property)) {
@@ -2368,6 +2411,7 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(DOME_ABORT_MOTION_PROPERTY, property, false);
 			dome_handle_abort(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(DOME_SHUTTER_PROPERTY, property)) {
@@ -2375,6 +2419,7 @@ static indigo_result dome_change_property(indigo_device *device, indigo_client *
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(DOME_SHUTTER_PROPERTY, property, false);
 			dome_handle_slit(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(DOME_PARK_PROPERTY, property)) {
@@ -2431,7 +2476,7 @@ static void focus_update_state() {
 	if ((device == NULL) || (!IS_CONNECTED)) return;
 
 	static ascol_glst_t prev_glst = {0};
-	static bool update_all = true;
+	bool update_all = PRIVATE_DATA->focus_update_all;
 	static bool update_focus = true;
 	static double prev_focus_pos = 0;
 	char *descrs, *descr;
@@ -2463,9 +2508,9 @@ static void focus_update_state() {
 		}
 	}
 
-	pthread_mutex_lock(&PRIVATE_DATA->net_mutex);
-	int res = ascol_FOPO(PRIVATE_DATA->dev_id, &FOCUSER_POSITION_ITEM->number.value);
-	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
+	int res = PRIVATE_DATA->state.result[ASCOL_STATE_FOPO];
+	if (res == ASCOL_OK)
+		FOCUSER_POSITION_ITEM->number.value = PRIVATE_DATA->state.focus_pos;
 	if (res != ASCOL_OK) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_FOPO(%d) = %d", PRIVATE_DATA->dev_id, res);
 		FOCUSER_POSITION_PROPERTY->state = INDIGO_BUSY_STATE;
@@ -2485,7 +2530,7 @@ static void focus_update_state() {
 	   relaying on this and we have no track which one changed */
 	prev_glst = PRIVATE_DATA->glst;
 
-	update_all = false;
+	PRIVATE_DATA->focus_update_all = false;
 	prev_focus_pos = FOCUSER_POSITION_ITEM->number.value;
 }
 
@@ -2620,6 +2665,8 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 					CONNECTION_PROPERTY->state = INDIGO_OK_STATE;
 					indigo_define_property(device, FOCUSER_STATE_PROPERTY, NULL);
 					device->is_connected = true;
+					PRIVATE_DATA->focus_update_all = true;
+					panel_request_refresh(device);
 				} else {
 					CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
 					indigo_set_switch(CONNECTION_PROPERTY, CONNECTION_DISCONNECTED_ITEM, true);
@@ -2638,6 +2685,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(FOCUSER_STEPS_PROPERTY, property, false);
 			focus_handle_steps(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(FOCUSER_POSITION_PROPERTY, property)) {
@@ -2645,6 +2693,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(FOCUSER_POSITION_PROPERTY, property, false);
 			focus_handle_position(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 	} else if (indigo_property_match(FOCUSER_ABORT_MOTION_PROPERTY, property)) {
@@ -2652,6 +2701,7 @@ static indigo_result focuser_change_property(indigo_device *device, indigo_clien
 		if (IS_CONNECTED) {
 			indigo_property_copy_values(FOCUSER_ABORT_MOTION_PROPERTY, property, false);
 			focus_handle_abort(device);
+			panel_request_refresh(device);
 		}
 		return INDIGO_OK;
 		// --------------------------------------------------------------------------------
@@ -2760,15 +2810,27 @@ static void panel_detach_devices() {
 }
 
 
-static void panel_timer_callback(indigo_device *device) {
+/* All panel queries are read in one pipelined burst, properties of every connected device are then
+   published only if their values or states changed. Returns true if something is moving. */
+static bool panel_update_state(indigo_device *device) {
 	static ascol_glst_t prev_glst = {0};
 	static ascol_glme_t prev_glme = {0};
-	static bool update_all = true;
+	bool update_all = PRIVATE_DATA->panel_update_all;
 	char *descr, *descrs;
 	int index;
 
 	pthread_mutex_lock(&PRIVATE_DATA->net_mutex);
-	int res = ascol_GLST(PRIVATE_DATA->dev_id, &PRIVATE_DATA->glst);
+	int res = ascol_read_state(PRIVATE_DATA->dev_id, &PRIVATE_DATA->state);
+	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
+	if (res != ASCOL_OK) {
+		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_read_state(%d) = %d", PRIVATE_DATA->dev_id, res);
+		for (index = 0; index < ASCOL_STATE_N; index++)
+			PRIVATE_DATA->state.result[index] = res;
+	}
+
+	res = PRIVATE_DATA->state.result[ASCOL_STATE_GLST];
+	if (res == ASCOL_OK)
+		PRIVATE_DATA->glst = PRIVATE_DATA->state.glst;
 	if (res != ASCOL_OK) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_GLST(%d) = %d", PRIVATE_DATA->dev_id, res);
 		ALARM_PROPERTY->state = INDIGO_BUSY_STATE;
@@ -2793,10 +2855,10 @@ static void panel_timer_callback(indigo_device *device) {
 		indigo_update_property(device, ALARM_PROPERTY, NULL);
 	}
 
-	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
-	pthread_mutex_lock(&PRIVATE_DATA->net_mutex);
-	res = ascol_GLME(PRIVATE_DATA->dev_id, &PRIVATE_DATA->glme);
-	pthread_mutex_unlock(&PRIVATE_DATA->net_mutex);
+	res = PRIVATE_DATA->state.result[ASCOL_STATE_GLME];
+	if (res == ASCOL_OK) {
+		memcpy(PRIVATE_DATA->glme.value, PRIVATE_DATA->state.glme.value, sizeof(PRIVATE_DATA->glme.value));
+	}
 	if (res != ASCOL_OK) {
 		INDIGO_DRIVER_ERROR(DRIVER_NAME, "ascol_GLME(%d) = %d", PRIVATE_DATA->dev_id, res);
 		GLME_PROPERTY->state = INDIGO_BUSY_STATE;
@@ -2821,15 +2883,75 @@ static void panel_timer_callback(indigo_device *device) {
 	focus_update_state();
 	guider_update_state();
 
-	// Reschedule execution
-	update_all = false;
-	indigo_reschedule_timer(device, REFRESH_SECONDS, &PRIVATE_DATA->panel_timer);
+	PRIVATE_DATA->panel_update_all = false;
+	if (PRIVATE_DATA->state.result[ASCOL_STATE_GLST] != ASCOL_OK)
+		return false;
+	return
+		(PRIVATE_DATA->glst.telescope_state > TE_STATE_OFF_REQ) ||
+		(PRIVATE_DATA->glst.ra_axis_state > 1) || (PRIVATE_DATA->glst.de_axis_state > 1) ||
+		((PRIVATE_DATA->glst.oil_state >= OIL_STATE_START1) && (PRIVATE_DATA->glst.oil_state <= OIL_STATE_START3)) ||
+		((PRIVATE_DATA->glst.dome_state != DOME_STATE_OFF) && (PRIVATE_DATA->glst.dome_state != DOME_STATE_STOP) && (PRIVATE_DATA->glst.dome_state != DOME_STATE_AUTO_STOP)) ||
+		((PRIVATE_DATA->glst.focus_state != FOCUS_STATE_OFF) && (PRIVATE_DATA->glst.focus_state != FOCUS_STATE_STOP)) ||
+		(PRIVATE_DATA->glst.slit_state == SF_STATE_OPENING) || (PRIVATE_DATA->glst.slit_state == SF_STATE_CLOSING) ||
+		(PRIVATE_DATA->glst.flap_tube_state == SF_STATE_OPENING) || (PRIVATE_DATA->glst.flap_tube_state == SF_STATE_CLOSING) ||
+		(PRIVATE_DATA->glst.flap_coude_state == SF_STATE_OPENING) || (PRIVATE_DATA->glst.flap_coude_state == SF_STATE_CLOSING);
+}
+
+static void timespec_add(struct timespec *ts, double seconds) {
+	long nsec = ts->tv_nsec + (long)((seconds - (long)seconds) * 1e9);
+	ts->tv_sec += (long)seconds + nsec / 1000000000;
+	ts->tv_nsec = nsec % 1000000000;
+}
+
+/* Refresh thread runs on panel connection, it refreshes every REFRESH_FAST_SECONDS while something is moving
+   and every REFRESH_SLOW_SECONDS otherwise, panel_request_refresh() shortens the wait after a command */
+static void *panel_refresh_thread(void *arg) {
+	indigo_device *device = (indigo_device *)arg;
+	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Refresh thread started");
+	pthread_mutex_lock(&PRIVATE_DATA->refresh_mutex);
+	while (PRIVATE_DATA->refresh_running) {
+		PRIVATE_DATA->refresh_requested = false;
+		pthread_mutex_unlock(&PRIVATE_DATA->refresh_mutex);
+		bool moving = panel_update_state(device);
+		pthread_mutex_lock(&PRIVATE_DATA->refresh_mutex);
+		struct timespec deadline, now;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		timespec_add(&deadline, moving ? REFRESH_FAST_SECONDS : REFRESH_SLOW_SECONDS);
+		while (PRIVATE_DATA->refresh_running) {
+			if (PRIVATE_DATA->refresh_requested) {
+				PRIVATE_DATA->refresh_requested = false;
+				clock_gettime(CLOCK_REALTIME, &now);
+				timespec_add(&now, REFRESH_FAST_SECONDS);
+				if ((now.tv_sec < deadline.tv_sec) || ((now.tv_sec == deadline.tv_sec) && (now.tv_nsec < deadline.tv_nsec)))
+					deadline = now;
+			}
+			if (pthread_cond_timedwait(&PRIVATE_DATA->refresh_cond, &PRIVATE_DATA->refresh_mutex, &deadline) == ETIMEDOUT)
+				break;
+		}
+	}
+	pthread_mutex_unlock(&PRIVATE_DATA->refresh_mutex);
+	INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Refresh thread finished");
+	return NULL;
+}
+
+static void panel_stop_refresh(indigo_device *device) {
+	pthread_mutex_lock(&PRIVATE_DATA->refresh_mutex);
+	if (!PRIVATE_DATA->refresh_running) {
+		pthread_mutex_unlock(&PRIVATE_DATA->refresh_mutex);
+		return;
+	}
+	PRIVATE_DATA->refresh_running = false;
+	pthread_cond_signal(&PRIVATE_DATA->refresh_cond);
+	pthread_mutex_unlock(&PRIVATE_DATA->refresh_mutex);
+	pthread_join(PRIVATE_DATA->refresh_thread, NULL);
 }
 
 static indigo_result panel_attach(indigo_device *device) {
 	assert(device != NULL);
 	assert(PRIVATE_DATA != NULL);
 	if (indigo_aux_attach(device, DRIVER_VERSION) == INDIGO_OK) {
+		pthread_mutex_init(&PRIVATE_DATA->refresh_mutex, NULL);
+		pthread_cond_init(&PRIVATE_DATA->refresh_cond, NULL);
 		// -------------------------------------------------------------------------------- DEVICE_PORT, DEVICE_PORTS
 		DEVICE_PORTS_PROPERTY->hidden = true;
 		AUTHENTICATION_PROPERTY->hidden = false;
@@ -2902,7 +3024,12 @@ static indigo_result panel_change_property(indigo_device *device, indigo_client
 					indigo_define_property(device, GLME_PROPERTY, NULL);
 					device->is_connected = true;
 					/* start updates */
-					PRIVATE_DATA->panel_timer = indigo_set_timer(device, 0, panel_timer_callback);
+					PRIVATE_DATA->panel_update_all = true;
+					PRIVATE_DATA->refresh_running = true;
+					if (pthread_create(&PRIVATE_DATA->refresh_thread, NULL, panel_refresh_thread, device)) {
+						INDIGO_DRIVER_ERROR(DRIVER_NAME, "Can't create refresh thread");
+						PRIVATE_DATA->refresh_running = false;
+					}
 					panel_attach_devices(device);
 				} else {
 					CONNECTION_PROPERTY->state = INDIGO_ALERT_STATE;
@@ -2911,8 +3038,8 @@ static indigo_result panel_change_property(indigo_device *device, indigo_client
 			}
 		} else {
 			if (device->is_connected) {
+				panel_stop_refresh(device);
 				panel_detach_devices();
-				indigo_cancel_timer(device, &PRIVATE_DATA->panel_timer);
 				ascol_device_close(device);
 				indigo_delete_property(device, ALARM_PROPERTY, NULL);
 				indigo_define_property(device, GLME_PROPERTY, NULL);
@@ -2928,11 +3055,13 @@ static indigo_result panel_detach(indigo_device *device) {
 	assert(device != NULL);
 	if (CONNECTION_CONNECTED_ITEM->sw.value) {
 		indigo_device_disconnect(NULL, device->name);
-		indigo_cancel_timer(device, &PRIVATE_DATA->panel_timer);
+		panel_stop_refresh(device);
 	}
 
 	indigo_release_property(ALARM_PROPERTY);
 	indigo_release_property(GLME_PROPERTY);
+	pthread_mutex_destroy(&PRIVATE_DATA->refresh_mutex);
+	pthread_cond_destroy(&PRIVATE_DATA->refresh_cond);
 
 	INDIGO_DEVICE_DETACH_LOG(DRIVER_NAME, device->name);
 	return indigo_aux_detach(device);
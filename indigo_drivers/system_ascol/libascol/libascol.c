@@ -593,6 +593,70 @@ int ascol_check_alarm(ascol_glst_t glst, int alarm, char **descr, int *state) {
 }
 
 
+/* Response parsers shared by the single commands and ascol_read_state() */
+
+static int parse_1_double(const char *resp, double *val) {
+	if (sscanf(resp, "%lf", val) != 1) return ASCOL_RESPONCE_ERROR;
+	return ASCOL_OK;
+}
+
+static int parse_2_double(const char *resp, double *val1, double *val2) {
+	if (sscanf(resp, "%lf %lf", val1, val2) != 2) return ASCOL_RESPONCE_ERROR;
+	return ASCOL_OK;
+}
+
+static int parse_3_ra_de_w(const char *resp, double *ra, double *de, char *west) {
+	char ra_s[ASCOL_MSG_LEN];
+	char de_s[ASCOL_MSG_LEN];
+	int west_c;
+
+	if (sscanf(resp, "%s %s %d", ra_s, de_s, &west_c) != 3) return ASCOL_RESPONCE_ERROR;
+	if (ascol_hms2dd(ra, ra_s)) return ASCOL_RESPONCE_ERROR;
+	if (ascol_dms2dd(de, de_s)) return ASCOL_RESPONCE_ERROR;
+	*west = west_c;
+	return ASCOL_OK;
+}
+
+static int parse_oimv(const char *resp, ascol_oimv_t *oimv) {
+	int res = sscanf(
+		resp, "%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
+		&(oimv->value[0]), &(oimv->value[1]), &(oimv->value[2]), &(oimv->value[3]), &(oimv->value[4]),
+		&(oimv->value[5]), &(oimv->value[6]), &(oimv->value[7]), &(oimv->value[8]), &(oimv->value[9]),
+		&(oimv->value[10]), &(oimv->value[11]),&(oimv->value[12]), &(oimv->value[13]), &(oimv->value[14]),
+		&(oimv->value[15]), &(oimv->value[16])
+	);
+	if (res != ASCOL_OIMV_N) return ASCOL_RESPONCE_ERROR;
+	return ASCOL_OK;
+}
+
+static int parse_glme(const char *resp, ascol_glme_t *glme) {
+	int res = sscanf(
+		resp, "%lf %lf %lf %lf %lf %lf %lf",
+		&(glme->value[0]), &(glme->value[1]), &(glme->value[2]), &(glme->value[3]),
+		&(glme->value[4]), &(glme->value[5]), &(glme->value[6])
+	);
+	if (res != ASCOL_GLME_N) return ASCOL_RESPONCE_ERROR;
+	return ASCOL_OK;
+}
+
+static int parse_glst(const char *resp, ascol_glst_t *glst) {
+	int res = sscanf(
+		resp, "%hu %hu %hu %hu %hu %*d %hu %hu %hu %hu %*d %*d %*d %*d %hu %hu %hu %hu %hu %hu %hu %*d",
+		&(glst->oil_state), &(glst->telescope_state), &(glst->ra_axis_state), &(glst->de_axis_state), &(glst->focus_state),
+		&(glst->dome_state), &(glst->slit_state), &(glst->flap_tube_state), &(glst->flap_coude_state), &(glst->selected_model_index),
+		&(glst->state_bits), &(glst->alarm_bits[0]), &(glst->alarm_bits[1]), &(glst->alarm_bits[2]), &(glst->alarm_bits[3]),
+		&(glst->alarm_bits[4])
+	);
+	/* sscanf() returns the number of matched fields on Linux,
+	   on MacOS returns tne number of read fields */
+	if ((res != ASCOL_GLST_N_LINUX) && (res != ASCOL_GLST_N_MACOS)) {
+		ASCOL_DEBUG("%s()=%2d <=> parsed %d fields\n", __FUNCTION__, ASCOL_RESPONCE_ERROR, res);
+		return ASCOL_RESPONCE_ERROR;
+	}
+	return ASCOL_OK;
+}
+
+
 /* COMMANDS TO ASCOL CONTROLER */
 /* Most commands are mapped to the following functions */
 
@@ -692,7 +756,7 @@ int ascol_2_double_1_int_param_cmd(int devfd, char *cmd_name, double param1, int
 int ascol_1_double_return_cmd(int devfd, char *cmd_name, double *val) {
 	char cmd[ASCOL_MSG_LEN] = {0};
 	char resp[ASCOL_MSG_LEN] = {0};
-	double buf;
+	double buf = 0;
 
 	snprintf(cmd, ASCOL_MSG_LEN, "%s\n", cmd_name);
 	int res = ascol_write(devfd, cmd);
@@ -703,12 +767,12 @@ int ascol_1_double_return_cmd(int devfd, char *cmd_name, double *val) {
 	ASCOL_DEBUG_READ(res, resp);
 	if (res <= 0) return ASCOL_READ_ERROR;
 
-	res = sscanf(resp, "%lf", &buf);
-	if (res != 1) return ASCOL_RESPONCE_ERROR;
+	res = parse_1_double(resp, &buf);
+	if (res != ASCOL_OK) return res;
 
 	if (val) *val = buf;
 
-	ASCOL_DEBUG("%s()=%2d <=> %lf\n", __FUNCTION__, ASCOL_OK, *val);
+	ASCOL_DEBUG("%s()=%2d <=> %lf\n", __FUNCTION__, ASCOL_OK, buf);
 	return ASCOL_OK;
 }
 
@@ -716,8 +780,8 @@ int ascol_1_double_return_cmd(int devfd, char *cmd_name, double *val) {
 int ascol_2_double_return_cmd(int devfd, char *cmd_name, double *val1, double *val2) {
 	char cmd[ASCOL_MSG_LEN] = {0};
 	char resp[ASCOL_MSG_LEN] = {0};
-	double buf1;
-	double buf2;
+	double buf1 = 0;
+	double buf2 = 0;
 
 	snprintf(cmd, ASCOL_MSG_LEN, "%s\n", cmd_name);
 	int res = ascol_write(devfd, cmd);
@@ -728,13 +792,13 @@ int ascol_2_double_return_cmd(int devfd, char *cmd_name, double *val1, double *v
 	ASCOL_DEBUG_READ(res, resp);
 	if (res <= 0) return ASCOL_READ_ERROR;
 
-	res = sscanf(resp, "%lf %lf", &buf1, &buf2);
-	if (res != 2) return ASCOL_RESPONCE_ERROR;
+	res = parse_2_double(resp, &buf1, &buf2);
+	if (res != ASCOL_OK) return res;
 
 	if (val1) *val1 = buf1;
 	if (val2) *val2 = buf2;
 
-	ASCOL_DEBUG("%s()=%2d <=> %lf %lf\n", __FUNCTION__, ASCOL_OK, *val1, *val2);
+	ASCOL_DEBUG("%s()=%2d <=> %lf %lf\n", __FUNCTION__, ASCOL_OK, buf1, buf2);
 	return ASCOL_OK;
 }
 
@@ -742,9 +806,8 @@ int ascol_2_double_return_cmd(int devfd, char *cmd_name, double *val1, double *v
 int ascol_3_ra_de_w_return_cmd(int devfd, char *cmd_name, double *ra, double *de, char *west) {
 	char cmd[ASCOL_MSG_LEN] = {0};
 	char resp[ASCOL_MSG_LEN] = {0};
-	char ra_s[ASCOL_MSG_LEN];
-	char de_s[ASCOL_MSG_LEN];
-	int west_c;
+	double ra_d = 0, de_d = 0;
+	char west_c = 0;
 
 	snprintf(cmd, ASCOL_MSG_LEN, "%s\n", cmd_name);
 	int res = ascol_write(devfd, cmd);
@@ -755,19 +818,14 @@ int ascol_3_ra_de_w_return_cmd(int devfd, char *cmd_name, double *ra, double *de
 	ASCOL_DEBUG_READ(res, resp);
 	if (res <= 0) return ASCOL_READ_ERROR;
 
-	res = sscanf(resp, "%s %s %d", ra_s, de_s, &west_c);
-	if (res != 3) return ASCOL_RESPONCE_ERROR;
-
-	res = 0;
-	if (ra) res = ascol_hms2dd(ra, ra_s);
-	if (res) return ASCOL_RESPONCE_ERROR;
-
-	if (de) res = ascol_dms2dd(de, de_s);
-	if (res) return ASCOL_RESPONCE_ERROR;
+	res = parse_3_ra_de_w(resp, &ra_d, &de_d, &west_c);
+	if (res != ASCOL_OK) return res;
 
+	if (ra) *ra = ra_d;
+	if (de) *de = de_d;
 	if (west) *west = west_c;
 
-	ASCOL_DEBUG("%s()=%2d <=> %lf %lf %d\n", __FUNCTION__, ASCOL_OK, *ra, *de, *west);
+	ASCOL_DEBUG("%s()=%2d <=> %lf %lf %d\n", __FUNCTION__, ASCOL_OK, ra_d, de_d, west_c);
 	return ASCOL_OK;
 }
 
@@ -792,14 +850,8 @@ int ascol_OIMV(int devfd, ascol_oimv_t *oimv) {
 	ASCOL_DEBUG_READ(res, resp);
 	if (res <= 0) return ASCOL_READ_ERROR;
 
-	res = sscanf(
-		resp, "%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
-		&(oimv->value[0]), &(oimv->value[1]), &(oimv->value[2]), &(oimv->value[3]), &(oimv->value[4]),
-		&(oimv->value[5]), &(oimv->value[6]), &(oimv->value[7]), &(oimv->value[8]), &(oimv->value[9]),
-		&(oimv->value[10]), &(oimv->value[11]),&(oimv->value[12]), &(oimv->value[13]), &(oimv->value[14]),
-		&(oimv->value[15]), &(oimv->value[16])
-	);
-	if (res != ASCOL_OIMV_N) return ASCOL_RESPONCE_ERROR;
+	res = parse_oimv(resp, oimv);
+	if (res != ASCOL_OK) return res;
 
 	ASCOL_DEBUG("%s()=%2d <=> ascol_oimv_t\n", __FUNCTION__, ASCOL_OK);
 	return ASCOL_OK;
@@ -871,12 +923,8 @@ int ascol_GLME(int devfd, ascol_glme_t *glme) {
 	ASCOL_DEBUG_READ(res, resp);
 	if (res <= 0) return ASCOL_READ_ERROR;
 
-	res = sscanf(
-		resp, "%lf %lf %lf %lf %lf %lf %lf",
-		&(glme->value[0]), &(glme->value[1]), &(glme->value[2]), &(glme->value[3]),
-		&(glme->value[4]), &(glme->value[5]), &(glme->value[6])
-	);
-	if (res != ASCOL_GLME_N) return ASCOL_RESPONCE_ERROR;
+	res = parse_glme(resp, glme);
+	if (res != ASCOL_OK) return res;
 
 	ASCOL_DEBUG("%s()=%2d <=> ascol_glme_t\n", __FUNCTION__, ASCOL_OK);
 	return ASCOL_OK;
@@ -897,20 +945,73 @@ int ascol_GLST(int devfd, ascol_glst_t *glst) {
 	ASCOL_DEBUG_READ(res, resp);
 	if (res <= 0) return ASCOL_READ_ERROR;
 
-	res = sscanf(
-		resp, "%hu %hu %hu %hu %hu %*d %hu %hu %hu %hu %*d %*d %*d %*d %hu %hu %hu %hu %hu %hu %hu %*d",
-		&(glst->oil_state), &(glst->telescope_state), &(glst->ra_axis_state), &(glst->de_axis_state), &(glst->focus_state),
-		&(glst->dome_state), &(glst->slit_state), &(glst->flap_tube_state), &(glst->flap_coude_state), &(glst->selected_model_index),
-		&(glst->state_bits), &(glst->alarm_bits[0]), &(glst->alarm_bits[1]), &(glst->alarm_bits[2]), &(glst->alarm_bits[3]),
-		&(glst->alarm_bits[4])
-	);
-	/* sscanf() returns the number of matched fields on Linux,
-	   on MacOS returns tne number of read fields */
-	if ((res != ASCOL_GLST_N_LINUX) && (res != ASCOL_GLST_N_MACOS)) {
-		ASCOL_DEBUG("%s()=%2d <=> parsed %d fields\n", __FUNCTION__, ASCOL_RESPONCE_ERROR, res);
-		return ASCOL_RESPONCE_ERROR;
-	}
+	res = parse_glst(resp, glst);
+	if (res != ASCOL_OK) return res;
 
 	ASCOL_DEBUG("%s()=%2d <=> ascol_glst_t\n", __FUNCTION__, ASCOL_OK);
 	return ASCOL_OK;
 }
+
+
+/* Panel state: all status queries are written in one burst and the responses are read back in order,
+   so a refresh costs one round trip instead of one per query. Every query is answered by exactly
+   one line, so a failed query does not break the stream and is only reported in state->result[]. */
+
+static const char *state_cmds[ASCOL_STATE_N] = { "GLST", "GLME", "OIMV", "TRRD", "TRHD", "TRGV", "DOPO", "FOPO" };
+
+int ascol_read_state(int devfd, ascol_state_t *state) {
+	char cmd[ASCOL_MSG_LEN] = {0};
+	char resp[ASCOL_MSG_LEN];
+
+	if ((!state) || (devfd < 0)) return ASCOL_PARAM_ERROR;
+
+	state->glme.description = (char **)glme_descriptions;
+	state->glme.unit = (char **)glme_units;
+	state->oimv.description = (char **)oimv_descriptions;
+	state->oimv.unit = (char **)oimv_units;
+
+	for (int i = 0; i < ASCOL_STATE_N; i++) {
+		strcat(cmd, state_cmds[i]);
+		strcat(cmd, "\n");
+	}
+	int res = ascol_write(devfd, cmd);
+	ASCOL_DEBUG_WRITE(res, cmd);
+	if (res != strlen(cmd)) return ASCOL_WRITE_ERROR;
+
+	for (int i = 0; i < ASCOL_STATE_N; i++) {
+		memset(resp, 0, sizeof(resp));
+		res = ascol_read(devfd, resp, ASCOL_MSG_LEN);
+		ASCOL_DEBUG_READ(res, resp);
+		if (res <= 0) return ASCOL_READ_ERROR;
+		switch (i) {
+			case ASCOL_STATE_GLST:
+				res = parse_glst(resp, &state->glst);
+				break;
+			case ASCOL_STATE_GLME:
+				res = parse_glme(resp, &state->glme);
+				break;
+			case ASCOL_STATE_OIMV:
+				res = parse_oimv(resp, &state->oimv);
+				break;
+			case ASCOL_STATE_TRRD:
+				res = parse_3_ra_de_w(resp, &state->ra, &state->ra_de, &state->west);
+				break;
+			case ASCOL_STATE_TRHD:
+				res = parse_2_double(resp, &state->ha, &state->ha_de);
+				break;
+			case ASCOL_STATE_TRGV:
+				res = parse_2_double(resp, &state->ra_gv, &state->de_gv);
+				break;
+			case ASCOL_STATE_DOPO:
+				res = parse_1_double(resp, &state->dome_pos);
+				break;
+			case ASCOL_STATE_FOPO:
+				res = parse_1_double(resp, &state->focus_pos);
+				break;
+		}
+		state->result[i] = res;
+	}
+
+	ASCOL_DEBUG("%s()=%2d <=> ascol_state_t\n", __FUNCTION__, ASCOL_OK);
+	return ASCOL_OK;
+}
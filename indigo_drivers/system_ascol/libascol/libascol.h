@@ -206,6 +206,29 @@ typedef struct {
 	// 22 -> unused
 } ascol_glst_t;
 
+/* Panel state read by ascol_read_state(), result[] holds the result code of every query */
+#define ASCOL_STATE_GLST     (0)
+#define ASCOL_STATE_GLME     (1)
+#define ASCOL_STATE_OIMV     (2)
+#define ASCOL_STATE_TRRD     (3)
+#define ASCOL_STATE_TRHD     (4)
+#define ASCOL_STATE_TRGV     (5)
+#define ASCOL_STATE_DOPO     (6)
+#define ASCOL_STATE_FOPO     (7)
+#define ASCOL_STATE_N        (8)
+typedef struct {
+	ascol_glst_t glst;
+	ascol_glme_t glme;
+	ascol_oimv_t oimv;
+	double ra, ra_de;
+	char west;
+	double ha, ha_de;
+	double ra_gv, de_gv;
+	double dome_pos;
+	double focus_pos;
+	int result[ASCOL_STATE_N];
+} ascol_state_t;
+
 #ifdef __cplusplus /* If this is a C++ compiler, use C linkage */
 extern "C" {
 #endif
@@ -274,6 +297,9 @@ int ascol_GLST(int devfd, ascol_glst_t *glst);
 /* GLobal read UTc */
 int ascol_GLUT(int devfd, double *ut);
 
+/* Read GLST, GLME, OIMV, TRRD, TRHD, TRGV, DOPO and FOPO in one pipelined burst */
+int ascol_read_state(int devfd, ascol_state_t *state);
+
 
 /* Telescope Commands */
 
@@ -156,6 +156,7 @@ typedef struct {/* there is no .name =  because of g++ C99 bug affecting string
 	char name[INDIGO_NAME_SIZE];        ///< property wide unique item name
 	char label[INDIGO_VALUE_SIZE];      ///< item description in human readable form
 	char hints[INDIGO_VALUE_SIZE];			///< item GUI hints
+	short version_mapping;              ///< cached legacy name mapping lookup (used by indigo_version.c only)
 	union {
 		/** Text property item specific fields.
 		 */
@@ -207,6 +208,7 @@ typedef struct {
 	indigo_rule rule;                   ///< switch behaviour rule (for switch properties)
 	short version;                      ///< property version INDIGO_VERSION_NONE, INDIGO_VERSION_LEGACY or INDIGO_VERSION_2_0
 	bool hidden;                        ///< property is hidden/unused by  driver (for optional properties)
+	short version_mapping;              ///< cached legacy name mapping lookup (used by indigo_version.c only)
 	int count;                          ///< number of property items
 	indigo_item items[];                ///< property items
 } indigo_property;
@@ -33,12 +33,1393 @@
 #include <time.h>
 #include <math.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <limits.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <jpeglib.h>
+#include <zlib.h>
 
 #include "indigo_ccd_driver.h"
 #include "indigo_io.h"
 
+// -------------------------------------------------------------------------------- local image writer
+
+// Local files are written by single background thread, exposure thread only copies data to bounded queue
+// and waits just if the queue is full. XXX sequence numbers are cached per directory and prefix.
+
+#define IMAGE_WRITER_QUEUE_FRAMES	16
+#define IMAGE_WRITER_QUEUE_BYTES	(1024L * 1024L * 1024L)
+#define SEQUENCE_CACHE_SIZE				16
+#define DIRECT_IO_ALIGNMENT				4096
+
+typedef enum {
+	WRITE_BUFFERED,
+	WRITE_SYNC,
+	WRITE_DIRECT
+} image_write_policy;
+
+typedef struct image_write_job {
+	indigo_device *device;
+	char file_name[INDIGO_VALUE_SIZE];
+	void *data;
+	long size;
+	image_write_policy policy;
+	struct image_write_job *next;
+} image_write_job;
+
+static struct {
+	char format[INDIGO_VALUE_SIZE];
+	int next;
+} sequence_cache[SEQUENCE_CACHE_SIZE];
+static int sequence_cache_next = 0;
+
+static pthread_mutex_t image_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t image_writer_cond = PTHREAD_COND_INITIALIZER;
+static image_write_job *image_writer_head = NULL, *image_writer_tail = NULL;
+static indigo_device *image_writer_device = NULL;
+static int image_writer_frames = 0;
+static long image_writer_bytes = 0;
+static bool image_writer_running = false;
+static pthread_mutex_t image_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int next_sequence_number(const char *format) {
+	pthread_mutex_lock(&image_writer_mutex);
+	int index;
+	for (index = 0; index < SEQUENCE_CACHE_SIZE; index++) {
+		if (!strcmp(sequence_cache[index].format, format))
+			break;
+	}
+	if (index == SEQUENCE_CACHE_SIZE) {
+		index = sequence_cache_next;
+		sequence_cache_next = (sequence_cache_next + 1) % SEQUENCE_CACHE_SIZE;
+		strncpy(sequence_cache[index].format, format, INDIGO_VALUE_SIZE);
+		sequence_cache[index].next = 1;
+	}
+	// usually just one stat(), more only if files were created behind our back
+	char file_name[INDIGO_VALUE_SIZE];
+	struct stat sb;
+	int i = sequence_cache[index].next;
+	while (true) {
+		snprintf(file_name, sizeof(file_name), format, i);
+		if (stat(file_name, &sb) == 0 && S_ISREG(sb.st_mode))
+			i++;
+		else
+			break;
+	}
+	sequence_cache[index].next = i + 1;
+	pthread_mutex_unlock(&image_writer_mutex);
+	return i;
+}
+
+static bool write_image_file(image_write_job *job, char *message) {
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	long size = job->size;
+#ifdef O_DIRECT
+	if (job->policy == WRITE_DIRECT) {
+		flags |= O_DIRECT;
+		size = (job->size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+	}
+#endif
+	int handle = open(job->file_name, flags, 0644);
+#ifdef O_DIRECT
+	if (handle < 0 && job->policy == WRITE_DIRECT && errno == EINVAL) {
+		// file system doesn't support O_DIRECT
+		size = job->size;
+		handle = open(job->file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+#endif
+	if (handle < 0) {
+		strncpy(message, strerror(errno), INDIGO_VALUE_SIZE);
+		return false;
+	}
+#ifdef F_NOCACHE
+	if (job->policy == WRITE_DIRECT)
+		fcntl(handle, F_NOCACHE, 1);
+#endif
+#ifdef INDIGO_LINUX
+	if (job->policy == WRITE_SYNC)
+		posix_fallocate(handle, 0, job->size);
+#endif
+	bool result = indigo_write(handle, job->data, size);
+	if (result && size != job->size)
+		result = ftruncate(handle, job->size) == 0;
+	if (result && job->policy == WRITE_SYNC) {
+#ifdef INDIGO_LINUX
+		result = fdatasync(handle) == 0;
+#else
+		result = fsync(handle) == 0;
+#endif
+	}
+	if (!result)
+		strncpy(message, strerror(errno), INDIGO_VALUE_SIZE);
+	close(handle);
+	return result;
+}
+
+// CCD_IMAGE_FILE is Busy while any local write of the device is pending, updates are serialized so that the result
+// of finished write can't overtake Busy state of the next one
+
+static void update_image_file(indigo_device *device, int pending, const char *file_name, const char *message) {
+	pthread_mutex_lock(&image_file_mutex);
+	CCD_CONTEXT->image_writes_pending += pending;
+	indigo_property_state state = message ? INDIGO_ALERT_STATE : CCD_CONTEXT->image_writes_pending > 0 ? INDIGO_BUSY_STATE : INDIGO_OK_STATE;
+	if (file_name)
+		strncpy(CCD_IMAGE_FILE_ITEM->text.value, file_name, INDIGO_VALUE_SIZE);
+	if (file_name || state != CCD_IMAGE_FILE_PROPERTY->state) {
+		CCD_IMAGE_FILE_PROPERTY->state = state;
+		indigo_update_property(device, CCD_IMAGE_FILE_PROPERTY, message);
+	}
+	pthread_mutex_unlock(&image_file_mutex);
+}
+
+static void *image_writer_thread(void *arg) {
+	char message[INDIGO_VALUE_SIZE];
+	pthread_mutex_lock(&image_writer_mutex);
+	while (true) {
+		while (image_writer_head == NULL)
+			pthread_cond_wait(&image_writer_cond, &image_writer_mutex);
+		image_write_job *job = image_writer_head;
+		image_writer_head = job->next;
+		if (image_writer_head == NULL)
+			image_writer_tail = NULL;
+		image_writer_device = job->device;
+		pthread_mutex_unlock(&image_writer_mutex);
+		clock_t start = clock();
+		indigo_device *device = job->device;
+		bool result = write_image_file(job, message);
+		INDIGO_DEBUG(indigo_debug("Local save of %s in %gs", job->file_name, (clock() - start) / (double)CLOCKS_PER_SEC));
+		update_image_file(device, -1, job->file_name, result ? NULL : message);
+		pthread_mutex_lock(&image_writer_mutex);
+		image_writer_device = NULL;
+		image_writer_frames--;
+		image_writer_bytes -= job->size;
+		free(job->data);
+		free(job);
+		pthread_cond_broadcast(&image_writer_cond);
+	}
+	return NULL;
+}
+
+static bool queue_image_file(indigo_device *device, const char *file_name, void *data, long size) {
+	image_write_job *job = malloc(sizeof(image_write_job));
+	if (job == NULL)
+		return false;
+	job->device = device;
+	strncpy(job->file_name, file_name, INDIGO_VALUE_SIZE);
+	job->size = size;
+	job->policy = CCD_LOCAL_MODE_WRITE_SYNC_ITEM->sw.value ? WRITE_SYNC : CCD_LOCAL_MODE_WRITE_DIRECT_ITEM->sw.value ? WRITE_DIRECT : WRITE_BUFFERED;
+	job->next = NULL;
+	// direct I/O needs aligned buffer padded to whole blocks
+	long buffer_size = (size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+	if (posix_memalign(&job->data, DIRECT_IO_ALIGNMENT, buffer_size)) {
+		free(job);
+		return false;
+	}
+	memcpy(job->data, data, size);
+	memset((char *)job->data + size, 0, buffer_size - size);
+	pthread_mutex_lock(&image_writer_mutex);
+	if (!image_writer_running) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, image_writer_thread, NULL) != 0) {
+			pthread_mutex_unlock(&image_writer_mutex);
+			free(job->data);
+			free(job);
+			return false;
+		}
+		pthread_detach(thread);
+		image_writer_running = true;
+	}
+	if (image_writer_frames >= IMAGE_WRITER_QUEUE_FRAMES || (image_writer_frames > 0 && image_writer_bytes + size > IMAGE_WRITER_QUEUE_BYTES)) {
+		INDIGO_DEBUG(indigo_debug("Image writer queue is full, waiting"));
+		while (image_writer_frames >= IMAGE_WRITER_QUEUE_FRAMES || (image_writer_frames > 0 && image_writer_bytes + size > IMAGE_WRITER_QUEUE_BYTES))
+			pthread_cond_wait(&image_writer_cond, &image_writer_mutex);
+	}
+	if (image_writer_tail)
+		image_writer_tail->next = job;
+	else
+		image_writer_head = job;
+	image_writer_tail = job;
+	image_writer_frames++;
+	image_writer_bytes += size;
+	pthread_cond_broadcast(&image_writer_cond);
+	pthread_mutex_unlock(&image_writer_mutex);
+	return true;
+}
+
+static void wait_for_image_writer(indigo_device *device) {
+	pthread_mutex_lock(&image_writer_mutex);
+	while (true) {
+		bool pending = image_writer_device == device;
+		for (image_write_job *job = image_writer_head; job && !pending; job = job->next)
+			pending = job->device == device;
+		if (!pending)
+			break;
+		pthread_cond_wait(&image_writer_cond, &image_writer_mutex);
+	}
+	pthread_mutex_unlock(&image_writer_mutex);
+}
+
+static void save_local_image(indigo_device *device, const char *suffix, void *data, long size) {
+	char *dir = CCD_LOCAL_MODE_DIR_ITEM->text.value;
+	char *prefix = CCD_LOCAL_MODE_PREFIX_ITEM->text.value;
+	if (strlen(dir) + strlen(prefix) + strlen(suffix) < INDIGO_VALUE_SIZE) {
+		char file_name[INDIGO_VALUE_SIZE];
+		char *xxx = strstr(prefix, "XXX");
+		if (xxx == NULL) {
+			strncpy(file_name, dir, INDIGO_VALUE_SIZE);
+			strcat(file_name, prefix);
+			strcat(file_name, suffix);
+		} else {
+			char format[INDIGO_VALUE_SIZE];
+			strcpy(format, dir);
+			strncat(format, prefix, xxx - prefix);
+			strcat(format, "%03d");
+			strcat(format, xxx+3);
+			strcat(format, suffix);
+			snprintf(file_name, sizeof(file_name), format, next_sequence_number(format));
+		}
+		update_image_file(device, 1, NULL, NULL);
+		if (!queue_image_file(device, file_name, data, size))
+			update_image_file(device, -1, file_name, "Can't queue image for writing");
+	} else {
+		update_image_file(device, 0, NULL, "dir + prefix + suffix is too long");
+	}
+}
+
+// -------------------------------------------------------------------------------- image pipeline
+
+// Stages registered by drivers run on typed frame descriptor before built-in format conversions. Row band
+// callbacks are split to even row bands (so 2x2 Bayer cells are never split) and run on worker threads.
+
+#define FRAME_WORKERS_MAX					8
+#define FRAME_ROWS_MIN_PIXELS			(256 * 1024)
+
+typedef struct indigo_frame_stage_entry {
+	const indigo_frame_stage *stage;
+	void *context;
+	struct indigo_frame_stage_entry *next;
+} indigo_frame_stage_entry;
+
+typedef struct {
+	indigo_device *device;
+	indigo_frame *frame;
+	indigo_frame_rows_callback callback;
+	void *context;
+	int first_row;
+	int end_row;
+} frame_rows_job;
+
+static pthread_rwlock_t frame_stage_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+indigo_result indigo_add_frame_stage(indigo_device *device, const indigo_frame_stage *stage, void *context) {
+	assert(device != NULL);
+	assert(stage != NULL);
+	pthread_rwlock_wrlock(&frame_stage_lock);
+	indigo_frame_stage_entry **link = &CCD_CONTEXT->frame_stages;
+	for (indigo_frame_stage_entry *entry = *link; entry; entry = entry->next) {
+		if (entry->stage == stage) {
+			pthread_rwlock_unlock(&frame_stage_lock);
+			return INDIGO_FAILED;
+		}
+	}
+	while (*link && (*link)->stage->order <= stage->order)
+		link = &(*link)->next;
+	indigo_frame_stage_entry *entry = malloc(sizeof(indigo_frame_stage_entry));
+	assert(entry != NULL);
+	entry->stage = stage;
+	entry->context = context;
+	entry->next = *link;
+	*link = entry;
+	pthread_rwlock_unlock(&frame_stage_lock);
+	return INDIGO_OK;
+}
+
+indigo_result indigo_remove_frame_stage(indigo_device *device, const indigo_frame_stage *stage) {
+	assert(device != NULL);
+	pthread_rwlock_wrlock(&frame_stage_lock);
+	for (indigo_frame_stage_entry **link = &CCD_CONTEXT->frame_stages; *link; link = &(*link)->next) {
+		indigo_frame_stage_entry *entry = *link;
+		if (entry->stage == stage) {
+			*link = entry->next;
+			free(entry);
+			pthread_rwlock_unlock(&frame_stage_lock);
+			return INDIGO_OK;
+		}
+	}
+	pthread_rwlock_unlock(&frame_stage_lock);
+	return INDIGO_FAILED;
+}
+
+static int frame_workers(void) {
+	static int count = 0;
+	if (count == 0) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		count = online < 1 ? 1 : online > FRAME_WORKERS_MAX ? FRAME_WORKERS_MAX : (int)online;
+	}
+	return count;
+}
+
+static void *frame_rows_worker(void *arg) {
+	frame_rows_job *job = arg;
+	job->callback(job->device, job->frame, job->first_row, job->end_row, job->context);
+	return NULL;
+}
+
+void indigo_process_frame_rows(indigo_device *device, indigo_frame *frame, indigo_frame_rows_callback callback, void *context) {
+	assert(device != NULL);
+	assert(frame != NULL);
+	int count = frame_workers();
+	if (count > frame->height / 2)
+		count = frame->height / 2;
+	if (count < 2 || (long)frame->width * frame->height < FRAME_ROWS_MIN_PIXELS) {
+		callback(device, frame, 0, frame->height, context);
+		return;
+	}
+	int band = ((frame->height + count - 1) / count + 1) & ~1;
+	pthread_t threads[FRAME_WORKERS_MAX];
+	frame_rows_job jobs[FRAME_WORKERS_MAX];
+	bool started[FRAME_WORKERS_MAX] = { false };
+	for (int i = 0; i < count; i++) {
+		frame_rows_job *job = jobs + i;
+		job->device = device;
+		job->frame = frame;
+		job->callback = callback;
+		job->context = context;
+		job->first_row = i * band;
+		job->end_row = (i + 1) * band < frame->height ? (i + 1) * band : frame->height;
+		if (i > 0 && job->first_row < job->end_row)
+			started[i] = pthread_create(threads + i, NULL, frame_rows_worker, job) == 0;
+	}
+	frame_rows_worker(jobs);
+	for (int i = 1; i < count; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else if (jobs[i].first_row < jobs[i].end_row)
+			frame_rows_worker(jobs + i);
+	}
+}
+
+void *indigo_frame_buffer(indigo_device *device, indigo_frame *frame, unsigned long size) {
+	assert(device != NULL);
+	int index = frame != NULL && CCD_CONTEXT->frame_buffer[0] != NULL && CCD_CONTEXT->frame_buffer[0] == frame->data ? 1 : 0;
+	size += FITS_HEADER_SIZE;
+	if (CCD_CONTEXT->frame_buffer_size[index] < size) {
+		free(CCD_CONTEXT->frame_buffer[index]);
+		CCD_CONTEXT->frame_buffer[index] = indigo_alloc_blob_buffer(size);
+		assert(CCD_CONTEXT->frame_buffer[index] != NULL);
+		CCD_CONTEXT->frame_buffer_size[index] = size;
+	}
+	return CCD_CONTEXT->frame_buffer[index];
+}
+
+static void run_frame_stage(indigo_device *device, const indigo_frame_stage *stage, indigo_frame *frame, void *context) {
+	INDIGO_DEBUG(clock_t start = clock());
+	bool result = true;
+	if (stage->process)
+		result = stage->process(device, frame, context);
+	if (result && stage->process_rows)
+		indigo_process_frame_rows(device, frame, stage->process_rows, context);
+	if (!result)
+		indigo_error("%s: '%s' stage failed", device->name, stage->name);
+	INDIGO_DEBUG(indigo_debug("%s in %gs", stage->name, (clock() - start) / (double)CLOCKS_PER_SEC));
+}
+
+static void release_frame_pipeline(indigo_device *device) {
+	pthread_rwlock_wrlock(&frame_stage_lock);
+	while (CCD_CONTEXT->frame_stages) {
+		indigo_frame_stage_entry *entry = CCD_CONTEXT->frame_stages;
+		CCD_CONTEXT->frame_stages = entry->next;
+		free(entry);
+	}
+	pthread_rwlock_unlock(&frame_stage_lock);
+	for (int i = 0; i < 2; i++) {
+		free(CCD_CONTEXT->frame_buffer[i]);
+		CCD_CONTEXT->frame_buffer[i] = NULL;
+		CCD_CONTEXT->frame_buffer_size[i] = 0;
+	}
+}
+
+// -------------------------------------------------------------------------------- master calibration
+
+// Masters are float32 files in ~/.indigo/calibration mapped to memory on first use. Darks are matched by geometry
+// (size and origin), binning, gain, offset, exposure [ms] and temperature [C], flats by geometry, binning, gain and
+// offset. Masters are built by running mean with online sigma clipping, so frames are never stored.
+
+#define CALIBRATION_SIGNATURE				"INDIGOCM"
+#define CALIBRATION_CLIP_SIGMA			3.0f
+#define CALIBRATION_CLIP_FRAMES			3
+#define CALIBRATION_CLIP_VARIANCE		1.0f
+#define CALIBRATION_TEMPERATURE_TOLERANCE	1
+
+typedef enum {
+	MASTER_NONE = 0,
+	MASTER_DARK = 1,
+	MASTER_FLAT = 2
+} calibration_master_type;
+
+typedef struct {
+	int32_t width;
+	int32_t height;
+	int32_t bpp;
+	int32_t horizontal_bin;
+	int32_t vertical_bin;
+	int32_t gain;					// gain * 100
+	int32_t offset;				// offset * 100
+	int32_t exposure;			// [ms], darks only
+	int32_t temperature;	// [C], darks only
+	int32_t left;					// CCD_FRAME origin
+	int32_t top;
+} calibration_key;
+
+typedef struct {
+	char signature[8];
+	uint32_t type;
+	uint32_t frames;
+	calibration_key key;
+	uint32_t reserved[1];
+} calibration_header;
+
+typedef struct {
+	calibration_key key;
+	bool valid;
+	void *map;
+	size_t map_size;
+	const float *pixels;
+} calibration_master;
+
+typedef struct indigo_ccd_calibration {
+	pthread_mutex_t mutex;
+	calibration_master dark;
+	calibration_master flat;
+	calibration_master_type building;
+	calibration_key build_key;
+	float *mean;
+	float *m2;
+	uint16_t *count;
+	long samples;
+	int frames;
+} indigo_ccd_calibration;
+
+typedef struct {
+	indigo_ccd_calibration *calibration;
+	const float *dark;
+	const float *flat;
+	int channels;
+} calibration_job;
+
+static void make_calibration_key(indigo_device *device, indigo_frame *frame, calibration_master_type type, calibration_key *key) {
+	memset(key, 0, sizeof(calibration_key));
+	key->width = frame->width;
+	key->height = frame->height;
+	key->bpp = frame->bpp;
+	key->horizontal_bin = frame->horizontal_bin;
+	key->vertical_bin = frame->vertical_bin;
+	// subframe of the same size taken elsewhere on the sensor needs its own master
+	key->left = (int32_t)CCD_FRAME_LEFT_ITEM->number.value;
+	key->top = (int32_t)CCD_FRAME_TOP_ITEM->number.value;
+	if (!CCD_GAIN_PROPERTY->hidden)
+		key->gain = (int32_t)round(CCD_GAIN_ITEM->number.value * 100);
+	if (!CCD_OFFSET_PROPERTY->hidden)
+		key->offset = (int32_t)round(CCD_OFFSET_ITEM->number.value * 100);
+	if (type == MASTER_DARK) {
+		key->exposure = (int32_t)round(CCD_EXPOSURE_ITEM->number.target * 1000);
+		if (!CCD_TEMPERATURE_PROPERTY->hidden) {
+			// regulated sensor is keyed by setpoint, reading hovers around it
+			if (!CCD_COOLER_PROPERTY->hidden && CCD_COOLER_ON_ITEM->sw.value)
+				key->temperature = (int32_t)round(CCD_TEMPERATURE_ITEM->number.target);
+			else
+				key->temperature = (int32_t)round(CCD_TEMPERATURE_ITEM->number.value);
+		}
+	}
+}
+
+static bool make_calibration_file_name(indigo_device *device, calibration_master_type type, calibration_key *key, char *path, int size) {
+	int length = snprintf(path, size, "%s/.indigo", getenv("HOME"));
+	mkdir(path, 0777);
+	length += snprintf(path + length, size - length, "/calibration");
+	if (mkdir(path, 0777) != 0 && errno != EEXIST)
+		return false;
+	length += snprintf(path + length, size - length, "/%s_%s_%dx%dx%d_x%d_y%d_%dx%d_g%g_o%g", device->name, type == MASTER_DARK ? "dark" : "flat", key->width, key->height, key->bpp, key->left, key->top, key->horizontal_bin, key->vertical_bin, key->gain / 100.0, key->offset / 100.0);
+	if (type == MASTER_DARK)
+		length += snprintf(path + length, size - length, "_e%d_t%d", key->exposure, key->temperature);
+	snprintf(path + length, size - length, ".master");
+	for (char *space = strchr(path, ' '); space; space = strchr(space + 1, ' '))
+		*space = '_';
+	return true;
+}
+
+static void unmap_master(calibration_master *master) {
+	if (master->map)
+		munmap(master->map, master->map_size);
+	master->map = NULL;
+	master->pixels = NULL;
+	master->valid = false;
+}
+
+static const float *find_master(indigo_device *device, calibration_master *master, calibration_master_type type, indigo_frame *frame) {
+	calibration_key key;
+	make_calibration_key(device, frame, type, &key);
+	// drifting unregulated sensor keeps current master dark while temperature stays within tolerance
+	if (master->pixels && abs(key.temperature - master->key.temperature) <= CALIBRATION_TEMPERATURE_TOLERANCE)
+		key.temperature = master->key.temperature;
+	if (master->valid && !memcmp(&key, &master->key, sizeof(calibration_key)))
+		return master->pixels;
+	unmap_master(master);
+	master->key = key;
+	master->valid = true;
+	char path[PATH_MAX];
+	int handle = make_calibration_file_name(device, type, &key, path, sizeof(path)) ? open(path, O_RDONLY) : -1;
+	if (handle >= 0) {
+		size_t size = sizeof(calibration_header) + (size_t)key.width * key.height * (key.bpp == 24 || key.bpp == 48 ? 3 : 1) * sizeof(float);
+		struct stat file_stat;
+		if (fstat(handle, &file_stat) == 0 && file_stat.st_size == size) {
+			void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, handle, 0);
+			if (map != MAP_FAILED) {
+				calibration_header *header = map;
+				if (!memcmp(header->signature, CALIBRATION_SIGNATURE, 8) && header->type == type && !memcmp(&header->key, &key, sizeof(calibration_key))) {
+					master->map = map;
+					master->map_size = size;
+					master->pixels = map + sizeof(calibration_header);
+				} else {
+					munmap(map, size);
+				}
+			}
+		}
+		close(handle);
+	}
+	if (master->pixels) {
+		INDIGO_DEBUG(indigo_debug("%s: using %s", device->name, path));
+		if (CCD_CALIBRATION_PROPERTY->state == INDIGO_ALERT_STATE) {
+			CCD_CALIBRATION_PROPERTY->state = INDIGO_OK_STATE;
+			indigo_update_property(device, CCD_CALIBRATION_PROPERTY, NULL);
+		}
+	} else {
+		CCD_CALIBRATION_PROPERTY->state = INDIGO_ALERT_STATE;
+		indigo_update_property(device, CCD_CALIBRATION_PROPERTY, "No master %s for this exposure, temperature, gain, offset and binning", type == MASTER_DARK ? "dark" : "flat");
+	}
+	return master->pixels;
+}
+
+static void calibrate_8(uint8_t *restrict pixels, const float *restrict dark, const float *restrict flat, long count) {
+	for (long i = 0; i < count; i++) {
+		float value = pixels[i];
+		if (dark)
+			value -= dark[i];
+		if (flat)
+			value *= flat[i];
+		value += 0.5f;
+		value = value < 0.0f ? 0.0f : value;
+		value = value > 255.0f ? 255.0f : value;
+		pixels[i] = (uint8_t)value;
+	}
+}
+
+static void calibrate_16(uint16_t *restrict pixels, const float *restrict dark, const float *restrict flat, long count) {
+	if (dark && flat) {
+		for (long i = 0; i < count; i++) {
+			float value = ((float)pixels[i] - dark[i]) * flat[i] + 0.5f;
+			value = value < 0.0f ? 0.0f : value;
+			value = value > 65535.0f ? 65535.0f : value;
+			pixels[i] = (uint16_t)value;
+		}
+	} else if (dark) {
+		for (long i = 0; i < count; i++) {
+			float value = (float)pixels[i] - dark[i] + 0.5f;
+			value = value < 0.0f ? 0.0f : value;
+			value = value > 65535.0f ? 65535.0f : value;
+			pixels[i] = (uint16_t)value;
+		}
+	} else if (flat) {
+		for (long i = 0; i < count; i++) {
+			float value = (float)pixels[i] * flat[i] + 0.5f;
+			value = value > 65535.0f ? 65535.0f : value;
+			pixels[i] = (uint16_t)value;
+		}
+	}
+}
+
+static void swap_16(uint16_t *pixels, long count) {
+	for (long i = 0; i < count; i++)
+		pixels[i] = pixels[i] << 8 | pixels[i] >> 8;
+}
+
+static void calibration_apply_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	calibration_job *job = context;
+	long first = (long)first_row * frame->width * job->channels;
+	long count = (long)(end_row - first_row) * frame->width * job->channels;
+	const float *dark = job->dark ? job->dark + first : NULL;
+	const float *flat = job->flat ? job->flat + first : NULL;
+	if (frame->bpp == 8 || frame->bpp == 24) {
+		calibrate_8((uint8_t *)(frame->data + FITS_HEADER_SIZE) + first, dark, flat, count);
+	} else {
+		uint16_t *pixels = (uint16_t *)(frame->data + FITS_HEADER_SIZE) + first;
+		if (!frame->little_endian)
+			swap_16(pixels, count);
+		calibrate_16(pixels, dark, flat, count);
+		if (!frame->little_endian)
+			swap_16(pixels, count);
+	}
+}
+
+static void calibration_accumulate_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	calibration_job *job = context;
+	indigo_ccd_calibration *calibration = job->calibration;
+	long first = (long)first_row * frame->width * job->channels;
+	long count = (long)(end_row - first_row) * frame->width * job->channels;
+	float *mean = calibration->mean + first;
+	float *m2 = calibration->m2 + first;
+	uint16_t *n = calibration->count + first;
+	uint8_t *b8 = (uint8_t *)(frame->data + FITS_HEADER_SIZE) + first;
+	uint16_t *b16 = (uint16_t *)(frame->data + FITS_HEADER_SIZE) + first;
+	bool wide = frame->bpp == 16 || frame->bpp == 48;
+	for (long i = 0; i < count; i++) {
+		float value;
+		if (!wide)
+			value = b8[i];
+		else if (frame->little_endian)
+			value = b16[i];
+		else
+			value = (uint16_t)(b16[i] << 8 | b16[i] >> 8);
+		float delta = value - mean[i];
+		// variance floor [ADU^2] keeps quantised or saturated pixels with identical samples from rejecting any change
+		if (n[i] >= CALIBRATION_CLIP_FRAMES && delta * delta > CALIBRATION_CLIP_SIGMA * CALIBRATION_CLIP_SIGMA * fmaxf(m2[i] / (n[i] - 1), CALIBRATION_CLIP_VARIANCE))
+			continue;
+		if (n[i] < UINT16_MAX)
+			n[i]++;
+		mean[i] += delta / n[i];
+		m2[i] += delta * (value - mean[i]);
+	}
+}
+
+static void release_calibration_accumulator(indigo_ccd_calibration *calibration) {
+	free(calibration->mean);
+	free(calibration->m2);
+	free(calibration->count);
+	calibration->mean = calibration->m2 = NULL;
+	calibration->count = NULL;
+	calibration->samples = 0;
+	calibration->frames = 0;
+}
+
+static bool calibration_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	indigo_ccd_calibration *calibration = context;
+	if (frame->bpp != 8 && frame->bpp != 16 && frame->bpp != 24 && frame->bpp != 48)
+		return true;
+	pthread_mutex_lock(&calibration->mutex);
+	calibration_job job = { calibration, NULL, NULL, frame->bpp == 24 || frame->bpp == 48 ? 3 : 1 };
+	if (calibration->building != MASTER_DARK) {
+		if (CCD_CALIBRATION_DARK_ITEM->sw.value)
+			job.dark = find_master(device, &calibration->dark, MASTER_DARK, frame);
+		if (CCD_CALIBRATION_FLAT_ITEM->sw.value && calibration->building == MASTER_NONE)
+			job.flat = find_master(device, &calibration->flat, MASTER_FLAT, frame);
+	}
+	if (job.dark || job.flat)
+		indigo_process_frame_rows(device, frame, calibration_apply_rows, &job);
+	if (calibration->building != MASTER_NONE) {
+		calibration_key key;
+		make_calibration_key(device, frame, calibration->building, &key);
+		if (calibration->mean == NULL || key.width != calibration->build_key.width || key.height != calibration->build_key.height || key.bpp != calibration->build_key.bpp || key.left != calibration->build_key.left || key.top != calibration->build_key.top) {
+			release_calibration_accumulator(calibration);
+			calibration->build_key = key;
+			calibration->samples = (long)frame->width * frame->height * job.channels;
+			calibration->mean = calloc(calibration->samples, sizeof(float));
+			calibration->m2 = calloc(calibration->samples, sizeof(float));
+			calibration->count = calloc(calibration->samples, sizeof(uint16_t));
+		}
+		if (calibration->mean && calibration->m2 && calibration->count) {
+			indigo_process_frame_rows(device, frame, calibration_accumulate_rows, &job);
+			calibration->frames++;
+			indigo_update_property(device, CCD_CALIBRATION_MASTER_PROPERTY, "%d frames accumulated", calibration->frames);
+		} else {
+			release_calibration_accumulator(calibration);
+			CCD_CALIBRATION_MASTER_PROPERTY->state = INDIGO_ALERT_STATE;
+			indigo_update_property(device, CCD_CALIBRATION_MASTER_PROPERTY, "Not enough memory for master accumulator");
+		}
+	}
+	pthread_mutex_unlock(&calibration->mutex);
+	return true;
+}
+
+static bool calibration_stage_active(indigo_device *device, indigo_frame *frame, void *context) {
+	indigo_ccd_calibration *calibration = context;
+	return CCD_CALIBRATION_DARK_ITEM->sw.value || CCD_CALIBRATION_FLAT_ITEM->sw.value || calibration->building != MASTER_NONE;
+}
+
+static const indigo_frame_stage calibration_stage = { "Calibration", INDIGO_FRAME_STAGE_CALIBRATION, calibration_stage_process, NULL, calibration_stage_active };
+
+static bool finish_calibration_master(indigo_device *device, char *message, int size) {
+	indigo_ccd_calibration *calibration = CCD_CONTEXT->calibration;
+	bool result = true;
+	pthread_mutex_lock(&calibration->mutex);
+	if (calibration->building != MASTER_NONE && calibration->frames > 0) {
+		float *pixels = calibration->mean;
+		if (calibration->building == MASTER_FLAT) {
+			double sum = 0;
+			for (long i = 0; i < calibration->samples; i++)
+				sum += pixels[i];
+			float average = sum / calibration->samples;
+			for (long i = 0; i < calibration->samples; i++)
+				pixels[i] = pixels[i] > 1.0f ? average / pixels[i] : 1.0f;
+		}
+		calibration_header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.signature, CALIBRATION_SIGNATURE, 8);
+		header.type = calibration->building;
+		header.frames = calibration->frames;
+		header.key = calibration->build_key;
+		char path[PATH_MAX], tmp[PATH_MAX + 4];
+		result = false;
+		if (make_calibration_file_name(device, calibration->building, &header.key, path, sizeof(path))) {
+			snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+			int handle = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (handle >= 0) {
+				result = indigo_write(handle, (const char *)&header, sizeof(header)) && indigo_write(handle, (const char *)pixels, calibration->samples * sizeof(float));
+				result = close(handle) == 0 && result;
+				result = result && rename(tmp, path) == 0;
+				if (!result)
+					unlink(tmp);
+			}
+		}
+		if (result)
+			snprintf(message, size, "Master %s from %d frames saved", calibration->building == MASTER_DARK ? "dark" : "flat", calibration->frames);
+		else
+			snprintf(message, size, "Failed to save master %s (%s)", calibration->building == MASTER_DARK ? "dark" : "flat", strerror(errno));
+		unmap_master(&calibration->dark);
+		unmap_master(&calibration->flat);
+	}
+	release_calibration_accumulator(calibration);
+	calibration->building = MASTER_NONE;
+	pthread_mutex_unlock(&calibration->mutex);
+	return result;
+}
+
+static void release_calibration(indigo_device *device) {
+	indigo_ccd_calibration *calibration = CCD_CONTEXT->calibration;
+	if (calibration) {
+		indigo_remove_frame_stage(device, &calibration_stage);
+		release_calibration_accumulator(calibration);
+		unmap_master(&calibration->dark);
+		unmap_master(&calibration->flat);
+		pthread_mutex_destroy(&calibration->mutex);
+		free(calibration);
+		CCD_CONTEXT->calibration = NULL;
+	}
+}
+
+// -------------------------------------------------------------------------------- image statistics
+
+// Background and noise are estimated from histogram (median and MAD) collected over row bands in parallel, stars are
+// local maxima above background + STATS_DETECTION_SIGMA * noise with at least two 4-neighbours above the threshold
+// (rejects hot pixels). HFD and FWHM are medians over the brightest STATS_MEASURED_STARS stars measured on pixels above
+// background + STATS_MEASURE_SIGMA * noise. Colour frames are measured on green channel.
+
+#define STATS_HISTOGRAM_SIZE		65536
+#define STATS_DETECTION_SIGMA		5
+#define STATS_MEASURE_SIGMA			3
+#define STATS_CANDIDATES				256
+#define STATS_MEASURED_STARS		20
+#define STATS_STAR_RADIUS				8
+#define STATS_WINDOW						(2 * STATS_STAR_RADIUS + 1)
+
+typedef struct {
+	int x, y;
+	float peak;
+} stats_star;
+
+typedef struct {
+	pthread_mutex_t mutex;
+	int channels;
+	int channel;
+	bool wide;
+	bool swap;
+	uint32_t *histogram;
+	double sum;
+	int max;
+	int threshold;
+	stats_star candidates[STATS_CANDIDATES];
+	int count;
+	long detected;
+} stats_job;
+
+static inline int stats_sample(indigo_frame *frame, stats_job *job, long index) {
+	index = index * job->channels + job->channel;
+	if (!job->wide)
+		return ((uint8_t *)(frame->data + FITS_HEADER_SIZE))[index];
+	uint16_t value = ((uint16_t *)(frame->data + FITS_HEADER_SIZE))[index];
+	return job->swap ? (uint16_t)(value << 8 | value >> 8) : value;
+}
+
+static void stats_histogram_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	stats_job *job = context;
+	uint32_t *histogram = calloc(STATS_HISTOGRAM_SIZE, sizeof(uint32_t));
+	if (histogram == NULL)
+		return;
+	double sum = 0;
+	long end = (long)end_row * frame->width;
+	for (long i = (long)first_row * frame->width; i < end; i++)
+		histogram[stats_sample(frame, job, i)]++;
+	int max = 0;
+	for (int i = 0; i < STATS_HISTOGRAM_SIZE; i++) {
+		if (histogram[i]) {
+			sum += (double)i * histogram[i];
+			max = i;
+		}
+	}
+	pthread_mutex_lock(&job->mutex);
+	for (int i = 0; i <= max; i++)
+		job->histogram[i] += histogram[i];
+	job->sum += sum;
+	if (max > job->max)
+		job->max = max;
+	pthread_mutex_unlock(&job->mutex);
+	free(histogram);
+}
+
+static void stats_add_candidate(stats_star *candidates, int *count, stats_star *star) {
+	if (*count < STATS_CANDIDATES) {
+		candidates[(*count)++] = *star;
+		return;
+	}
+	int faintest = 0;
+	for (int i = 1; i < STATS_CANDIDATES; i++) {
+		if (candidates[i].peak < candidates[faintest].peak)
+			faintest = i;
+	}
+	if (candidates[faintest].peak < star->peak)
+		candidates[faintest] = *star;
+}
+
+static void stats_detect_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	stats_job *job = context;
+	int width = frame->width;
+	int threshold = job->threshold;
+	stats_star candidates[STATS_CANDIDATES];
+	int count = 0;
+	long detected = 0;
+	if (first_row < STATS_STAR_RADIUS)
+		first_row = STATS_STAR_RADIUS;
+	if (end_row > frame->height - STATS_STAR_RADIUS)
+		end_row = frame->height - STATS_STAR_RADIUS;
+	for (int y = first_row; y < end_row; y++) {
+		long row = (long)y * width;
+		for (int x = STATS_STAR_RADIUS; x < width - STATS_STAR_RADIUS; x++) {
+			int value = stats_sample(frame, job, row + x);
+			if (value <= threshold)
+				continue;
+			int left = stats_sample(frame, job, row + x - 1);
+			int right = stats_sample(frame, job, row + x + 1);
+			int up = stats_sample(frame, job, row - width + x);
+			int down = stats_sample(frame, job, row + width + x);
+			if (value <= left || value < right || value <= up || value < down)
+				continue;
+			if (value <= stats_sample(frame, job, row - width + x - 1) || value <= stats_sample(frame, job, row - width + x + 1) || value < stats_sample(frame, job, row + width + x - 1) || value < stats_sample(frame, job, row + width + x + 1))
+				continue;
+			if ((left > threshold) + (right > threshold) + (up > threshold) + (down > threshold) < 2)
+				continue;
+			stats_star star = { x, y, value };
+			stats_add_candidate(candidates, &count, &star);
+			detected++;
+		}
+	}
+	pthread_mutex_lock(&job->mutex);
+	for (int i = 0; i < count; i++)
+		stats_add_candidate(job->candidates, &job->count, candidates + i);
+	job->detected += detected;
+	pthread_mutex_unlock(&job->mutex);
+}
+
+static bool stats_measure_star(indigo_frame *frame, stats_job *job, stats_star *star, float background, float noise, double *x, double *y, double *hfd, double *fwhm) {
+	float window[STATS_WINDOW][STATS_WINDOW];
+	float offsets[STATS_WINDOW];
+	for (int i = 0; i < STATS_WINDOW; i++)
+		offsets[i] = i - STATS_STAR_RADIUS;
+	for (int j = 0; j < STATS_WINDOW; j++) {
+		long row = (long)(star->y + j - STATS_STAR_RADIUS) * frame->width + star->x - STATS_STAR_RADIUS;
+		for (int i = 0; i < STATS_WINDOW; i++) {
+			float value = stats_sample(frame, job, row + i) - background;
+			window[j][i] = value > STATS_MEASURE_SIGMA * noise ? value : 0;
+		}
+	}
+	float sum = 0, sum_x = 0, sum_y = 0;
+	for (int j = 0; j < STATS_WINDOW; j++) {
+		float row_sum = 0, row_x = 0;
+		for (int i = 0; i < STATS_WINDOW; i++) {
+			row_sum += window[j][i];
+			row_x += window[j][i] * offsets[i];
+		}
+		sum += row_sum;
+		sum_x += row_x;
+		sum_y += row_sum * offsets[j];
+	}
+	if (sum <= 0)
+		return false;
+	float cx = sum_x / sum, cy = sum_y / sum;
+	float sum_r = 0, sum_r2 = 0;
+	for (int j = 0; j < STATS_WINDOW; j++) {
+		float dy2 = (offsets[j] - cy) * (offsets[j] - cy);
+		for (int i = 0; i < STATS_WINDOW; i++) {
+			float r2 = (offsets[i] - cx) * (offsets[i] - cx) + dy2;
+			sum_r += window[j][i] * sqrtf(r2);
+			sum_r2 += window[j][i] * r2;
+		}
+	}
+	*x = star->x + cx;
+	*y = star->y + cy;
+	*hfd = 2 * sum_r / sum;
+	*fwhm = 2.3548 * sqrt(sum_r2 / sum / 2);
+	return true;
+}
+
+static int stats_compare_stars(const void *a, const void *b) {
+	float pa = ((stats_star *)a)->peak, pb = ((stats_star *)b)->peak;
+	return pa < pb ? 1 : pa > pb ? -1 : 0;
+}
+
+static int stats_compare_doubles(const void *a, const void *b) {
+	double da = *(double *)a, db = *(double *)b;
+	return da < db ? -1 : da > db ? 1 : 0;
+}
+
+static bool stats_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	if (!CCD_IMAGE_STATS_ENABLED_ITEM->sw.value || (frame->bpp != 8 && frame->bpp != 16 && frame->bpp != 24 && frame->bpp != 48))
+		return true;
+	stats_job *job = malloc(sizeof(stats_job));
+	uint32_t *histogram = calloc(STATS_HISTOGRAM_SIZE, sizeof(uint32_t));
+	if (job == NULL || histogram == NULL) {
+		free(job);
+		free(histogram);
+		return false;
+	}
+	memset(job, 0, sizeof(stats_job));
+	pthread_mutex_init(&job->mutex, NULL);
+	job->histogram = histogram;
+	job->channels = frame->bpp == 24 || frame->bpp == 48 ? 3 : 1;
+	job->channel = job->channels == 3 ? 1 : 0;
+	job->wide = frame->bpp == 16 || frame->bpp == 48;
+	job->swap = job->wide && !frame->little_endian;
+	indigo_process_frame_rows(device, frame, stats_histogram_rows, job);
+	long count = (long)frame->width * frame->height;
+	long half = (count + 1) / 2, cumulative = 0;
+	int median = 0;
+	while (median < STATS_HISTOGRAM_SIZE - 1 && (cumulative += histogram[median]) < half)
+		median++;
+	cumulative = histogram[median];
+	int mad = 0;
+	while (cumulative < half && mad < STATS_HISTOGRAM_SIZE) {
+		mad++;
+		if (median - mad >= 0)
+			cumulative += histogram[median - mad];
+		if (median + mad < STATS_HISTOGRAM_SIZE)
+			cumulative += histogram[median + mad];
+	}
+	double noise = 1.4826 * mad;
+	if (noise < 1)
+		noise = 1;
+	job->threshold = median + STATS_DETECTION_SIGMA * noise;
+	indigo_process_frame_rows(device, frame, stats_detect_rows, job);
+	qsort(job->candidates, job->count, sizeof(stats_star), stats_compare_stars);
+	double hfd[STATS_MEASURED_STARS], fwhm[STATS_MEASURED_STARS], x = 0, y = 0;
+	int measured = 0;
+	for (int i = 0; i < job->count && measured < STATS_MEASURED_STARS; i++) {
+		bool duplicate = false;
+		for (int j = 0; j < i && !duplicate; j++)
+			duplicate = abs(job->candidates[j].x - job->candidates[i].x) <= STATS_STAR_RADIUS && abs(job->candidates[j].y - job->candidates[i].y) <= STATS_STAR_RADIUS;
+		if (duplicate)
+			continue;
+		double star_x, star_y;
+		if (stats_measure_star(frame, job, job->candidates + i, median, noise, &star_x, &star_y, hfd + measured, fwhm + measured)) {
+			if (measured == 0) {
+				x = star_x;
+				y = star_y;
+			}
+			measured++;
+		}
+	}
+	qsort(hfd, measured, sizeof(double), stats_compare_doubles);
+	qsort(fwhm, measured, sizeof(double), stats_compare_doubles);
+	CCD_IMAGE_STATS_MEAN_ITEM->number.value = job->sum / count;
+	CCD_IMAGE_STATS_MEDIAN_ITEM->number.value = median;
+	CCD_IMAGE_STATS_NOISE_ITEM->number.value = noise;
+	CCD_IMAGE_STATS_MAX_ITEM->number.value = job->max;
+	CCD_IMAGE_STATS_STARS_ITEM->number.value = job->detected;
+	CCD_IMAGE_STATS_HFD_ITEM->number.value = measured ? hfd[measured / 2] : 0;
+	CCD_IMAGE_STATS_FWHM_ITEM->number.value = measured ? fwhm[measured / 2] : 0;
+	CCD_IMAGE_STATS_X_ITEM->number.value = x;
+	CCD_IMAGE_STATS_Y_ITEM->number.value = y;
+	CCD_IMAGE_STATS_PROPERTY->state = INDIGO_OK_STATE;
+	indigo_update_property(device, CCD_IMAGE_STATS_PROPERTY, NULL);
+	pthread_mutex_destroy(&job->mutex);
+	free(histogram);
+	free(job);
+	return true;
+}
+
+static bool stats_stage_active(indigo_device *device, indigo_frame *frame, void *context) {
+	return CCD_IMAGE_STATS_ENABLED_ITEM->sw.value;
+}
+
+static const indigo_frame_stage stats_stage = { "Image statistics", INDIGO_FRAME_STAGE_ANALYSIS, stats_stage_process, NULL, stats_stage_active };
+
+// -------------------------------------------------------------------------------- software binning and ROI
+
+// ROI is cropped and binned in single pass from source buffer to pooled buffer. Rows are first summed vertically into
+// row accumulator (the loop compiler vectorises), accumulator is then summed horizontally and written out.
+
+typedef struct {
+	void *source;
+	int source_width;
+	int left;
+	int top;
+	int horizontal;
+	int vertical;
+	int channels;
+	bool wide;
+	bool swap;
+	bool average;
+} binning_job;
+
+static const char *shift_bayer_pattern(const char *pattern, int dx, int dy) {
+	static const char *patterns[] = { "RGGB", "GRBG", "GBRG", "BGGR" };
+	for (int i = 0; i < 4; i++) {
+		if (!strcmp(pattern, patterns[i]))
+			return patterns[i ^ (dx & 1) ^ ((dy & 1) << 1)];
+	}
+	return NULL;
+}
+
+static void binning_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	binning_job *job = context;
+	int samples = frame->width * job->horizontal * job->channels;
+	uint32_t *accumulator = malloc(samples * sizeof(uint32_t));
+	if (accumulator == NULL)
+		return;
+	uint32_t max = job->wide ? 65535 : 255;
+	uint32_t divisor = job->average ? job->horizontal * job->vertical : 1;
+	for (int y = first_row; y < end_row; y++) {
+		memset(accumulator, 0, samples * sizeof(uint32_t));
+		for (int j = 0; j < job->vertical; j++) {
+			long offset = ((long)(job->top + y * job->vertical + j) * job->source_width + job->left) * job->channels;
+			if (!job->wide) {
+				uint8_t *in = (uint8_t *)job->source + offset;
+				for (int i = 0; i < samples; i++)
+					accumulator[i] += in[i];
+			} else if (job->swap) {
+				uint16_t *in = (uint16_t *)job->source + offset;
+				for (int i = 0; i < samples; i++)
+					accumulator[i] += (uint16_t)(in[i] << 8 | in[i] >> 8);
+			} else {
+				uint16_t *in = (uint16_t *)job->source + offset;
+				for (int i = 0; i < samples; i++)
+					accumulator[i] += in[i];
+			}
+		}
+		long out = (long)y * frame->width * job->channels;
+		for (int x = 0; x < frame->width; x++) {
+			for (int c = 0; c < job->channels; c++) {
+				uint32_t sum = 0;
+				for (int i = 0; i < job->horizontal; i++)
+					sum += accumulator[(x * job->horizontal + i) * job->channels + c];
+				sum = (sum + divisor / 2) / divisor;
+				if (sum > max)
+					sum = max;
+				if (!job->wide)
+					((uint8_t *)(frame->data + FITS_HEADER_SIZE))[out++] = sum;
+				else if (job->swap)
+					((uint16_t *)(frame->data + FITS_HEADER_SIZE))[out++] = (uint16_t)(sum << 8 | sum >> 8);
+				else
+					((uint16_t *)(frame->data + FITS_HEADER_SIZE))[out++] = sum;
+			}
+		}
+	}
+	free(accumulator);
+}
+
+static bool binning_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	int horizontal = CCD_SOFTWARE_BIN_HORIZONTAL_ITEM->number.value;
+	int vertical = CCD_SOFTWARE_BIN_VERTICAL_ITEM->number.value;
+	int left = CCD_SOFTWARE_FRAME_LEFT_ITEM->number.value;
+	int top = CCD_SOFTWARE_FRAME_TOP_ITEM->number.value;
+	int width = CCD_SOFTWARE_FRAME_WIDTH_ITEM->number.value;
+	int height = CCD_SOFTWARE_FRAME_HEIGHT_ITEM->number.value;
+	if (horizontal <= 1 && vertical <= 1 && left == 0 && top == 0 && width == 0 && height == 0)
+		return true;
+	if (frame->bpp != 8 && frame->bpp != 16 && frame->bpp != 24 && frame->bpp != 48)
+		return false;
+	if (horizontal < 1)
+		horizontal = 1;
+	if (vertical < 1)
+		vertical = 1;
+	if (left >= frame->width || top >= frame->height)
+		return false;
+	if (width <= 0 || left + width > frame->width)
+		width = frame->width - left;
+	if (height <= 0 || top + height > frame->height)
+		height = frame->height - top;
+	binning_job job = { frame->data + FITS_HEADER_SIZE, frame->width, left, top, horizontal, vertical, frame->bpp == 24 || frame->bpp == 48 ? 3 : 1, frame->bpp == 16 || frame->bpp == 48, (frame->bpp == 16 || frame->bpp == 48) && !frame->little_endian, CCD_SOFTWARE_BIN_AVERAGE_ITEM->sw.value };
+	indigo_frame binned = *frame;
+	binned.width = width / horizontal;
+	binned.height = height / vertical;
+	if (binned.width == 0 || binned.height == 0)
+		return false;
+	unsigned long size = (unsigned long)binned.width * binned.height * binned.bpp / 8;
+	binned.data = indigo_frame_buffer(device, frame, size);
+	indigo_process_frame_rows(device, &binned, binning_rows, &job);
+	binned.horizontal_bin *= horizontal;
+	binned.vertical_bin *= vertical;
+	if (binned.bayer_pattern)
+		binned.bayer_pattern = horizontal == 1 && vertical == 1 ? shift_bayer_pattern(binned.bayer_pattern, left, top) : NULL;
+	*frame = binned;
+	return true;
+}
+
+static bool binning_stage_active(indigo_device *device, indigo_frame *frame, void *context) {
+	return CCD_SOFTWARE_BIN_HORIZONTAL_ITEM->number.value > 1 || CCD_SOFTWARE_BIN_VERTICAL_ITEM->number.value > 1 || CCD_SOFTWARE_FRAME_LEFT_ITEM->number.value != 0 || CCD_SOFTWARE_FRAME_TOP_ITEM->number.value != 0 || CCD_SOFTWARE_FRAME_WIDTH_ITEM->number.value != 0 || CCD_SOFTWARE_FRAME_HEIGHT_ITEM->number.value != 0;
+}
+
+static const indigo_frame_stage binning_stage = { "Software binning", INDIGO_FRAME_STAGE_GEOMETRY, binning_stage_process, NULL, binning_stage_active };
+
+
+// -------------------------------------------------------------------------------- demosaicing
+
+// CFA rows are loaded into int rows with 2 pixel reflected margin (reflection keeps CFA parity), so interpolation
+// loops are branch free. Bilinear rows are kept in 3 row ring, VNG reads 5 raw rows and 3 bilinear rows around output
+// row, selects directions with gradient below threshold and adds their mean colour difference to raw sample.
+
+#define DEMOSAIC_MARGIN	2
+
+typedef struct {
+	void *source;
+	int cfa[4];
+	bool wide;
+	bool swap;
+	bool vng;
+} demosaic_job;
+
+typedef struct {
+	demosaic_job *job;
+	int width;
+	int height;
+	int32_t *raw[5];
+	int raw_y[5];
+	int32_t *bilinear[3];
+	int bilinear_y[3];
+} demosaic_band;
+
+static bool parse_bayer_pattern(const char *pattern, int *cfa) {
+	if (pattern == NULL || strlen(pattern) != 4)
+		return false;
+	int greens = 0;
+	for (int i = 0; i < 4; i++) {
+		switch (pattern[i]) {
+			case 'R':
+				cfa[i] = 0;
+				break;
+			case 'G':
+				cfa[i] = 1;
+				greens++;
+				break;
+			case 'B':
+				cfa[i] = 2;
+				break;
+			default:
+				return false;
+		}
+	}
+	return greens == 2 && cfa[0] != cfa[3];
+}
+
+static inline int demosaic_reflect(int i, int size) {
+	if (i < 0)
+		return -i;
+	if (i >= size)
+		return 2 * (size - 1) - i;
+	return i;
+}
+
+static int32_t *demosaic_raw_row(demosaic_band *band, int y) {
+	int slot = (y + 5 * DEMOSAIC_MARGIN) % 5;
+	int32_t *row = band->raw[slot];
+	if (band->raw_y[slot] == y)
+		return row + DEMOSAIC_MARGIN;
+	band->raw_y[slot] = y;
+	demosaic_job *job = band->job;
+	int width = band->width;
+	long offset = (long)demosaic_reflect(y, band->height) * width;
+	if (!job->wide) {
+		uint8_t *in = (uint8_t *)job->source + offset;
+		for (int x = 0; x < width; x++)
+			row[x + DEMOSAIC_MARGIN] = in[x];
+	} else if (job->swap) {
+		uint16_t *in = (uint16_t *)job->source + offset;
+		for (int x = 0; x < width; x++)
+			row[x + DEMOSAIC_MARGIN] = (uint16_t)(in[x] << 8 | in[x] >> 8);
+	} else {
+		uint16_t *in = (uint16_t *)job->source + offset;
+		for (int x = 0; x < width; x++)
+			row[x + DEMOSAIC_MARGIN] = in[x];
+	}
+	for (int i = 1; i <= DEMOSAIC_MARGIN; i++) {
+		row[DEMOSAIC_MARGIN - i] = row[DEMOSAIC_MARGIN + i];
+		row[DEMOSAIC_MARGIN + width - 1 + i] = row[DEMOSAIC_MARGIN + width - 1 - i];
+	}
+	return row + DEMOSAIC_MARGIN;
+}
+
+// Bilinear RGB for pixels -1 <= x <= width, colour of the sample and its neighbours only depends on x and y parity.
+
+static int32_t *demosaic_bilinear_row(demosaic_band *band, int y) {
+	int slot = (y + 3 * DEMOSAIC_MARGIN) % 3;
+	int32_t *rgb = band->bilinear[slot];
+	if (band->bilinear_y[slot] == y)
+		return rgb + 3;
+	band->bilinear_y[slot] = y;
+	int32_t *up = demosaic_raw_row(band, y - 1);
+	int32_t *mid = demosaic_raw_row(band, y);
+	int32_t *down = demosaic_raw_row(band, y + 1);
+	int *cfa = band->job->cfa;
+	for (int parity = 0; parity < 2; parity++) {
+		int x0 = parity ? -1 : 0;
+		int own = cfa[(y & 1) * 2 + parity];
+		int32_t *out = rgb + 3 + x0 * 3;
+		if (own == 1) {
+			int horizontal = cfa[(y & 1) * 2 + (parity ^ 1)];
+			int vertical = cfa[((y & 1) ^ 1) * 2 + parity];
+			for (int x = x0; x <= band->width; x += 2, out += 6) {
+				out[1] = mid[x];
+				out[horizontal] = (mid[x - 1] + mid[x + 1] + 1) >> 1;
+				out[vertical] = (up[x] + down[x] + 1) >> 1;
+			}
+		} else {
+			int other = 2 - own;
+			for (int x = x0; x <= band->width; x += 2, out += 6) {
+				out[own] = mid[x];
+				out[1] = (mid[x - 1] + mid[x + 1] + up[x] + down[x] + 2) >> 2;
+				out[other] = (up[x - 1] + up[x + 1] + down[x - 1] + down[x + 1] + 2) >> 2;
+			}
+		}
+	}
+	return rgb + 3;
+}
+
+static void demosaic_vng_row(demosaic_band *band, int y, int32_t *out) {
+	static const int directions[8][2] = { { 0, -1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 } };
+	int32_t *raw[5];
+	int32_t *bilinear[3];
+	for (int i = 0; i < 5; i++)
+		raw[i] = demosaic_raw_row(band, y - 2 + i);
+	for (int i = 0; i < 3; i++)
+		bilinear[i] = demosaic_bilinear_row(band, y - 1 + i);
+#define P(dx, dy) raw[2 + (dy)][x + (dx)]
+	for (int x = 0; x < band->width; x++, out += 3) {
+		int own = band->job->cfa[(y & 1) * 2 + (x & 1)];
+		int gradients[8];
+		int min = INT_MAX, max = 0;
+		for (int d = 0; d < 8; d++) {
+			int dx = directions[d][0], dy = directions[d][1], ex = -dy, ey = dx;
+			int gradient = 2 * abs(P(dx, dy) - P(-dx, -dy)) + 2 * abs(P(2 * dx, 2 * dy) - P(0, 0)) + abs(P(dx + ex, dy + ey) - P(-dx + ex, -dy + ey)) + abs(P(dx - ex, dy - ey) - P(-dx - ex, -dy - ey));
+			gradients[d] = gradient;
+			if (gradient < min)
+				min = gradient;
+			if (gradient > max)
+				max = gradient;
+		}
+		int threshold = min + max / 2;
+		int32_t difference[3] = { 0, 0, 0 };
+		int count = 0;
+		for (int d = 0; d < 8; d++) {
+			if (gradients[d] <= threshold) {
+				int32_t *neighbour = bilinear[1 + directions[d][1]] + (x + directions[d][0]) * 3;
+				difference[0] += neighbour[0] - neighbour[own];
+				difference[1] += neighbour[1] - neighbour[own];
+				difference[2] += neighbour[2] - neighbour[own];
+				count++;
+			}
+		}
+		int32_t value = P(0, 0);
+		for (int c = 0; c < 3; c++)
+			out[c] = c == own ? value : value + (difference[c] + (difference[c] >= 0 ? count / 2 : -count / 2)) / count;
+	}
+#undef P
+}
+
+static void demosaic_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	demosaic_job *job = context;
+	int width = frame->width;
+	int raw_size = width + 2 * DEMOSAIC_MARGIN;
+	int bilinear_size = (width + 2) * 3;
+	demosaic_band band = { job, width, frame->height };
+	int32_t *memory = malloc((5 * raw_size + 3 * bilinear_size + width * 3) * sizeof(int32_t));
+	if (memory == NULL)
+		return;
+	for (int i = 0; i < 5; i++) {
+		band.raw[i] = memory + i * raw_size;
+		band.raw_y[i] = INT_MIN;
+	}
+	for (int i = 0; i < 3; i++) {
+		band.bilinear[i] = memory + 5 * raw_size + i * bilinear_size;
+		band.bilinear_y[i] = INT_MIN;
+	}
+	int32_t *vng = memory + 5 * raw_size + 3 * bilinear_size;
+	int32_t max = job->wide ? 65535 : 255;
+	for (int y = first_row; y < end_row; y++) {
+		int32_t *rgb;
+		if (job->vng) {
+			demosaic_vng_row(&band, y, vng);
+			rgb = vng;
+		} else {
+			rgb = demosaic_bilinear_row(&band, y);
+		}
+		long offset = (long)y * width * 3;
+		if (!job->wide) {
+			uint8_t *out = (uint8_t *)(frame->data + FITS_HEADER_SIZE) + offset;
+			for (int i = 0; i < width * 3; i++)
+				out[i] = rgb[i] < 0 ? 0 : rgb[i] > max ? max : rgb[i];
+		} else {
+			uint16_t *out = (uint16_t *)(frame->data + FITS_HEADER_SIZE) + offset;
+			for (int i = 0; i < width * 3; i++)
+				out[i] = rgb[i] < 0 ? 0 : rgb[i] > max ? max : rgb[i];
+		}
+	}
+	free(memory);
+}
+
+// Replaces mosaic frame with little endian RGB frame in pooled buffer, returns false if frame is not mosaic or pattern is unknown.
+
+static bool demosaic_frame(indigo_device *device, indigo_frame *frame, bool vng) {
+	demosaic_job job = { frame->data + FITS_HEADER_SIZE };
+	if (frame->bayer_pattern == NULL || (frame->bpp != 8 && frame->bpp != 16) || frame->width < 4 || frame->height < 4 || !parse_bayer_pattern(frame->bayer_pattern, job.cfa))
+		return false;
+	job.wide = frame->bpp == 16;
+	job.swap = job.wide && !frame->little_endian;
+	job.vng = vng;
+	indigo_frame colour = *frame;
+	colour.bpp = frame->bpp * 3;
+	colour.little_endian = true;
+	colour.byte_order_rgb = true;
+	colour.bayer_pattern = NULL;
+	colour.data = indigo_frame_buffer(device, frame, (unsigned long)frame->width * frame->height * colour.bpp / 8);
+	indigo_process_frame_rows(device, &colour, demosaic_rows, &job);
+	*frame = colour;
+	return true;
+}
+
+static bool demosaic_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	if (CCD_DEMOSAIC_NONE_ITEM->sw.value || frame->bayer_pattern == NULL || (frame->bpp != 8 && frame->bpp != 16))
+		return true;
+	return demosaic_frame(device, frame, CCD_DEMOSAIC_VNG_ITEM->sw.value);
+}
+
+// camera encoded images are never mosaic
+
+static bool demosaic_stage_active(indigo_device *device, indigo_frame *frame, void *context) {
+	return !CCD_DEMOSAIC_NONE_ITEM->sw.value && frame != NULL && frame->bayer_pattern != NULL;
+}
+
+static const indigo_frame_stage demosaic_stage = { "Demosaicing", INDIGO_FRAME_STAGE_DEMOSAIC, demosaic_stage_process, NULL, demosaic_stage_active };
+
+// --------------------------------------------------------------------------------
+
 static void countdown_timer_callback(indigo_device *device) {
 	if (CCD_CONTEXT->countdown_enabled && CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE && CCD_EXPOSURE_ITEM->number.value >= 1) {
 		CCD_EXPOSURE_ITEM->number.value -= 1;
@@ -100,6 +1481,13 @@ indigo_result indigo_ccd_attach(indigo_device *device, unsigned version) {
 				return INDIGO_FAILED;
 			indigo_init_text_item(CCD_LOCAL_MODE_DIR_ITEM, CCD_LOCAL_MODE_DIR_ITEM_NAME, "Directory", "%s/", getenv("HOME"));
 			indigo_init_text_item(CCD_LOCAL_MODE_PREFIX_ITEM, CCD_LOCAL_MODE_PREFIX_ITEM_NAME, "File name prefix", "IMAGE_XXX");
+			// -------------------------------------------------------------------------------- CCD_LOCAL_MODE_WRITE
+			CCD_LOCAL_MODE_WRITE_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_LOCAL_MODE_WRITE_PROPERTY_NAME, CCD_MAIN_GROUP, "Local save policy", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 3);
+			if (CCD_LOCAL_MODE_WRITE_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_LOCAL_MODE_WRITE_BUFFERED_ITEM, CCD_LOCAL_MODE_WRITE_BUFFERED_ITEM_NAME, "Buffered", true);
+			indigo_init_switch_item(CCD_LOCAL_MODE_WRITE_SYNC_ITEM, CCD_LOCAL_MODE_WRITE_SYNC_ITEM_NAME, "Preallocate and sync to disk", false);
+			indigo_init_switch_item(CCD_LOCAL_MODE_WRITE_DIRECT_ITEM, CCD_LOCAL_MODE_WRITE_DIRECT_ITEM_NAME, "Direct I/O", false);
 			// -------------------------------------------------------------------------------- CCD_MODE
 			CCD_MODE_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_MODE_PROPERTY_NAME, CCD_MAIN_GROUP, "Capture mode", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 64);
 			if (CCD_MODE_PROPERTY == NULL)
@@ -246,6 +1634,93 @@ indigo_result indigo_ccd_attach(indigo_device *device, unsigned version) {
 			CCD_RBI_FLUSH_PROPERTY->hidden = true;
 			indigo_init_number_item(CCD_RBI_FLUSH_EXPOSURE_ITEM, CCD_RBI_FLUSH_EXPOSURE_ITEM_NAME, "NIR flood time (s)", 0, 16, 0, 1);
 			indigo_init_number_item(CCD_RBI_FLUSH_COUNT_ITEM, CCD_RBI_FLUSH_COUNT_ITEM_NAME, "Number of flushes", 1, 10, 1, 3);
+			// -------------------------------------------------------------------------------- CCD_CALIBRATION
+			CCD_CALIBRATION_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_CALIBRATION_PROPERTY_NAME, CCD_IMAGE_GROUP, "Calibration", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ANY_OF_MANY_RULE, 2);
+			if (CCD_CALIBRATION_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_CALIBRATION_DARK_ITEM, CCD_CALIBRATION_DARK_ITEM_NAME, "Subtract master dark", false);
+			indigo_init_switch_item(CCD_CALIBRATION_FLAT_ITEM, CCD_CALIBRATION_FLAT_ITEM_NAME, "Divide by master flat", false);
+			// -------------------------------------------------------------------------------- CCD_CALIBRATION_MASTER
+			CCD_CALIBRATION_MASTER_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_CALIBRATION_MASTER_PROPERTY_NAME, CCD_IMAGE_GROUP, "Build master", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 3);
+			if (CCD_CALIBRATION_MASTER_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_CALIBRATION_MASTER_NONE_ITEM, CCD_CALIBRATION_MASTER_NONE_ITEM_NAME, "None", true);
+			indigo_init_switch_item(CCD_CALIBRATION_MASTER_DARK_ITEM, CCD_CALIBRATION_MASTER_DARK_ITEM_NAME, "Master dark", false);
+			indigo_init_switch_item(CCD_CALIBRATION_MASTER_FLAT_ITEM, CCD_CALIBRATION_MASTER_FLAT_ITEM_NAME, "Master flat", false);
+			CCD_CONTEXT->calibration = malloc(sizeof(indigo_ccd_calibration));
+			assert(CCD_CONTEXT->calibration != NULL);
+			memset(CCD_CONTEXT->calibration, 0, sizeof(indigo_ccd_calibration));
+			pthread_mutex_init(&CCD_CONTEXT->calibration->mutex, NULL);
+			indigo_add_frame_stage(device, &calibration_stage, CCD_CONTEXT->calibration);
+			// -------------------------------------------------------------------------------- CCD_IMAGE_STATS
+			CCD_IMAGE_STATS_PROPERTY = indigo_init_number_property(NULL, device->name, CCD_IMAGE_STATS_PROPERTY_NAME, CCD_IMAGE_GROUP, "Image statistics", INDIGO_IDLE_STATE, INDIGO_RO_PERM, 9);
+			if (CCD_IMAGE_STATS_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_number_item(CCD_IMAGE_STATS_MEAN_ITEM, CCD_IMAGE_STATS_MEAN_ITEM_NAME, "Mean", 0, 65535, 0, 0);
+			indigo_init_number_item(CCD_IMAGE_STATS_MEDIAN_ITEM, CCD_IMAGE_STATS_MEDIAN_ITEM_NAME, "Median", 0, 65535, 0, 0);
+			indigo_init_number_item(CCD_IMAGE_STATS_NOISE_ITEM, CCD_IMAGE_STATS_NOISE_ITEM_NAME, "Noise", 0, 65535, 0, 0);
+			indigo_init_number_item(CCD_IMAGE_STATS_MAX_ITEM, CCD_IMAGE_STATS_MAX_ITEM_NAME, "Maximum", 0, 65535, 0, 0);
+			indigo_init_number_item(CCD_IMAGE_STATS_STARS_ITEM, CCD_IMAGE_STATS_STARS_ITEM_NAME, "Stars detected", 0, 1000000, 0, 0);
+			indigo_init_number_item(CCD_IMAGE_STATS_HFD_ITEM, CCD_IMAGE_STATS_HFD_ITEM_NAME, "HFD (px)", 0, 100, 0, 0);
+			indigo_init_number_item(CCD_IMAGE_STATS_FWHM_ITEM, CCD_IMAGE_STATS_FWHM_ITEM_NAME, "FWHM (px)", 0, 100, 0, 0);
+			indigo_init_number_item(CCD_IMAGE_STATS_X_ITEM, CCD_IMAGE_STATS_X_ITEM_NAME, "Brightest star X (px)", 0, 100000, 0, 0);
+			indigo_init_number_item(CCD_IMAGE_STATS_Y_ITEM, CCD_IMAGE_STATS_Y_ITEM_NAME, "Brightest star Y (px)", 0, 100000, 0, 0);
+			// -------------------------------------------------------------------------------- CCD_IMAGE_STATS_ENABLE
+			CCD_IMAGE_STATS_ENABLE_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_IMAGE_STATS_ENABLE_PROPERTY_NAME, CCD_IMAGE_GROUP, "Image statistics", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 2);
+			if (CCD_IMAGE_STATS_ENABLE_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_IMAGE_STATS_ENABLED_ITEM, CCD_IMAGE_STATS_ENABLED_ITEM_NAME, "Enabled", false);
+			indigo_init_switch_item(CCD_IMAGE_STATS_DISABLED_ITEM, CCD_IMAGE_STATS_DISABLED_ITEM_NAME, "Disabled", true);
+			indigo_add_frame_stage(device, &stats_stage, NULL);
+			// -------------------------------------------------------------------------------- CCD_SOFTWARE_BIN
+			CCD_SOFTWARE_BIN_PROPERTY = indigo_init_number_property(NULL, device->name, CCD_SOFTWARE_BIN_PROPERTY_NAME, CCD_IMAGE_GROUP, "Software binning", INDIGO_OK_STATE, INDIGO_RW_PERM, 2);
+			if (CCD_SOFTWARE_BIN_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_number_item(CCD_SOFTWARE_BIN_HORIZONTAL_ITEM, CCD_SOFTWARE_BIN_HORIZONTAL_ITEM_NAME, "Horizontal binning", 1, 8, 1, 1);
+			indigo_init_number_item(CCD_SOFTWARE_BIN_VERTICAL_ITEM, CCD_SOFTWARE_BIN_VERTICAL_ITEM_NAME, "Vertical binning", 1, 8, 1, 1);
+			// -------------------------------------------------------------------------------- CCD_SOFTWARE_BIN_MODE
+			CCD_SOFTWARE_BIN_MODE_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_SOFTWARE_BIN_MODE_PROPERTY_NAME, CCD_IMAGE_GROUP, "Software binning mode", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 2);
+			if (CCD_SOFTWARE_BIN_MODE_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_SOFTWARE_BIN_SUM_ITEM, CCD_SOFTWARE_BIN_SUM_ITEM_NAME, "Sum", false);
+			indigo_init_switch_item(CCD_SOFTWARE_BIN_AVERAGE_ITEM, CCD_SOFTWARE_BIN_AVERAGE_ITEM_NAME, "Average", true);
+			// -------------------------------------------------------------------------------- CCD_SOFTWARE_FRAME
+			CCD_SOFTWARE_FRAME_PROPERTY = indigo_init_number_property(NULL, device->name, CCD_SOFTWARE_FRAME_PROPERTY_NAME, CCD_IMAGE_GROUP, "Software frame", INDIGO_OK_STATE, INDIGO_RW_PERM, 4);
+			if (CCD_SOFTWARE_FRAME_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_number_item(CCD_SOFTWARE_FRAME_LEFT_ITEM, CCD_SOFTWARE_FRAME_LEFT_ITEM_NAME, "Left", 0, 100000, 1, 0);
+			indigo_init_number_item(CCD_SOFTWARE_FRAME_TOP_ITEM, CCD_SOFTWARE_FRAME_TOP_ITEM_NAME, "Top", 0, 100000, 1, 0);
+			indigo_init_number_item(CCD_SOFTWARE_FRAME_WIDTH_ITEM, CCD_SOFTWARE_FRAME_WIDTH_ITEM_NAME, "Width", 0, 100000, 1, 0);
+			indigo_init_number_item(CCD_SOFTWARE_FRAME_HEIGHT_ITEM, CCD_SOFTWARE_FRAME_HEIGHT_ITEM_NAME, "Height", 0, 100000, 1, 0);
+			indigo_add_frame_stage(device, &binning_stage, NULL);
+			// -------------------------------------------------------------------------------- CCD_DEMOSAIC
+			CCD_DEMOSAIC_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_DEMOSAIC_PROPERTY_NAME, CCD_IMAGE_GROUP, "Demosaicing", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 3);
+			if (CCD_DEMOSAIC_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_DEMOSAIC_NONE_ITEM, CCD_DEMOSAIC_NONE_ITEM_NAME, "None", true);
+			indigo_init_switch_item(CCD_DEMOSAIC_BILINEAR_ITEM, CCD_DEMOSAIC_BILINEAR_ITEM_NAME, "Bilinear", false);
+			indigo_init_switch_item(CCD_DEMOSAIC_VNG_ITEM, CCD_DEMOSAIC_VNG_ITEM_NAME, "Variable number of gradients", false);
+			// -------------------------------------------------------------------------------- CCD_PREVIEW_DEMOSAIC
+			CCD_PREVIEW_DEMOSAIC_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_PREVIEW_DEMOSAIC_PROPERTY_NAME, CCD_IMAGE_GROUP, "Preview demosaicing", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 3);
+			if (CCD_PREVIEW_DEMOSAIC_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_PREVIEW_DEMOSAIC_NONE_ITEM, CCD_PREVIEW_DEMOSAIC_NONE_ITEM_NAME, "None", false);
+			indigo_init_switch_item(CCD_PREVIEW_DEMOSAIC_BILINEAR_ITEM, CCD_PREVIEW_DEMOSAIC_BILINEAR_ITEM_NAME, "Bilinear", true);
+			indigo_init_switch_item(CCD_PREVIEW_DEMOSAIC_VNG_ITEM, CCD_PREVIEW_DEMOSAIC_VNG_ITEM_NAME, "Variable number of gradients", false);
+			// -------------------------------------------------------------------------------- CCD_FITS_COMPRESSION
+			CCD_FITS_COMPRESSION_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_FITS_COMPRESSION_PROPERTY_NAME, CCD_IMAGE_GROUP, "FITS compression", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 2);
+			if (CCD_FITS_COMPRESSION_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_FITS_COMPRESSION_NONE_ITEM, CCD_FITS_COMPRESSION_NONE_ITEM_NAME, "None", true);
+			indigo_init_switch_item(CCD_FITS_COMPRESSION_RICE_ITEM, CCD_FITS_COMPRESSION_RICE_ITEM_NAME, "Rice (tile compressed)", false);
+			// -------------------------------------------------------------------------------- CCD_XISF_COMPRESSION
+			CCD_XISF_COMPRESSION_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_XISF_COMPRESSION_PROPERTY_NAME, CCD_IMAGE_GROUP, "XISF compression", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 3);
+			if (CCD_XISF_COMPRESSION_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_switch_item(CCD_XISF_COMPRESSION_NONE_ITEM, CCD_XISF_COMPRESSION_NONE_ITEM_NAME, "None", true);
+			indigo_init_switch_item(CCD_XISF_COMPRESSION_LZ4_ITEM, CCD_XISF_COMPRESSION_LZ4_ITEM_NAME, "LZ4", false);
+			indigo_init_switch_item(CCD_XISF_COMPRESSION_ZLIB_ITEM, CCD_XISF_COMPRESSION_ZLIB_ITEM_NAME, "zlib", false);
+			indigo_add_frame_stage(device, &demosaic_stage, NULL);
 			// --------------------------------------------------------------------------------
 			return INDIGO_OK;
 		}
@@ -261,6 +1736,8 @@ indigo_result indigo_ccd_enumerate_properties(indigo_device *device, indigo_clie
 			indigo_define_property(device, CCD_INFO_PROPERTY, NULL);
 		if (indigo_property_match(CCD_LOCAL_MODE_PROPERTY, property))
 			indigo_define_property(device, CCD_LOCAL_MODE_PROPERTY, NULL);
+		if (indigo_property_match(CCD_LOCAL_MODE_WRITE_PROPERTY, property))
+			indigo_define_property(device, CCD_LOCAL_MODE_WRITE_PROPERTY, NULL);
 		if (indigo_property_match(CCD_IMAGE_FILE_PROPERTY, property))
 			indigo_define_property(device, CCD_IMAGE_FILE_PROPERTY, NULL);
 		if (indigo_property_match(CCD_MODE_PROPERTY, property))
@@ -305,6 +1782,28 @@ indigo_result indigo_ccd_enumerate_properties(indigo_device *device, indigo_clie
 			indigo_define_property(device, CCD_RBI_FLUSH_ENABLE_PROPERTY, NULL);
 		if (indigo_property_match(CCD_RBI_FLUSH_PROPERTY, property))
 			indigo_define_property(device, CCD_RBI_FLUSH_PROPERTY, NULL);
+		if (indigo_property_match(CCD_CALIBRATION_PROPERTY, property))
+			indigo_define_property(device, CCD_CALIBRATION_PROPERTY, NULL);
+		if (indigo_property_match(CCD_CALIBRATION_MASTER_PROPERTY, property))
+			indigo_define_property(device, CCD_CALIBRATION_MASTER_PROPERTY, NULL);
+		if (indigo_property_match(CCD_IMAGE_STATS_PROPERTY, property))
+			indigo_define_property(device, CCD_IMAGE_STATS_PROPERTY, NULL);
+		if (indigo_property_match(CCD_IMAGE_STATS_ENABLE_PROPERTY, property))
+			indigo_define_property(device, CCD_IMAGE_STATS_ENABLE_PROPERTY, NULL);
+		if (indigo_property_match(CCD_SOFTWARE_BIN_PROPERTY, property))
+			indigo_define_property(device, CCD_SOFTWARE_BIN_PROPERTY, NULL);
+		if (indigo_property_match(CCD_SOFTWARE_BIN_MODE_PROPERTY, property))
+			indigo_define_property(device, CCD_SOFTWARE_BIN_MODE_PROPERTY, NULL);
+		if (indigo_property_match(CCD_SOFTWARE_FRAME_PROPERTY, property))
+			indigo_define_property(device, CCD_SOFTWARE_FRAME_PROPERTY, NULL);
+		if (indigo_property_match(CCD_DEMOSAIC_PROPERTY, property))
+			indigo_define_property(device, CCD_DEMOSAIC_PROPERTY, NULL);
+		if (indigo_property_match(CCD_PREVIEW_DEMOSAIC_PROPERTY, property))
+			indigo_define_property(device, CCD_PREVIEW_DEMOSAIC_PROPERTY, NULL);
+		if (indigo_property_match(CCD_FITS_COMPRESSION_PROPERTY, property))
+			indigo_define_property(device, CCD_FITS_COMPRESSION_PROPERTY, NULL);
+		if (indigo_property_match(CCD_XISF_COMPRESSION_PROPERTY, property))
+			indigo_define_property(device, CCD_XISF_COMPRESSION_PROPERTY, NULL);
 	}
 	return indigo_device_enumerate_properties(device, client, property);
 }
@@ -319,6 +1818,7 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_define_property(device, CCD_INFO_PROPERTY, NULL);
 			indigo_define_property(device, CCD_UPLOAD_MODE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_LOCAL_MODE_PROPERTY, NULL);
+			indigo_define_property(device, CCD_LOCAL_MODE_WRITE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_MODE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_READ_MODE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_EXPOSURE_PROPERTY, NULL);
@@ -340,10 +1840,22 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_define_property(device, CCD_JPEG_SETTINGS_PROPERTY, NULL);
 			indigo_define_property(device, CCD_RBI_FLUSH_ENABLE_PROPERTY, NULL);
 			indigo_define_property(device, CCD_RBI_FLUSH_PROPERTY, NULL);
+			indigo_define_property(device, CCD_CALIBRATION_PROPERTY, NULL);
+			indigo_define_property(device, CCD_CALIBRATION_MASTER_PROPERTY, NULL);
+			indigo_define_property(device, CCD_IMAGE_STATS_PROPERTY, NULL);
+			indigo_define_property(device, CCD_IMAGE_STATS_ENABLE_PROPERTY, NULL);
+			indigo_define_property(device, CCD_SOFTWARE_BIN_PROPERTY, NULL);
+			indigo_define_property(device, CCD_SOFTWARE_BIN_MODE_PROPERTY, NULL);
+			indigo_define_property(device, CCD_SOFTWARE_FRAME_PROPERTY, NULL);
+			indigo_define_property(device, CCD_DEMOSAIC_PROPERTY, NULL);
+			indigo_define_property(device, CCD_PREVIEW_DEMOSAIC_PROPERTY, NULL);
+			indigo_define_property(device, CCD_FITS_COMPRESSION_PROPERTY, NULL);
+			indigo_define_property(device, CCD_XISF_COMPRESSION_PROPERTY, NULL);
 		} else {
 			indigo_delete_property(device, CCD_INFO_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_UPLOAD_MODE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_LOCAL_MODE_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_LOCAL_MODE_WRITE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_MODE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_READ_MODE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_EXPOSURE_PROPERTY, NULL);
@@ -365,6 +1877,17 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_delete_property(device, CCD_JPEG_SETTINGS_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_RBI_FLUSH_ENABLE_PROPERTY, NULL);
 			indigo_delete_property(device, CCD_RBI_FLUSH_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_CALIBRATION_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_CALIBRATION_MASTER_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_IMAGE_STATS_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_IMAGE_STATS_ENABLE_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_SOFTWARE_BIN_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_SOFTWARE_BIN_MODE_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_SOFTWARE_FRAME_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_DEMOSAIC_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_PREVIEW_DEMOSAIC_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_FITS_COMPRESSION_PROPERTY, NULL);
+			indigo_delete_property(device, CCD_XISF_COMPRESSION_PROPERTY, NULL);
 		}
 	} else if (indigo_property_match(CONFIG_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CONFIG
@@ -373,6 +1896,7 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_save_property(device, NULL, CCD_READ_MODE_PROPERTY);
 			indigo_save_property(device, NULL, CCD_UPLOAD_MODE_PROPERTY);
 			indigo_save_property(device, NULL, CCD_LOCAL_MODE_PROPERTY);
+			indigo_save_property(device, NULL, CCD_LOCAL_MODE_WRITE_PROPERTY);
 			indigo_save_property(device, NULL, CCD_FRAME_PROPERTY);
 			indigo_save_property(device, NULL, CCD_BIN_PROPERTY);
 			indigo_save_property(device, NULL, CCD_OFFSET_PROPERTY);
@@ -383,6 +1907,15 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_save_property(device, NULL, CCD_JPEG_SETTINGS_PROPERTY);
 			indigo_save_property(device, NULL, CCD_RBI_FLUSH_ENABLE_PROPERTY);
 			indigo_save_property(device, NULL, CCD_RBI_FLUSH_PROPERTY);
+			indigo_save_property(device, NULL, CCD_CALIBRATION_PROPERTY);
+			indigo_save_property(device, NULL, CCD_IMAGE_STATS_ENABLE_PROPERTY);
+			indigo_save_property(device, NULL, CCD_SOFTWARE_BIN_PROPERTY);
+			indigo_save_property(device, NULL, CCD_SOFTWARE_BIN_MODE_PROPERTY);
+			indigo_save_property(device, NULL, CCD_SOFTWARE_FRAME_PROPERTY);
+			indigo_save_property(device, NULL, CCD_DEMOSAIC_PROPERTY);
+			indigo_save_property(device, NULL, CCD_PREVIEW_DEMOSAIC_PROPERTY);
+			indigo_save_property(device, NULL, CCD_FITS_COMPRESSION_PROPERTY);
+			indigo_save_property(device, NULL, CCD_XISF_COMPRESSION_PROPERTY);
 		}
 	} else if (indigo_property_match(CCD_EXPOSURE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CCD_EXPOSURE
@@ -572,6 +2105,13 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 		if (IS_CONNECTED)
 			indigo_update_property(device, CCD_LOCAL_MODE_PROPERTY, NULL);
 		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_LOCAL_MODE_WRITE_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_LOCAL_MODE_WRITE
+		indigo_property_copy_values(CCD_LOCAL_MODE_WRITE_PROPERTY, property, false);
+		CCD_LOCAL_MODE_WRITE_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_LOCAL_MODE_WRITE_PROPERTY, NULL);
+		return INDIGO_OK;
 	} else if (indigo_property_match(CCD_FITS_HEADERS_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CCD_FITS_HEADERS
 		indigo_property_copy_values(CCD_FITS_HEADERS_PROPERTY, property, false);
@@ -650,6 +2190,97 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 			indigo_update_property(device, CCD_RBI_FLUSH_PROPERTY, NULL);
 		}
 		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_CALIBRATION_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_CALIBRATION
+		indigo_property_copy_values(CCD_CALIBRATION_PROPERTY, property, false);
+		pthread_mutex_lock(&CCD_CONTEXT->calibration->mutex);
+		unmap_master(&CCD_CONTEXT->calibration->dark);
+		unmap_master(&CCD_CONTEXT->calibration->flat);
+		pthread_mutex_unlock(&CCD_CONTEXT->calibration->mutex);
+		CCD_CALIBRATION_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_CALIBRATION_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_CALIBRATION_MASTER_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_CALIBRATION_MASTER
+		char message[INDIGO_VALUE_SIZE] = "";
+		bool result = finish_calibration_master(device, message, sizeof(message));
+		indigo_property_copy_values(CCD_CALIBRATION_MASTER_PROPERTY, property, false);
+		pthread_mutex_lock(&CCD_CONTEXT->calibration->mutex);
+		if (CCD_CALIBRATION_MASTER_DARK_ITEM->sw.value)
+			CCD_CONTEXT->calibration->building = MASTER_DARK;
+		else if (CCD_CALIBRATION_MASTER_FLAT_ITEM->sw.value)
+			CCD_CONTEXT->calibration->building = MASTER_FLAT;
+		pthread_mutex_unlock(&CCD_CONTEXT->calibration->mutex);
+		if (!result)
+			CCD_CALIBRATION_MASTER_PROPERTY->state = INDIGO_ALERT_STATE;
+		else if (CCD_CALIBRATION_MASTER_NONE_ITEM->sw.value)
+			CCD_CALIBRATION_MASTER_PROPERTY->state = INDIGO_OK_STATE;
+		else
+			CCD_CALIBRATION_MASTER_PROPERTY->state = INDIGO_BUSY_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_CALIBRATION_MASTER_PROPERTY, *message ? message : NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_IMAGE_STATS_ENABLE_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_IMAGE_STATS_ENABLE
+		indigo_property_copy_values(CCD_IMAGE_STATS_ENABLE_PROPERTY, property, false);
+		CCD_IMAGE_STATS_ENABLE_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_IMAGE_STATS_ENABLE_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_SOFTWARE_BIN_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_SOFTWARE_BIN
+		indigo_property_copy_values(CCD_SOFTWARE_BIN_PROPERTY, property, false);
+		CCD_SOFTWARE_BIN_HORIZONTAL_ITEM->number.value = (int)CCD_SOFTWARE_BIN_HORIZONTAL_ITEM->number.value;
+		CCD_SOFTWARE_BIN_VERTICAL_ITEM->number.value = (int)CCD_SOFTWARE_BIN_VERTICAL_ITEM->number.value;
+		CCD_SOFTWARE_BIN_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_SOFTWARE_BIN_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_SOFTWARE_BIN_MODE_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_SOFTWARE_BIN_MODE
+		indigo_property_copy_values(CCD_SOFTWARE_BIN_MODE_PROPERTY, property, false);
+		CCD_SOFTWARE_BIN_MODE_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_SOFTWARE_BIN_MODE_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_SOFTWARE_FRAME_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_SOFTWARE_FRAME
+		indigo_property_copy_values(CCD_SOFTWARE_FRAME_PROPERTY, property, false);
+		for (int i = 0; i < CCD_SOFTWARE_FRAME_PROPERTY->count; i++)
+			CCD_SOFTWARE_FRAME_PROPERTY->items[i].number.value = (int)CCD_SOFTWARE_FRAME_PROPERTY->items[i].number.value;
+		CCD_SOFTWARE_FRAME_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_SOFTWARE_FRAME_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_DEMOSAIC_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_DEMOSAIC
+		indigo_property_copy_values(CCD_DEMOSAIC_PROPERTY, property, false);
+		CCD_DEMOSAIC_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_DEMOSAIC_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_PREVIEW_DEMOSAIC_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_PREVIEW_DEMOSAIC
+		indigo_property_copy_values(CCD_PREVIEW_DEMOSAIC_PROPERTY, property, false);
+		CCD_PREVIEW_DEMOSAIC_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_PREVIEW_DEMOSAIC_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_FITS_COMPRESSION_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_FITS_COMPRESSION
+		indigo_property_copy_values(CCD_FITS_COMPRESSION_PROPERTY, property, false);
+		CCD_FITS_COMPRESSION_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_FITS_COMPRESSION_PROPERTY, NULL);
+		return INDIGO_OK;
+	} else if (indigo_property_match(CCD_XISF_COMPRESSION_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- CCD_XISF_COMPRESSION
+		indigo_property_copy_values(CCD_XISF_COMPRESSION_PROPERTY, property, false);
+		CCD_XISF_COMPRESSION_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED)
+			indigo_update_property(device, CCD_XISF_COMPRESSION_PROPERTY, NULL);
+		return INDIGO_OK;
 		// --------------------------------------------------------------------------------
 	}
 	return indigo_device_change_property(device, client, property);
@@ -657,9 +2288,11 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 
 indigo_result indigo_ccd_detach(indigo_device *device) {
 	assert(device != NULL);
+	wait_for_image_writer(device);
 	indigo_release_property(CCD_INFO_PROPERTY);
 	indigo_release_property(CCD_UPLOAD_MODE_PROPERTY);
 	indigo_release_property(CCD_LOCAL_MODE_PROPERTY);
+	indigo_release_property(CCD_LOCAL_MODE_WRITE_PROPERTY);
 	indigo_release_property(CCD_MODE_PROPERTY);
 	indigo_release_property(CCD_READ_MODE_PROPERTY);
 	indigo_release_property(CCD_EXPOSURE_PROPERTY);
@@ -681,6 +2314,19 @@ indigo_result indigo_ccd_detach(indigo_device *device) {
 	indigo_release_property(CCD_JPEG_SETTINGS_PROPERTY);
 	indigo_release_property(CCD_RBI_FLUSH_ENABLE_PROPERTY);
 	indigo_release_property(CCD_RBI_FLUSH_PROPERTY);
+	release_calibration(device);
+	indigo_release_property(CCD_CALIBRATION_PROPERTY);
+	indigo_release_property(CCD_CALIBRATION_MASTER_PROPERTY);
+	indigo_release_property(CCD_IMAGE_STATS_PROPERTY);
+	indigo_release_property(CCD_IMAGE_STATS_ENABLE_PROPERTY);
+	indigo_release_property(CCD_SOFTWARE_BIN_PROPERTY);
+	indigo_release_property(CCD_SOFTWARE_BIN_MODE_PROPERTY);
+	indigo_release_property(CCD_SOFTWARE_FRAME_PROPERTY);
+	indigo_release_property(CCD_DEMOSAIC_PROPERTY);
+	indigo_release_property(CCD_PREVIEW_DEMOSAIC_PROPERTY);
+	indigo_release_property(CCD_FITS_COMPRESSION_PROPERTY);
+	indigo_release_property(CCD_XISF_COMPRESSION_PROPERTY);
+	release_frame_pipeline(device);
 	return indigo_device_detach(device);
 }
 
@@ -765,71 +2411,717 @@ static void raw_to_jpeg(indigo_device *device, void *data_in, int frame_width, i
 				histo[*b16++ >> 8]++;
 			}
 		} else {
-			for (int i = 0; i < count; i++) {
-				int value = *b16;
-				value = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-				*b16++ = value;
-				histo[value >> 8]++;
+			for (int i = 0; i < count; i++) {
+				int value = *b16;
+				value = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+				*b16++ = value;
+				histo[value >> 8]++;
+			}
+		}
+		set_black_white(device, histo, count);
+		double scale = (CCD_JPEG_SETTINGS_WHITE_ITEM->number.value - CCD_JPEG_SETTINGS_BLACK_ITEM->number.value);
+		int offset = CCD_JPEG_SETTINGS_BLACK_ITEM->number.value;
+		unsigned char *b8 = copy;
+		b16 = copy;
+		for (int i = 0; i < count; i++) {
+			int value = (*b16++ - offset) / scale;
+			if (value < 0)
+				value = 0;
+			else if (value > 255)
+				value = 255;
+			*b8++ = value;
+		}
+	}
+	if (bpp == 8 || bpp == 16) {
+		cinfo.input_components = 1;
+		cinfo.in_color_space = JCS_GRAYSCALE;
+	}
+	if (bpp == 24 || bpp == 48) {
+		if (!byte_order_rgb) {
+			unsigned char *b8 = copy;
+			for (int i = 0; i < size_in; i++) {
+				unsigned char b = *b8;
+				unsigned char r = *(b8 + 2);
+				*b8 = r;
+				*(b8 + 2) = b;
+				b8 += 3;
+			}
+		}
+		cinfo.input_components = 3;
+		cinfo.in_color_space = JCS_RGB;
+	}
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, CCD_JPEG_SETTINGS_QUALITY_ITEM->number.target, true);
+	JSAMPROW row_pointer[1];
+	jpeg_start_compress( &cinfo, TRUE);
+	while( cinfo.next_scanline < cinfo.image_height ) {
+		row_pointer[0] = &((JSAMPROW)copy)[cinfo.next_scanline * cinfo.image_width *  cinfo.input_components];
+		jpeg_write_scanlines(&cinfo, row_pointer, 1);
+	}
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+	*data_out = mem;
+	*size_out = mem_size;
+	free(copy);
+	INDIGO_DEBUG(indigo_debug("RAW to preview conversion in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+}
+
+// -------------------------------------------------------------------------------- lossless compression
+
+// Rice coder produces the same bit stream as CFITSIO fits_rcomp_short() and fits_rcomp_byte() with BLOCKSIZE 32, so tile
+// compressed FITS can be read by funpack or any CFITSIO based application. LZ4 coder produces plain LZ4 block format.
+// Both FITS tiles and XISF subblocks are encoded in row bands on frame worker threads into band buffers which are
+// then concatenated.
+
+#define RICE_BLOCK_SIZE		32
+#define LZ4_HASH_BITS			14
+
+typedef struct {
+	uint8_t *out;
+	uint64_t buffer;
+	int bits;
+} bit_writer;
+
+static inline void put_bits(bit_writer *writer, uint32_t value, int count) {
+	writer->buffer = writer->buffer << count | (value & ((1U << count) - 1));
+	writer->bits += count;
+	while (writer->bits >= 8) {
+		writer->bits -= 8;
+		*writer->out++ = (uint8_t)(writer->buffer >> writer->bits);
+	}
+}
+
+static inline void flush_bits(bit_writer *writer) {
+	if (writer->bits > 0)
+		*writer->out++ = (uint8_t)(writer->buffer << (8 - writer->bits));
+	writer->bits = 0;
+}
+
+static void rice_block(bit_writer *writer, const uint16_t *diff, int count, int fs_bits, int fs_max, int b_bits) {
+	int sum = 0;
+	for (int i = 0; i < count; i++)
+		sum += diff[i];
+	int average = sum - count / 2 - 1;
+	unsigned psum = average < 0 ? 0 : (unsigned)(average / count) >> 1;
+	int fs = 0;
+	while (psum > 0) {
+		psum >>= 1;
+		fs++;
+	}
+	if (fs >= fs_max) {
+		put_bits(writer, fs_max + 1, fs_bits);
+		for (int i = 0; i < count; i++)
+			put_bits(writer, diff[i], b_bits);
+	} else if (fs == 0 && sum == 0) {
+		put_bits(writer, 0, fs_bits);
+	} else {
+		put_bits(writer, fs + 1, fs_bits);
+		for (int i = 0; i < count; i++) {
+			int top = diff[i] >> fs;
+			while (top > 16) {
+				put_bits(writer, 0, 16);
+				top -= 16;
+			}
+			put_bits(writer, 1, top + 1);
+			if (fs > 0)
+				put_bits(writer, diff[i], fs);
+		}
+	}
+}
+
+// in are big endian signed 16 bit samples as stored in FITS
+
+static long rice_encode_16(const uint8_t *in, int count, uint8_t *out) {
+	bit_writer writer = { out, 0, 0 };
+	uint16_t diff[RICE_BLOCK_SIZE];
+	int16_t last = (int16_t)(in[0] << 8 | in[1]);
+	put_bits(&writer, (uint16_t)last, 16);
+	for (int i = 0; i < count; i += RICE_BLOCK_SIZE) {
+		int block = count - i < RICE_BLOCK_SIZE ? count - i : RICE_BLOCK_SIZE;
+		for (int j = 0; j < block; j++, in += 2) {
+			int16_t next = (int16_t)(in[0] << 8 | in[1]);
+			int16_t delta = (int16_t)(next - last);
+			diff[j] = delta < 0 ? (uint16_t)(-2 * delta - 1) : (uint16_t)(2 * delta);
+			last = next;
+		}
+		rice_block(&writer, diff, block, 4, 14, 16);
+	}
+	flush_bits(&writer);
+	return writer.out - out;
+}
+
+static long rice_encode_8(const uint8_t *in, int count, uint8_t *out) {
+	bit_writer writer = { out, 0, 0 };
+	uint16_t diff[RICE_BLOCK_SIZE];
+	uint8_t last = in[0];
+	put_bits(&writer, last, 8);
+	for (int i = 0; i < count; i += RICE_BLOCK_SIZE) {
+		int block = count - i < RICE_BLOCK_SIZE ? count - i : RICE_BLOCK_SIZE;
+		for (int j = 0; j < block; j++) {
+			int8_t delta = (int8_t)(*in - last);
+			diff[j] = delta < 0 ? (uint8_t)(-2 * delta - 1) : (uint8_t)(2 * delta);
+			last = *in++;
+		}
+		rice_block(&writer, diff, block, 3, 6, 8);
+	}
+	flush_bits(&writer);
+	return writer.out - out;
+}
+
+static inline uint32_t read_32(const uint8_t *p) {
+	uint32_t value;
+	memcpy(&value, p, 4);
+	return value;
+}
+
+static uint8_t *lz4_sequence(uint8_t *out, const uint8_t *literals, long literal_length, long offset, long match_length) {
+	uint8_t *token = out++;
+	*token = (literal_length < 15 ? literal_length : 15) << 4;
+	if (literal_length >= 15) {
+		long length = literal_length - 15;
+		for (; length >= 255; length -= 255)
+			*out++ = 255;
+		*out++ = length;
+	}
+	memcpy(out, literals, literal_length);
+	out += literal_length;
+	if (match_length == 0)
+		return out;
+	*out++ = offset & 0xFF;
+	*out++ = offset >> 8;
+	long length = match_length - 4;
+	*token |= length < 15 ? length : 15;
+	if (length >= 15) {
+		for (length -= 15; length >= 255; length -= 255)
+			*out++ = 255;
+		*out++ = length;
+	}
+	return out;
+}
+
+// Greedy single probe LZ4, search step grows by one every 64 failed probes. Last match starts at least 12 bytes and ends
+// at least 5 bytes before end of input as required by the format.
+
+static long lz4_encode(const uint8_t *in, long size, uint8_t *out) {
+	uint32_t *table = calloc(1 << LZ4_HASH_BITS, sizeof(uint32_t));
+	if (table == NULL)
+		return -1;
+	const uint8_t *ip = in, *anchor = in, *end = in + size;
+	uint8_t *op = out;
+	if (size > 12) {
+		const uint8_t *match_limit = end - 12, *copy_limit = end - 5;
+		int attempts = 64;
+		ip++;
+		while (ip < match_limit) {
+			uint32_t sequence = read_32(ip);
+			uint32_t hash = (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+			const uint8_t *candidate = in + table[hash];
+			table[hash] = (uint32_t)(ip - in);
+			if (candidate >= ip || ip - candidate > 65535 || read_32(candidate) != sequence) {
+				ip += attempts++ >> 6;
+				continue;
+			}
+			while (ip > anchor && candidate > in && ip[-1] == candidate[-1]) {
+				ip--;
+				candidate--;
+			}
+			const uint8_t *match_end = ip + 4, *reference = candidate + 4;
+			while (match_end < copy_limit && *match_end == *reference) {
+				match_end++;
+				reference++;
+			}
+			op = lz4_sequence(op, anchor, ip - anchor, ip - candidate, match_end - ip);
+			anchor = ip = match_end;
+			attempts = 64;
+		}
+	}
+	op = lz4_sequence(op, anchor, end - anchor, 0, 0);
+	free(table);
+	return op - out;
+}
+
+static inline long lz4_bound(long size) {
+	return size + size / 255 + 16;
+}
+
+typedef struct {
+	const uint8_t *source;
+	int bytes;
+	int planes;
+	long size;
+	bool zlib;
+	uint8_t **band_data;
+	long *band_size;
+	uint32_t *tile_offset;
+	uint32_t *tile_size;
+	bool failed;
+} compression_job;
+
+static void fits_tiles_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	compression_job *job = context;
+	long row_size = (long)frame->width * job->bytes;
+	uint8_t *out = malloc((row_size + row_size / 16 + 16) * (end_row - first_row) * job->planes);
+	if (out == NULL) {
+		job->failed = true;
+		return;
+	}
+	long size = 0;
+	for (int plane = 0; plane < job->planes; plane++) {
+		for (int y = first_row; y < end_row; y++) {
+			long tile = (long)plane * frame->height + y;
+			const uint8_t *in = job->source + tile * row_size;
+			long length = job->bytes == 2 ? rice_encode_16(in, frame->width, out + size) : rice_encode_8(in, frame->width, out + size);
+			job->tile_offset[tile] = (uint32_t)size;
+			job->tile_size[tile] = (uint32_t)length;
+			size += length;
+		}
+	}
+	job->band_data[first_row] = out;
+	job->band_size[first_row] = size;
+}
+
+static void xisf_shuffle_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	compression_job *job = context;
+	long count = job->size / job->bytes;
+	long first = count * first_row / frame->height, end = count * end_row / frame->height;
+	uint8_t *out = frame->data + FITS_HEADER_SIZE;
+	for (int byte = 0; byte < job->bytes; byte++) {
+		const uint8_t *in = job->source + byte;
+		uint8_t *plane = out + byte * count;
+		for (long i = first; i < end; i++)
+			plane[i] = in[i * job->bytes];
+	}
+}
+
+static void xisf_subblocks_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	compression_job *job = context;
+	long first = job->size * first_row / frame->height, end = job->size * end_row / frame->height;
+	unsigned long length = job->zlib ? compressBound(end - first) : lz4_bound(end - first);
+	uint8_t *out = malloc(length);
+	if (out == NULL) {
+		job->failed = true;
+		return;
+	}
+	long size;
+	if (job->zlib)
+		size = compress2(out, &length, job->source + first, end - first, Z_DEFAULT_COMPRESSION) == Z_OK ? (long)length : -1;
+	else
+		size = lz4_encode(job->source + first, end - first, out);
+	if (size < 0)
+		job->failed = true;
+	job->band_data[first_row] = out;
+	job->band_size[first_row] = size;
+}
+
+static void release_compression_job(indigo_frame *frame, compression_job *job) {
+	for (int y = 0; y < frame->height; y++)
+		free(job->band_data[y]);
+	free(job->band_data);
+	free(job->band_size);
+	free(job->tile_offset);
+	free(job->tile_size);
+}
+
+// Replaces uncompressed FITS in frame->blob with tile compressed one (empty primary HDU and compressed image in BINTABLE
+// extension, one tile per row and plane), original FITS is kept if compression doesn't save anything.
+
+// FITS card is always exactly 80 characters, header is prefilled with spaces and longer card is truncated
+
+static void fits_card(char *card, const char *format, ...) {
+	char buffer[128];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	if (length > 80) {
+		indigo_error("FITS card '%.8s' is %d characters long, truncated", buffer, length);
+		length = 80;
+	}
+	if (length > 0)
+		memcpy(card, buffer, length);
+}
+
+static bool fits_compress(indigo_device *device, indigo_frame *frame) {
+	int bytes = (frame->bpp == 8 || frame->bpp == 24) ? 1 : 2;
+	int planes = frame->bpp == 24 || frame->bpp == 48 ? 3 : 1;
+	long tiles = (long)frame->height * planes;
+	compression_job job = { (uint8_t *)frame->blob + FITS_HEADER_SIZE, bytes, planes };
+	job.band_data = calloc(frame->height, sizeof(uint8_t *));
+	job.band_size = calloc(frame->height, sizeof(long));
+	job.tile_offset = calloc(tiles, sizeof(uint32_t));
+	job.tile_size = calloc(tiles, sizeof(uint32_t));
+	if (job.band_data == NULL || job.band_size == NULL || job.tile_offset == NULL || job.tile_size == NULL) {
+		release_compression_job(frame, &job);
+		return false;
+	}
+	indigo_process_frame_rows(device, frame, fits_tiles_rows, &job);
+	if (job.failed) {
+		release_compression_job(frame, &job);
+		return false;
+	}
+	long heap_size = 0;
+	uint32_t max_tile = 0;
+	for (int y = 0; y < frame->height; y++)
+		heap_size += job.band_size[y];
+	for (long tile = 0; tile < tiles; tile++)
+		if (job.tile_size[tile] > max_tile)
+			max_tile = job.tile_size[tile];
+	char cards[FITS_HEADER_SIZE];
+	memcpy(cards, frame->blob, FITS_HEADER_SIZE);
+	int card_count = 0, kept_count = 0;
+	for (char *card = cards; card < cards + FITS_HEADER_SIZE && strncmp(card, "END     ", 8); card += 80) {
+		card_count++;
+		if (strncmp(card, "SIMPLE  ", 8) && strncmp(card, "BITPIX  ", 8) && strncmp(card, "NAXIS", 5) && strncmp(card, "EXTEND  ", 8))
+			kept_count++;
+	}
+	int extension_cards = planes == 3 ? 25 : 23;
+	int header_blocks = (kept_count + extension_cards + 35) / 36;
+	long data_size = tiles * 8 + heap_size;
+	long size = FITS_HEADER_SIZE + header_blocks * FITS_HEADER_SIZE + (data_size + FITS_HEADER_SIZE - 1) / FITS_HEADER_SIZE * FITS_HEADER_SIZE;
+	if (size >= (long)frame->blob_size) {
+		release_compression_job(frame, &job);
+		return true;
+	}
+	char *header = frame->blob;
+	memset(header, ' ', FITS_HEADER_SIZE * (header_blocks + 1));
+	fits_card(header, "SIMPLE  =                    T / file conforms to FITS standard");
+	fits_card(header += 80, "BITPIX  =                    8 / number of bits per data pixel");
+	fits_card(header += 80, "NAXIS   =                    0 / no data in primary HDU");
+	fits_card(header += 80, "EXTEND  =                    T / FITS dataset may contain extensions");
+	fits_card(header += 80, "END");
+	header = (char *)frame->blob + FITS_HEADER_SIZE;
+	fits_card(header, "XTENSION= 'BINTABLE'           / binary table extension");
+	fits_card(header += 80, "BITPIX  =                    8 / 8-bit bytes");
+	fits_card(header += 80, "NAXIS   =                    2 / 2-dimensional binary table");
+	fits_card(header += 80, "NAXIS1  =                    8 / width of table in bytes");
+	fits_card(header += 80, "NAXIS2  = %20ld / number of rows in table", tiles);
+	fits_card(header += 80, "PCOUNT  = %20ld / size of special data area", heap_size);
+	fits_card(header += 80, "GCOUNT  =                    1 / one data group");
+	fits_card(header += 80, "TFIELDS =                    1 / number of fields in each row");
+	fits_card(header += 80, "TTYPE1  = 'COMPRESSED_DATA'    / label for field 1");
+	char format[20];
+	sprintf(format, "1PB(%u)", max_tile);
+	fits_card(header += 80, "TFORM1  = '%s'%*c / data format of field: variable length array", format, (int)(18 - strlen(format)), ' ');
+	fits_card(header += 80, "ZIMAGE  =                    T / extension contains compressed image");
+	fits_card(header += 80, "ZBITPIX = %20d / number of bits per data pixel", bytes * 8);
+	fits_card(header += 80, "ZNAXIS  = %20d / number of data axes", planes == 3 ? 3 : 2);
+	fits_card(header += 80, "ZNAXIS1 = %20d / length of data axis 1 [pixels]", frame->width);
+	fits_card(header += 80, "ZNAXIS2 = %20d / length of data axis 2 [pixels]", frame->height);
+	if (planes == 3) {
+		fits_card(header += 80, "ZNAXIS3 =                    3 / length of data axis 3 [RGB]");
+	}
+	fits_card(header += 80, "ZTILE1  = %20d / size of tiles to be compressed", frame->width);
+	fits_card(header += 80, "ZTILE2  =                    1 / size of tiles to be compressed");
+	if (planes == 3) {
+		fits_card(header += 80, "ZTILE3  =                    1 / size of tiles to be compressed");
+	}
+	fits_card(header += 80, "ZCMPTYPE= 'RICE_1'             / compression algorithm");
+	fits_card(header += 80, "ZNAME1  = 'BLOCKSIZE'          / compression block size");
+	fits_card(header += 80, "ZVAL1   = %20d / pixels per block", RICE_BLOCK_SIZE);
+	fits_card(header += 80, "ZNAME2  = 'BYTEPIX'            / bytes per pixel (1, 2, 4, or 8)");
+	fits_card(header += 80, "ZVAL2   = %20d / bytes per pixel (1, 2, 4, or 8)", bytes);
+	for (char *card = cards; card < cards + card_count * 80; card += 80) {
+		if (strncmp(card, "SIMPLE  ", 8) && strncmp(card, "BITPIX  ", 8) && strncmp(card, "NAXIS", 5) && strncmp(card, "EXTEND  ", 8))
+			memcpy(header += 80, card, 80);
+	}
+	fits_card(header += 80, "END");
+	uint8_t *table = (uint8_t *)frame->blob + FITS_HEADER_SIZE + header_blocks * FITS_HEADER_SIZE;
+	uint8_t *heap = table + tiles * 8;
+	long base = 0;
+	for (int y = 0; y < frame->height; y++) {
+		if (job.band_data[y]) {
+			memcpy(heap + base, job.band_data[y], job.band_size[y]);
+			for (int plane = 0; plane < planes; plane++) {
+				for (int row = y; row < frame->height && (row == y || job.band_data[row] == NULL); row++) {
+					long tile = (long)plane * frame->height + row;
+					uint32_t length = job.tile_size[tile], offset = (uint32_t)(base + job.tile_offset[tile]);
+					uint8_t *descriptor = table + tile * 8;
+					descriptor[0] = length >> 24;
+					descriptor[1] = length >> 16;
+					descriptor[2] = length >> 8;
+					descriptor[3] = length;
+					descriptor[4] = offset >> 24;
+					descriptor[5] = offset >> 16;
+					descriptor[6] = offset >> 8;
+					descriptor[7] = offset;
+				}
+			}
+			base += job.band_size[y];
+		}
+	}
+	memset(table + data_size, 0, size - FITS_HEADER_SIZE * (header_blocks + 1) - data_size);
+	frame->blob_size = size;
+	release_compression_job(frame, &job);
+	return true;
+}
+
+// Compresses XISF data block in place, compression attribute and subblock list are written to attributes.
+
+static bool xisf_compress(indigo_device *device, indigo_frame *frame, unsigned long *size, char *attributes, int attributes_size) {
+	int bytes = (frame->bpp == 8 || frame->bpp == 24) ? 1 : 2;
+	compression_job job = { frame->data + FITS_HEADER_SIZE, bytes, 1, *size, CCD_XISF_COMPRESSION_ZLIB_ITEM->sw.value };
+	job.band_data = calloc(frame->height, sizeof(uint8_t *));
+	job.band_size = calloc(frame->height, sizeof(long));
+	if (job.band_data == NULL || job.band_size == NULL) {
+		release_compression_job(frame, &job);
+		return false;
+	}
+	if (bytes > 1) {
+		indigo_frame shuffled = *frame;
+		shuffled.data = indigo_frame_buffer(device, frame, *size);
+		indigo_process_frame_rows(device, &shuffled, xisf_shuffle_rows, &job);
+		job.source = shuffled.data + FITS_HEADER_SIZE;
+	}
+	indigo_process_frame_rows(device, frame, xisf_subblocks_rows, &job);
+	unsigned long compressed = 0;
+	for (int y = 0; y < frame->height; y++)
+		compressed += job.band_data[y] ? job.band_size[y] : 0;
+	if (job.failed || compressed >= *size) {
+		bool result = !job.failed;
+		release_compression_job(frame, &job);
+		return result;
+	}
+	const char *codec = job.zlib ? "zlib" : "lz4";
+	int length = bytes > 1 ? snprintf(attributes, attributes_size, " compression='%s+sh:%lu:%d' subblocks='", codec, *size, bytes) : snprintf(attributes, attributes_size, " compression='%s:%lu' subblocks='", codec, *size);
+	uint8_t *out = frame->data + FITS_HEADER_SIZE;
+	for (int y = 0, end; y < frame->height; y = end) {
+		for (end = y + 1; end < frame->height && job.band_data[end] == NULL; end++)
+			;
+		memcpy(out, job.band_data[y], job.band_size[y]);
+		out += job.band_size[y];
+		if (length < attributes_size)
+			length += snprintf(attributes + length, attributes_size - length, "%s%ld,%ld", y ? ":" : "", job.band_size[y], (long)(*size * end / frame->height - *size * y / frame->height));
+	}
+	if (length < attributes_size)
+		snprintf(attributes + length, attributes_size - length, "'");
+	*size = compressed;
+	release_compression_job(frame, &job);
+	return true;
+}
+
+#define FORMAT_STAGE_ORDER	1000
+
+static bool preview_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	indigo_frame colour = *frame;
+	if (frame->bayer_pattern && !CCD_PREVIEW_DEMOSAIC_NONE_ITEM->sw.value && !demosaic_frame(device, &colour, CCD_PREVIEW_DEMOSAIC_VNG_ITEM->sw.value))
+		colour = *frame;
+	raw_to_jpeg(device, colour.data, colour.width, colour.height, colour.bpp, colour.little_endian, colour.byte_order_rgb, &frame->preview, &frame->preview_size);
+	return frame->preview != NULL;
+}
+
+static void fits_mono16_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	short *raw = (short *)(frame->data + FITS_HEADER_SIZE) + (long)first_row * frame->width;
+	long count = (long)(end_row - first_row) * frame->width;
+	if (frame->little_endian) {
+		for (long i = 0; i < count; i++) {
+			int value = *raw - 32768;
+			*raw++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+		}
+	} else {
+		for (long i = 0; i < count; i++) {
+			int value = *raw;
+			value = ((value & 0xff) << 8 | (value & 0xff00) >> 8 ) - 32768;
+			*raw++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+		}
+	}
+}
+
+static void fits_rgb24_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	long size = (long)frame->width * frame->height;
+	long first = (long)first_row * frame->width;
+	long count = (long)(end_row - first_row) * frame->width;
+	unsigned char *red = context + FITS_HEADER_SIZE + first;
+	unsigned char *green = red + size;
+	unsigned char *blue = red + 2 * size;
+	unsigned char *tmp = frame->data + FITS_HEADER_SIZE + 3 * first;
+	if (frame->byte_order_rgb) {
+		for (long i = 0; i < count; i++) {
+			*red++ = *tmp++;
+			*green++ = *tmp++;
+			*blue++ = *tmp++;
+		}
+	} else {
+		for (long i = 0; i < count; i++) {
+			*blue++ = *tmp++;
+			*green++ = *tmp++;
+			*red++ = *tmp++;
+		}
+	}
+}
+
+static void fits_rgb48_rows(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context) {
+	long size = (long)frame->width * frame->height;
+	long first = (long)first_row * frame->width;
+	long count = (long)(end_row - first_row) * frame->width;
+	unsigned short *red = (unsigned short *)(context + FITS_HEADER_SIZE) + first;
+	unsigned short *green = red + size;
+	unsigned short *blue = red + 2 * size;
+	unsigned short *tmp = (unsigned short *)(frame->data + FITS_HEADER_SIZE) + 3 * first;
+	if (frame->little_endian) {
+		if (frame->byte_order_rgb) {
+			for (long i = 0; i < count; i++) {
+				int value = *tmp++ - 32768;
+				*red++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+				value = *tmp++ - 32768;
+				*green++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+				value = *tmp++ - 32768;
+				*blue++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+			}
+		} else {
+			for (long i = 0; i < count; i++) {
+				int value = *tmp++ - 32768;
+				*blue++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+				value = *tmp++ - 32768;
+				*green++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+				value = *tmp++ - 32768;
+				*red++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+			}
+		}
+	} else {
+		if (frame->byte_order_rgb) {
+			for (long i = 0; i < count; i++) {
+				*red++ = *tmp++;
+				*green++ = *tmp++;
+				*blue++ = *tmp++;
+			}
+		} else {
+			for (long i = 0; i < count; i++) {
+				*blue++ = *tmp++;
+				*green++ = *tmp++;
+				*red++ = *tmp++;
 			}
 		}
-		set_black_white(device, histo, count);
-		double scale = (CCD_JPEG_SETTINGS_WHITE_ITEM->number.value - CCD_JPEG_SETTINGS_BLACK_ITEM->number.value);
-		int offset = CCD_JPEG_SETTINGS_BLACK_ITEM->number.value;
-		unsigned char *b8 = copy;
-		b16 = copy;
-		for (int i = 0; i < count; i++) {
-			int value = (*b16++ - offset) / scale;
-			if (value < 0)
-				value = 0;
-			else if (value > 255)
-				value = 255;
-			*b8++ = value;
-		}
 	}
-	if (bpp == 8 || bpp == 16) {
-		cinfo.input_components = 1;
-		cinfo.in_color_space = JCS_GRAYSCALE;
+}
+
+static bool fits_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	int byte_per_pixel = frame->bpp / 8;
+	int naxis = 2;
+	unsigned long size = (unsigned long)frame->width * frame->height;
+	unsigned long blobsize = byte_per_pixel * size;
+	if (byte_per_pixel == 3) {
+		byte_per_pixel = 1;
+		naxis = 3;
+	} else if (byte_per_pixel == 6) {
+		byte_per_pixel = 2;
+		naxis = 3;
 	}
-	if (bpp == 24 || bpp == 48) {
-		if (!byte_order_rgb) {
-			unsigned char *b8 = copy;
-			for (int i = 0; i < size_in; i++) {
-				unsigned char b = *b8;
-				unsigned char r = *(b8 + 2);
-				*b8 = r;
-				*(b8 + 2) = b;
-				b8 += 3;
+	if (byte_per_pixel == 2 && naxis == 2) {
+		indigo_process_frame_rows(device, frame, fits_mono16_rows, NULL);
+	} else if (naxis == 3) {
+		void *planar = indigo_frame_buffer(device, frame, blobsize + 2880);
+		indigo_process_frame_rows(device, frame, byte_per_pixel == 1 ? fits_rgb24_rows : fits_rgb48_rows, planar);
+		frame->data = planar;
+	}
+	time_t timer;
+	struct tm* tm_info;
+	char date_time_end[20];
+	time(&timer);
+	tm_info = gmtime(&timer);
+	strftime(date_time_end, 20, "%Y-%m-%dT%H:%M:%S", tm_info);
+	char *header = frame->data;
+	memset(header, ' ', FITS_HEADER_SIZE);
+	fits_card(header, "SIMPLE  =                    T / file conforms to FITS standard");
+	fits_card(header += 80, "BITPIX  = %20d / number of bits per data pixel", byte_per_pixel * 8);
+	fits_card(header += 80, "NAXIS   =                    %d / number of data axes", naxis);
+	fits_card(header += 80, "NAXIS1  = %20d / length of data axis 1 [pixels]", frame->width);
+	fits_card(header += 80, "NAXIS2  = %20d / length of data axis 2 [pixels]", frame->height);
+	if (naxis == 3) {
+		fits_card(header += 80, "NAXIS3  = %20d / length of data axis 3 [RGB]", 3);
+	}
+	fits_card(header += 80, "EXTEND  =                    T / FITS dataset may contain extensions");
+	fits_card(header += 80, "COMMENT   FITS (Flexible Image Transport System) format is defined in 'Astronomy");
+	fits_card(header += 80, "COMMENT   and Astrophysics', volume 376, page 359; bibcode: 2001A&A...376..359H");
+	fits_card(header += 80, "COMMENT   Created by INDIGO %d.%d framework, see www.indigo-astronomy.org", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF);
+	if (byte_per_pixel == 2) {
+		fits_card(header += 80, "BZERO   =                32768 / offset data range to that of unsigned short");
+		fits_card(header += 80, "BSCALE  =                    1 / default scaling factor");
+	} else {
+	//	fits_card(header += 80, "BZERO   =                    0 / offset data range to that of unsigned short");
+	//	fits_card(header += 80, "BSCALE  =                  256 / default scaling factor");
+	}
+	fits_card(header += 80, "XBINNING= %20d / horizontal binning [pixels]", frame->horizontal_bin);
+	fits_card(header += 80, "YBINNING= %20d / vertical binning [pixels]", frame->vertical_bin);
+	if (CCD_INFO_PIXEL_WIDTH_ITEM->number.value > 0 && CCD_INFO_PIXEL_HEIGHT_ITEM->number.value) {
+		fits_card(header += 80, "XPIXSZ  = %20.2f / pixel width [microns]", CCD_INFO_PIXEL_WIDTH_ITEM->number.value * frame->horizontal_bin);
+		fits_card(header += 80, "YPIXSZ  = %20.2f / pixel height [microns]", CCD_INFO_PIXEL_HEIGHT_ITEM->number.value * frame->vertical_bin);
+	}
+	fits_card(header += 80, "EXPTIME = %20.2f / exposure time [s]", CCD_EXPOSURE_ITEM->number.target);
+	if (!CCD_TEMPERATURE_PROPERTY->hidden) {
+		fits_card(header += 80, "CCD-TEMP= %20.2f / CCD temperature [C]", CCD_TEMPERATURE_ITEM->number.value);
+	}
+	if (CCD_FRAME_TYPE_LIGHT_ITEM->sw.value)
+		fits_card(header += 80, "IMAGETYP= 'Light'               / frame type");
+	else if (CCD_FRAME_TYPE_FLAT_ITEM->sw.value)
+		fits_card(header += 80, "IMAGETYP= 'Flat'                / frame type");
+	else if (CCD_FRAME_TYPE_BIAS_ITEM->sw.value)
+		fits_card(header += 80, "IMAGETYP= 'Bias'                / frame type");
+	else if (CCD_FRAME_TYPE_DARK_ITEM->sw.value)
+		fits_card(header += 80, "IMAGETYP= 'Dark'                / frame type");
+	if (!CCD_GAIN_PROPERTY->hidden) {
+		fits_card(header += 80, "GAIN    = %20.2f / Gain", CCD_GAIN_ITEM->number.value);
+	}
+	if (!CCD_OFFSET_PROPERTY->hidden) {
+		fits_card(header += 80, "OFFSET  = %20.2f / Offset", CCD_OFFSET_ITEM->number.value);
+	}
+	if (!CCD_GAMMA_PROPERTY->hidden) {
+		fits_card(header += 80, "GAMMA   = %20.2f / Gamma", CCD_GAMMA_ITEM->number.value);
+	}
+	fits_card(header += 80, "DATE-OBS= '%s' / UTC date that FITS file was created", date_time_end);
+	fits_card(header += 80, "INSTRUME= '%s'%*c / instrument name", device->name, (int)(19 - strlen(device->name)), ' ');
+	indigo_fits_keyword *keywords = frame->keywords;
+	if (keywords) {
+		while (keywords->type && (header - (char *)frame->data) < (FITS_HEADER_SIZE - 80)) {
+			switch (keywords->type) {
+				case INDIGO_FITS_NUMBER:
+					fits_card(header += 80, "%7s= %20f / %s", keywords->name, keywords->number, keywords->comment);
+					break;
+				case INDIGO_FITS_STRING: {
+					const char *string = keywords->string;
+					if (!strcmp(keywords->name, "BAYERPAT")) {
+						// pattern may be shifted by software frame or dropped by software binning
+						if (frame->bayer_pattern == NULL) {
+							keywords++;
+							continue;
+						}
+						string = frame->bayer_pattern;
+					}
+					fits_card(header += 80, "%7s= '%s'%*c / %s", keywords->name, string, (int)(18 - strlen(string)), ' ', keywords->comment);
+					break;
+				}
+				case INDIGO_FITS_LOGICAL:
+					fits_card(header += 80, "%7s=                    %c / %s", keywords->name, keywords->logical ? 'T' : 'F', keywords->comment);
+					break;
 			}
+			keywords++;
 		}
-		cinfo.input_components = 3;
-		cinfo.in_color_space = JCS_RGB;
 	}
-	jpeg_set_defaults(&cinfo);
-	jpeg_set_quality(&cinfo, CCD_JPEG_SETTINGS_QUALITY_ITEM->number.target, true);
-	JSAMPROW row_pointer[1];
-	jpeg_start_compress( &cinfo, TRUE);
-	while( cinfo.next_scanline < cinfo.image_height ) {
-		row_pointer[0] = &((JSAMPROW)copy)[cinfo.next_scanline * cinfo.image_width *  cinfo.input_components];
-		jpeg_write_scanlines(&cinfo, row_pointer, 1);
+	for (int i = 0; i < CCD_FITS_HEADERS_PROPERTY->count; i++) {
+		indigo_item *item = CCD_FITS_HEADERS_PROPERTY->items + i;
+		if (*item->text.value && (header - (char *)frame->data) < (FITS_HEADER_SIZE - 80)) {
+			fits_card(header += 80, "%s", item->text.value);
+		}
 	}
-	jpeg_finish_compress(&cinfo);
-	jpeg_destroy_compress(&cinfo);
-	*data_out = mem;
-	*size_out = mem_size;
-	free(copy);
-	INDIGO_DEBUG(indigo_debug("RAW to preview conversion in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+	fits_card(header += 80, "END");
+	int mod2880 = blobsize % 2880;
+	if (mod2880) {
+		int padding = 2880 - mod2880;
+		if (padding) {
+			memset(frame->data + FITS_HEADER_SIZE + blobsize, 0, padding);
+			blobsize += padding;
+		}
+	}
+	frame->blob = frame->data;
+	frame->blob_size = FITS_HEADER_SIZE + blobsize;
+	if (CCD_FITS_COMPRESSION_RICE_ITEM->sw.value && !fits_compress(device, frame))
+		indigo_error("%s: FITS compression failed, uncompressed image used", device->name);
+	return true;
 }
 
-void indigo_process_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, bool byte_order_rgb, indigo_fits_keyword *keywords) {
-	assert(device != NULL);
-	assert(data != NULL);
-	INDIGO_DEBUG(clock_t start = clock());
-
-	int horizontal_bin = CCD_BIN_HORIZONTAL_ITEM->number.value;
-	int vertical_bin = CCD_BIN_VERTICAL_ITEM->number.value;
-	int byte_per_pixel = bpp / 8;
+static bool xisf_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	int byte_per_pixel = frame->bpp / 8;
 	int naxis = 2;
-	unsigned long size = frame_width * frame_height;
+	unsigned long size = (unsigned long)frame->width * frame->height;
 	unsigned long blobsize = byte_per_pixel * size;
 	if (byte_per_pixel == 3) {
 		byte_per_pixel = 1;
@@ -838,536 +3130,305 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 		byte_per_pixel = 2;
 		naxis = 3;
 	}
-
-	void *jpeg_data = NULL;
-	unsigned long jpeg_size = 0;
-	if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value) {
-		raw_to_jpeg(device, data, frame_width, frame_height, bpp, little_endian, byte_order_rgb, &jpeg_data, &jpeg_size);
-	}
-
-	if (!CCD_UPLOAD_MODE_PREVIEW_ITEM->sw.value) {
-		if (CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
-			INDIGO_DEBUG(clock_t start = clock());
-			time_t timer;
-			struct tm* tm_info;
-			char date_time_end[20];
-			time(&timer);
-			tm_info = gmtime(&timer);
-			strftime(date_time_end, 20, "%Y-%m-%dT%H:%M:%S", tm_info);
-			char *header = data;
-			memset(header, ' ', FITS_HEADER_SIZE);
-			int t = sprintf(header, "SIMPLE  =                    T / file conforms to FITS standard");
-			header[t] = ' ';
-			t = sprintf(header += 80, "BITPIX  = %20d / number of bits per data pixel", byte_per_pixel * 8);
-			header[t] = ' ';
-			t = sprintf(header += 80, "NAXIS   =                    %d / number of data axes", naxis);
-			header[t] = ' ';
-			t = sprintf(header += 80, "NAXIS1  = %20d / length of data axis 1 [pixels]", frame_width);
-			header[t] = ' ';
-			t = sprintf(header += 80, "NAXIS2  = %20d / length of data axis 2 [pixels]", frame_height);
-			header[t] = ' ';
-			if (naxis == 3) {
-				t = sprintf(header += 80, "NAXIS3  = %20d / length of data axis 3 [RGB]", 3);
-				header[t] = ' ';
-			}
-			t = sprintf(header += 80, "EXTEND  =                    T / FITS dataset may contain extensions");
-			header[t] = ' ';
-			t = sprintf(header += 80, "COMMENT   FITS (Flexible Image Transport System) format is defined in 'Astronomy");
-			header[t] = ' ';
-			t = sprintf(header += 80, "COMMENT   and Astrophysics', volume 376, page 359; bibcode: 2001A&A...376..359H");
-			header[t] = ' ';
-			t = sprintf(header += 80, "COMMENT   Created by INDIGO %d.%d framework, see www.indigo-astronomy.org", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF);
-			header[t] = ' ';
-			if (byte_per_pixel == 2) {
-				t = sprintf(header += 80, "BZERO   =                32768 / offset data range to that of unsigned short");
-				header[t] = ' ';
-				t = sprintf(header += 80, "BSCALE  =                    1 / default scaling factor");
-				header[t] = ' ';
-			} else {
-			//	t = sprintf(header += 80, "BZERO   =                    0 / offset data range to that of unsigned short");
-			//	header[t] = ' ';
-			//	t = sprintf(header += 80, "BSCALE  =                  256 / default scaling factor");
-			//	header[t] = ' ';
-			}
-			t = sprintf(header += 80, "XBINNING= %20d / horizontal binning [pixels]", horizontal_bin);
-			header[t] = ' ';
-			t = sprintf(header += 80, "YBINNING= %20d / vertical binning [pixels]", vertical_bin);
-			header[t] = ' ';
-			if (CCD_INFO_PIXEL_WIDTH_ITEM->number.value > 0 && CCD_INFO_PIXEL_HEIGHT_ITEM->number.value) {
-				t = sprintf(header += 80, "XPIXSZ  = %20.2f / pixel width [microns]", CCD_INFO_PIXEL_WIDTH_ITEM->number.value * horizontal_bin);
-				header[t] = ' ';
-				t = sprintf(header += 80, "YPIXSZ  = %20.2f / pixel height [microns]", CCD_INFO_PIXEL_HEIGHT_ITEM->number.value * vertical_bin);
-				header[t] = ' ';
-			}
-			t = sprintf(header += 80, "EXPTIME = %20.2f / exposure time [s]", CCD_EXPOSURE_ITEM->number.target);
-			header[t] = ' ';
-			if (!CCD_TEMPERATURE_PROPERTY->hidden) {
-				t = sprintf(header += 80, "CCD-TEMP= %20.2f / CCD temperature [C]", CCD_TEMPERATURE_ITEM->number.value);
-				header[t] = ' ';
-			}
-			if (CCD_FRAME_TYPE_LIGHT_ITEM->sw.value)
-				t = sprintf(header += 80, "IMAGETYP= 'Light'               / frame type");
-			else if (CCD_FRAME_TYPE_FLAT_ITEM->sw.value)
-				t = sprintf(header += 80, "IMAGETYP= 'Flat'                / frame type");
-			else if (CCD_FRAME_TYPE_BIAS_ITEM->sw.value)
-				t = sprintf(header += 80, "IMAGETYP= 'Bias'                / frame type");
-			else if (CCD_FRAME_TYPE_DARK_ITEM->sw.value)
-				t = sprintf(header += 80, "IMAGETYP= 'Dark'                / frame type");
-			header[t] = ' ';
-			if (!CCD_GAIN_PROPERTY->hidden) {
-				t = sprintf(header += 80, "GAIN    = %20.2f / Gain", CCD_GAIN_ITEM->number.value);
-				header[t] = ' ';
-			}
-			if (!CCD_OFFSET_PROPERTY->hidden) {
-				t = sprintf(header += 80, "OFFSET  = %20.2f / Offset", CCD_OFFSET_ITEM->number.value);
-				header[t] = ' ';
-			}
-			if (!CCD_GAMMA_PROPERTY->hidden) {
-				t = sprintf(header += 80, "GAMMA   = %20.2f / Gamma", CCD_GAMMA_ITEM->number.value);
-				header[t] = ' ';
+	if (naxis == 2 && byte_per_pixel == 2) {
+		if (!frame->little_endian) {
+			short *b16 = (short *)(frame->data + FITS_HEADER_SIZE);
+			for (int i = 0; i < size; i++) {
+				int value = *b16;
+				*b16++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
 			}
-			t = sprintf(header += 80, "DATE-OBS= '%s' / UTC date that FITS file was created", date_time_end);
-			header[t] = ' ';
-			t = sprintf(header += 80, "INSTRUME= '%s'%*c / instrument name", device->name, (int)(19 - strlen(device->name)), ' ');
-			header[t] = ' ';
-			if (keywords) {
-				while (keywords->type && (header - (char *)data) < (FITS_HEADER_SIZE - 80)) {
-					switch (keywords->type) {
-						case INDIGO_FITS_NUMBER:
-							t = sprintf(header += 80, "%7s= %20f / %s", keywords->name, keywords->number, keywords->comment);
-							break;
-						case INDIGO_FITS_STRING:
-							t = sprintf(header += 80, "%7s= '%s'%*c / %s", keywords->name, keywords->string, (int)(18 - strlen(keywords->string)), ' ', keywords->comment);
-							break;
-						case INDIGO_FITS_LOGICAL:
-							t = sprintf(header += 80, "%7s=                    %c / %s", keywords->name, keywords->logical ? 'T' : 'F', keywords->comment);
-							break;
-					}
-					header[t] = ' ';
-					keywords++;
-				}
+		}
+	} else if (naxis == 3 && byte_per_pixel == 1) {
+		if (!frame->byte_order_rgb) {
+			unsigned char *b8 = frame->data + FITS_HEADER_SIZE;
+			for (int i = 0; i < size; i++) {
+				unsigned char b = *b8;
+				unsigned char r = *(b8 + 2);
+				*b8 = r;
+				*(b8 + 2) = b;
+				b8 += 3;
 			}
-			for (int i = 0; i < CCD_FITS_HEADERS_PROPERTY->count; i++) {
-				indigo_item *item = CCD_FITS_HEADERS_PROPERTY->items + i;
-				if (*item->text.value && (header - (char *)data) < (FITS_HEADER_SIZE - 80)) {
-					t = sprintf(header += 80, "%s", item->text.value);
-					header[t] = ' ';
+		}
+	} else if (naxis == 3 && byte_per_pixel == 2) {
+		unsigned char *b16 = frame->data + FITS_HEADER_SIZE;
+		if (frame->little_endian) {
+			if (!frame->byte_order_rgb) {
+				for (int i = 0; i < size; i++) {
+					unsigned char b = *b16;
+					unsigned char r = *(b16 + 2);
+					*b16 = r;
+					*(b16 + 2) = b;
+					b16 += 3;
 				}
 			}
-			t = sprintf(header += 80, "END");
-			header[t] = ' ';
-			if (byte_per_pixel == 2 && naxis == 2) {
-				short *raw = (short *)(data + FITS_HEADER_SIZE);
-				if (little_endian) {
-					for (int i = 0; i < size; i++) {
-						int value = *raw - 32768;
-						*raw++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-					}
-				} else {
-					for (int i = 0; i < size; i++) {
-						int value = *raw;
-						value = ((value & 0xff) << 8 | (value & 0xff00) >> 8 ) - 32768;
-						*raw++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-					}
-				}
-			} else if (byte_per_pixel == 1 && naxis == 3) {
-				unsigned char *raw = malloc(3 * size);
-				unsigned char *red = raw;
-				unsigned char *green = raw + size;
-				unsigned char *blue = raw + 2 * size;
-				unsigned char *tmp = data + FITS_HEADER_SIZE;
-				if (byte_order_rgb) {
-					for (int i = 0; i < size; i++) {
-						*red++ = *tmp++;
-						*green++ = *tmp++;
-						*blue++ = *tmp++;
-					}
-				} else {
-					for (int i = 0; i < size; i++) {
-						*blue++ = *tmp++;
-						*green++ = *tmp++;
-						*red++ = *tmp++;
-					}
-				}
-				memcpy(data + FITS_HEADER_SIZE, raw, 3 * size);
-				free(raw);
-			} else if (byte_per_pixel == 2 && naxis == 3) {
-				unsigned short *raw = malloc(6 * size);
-				unsigned short *red = raw;
-				unsigned short *green = raw + size;
-				unsigned short *blue = raw + 2 * size;
-				unsigned short *tmp = (unsigned short *)(data + FITS_HEADER_SIZE);
-				if (little_endian) {
-					if (byte_order_rgb) {
-						for (int i = 0; i < size; i++) {
-							int value = *tmp++ - 32768;
-							*red++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							value = *tmp++ - 32768;
-							*green++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							value = *tmp++ - 32768;
-							*blue++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-						}
-					} else {
-						for (int i = 0; i < size; i++) {
-							int value = *tmp++ - 32768;
-							*blue++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							value = *tmp++ - 32768;
-							*green++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							value = *tmp++ - 32768;
-							*red++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-						}
-					}
-				} else {
-					if (byte_order_rgb) {
-						for (int i = 0; i < size; i++) {
-							*red++ = *tmp++;
-							*green++ = *tmp++;
-							*blue++ = *tmp++;
-						}
-					} else {
-						for (int i = 0; i < size; i++) {
-							*blue++ = *tmp++;
-							*green++ = *tmp++;
-							*red++ = *tmp++;
-						}
-					}
+		} else {
+			if (frame->byte_order_rgb) {
+				for (int i = 0; i < size; i++) {
+					int value = *b16;
+					*b16++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
 				}
-				memcpy(data + FITS_HEADER_SIZE, raw, 6 * size);
-				free(raw);
-			}
-			int mod2880 = blobsize % 2880;
-			if (mod2880) {
-				int padding = 2880 - mod2880;
-				if (padding) {
-					memset(data + FITS_HEADER_SIZE + blobsize, 0, padding);
-					blobsize += padding;
+			} else {
+				for (int i = 0; i < size; i++) {
+					int value = *b16;
+					unsigned b = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+					value = *(b16 + 1);
+					unsigned g = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+					value = *(b16 + 2);
+					unsigned r = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+					*b16 = r;
+					*(b16 + 1) = g;
+					*(b16 + 2) = b;
+					b16 += 3;
 				}
 			}
-			INDIGO_DEBUG(indigo_debug("RAW to FITS conversion in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
-		} else if (CCD_IMAGE_FORMAT_XISF_ITEM->sw.value) {
-			INDIGO_DEBUG(clock_t start = clock());
-			time_t timer;
-			struct tm* tm_info;
-			char date_time_end[21], date_time_start[21];
-			time(&timer);
-			tm_info = gmtime(&timer);
-			strftime(date_time_end, 21, "%Y-%m-%dT%H:%M:%SZ", tm_info);
-			timer -= CCD_EXPOSURE_ITEM->number.target;
-			tm_info = gmtime(&timer);
-			strftime(date_time_start, 21, "%Y-%m-%dT%H:%M:%SZ", tm_info);
-			char *header = data;
-			strcpy(header, "XISF0100");
-			header += 16;
-			memset(header, 0, FITS_HEADER_SIZE);
-			sprintf(header, "<?xml version='1.0' encoding='UTF-8'?><xisf xmlns='http://www.pixinsight.com/xisf' xmlns:xsi='http://www.w3.org/2001/XMLSchema-instance' version='1.0' xsi:schemaLocation='http://www.pixinsight.com/xisf http://pixinsight.com/xisf/xisf-1.0.xsd'>");
-			header += strlen(header);
-			char *frame_type = "Light";
-			if (CCD_FRAME_TYPE_FLAT_ITEM->sw.value)
-				frame_type ="Flat";
-			else if (CCD_FRAME_TYPE_BIAS_ITEM->sw.value)
-				frame_type ="Bias";
-			else if (CCD_FRAME_TYPE_DARK_ITEM->sw.value)
-				frame_type ="Dark";
-			if (naxis == 2 && byte_per_pixel == 1) {
-				sprintf(header, "<Image geometry='%d:%d:1' imageType='%s' sampleFormat='UInt8' colorSpace='Gray' location='attachment:%d:%lu'>", frame_width, frame_height, frame_type, FITS_HEADER_SIZE, blobsize);
-			} else if (naxis == 2 && byte_per_pixel == 2) {
-				sprintf(header, "<Image geometry='%d:%d:1' imageType='%s' sampleFormat='UInt16' colorSpace='Gray' location='attachment:%d:%lu'>", frame_width, frame_height, frame_type, FITS_HEADER_SIZE, blobsize);
-			} else if (naxis == 3 && byte_per_pixel == 1) {
-				sprintf(header, "<Image geometry='%d:%d:3' imageType='%s' pixelStorage='Normal' sampleFormat='UInt8' colorSpace='RGB' location='attachment:%d:%lu'>", frame_width, frame_height, frame_type, FITS_HEADER_SIZE, blobsize);
-			} else if (naxis == 3 && byte_per_pixel == 2) {
-				sprintf(header, "<Image geometry='%d:%d:3' imageType='%s' pixelStorage='Normal' sampleFormat='UInt16' colorSpace='RGB' location='attachment:%d:%lu'>", frame_width, frame_height, frame_type, FITS_HEADER_SIZE, blobsize);
-			}
-			header += strlen(header);
-			sprintf(header, "<Property id='Observation:Time:Start' type='TimePoint' value='%s'/><Property id='Observation:Time:End' type='TimePoint' value='%s'/>", date_time_start ,date_time_end);
-			header += strlen(header);
-			sprintf(header, "<Property id='Instrument:Camera:Name' type='String'>%s</Property>", device->name);
-			header += strlen(header);
-			sprintf(header, "<Property id='Instrument:Camera:XBinning' type='Int32' value='%d'/><Property id='Instrument:Camera:YBinning' type='Int32' value='%d'/>", horizontal_bin, vertical_bin);
-			header += strlen(header);
-			sprintf(header, "<Property id='Instrument:ExposureTime' type='Float32' value='%.5f'/>", CCD_EXPOSURE_ITEM->number.target);
-			header += strlen(header);
-			sprintf(header, "<Property id='Instrument:Sensor:XPixelSize' type='Float32' value='%.2f'/><Property id='Instrument:Sensor:YPixelSize' type='Float32' value='%.2f'/>", CCD_INFO_PIXEL_WIDTH_ITEM->number.value * horizontal_bin, CCD_INFO_PIXEL_HEIGHT_ITEM->number.value * vertical_bin);
+		}
+	}
+	unsigned long data_size = blobsize;
+	char compression[512] = "";
+	if (!CCD_XISF_COMPRESSION_NONE_ITEM->sw.value && !xisf_compress(device, frame, &data_size, compression, sizeof(compression)))
+		indigo_error("%s: XISF compression failed, uncompressed image used", device->name);
+	time_t timer;
+	struct tm* tm_info;
+	char date_time_end[21], date_time_start[21];
+	time(&timer);
+	tm_info = gmtime(&timer);
+	strftime(date_time_end, 21, "%Y-%m-%dT%H:%M:%SZ", tm_info);
+	timer -= CCD_EXPOSURE_ITEM->number.target;
+	tm_info = gmtime(&timer);
+	strftime(date_time_start, 21, "%Y-%m-%dT%H:%M:%SZ", tm_info);
+	char *header = frame->data;
+	strcpy(header, "XISF0100");
+	header += 16;
+	memset(header, 0, FITS_HEADER_SIZE - 16);
+	sprintf(header, "<?xml version='1.0' encoding='UTF-8'?><xisf xmlns='http://www.pixinsight.com/xisf' xmlns:xsi='http://www.w3.org/2001/XMLSchema-instance' version='1.0' xsi:schemaLocation='http://www.pixinsight.com/xisf http://pixinsight.com/xisf/xisf-1.0.xsd'>");
+	header += strlen(header);
+	char *frame_type = "Light";
+	if (CCD_FRAME_TYPE_FLAT_ITEM->sw.value)
+		frame_type ="Flat";
+	else if (CCD_FRAME_TYPE_BIAS_ITEM->sw.value)
+		frame_type ="Bias";
+	else if (CCD_FRAME_TYPE_DARK_ITEM->sw.value)
+		frame_type ="Dark";
+	if (naxis == 2 && byte_per_pixel == 1) {
+		sprintf(header, "<Image geometry='%d:%d:1' imageType='%s' sampleFormat='UInt8' colorSpace='Gray' location='attachment:%d:%lu'%s>", frame->width, frame->height, frame_type, FITS_HEADER_SIZE, data_size, compression);
+	} else if (naxis == 2 && byte_per_pixel == 2) {
+		sprintf(header, "<Image geometry='%d:%d:1' imageType='%s' sampleFormat='UInt16' colorSpace='Gray' location='attachment:%d:%lu'%s>", frame->width, frame->height, frame_type, FITS_HEADER_SIZE, data_size, compression);
+	} else if (naxis == 3 && byte_per_pixel == 1) {
+		sprintf(header, "<Image geometry='%d:%d:3' imageType='%s' pixelStorage='Normal' sampleFormat='UInt8' colorSpace='RGB' location='attachment:%d:%lu'%s>", frame->width, frame->height, frame_type, FITS_HEADER_SIZE, data_size, compression);
+	} else if (naxis == 3 && byte_per_pixel == 2) {
+		sprintf(header, "<Image geometry='%d:%d:3' imageType='%s' pixelStorage='Normal' sampleFormat='UInt16' colorSpace='RGB' location='attachment:%d:%lu'%s>", frame->width, frame->height, frame_type, FITS_HEADER_SIZE, data_size, compression);
+	}
+	header += strlen(header);
+	sprintf(header, "<Property id='Observation:Time:Start' type='TimePoint' value='%s'/><Property id='Observation:Time:End' type='TimePoint' value='%s'/>", date_time_start ,date_time_end);
+	header += strlen(header);
+	sprintf(header, "<Property id='Instrument:Camera:Name' type='String'>%s</Property>", device->name);
+	header += strlen(header);
+	sprintf(header, "<Property id='Instrument:Camera:XBinning' type='Int32' value='%d'/><Property id='Instrument:Camera:YBinning' type='Int32' value='%d'/>", frame->horizontal_bin, frame->vertical_bin);
+	header += strlen(header);
+	sprintf(header, "<Property id='Instrument:ExposureTime' type='Float32' value='%.5f'/>", CCD_EXPOSURE_ITEM->number.target);
+	header += strlen(header);
+	sprintf(header, "<Property id='Instrument:Sensor:XPixelSize' type='Float32' value='%.2f'/><Property id='Instrument:Sensor:YPixelSize' type='Float32' value='%.2f'/>", CCD_INFO_PIXEL_WIDTH_ITEM->number.value * frame->horizontal_bin, CCD_INFO_PIXEL_HEIGHT_ITEM->number.value * frame->vertical_bin);
+	header += strlen(header);
+	if (!CCD_TEMPERATURE_PROPERTY->hidden) {
+		sprintf(header, "<Property id='Instrument:Sensor:Temperature' type='Float32' value='%.2f'/><Property id='Instrument:Sensor:TargetTemperature' type='Float32' value='%.2f'/>", CCD_TEMPERATURE_ITEM->number.value, CCD_TEMPERATURE_ITEM->number.target);
+	}
+	header += strlen(header);
+	if (!CCD_GAIN_PROPERTY->hidden) {
+		sprintf(header, "<Property id='Instrument:Camera:Gain' type='Float32' value='%g'/>", CCD_GAIN_ITEM->number.value);
+		header += strlen(header);
+	}
+	for (int i = 0; i < CCD_FITS_HEADERS_PROPERTY->count; i++) {
+		indigo_item *item = CCD_FITS_HEADERS_PROPERTY->items + i;
+		if (!strncmp(item->text.value, "FILTER=", 7)) {
+			sprintf(header, "<Property id='Instrument:Filter:Name' type='String' value='%s'/>", item->text.value + 7);
 			header += strlen(header);
-			if (!CCD_TEMPERATURE_PROPERTY->hidden) {
-				sprintf(header, "<Property id='Instrument:Sensor:Temperature' type='Float32' value='%.2f'/><Property id='Instrument:Sensor:TargetTemperature' type='Float32' value='%.2f'/>", CCD_TEMPERATURE_ITEM->number.value, CCD_TEMPERATURE_ITEM->number.target);
-			}
+		} else if (!strncmp(item->text.value, "FOCUS=", 6)) {
+			sprintf(header, "<Property id='Instrument:Focuser:Position' type='String' value='%s'/>", item->text.value + 6);
 			header += strlen(header);
-			if (!CCD_GAIN_PROPERTY->hidden) {
-				sprintf(header, "<Property id='Instrument:Camera:Gain' type='Float32' value='%g'/>", CCD_GAIN_ITEM->number.value);
-				header += strlen(header);
-			}
-			for (int i = 0; i < CCD_FITS_HEADERS_PROPERTY->count; i++) {
-				indigo_item *item = CCD_FITS_HEADERS_PROPERTY->items + i;
-				if (!strncmp(item->text.value, "FILTER=", 7)) {
-					sprintf(header, "<Property id='Instrument:Filter:Name' type='String' value='%s'/>", item->text.value + 7);
-					header += strlen(header);
-				} else if (!strncmp(item->text.value, "FOCUS=", 6)) {
-					sprintf(header, "<Property id='Instrument:Focuser:Position' type='String' value='%s'/>", item->text.value + 6);
-					header += strlen(header);
-				}
+		}
+	}
+	if (frame->bayer_pattern) {
+		sprintf(header, "<ColorFilterArray pattern='%s' width='2' height='2'/>", frame->bayer_pattern);
+		header += strlen(header);
+	}
+	sprintf(header, "</Image><Metadata><Property id='XISF:CreationTime' type='String'>%s</Property><Property id='XISF:CreatorApplication' type='String'>INDIGO 2.0-%d</Property>", date_time_end, INDIGO_BUILD);
+	header += strlen(header);
+#ifdef INDIGO_LINUX
+	sprintf(header, "<Property id='XISF:CreatorOS' type='String'>Linux</Property>");
+#endif
+#ifdef INDIGO_MACOS
+	sprintf(header, "<Property id='XISF:CreatorOS' type='String'>macOS</Property>");
+#endif
+#ifdef INDIGO_WINDOWS
+	sprintf(header, "<Property id='XISF:CreatorOS' type='String'>Windows</Property>");
+#endif
+	header += strlen(header);
+	sprintf(header, "<Property id='XISF:BlockAlignmentSize' type='UInt16' value='2880'/></Metadata></xisf>");
+	header += strlen(header);
+	*(uint32_t *)(frame->data + 8) = (uint32_t)(header - (char *)frame->data) - 16;
+	frame->blob = frame->data;
+	frame->blob_size = FITS_HEADER_SIZE + data_size;
+	return true;
+}
+
+static bool raw_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	int byte_per_pixel = frame->bpp / 8;
+	int naxis = 2;
+	unsigned long size = (unsigned long)frame->width * frame->height;
+	unsigned long blobsize = byte_per_pixel * size;
+	if (byte_per_pixel == 3) {
+		byte_per_pixel = 1;
+		naxis = 3;
+	} else if (byte_per_pixel == 6) {
+		byte_per_pixel = 2;
+		naxis = 3;
+	}
+	indigo_raw_header *header = (indigo_raw_header *)(frame->data + FITS_HEADER_SIZE - sizeof(indigo_raw_header));
+	if (naxis == 2 && byte_per_pixel == 1)
+		header->signature = INDIGO_RAW_MONO8;
+	else if (naxis == 2 && byte_per_pixel == 2) {
+		header->signature = INDIGO_RAW_MONO16;
+		if (!frame->little_endian) {
+			short *b16 = (short *)(frame->data + FITS_HEADER_SIZE);
+			for (int i = 0; i < size; i++) {
+				int value = *b16;
+				*b16++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
 			}
-			if (keywords) {
-				while (keywords->type) {
-					if (!strcmp(keywords->name, "BAYERPAT")) {
-						sprintf(header, "<ColorFilterArray pattern='%s' width='2' height='2'/>", keywords->string);
-						header += strlen(header);
-					}
-					keywords++;
-				}
+		}
+	} else if (naxis == 3 && byte_per_pixel == 1) {
+		header->signature = INDIGO_RAW_RGB24;
+		if (!frame->byte_order_rgb) {
+			unsigned char *b8 = frame->data + FITS_HEADER_SIZE;
+			for (int i = 0; i < size; i++) {
+				unsigned char b = *b8;
+				unsigned char r = *(b8 + 2);
+				*b8 = r;
+				*(b8 + 2) = b;
+				b8 += 3;
 			}
-			sprintf(header, "</Image><Metadata><Property id='XISF:CreationTime' type='String'>%s</Property><Property id='XISF:CreatorApplication' type='String'>INDIGO 2.0-%d</Property>", date_time_end, INDIGO_BUILD);
-			header += strlen(header);
-	#ifdef INDIGO_LINUX
-			sprintf(header, "<Property id='XISF:CreatorOS' type='String'>Linux</Property>");
-	#endif
-	#ifdef INDIGO_MACOS
-			sprintf(header, "<Property id='XISF:CreatorOS' type='String'>macOS</Property>");
-	#endif
-	#ifdef INDIGO_WINDOWS
-			sprintf(header, "<Property id='XISF:CreatorOS' type='String'>Windows</Property>");
-	#endif
-			header += strlen(header);
-			sprintf(header, "<Property id='XISF:BlockAlignmentSize' type='UInt16' value='2880'/></Metadata></xisf>");
-			header += strlen(header);
-			*(uint32_t *)(data + 8) = (uint32_t)(header - (char *)data) - 16;
-			if (naxis == 2 && byte_per_pixel == 2) {
-				if (!little_endian) {
-					short *b16 = (short *)(data + FITS_HEADER_SIZE);
-					for (int i = 0; i < size; i++) {
-						int value = *b16;
-						*b16++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-					}
-				}
-			} else if (naxis == 3 && byte_per_pixel == 1) {
-				if (!byte_order_rgb) {
-					unsigned char *b8 = data + FITS_HEADER_SIZE;
-					for (int i = 0; i < size; i++) {
-						unsigned char b = *b8;
-						unsigned char r = *(b8 + 2);
-						*b8 = r;
-						*(b8 + 2) = b;
-						b8 += 3;
-					}
-				}
-			} else if (naxis == 3 && byte_per_pixel == 2) {
-				unsigned char *b16 = data + FITS_HEADER_SIZE;
-				if (little_endian) {
-					if (!byte_order_rgb) {
-						for (int i = 0; i < size; i++) {
-							unsigned char b = *b16;
-							unsigned char r = *(b16 + 2);
-							*b16 = r;
-							*(b16 + 2) = b;
-							b16 += 3;
-						}
-					}
-				} else {
-					if (byte_order_rgb) {
-						for (int i = 0; i < size; i++) {
-							int value = *b16;
-							*b16++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-						}
-					} else {
-						for (int i = 0; i < size; i++) {
-							int value = *b16;
-							unsigned b = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							value = *(b16 + 1);
-							unsigned g = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							value = *(b16 + 2);
-							unsigned r = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							*b16 = r;
-							*(b16 + 1) = g;
-							*(b16 + 2) = b;
-							b16 += 3;
-						}
-					}
+		}
+	} else if (naxis == 3 && byte_per_pixel == 2) {
+		header->signature = INDIGO_RAW_RGB48;
+		unsigned char *b16 = frame->data + FITS_HEADER_SIZE;
+		if (frame->little_endian) {
+			if (!frame->byte_order_rgb) {
+				for (int i = 0; i < size; i++) {
+					unsigned char b = *b16;
+					unsigned char r = *(b16 + 2);
+					*b16 = r;
+					*(b16 + 2) = b;
+					b16 += 3;
 				}
 			}
-			INDIGO_DEBUG(indigo_debug("RAW to XISF conversion in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
-		} else if (CCD_IMAGE_FORMAT_RAW_ITEM->sw.value) {
-			indigo_raw_header *header = (indigo_raw_header *)(data + FITS_HEADER_SIZE - sizeof(indigo_raw_header));
-			if (naxis == 2 && byte_per_pixel == 1)
-				header->signature = INDIGO_RAW_MONO8;
-			else if (naxis == 2 && byte_per_pixel == 2) {
-				header->signature = INDIGO_RAW_MONO16;
-				if (!little_endian) {
-					short *b16 = (short *)(data + FITS_HEADER_SIZE);
-					for (int i = 0; i < size; i++) {
-						int value = *b16;
-						*b16++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-					}
-				}
-			} else if (naxis == 3 && byte_per_pixel == 1) {
-				header->signature = INDIGO_RAW_RGB24;
-				if (!byte_order_rgb) {
-					unsigned char *b8 = data + FITS_HEADER_SIZE;
-					for (int i = 0; i < size; i++) {
-						unsigned char b = *b8;
-						unsigned char r = *(b8 + 2);
-						*b8 = r;
-						*(b8 + 2) = b;
-						b8 += 3;
-					}
+		} else {
+			if (frame->byte_order_rgb) {
+				for (int i = 0; i < size; i++) {
+					int value = *b16;
+					*b16++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
 				}
-			} else if (naxis == 3 && byte_per_pixel == 2) {
-				header->signature = INDIGO_RAW_RGB48;
-				unsigned char *b16 = data + FITS_HEADER_SIZE;
-				if (little_endian) {
-					if (!byte_order_rgb) {
-						for (int i = 0; i < size; i++) {
-							unsigned char b = *b16;
-							unsigned char r = *(b16 + 2);
-							*b16 = r;
-							*(b16 + 2) = b;
-							b16 += 3;
-						}
-					}
-				} else {
-					if (byte_order_rgb) {
-						for (int i = 0; i < size; i++) {
-							int value = *b16;
-							*b16++ = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-						}
-					} else {
-						for (int i = 0; i < size; i++) {
-							int value = *b16;
-							unsigned b = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							value = *(b16 + 1);
-							unsigned g = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							value = *(b16 + 2);
-							unsigned r = (value & 0xff) << 8 | (value & 0xff00) >> 8;
-							*b16 = r;
-							*(b16 + 1) = g;
-							*(b16 + 2) = b;
-							b16 += 3;
-						}
-					}
+			} else {
+				for (int i = 0; i < size; i++) {
+					int value = *b16;
+					unsigned b = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+					value = *(b16 + 1);
+					unsigned g = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+					value = *(b16 + 2);
+					unsigned r = (value & 0xff) << 8 | (value & 0xff00) >> 8;
+					*b16 = r;
+					*(b16 + 1) = g;
+					*(b16 + 2) = b;
+					b16 += 3;
 				}
 			}
-			header->width = frame_width;
-			header->height = frame_height;
-		} else if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value) {
-			if (jpeg_data && jpeg_size < blobsize) {
-				memcpy(data, jpeg_data, jpeg_size);
-				blobsize = jpeg_size;
-			}
 		}
 	}
-	if (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value) {
-		char *dir = CCD_LOCAL_MODE_DIR_ITEM->text.value;
-		char *prefix = CCD_LOCAL_MODE_PREFIX_ITEM->text.value;
-		char *suffix;
+	header->width = frame->width;
+	header->height = frame->height;
+	frame->blob = frame->data + FITS_HEADER_SIZE - sizeof(indigo_raw_header);
+	frame->blob_size = blobsize + sizeof(indigo_raw_header);
+	return true;
+}
+
+static bool jpeg_stage_process(indigo_device *device, indigo_frame *frame, void *context) {
+	if (frame->preview == NULL)
+		return false;
+	if (frame->preview_size < (unsigned long)frame->width * frame->height * frame->bpp / 8)
+		frame->blob = frame->data;
+	else
+		frame->blob = indigo_frame_buffer(device, frame, frame->preview_size);
+	memcpy(frame->blob, frame->preview, frame->preview_size);
+	frame->blob_size = frame->preview_size;
+	return true;
+}
+
+static const indigo_frame_stage preview_stage = { "RAW to preview conversion", FORMAT_STAGE_ORDER, preview_stage_process, NULL };
+static const indigo_frame_stage fits_stage = { "RAW to FITS conversion", FORMAT_STAGE_ORDER, fits_stage_process, NULL };
+static const indigo_frame_stage xisf_stage = { "RAW to XISF conversion", FORMAT_STAGE_ORDER, xisf_stage_process, NULL };
+static const indigo_frame_stage raw_stage = { "RAW header", FORMAT_STAGE_ORDER, raw_stage_process, NULL };
+static const indigo_frame_stage jpeg_stage = { "JPEG copy", FORMAT_STAGE_ORDER, jpeg_stage_process, NULL };
+
+void indigo_process_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, bool byte_order_rgb, indigo_fits_keyword *keywords) {
+	assert(device != NULL);
+	assert(data != NULL);
+	INDIGO_DEBUG(clock_t start = clock());
+
+	indigo_frame frame = { data, frame_width, frame_height, bpp, little_endian, byte_order_rgb, CCD_BIN_HORIZONTAL_ITEM->number.value, CCD_BIN_VERTICAL_ITEM->number.value, NULL, keywords };
+	for (indigo_fits_keyword *keyword = keywords; keyword && keyword->type; keyword++) {
+		if (keyword->type == INDIGO_FITS_STRING && !strcmp(keyword->name, "BAYERPAT"))
+			frame.bayer_pattern = keyword->string;
+	}
+	pthread_rwlock_rdlock(&frame_stage_lock);
+	for (indigo_frame_stage_entry *entry = CCD_CONTEXT->frame_stages; entry; entry = entry->next)
+		run_frame_stage(device, entry->stage, &frame, entry->context);
+	pthread_rwlock_unlock(&frame_stage_lock);
+
+	if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value) {
+		run_frame_stage(device, &preview_stage, &frame, NULL);
+	}
+	char *suffix = NULL;
+	if (!CCD_UPLOAD_MODE_PREVIEW_ITEM->sw.value) {
 		if (CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
+			run_frame_stage(device, &fits_stage, &frame, NULL);
 			suffix = ".fits";
 		} else if (CCD_IMAGE_FORMAT_XISF_ITEM->sw.value) {
+			run_frame_stage(device, &xisf_stage, &frame, NULL);
 			suffix = ".xisf";
 		} else if (CCD_IMAGE_FORMAT_RAW_ITEM->sw.value) {
+			run_frame_stage(device, &raw_stage, &frame, NULL);
 			suffix = ".raw";
 		} else if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value) {
+			run_frame_stage(device, &jpeg_stage, &frame, NULL);
 			suffix = ".jpeg";
 		}
-		int handle = 0;
-		char *message = NULL;
-		if (strlen(dir) + strlen(prefix) + strlen(suffix) < INDIGO_VALUE_SIZE) {
-			char file_name[INDIGO_VALUE_SIZE];
-			char *xxx = strstr(prefix, "XXX");
-			if (xxx == NULL) {
-				strncpy(file_name, dir, INDIGO_VALUE_SIZE);
-				strcat(file_name, prefix);
-				strcat(file_name, suffix);
-			} else {
-				char format[INDIGO_VALUE_SIZE];
-				strcpy(format, dir);
-				strncat(format, prefix, xxx - prefix);
-				strcat(format, "%03d");
-				strcat(format, xxx+3);
-				strcat(format, suffix);
-				struct stat sb;
-				int i = 1;
-				while (true) {
-					snprintf(file_name, sizeof(file_name), format, i);
-					if (stat(file_name, &sb) == 0 && S_ISREG(sb.st_mode))
-						i++;
-					else
-						break;
-				}
-			}
-			strncpy(CCD_IMAGE_FILE_ITEM->text.value, file_name, INDIGO_VALUE_SIZE);
-			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_OK_STATE;
-			handle = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-			if (handle) {
-				if (CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
-					if (!indigo_write(handle, data, FITS_HEADER_SIZE + blobsize)) {
-						CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-						message = strerror(errno);
-					}
-				} else if (CCD_IMAGE_FORMAT_XISF_ITEM->sw.value) {
-					if (!indigo_write(handle, data, FITS_HEADER_SIZE + blobsize)) {
-						CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-						message = strerror(errno);
-					}
-				} else if (CCD_IMAGE_FORMAT_RAW_ITEM->sw.value) {
-					if (!indigo_write(handle, data + FITS_HEADER_SIZE - sizeof(indigo_raw_header), blobsize + sizeof(indigo_raw_header))) {
-						CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-						message = strerror(errno);
-					}
-				} else if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value) {
-					if (!indigo_write(handle, data, blobsize)) {
-						CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-						message = strerror(errno);
-					}
-				}
-				close(handle);
-			} else {
-				CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-				message = strerror(errno);
-			}
-		} else {
-			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-			message = "dir + prefix + suffix is too long";
-		}
-		indigo_update_property(device, CCD_IMAGE_FILE_PROPERTY, message);
-		INDIGO_DEBUG(indigo_debug("Local save in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 	}
-	if (CCD_UPLOAD_MODE_CLIENT_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value) {
+	if (suffix && frame.blob && (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value)) {
+		save_local_image(device, suffix, frame.blob, frame.blob_size);
+		INDIGO_DEBUG(indigo_debug("Local save queued in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+	}
+	if (suffix && frame.blob && (CCD_UPLOAD_MODE_CLIENT_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value)) {
 		*CCD_IMAGE_ITEM->blob.url = 0;
-		if (CCD_IMAGE_FORMAT_FITS_ITEM->sw.value) {
-			CCD_IMAGE_ITEM->blob.value = data;
-			CCD_IMAGE_ITEM->blob.size = FITS_HEADER_SIZE + blobsize;
-			strncpy(CCD_IMAGE_ITEM->blob.format, ".fits", INDIGO_NAME_SIZE);
-		} else if (CCD_IMAGE_FORMAT_XISF_ITEM->sw.value) {
-			CCD_IMAGE_ITEM->blob.value = data;
-			CCD_IMAGE_ITEM->blob.size = FITS_HEADER_SIZE + blobsize;
-			strncpy(CCD_IMAGE_ITEM->blob.format, ".xisf", INDIGO_NAME_SIZE);
-		} else if (CCD_IMAGE_FORMAT_RAW_ITEM->sw.value) {
-			CCD_IMAGE_ITEM->blob.value = data + FITS_HEADER_SIZE - sizeof(indigo_raw_header);
-			CCD_IMAGE_ITEM->blob.size = blobsize + sizeof(indigo_raw_header);
-			strncpy(CCD_IMAGE_ITEM->blob.format, ".raw", INDIGO_NAME_SIZE);
-		} else if (CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value) {
-			CCD_IMAGE_ITEM->blob.value = data;
-			CCD_IMAGE_ITEM->blob.size = blobsize;
-			strncpy(CCD_IMAGE_ITEM->blob.format, ".jpeg", INDIGO_NAME_SIZE);
-		}
+		CCD_IMAGE_ITEM->blob.value = frame.blob;
+		CCD_IMAGE_ITEM->blob.size = frame.blob_size;
+		strncpy(CCD_IMAGE_ITEM->blob.format, suffix, INDIGO_NAME_SIZE);
 		CCD_IMAGE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
 		INDIGO_DEBUG(indigo_debug("Client upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 	}
 	if (CCD_UPLOAD_MODE_PREVIEW_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value) {
-		if (!(CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value && CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value)) {
-			if (jpeg_data && jpeg_size < blobsize) {
-				memcpy(data, jpeg_data, jpeg_size);
-				blobsize = jpeg_size;
-			}
-			CCD_IMAGE_ITEM->blob.value = data;
-			CCD_IMAGE_ITEM->blob.size = jpeg_size;
+		if (!(CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value && CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value))
+			run_frame_stage(device, &jpeg_stage, &frame, NULL);
+		if (frame.preview) {
+			*CCD_IMAGE_ITEM->blob.url = 0;
+			CCD_IMAGE_ITEM->blob.value = frame.blob;
+			CCD_IMAGE_ITEM->blob.size = frame.blob_size;
+			strncpy(CCD_IMAGE_ITEM->blob.format, ".jpeg", INDIGO_NAME_SIZE);
+			CCD_IMAGE_PROPERTY->state = INDIGO_OK_STATE;
+			indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
+			INDIGO_DEBUG(indigo_debug("Client preview upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 		}
-		strncpy(CCD_IMAGE_ITEM->blob.format, ".jpeg", INDIGO_NAME_SIZE);
-		CCD_IMAGE_PROPERTY->state = INDIGO_OK_STATE;
-		indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
-		INDIGO_DEBUG(indigo_debug("Client preview upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 	}
-	if (jpeg_data)
-		free(jpeg_data);
+	if (frame.preview)
+		free(frame.preview);
 }
 
 void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize, const char *suffix) {
@@ -1376,53 +3437,8 @@ void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize,
 	INDIGO_DEBUG(clock_t start = clock());
 
 	if (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value) {
-		char *dir = CCD_LOCAL_MODE_DIR_ITEM->text.value;
-		char *prefix = CCD_LOCAL_MODE_PREFIX_ITEM->text.value;
-		int handle = 0;
-		char *message = NULL;
-		if (strlen(dir) + strlen(prefix) + strlen(suffix) < INDIGO_VALUE_SIZE) {
-			char file_name[INDIGO_VALUE_SIZE];
-			char *xxx = strstr(prefix, "XXX");
-			if (xxx == NULL) {
-				strncpy(file_name, dir, INDIGO_VALUE_SIZE - strlen(prefix) - strlen(suffix));
-				strcat(file_name, prefix);
-				strcat(file_name, suffix);
-			} else {
-				char format[INDIGO_VALUE_SIZE];
-				strncpy(format, dir, INDIGO_VALUE_SIZE);
-				strncat(format, prefix, xxx - prefix);
-				strcat(format, "%03d");
-				strcat(format, xxx+3);
-				strcat(format, suffix);
-				struct stat sb;
-				int i = 1;
-				while (true) {
-					snprintf(file_name, sizeof(file_name), format, i);
-					if (stat(file_name, &sb) == 0 && S_ISREG(sb.st_mode))
-						i++;
-					else
-						break;
-				}
-			}
-			strncpy(CCD_IMAGE_FILE_ITEM->text.value, file_name, INDIGO_VALUE_SIZE);
-			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_OK_STATE;
-			handle = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-			if (handle) {
-				if (!indigo_write(handle, data, blobsize)) {
-					CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-					message = strerror(errno);
-				}
-				close(handle);
-			} else {
-				CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-				message = strerror(errno);
-			}
-		} else {
-			CCD_IMAGE_FILE_PROPERTY->state = INDIGO_ALERT_STATE;
-			message = "dir + prefix + suffix is too long";
-		}
-		indigo_update_property(device, CCD_IMAGE_FILE_PROPERTY, message);
-		INDIGO_DEBUG(indigo_debug("Local save in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
+		save_local_image(device, suffix, data, blobsize);
+		INDIGO_DEBUG(indigo_debug("Local save queued in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 	}
 	if (CCD_UPLOAD_MODE_CLIENT_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value) {
 		*CCD_IMAGE_ITEM->blob.url = 0;
@@ -1434,9 +3450,32 @@ void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize,
 		INDIGO_DEBUG(indigo_debug("Client upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 	}
 	if (CCD_UPLOAD_MODE_PREVIEW_ITEM->sw.value || CCD_UPLOAD_MODE_PREVIEW_LOCAL_ITEM->sw.value) {
-		// TBD make preview
+		// TBD make preview from non-JPEG images
+		if (!strcasecmp(suffix, ".jpeg") || !strcasecmp(suffix, ".jpg")) {
+			*CCD_IMAGE_ITEM->blob.url = 0;
+			CCD_IMAGE_ITEM->blob.value = data;
+			CCD_IMAGE_ITEM->blob.size = blobsize;
+			strncpy(CCD_IMAGE_ITEM->blob.format, ".jpeg", INDIGO_NAME_SIZE);
+		}
 		CCD_IMAGE_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
 		INDIGO_DEBUG(indigo_debug("Client preview upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 	}
 }
+
+bool indigo_ccd_jpeg_passthrough(indigo_device *device) {
+	assert(device != NULL);
+	if (!CCD_IMAGE_FORMAT_JPEG_ITEM->sw.value && !CCD_UPLOAD_MODE_PREVIEW_ITEM->sw.value)
+		return false;
+	bool result = true;
+	pthread_rwlock_rdlock(&frame_stage_lock);
+	for (indigo_frame_stage_entry *entry = CCD_CONTEXT->frame_stages; entry; entry = entry->next) {
+		const indigo_frame_stage *stage = entry->stage;
+		if (stage->active == NULL || stage->active(device, NULL, entry->context)) {
+			result = false;
+			break;
+		}
+	}
+	pthread_rwlock_unlock(&frame_stage_lock);
+	return result;
+}
@@ -121,6 +121,22 @@ extern "C" {
  */
 #define CCD_LOCAL_MODE_PREFIX_ITEM        (CCD_LOCAL_MODE_PROPERTY->items+1)
 
+/** CCD_LOCAL_MODE_WRITE property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_LOCAL_MODE_WRITE_PROPERTY     (CCD_CONTEXT->ccd_local_mode_write_property)
+
+/** CCD_LOCAL_MODE_WRITE.BUFFERED property item pointer.
+ */
+#define CCD_LOCAL_MODE_WRITE_BUFFERED_ITEM	(CCD_LOCAL_MODE_WRITE_PROPERTY->items+0)
+
+/** CCD_LOCAL_MODE_WRITE.SYNC property item pointer.
+ */
+#define CCD_LOCAL_MODE_WRITE_SYNC_ITEM    (CCD_LOCAL_MODE_WRITE_PROPERTY->items+1)
+
+/** CCD_LOCAL_MODE_WRITE.DIRECT property item pointer.
+ */
+#define CCD_LOCAL_MODE_WRITE_DIRECT_ITEM  (CCD_LOCAL_MODE_WRITE_PROPERTY->items+2)
+
 /** CCD_EXPOSURE property pointer, property is mandatory, property change request handler should set property items and state and call indigo_ccd_change_property().
  */
 #define CCD_EXPOSURE_PROPERTY             (CCD_CONTEXT->ccd_exposure_property)
@@ -367,6 +383,190 @@ extern "C" {
 /** CCD_RBI_FLUSH_ENABLE.DISABLE property item pointer.
  */
 #define CCD_RBI_FLUSH_DISABLED_ITEM     (CCD_RBI_FLUSH_ENABLE_PROPERTY->items + 1)
+
+/** CCD_CALIBRATION property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_CALIBRATION_PROPERTY        (CCD_CONTEXT->ccd_calibration_property)
+
+/** CCD_CALIBRATION.DARK property item pointer.
+ */
+#define CCD_CALIBRATION_DARK_ITEM       (CCD_CALIBRATION_PROPERTY->items + 0)
+
+/** CCD_CALIBRATION.FLAT property item pointer.
+ */
+#define CCD_CALIBRATION_FLAT_ITEM       (CCD_CALIBRATION_PROPERTY->items + 1)
+
+/** CCD_CALIBRATION_MASTER property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_CALIBRATION_MASTER_PROPERTY (CCD_CONTEXT->ccd_calibration_master_property)
+
+/** CCD_CALIBRATION_MASTER.NONE property item pointer.
+ */
+#define CCD_CALIBRATION_MASTER_NONE_ITEM (CCD_CALIBRATION_MASTER_PROPERTY->items + 0)
+
+/** CCD_CALIBRATION_MASTER.DARK property item pointer.
+ */
+#define CCD_CALIBRATION_MASTER_DARK_ITEM (CCD_CALIBRATION_MASTER_PROPERTY->items + 1)
+
+/** CCD_CALIBRATION_MASTER.FLAT property item pointer.
+ */
+#define CCD_CALIBRATION_MASTER_FLAT_ITEM (CCD_CALIBRATION_MASTER_PROPERTY->items + 2)
+
+/** CCD_IMAGE_STATS property pointer, property is mandatory, read-only property, updated by image statistics stage for every frame if enabled.
+ */
+#define CCD_IMAGE_STATS_PROPERTY        (CCD_CONTEXT->ccd_image_stats_property)
+
+/** CCD_IMAGE_STATS.MEAN property item pointer.
+ */
+#define CCD_IMAGE_STATS_MEAN_ITEM       (CCD_IMAGE_STATS_PROPERTY->items + 0)
+
+/** CCD_IMAGE_STATS.MEDIAN property item pointer.
+ */
+#define CCD_IMAGE_STATS_MEDIAN_ITEM     (CCD_IMAGE_STATS_PROPERTY->items + 1)
+
+/** CCD_IMAGE_STATS.NOISE property item pointer.
+ */
+#define CCD_IMAGE_STATS_NOISE_ITEM      (CCD_IMAGE_STATS_PROPERTY->items + 2)
+
+/** CCD_IMAGE_STATS.MAX property item pointer.
+ */
+#define CCD_IMAGE_STATS_MAX_ITEM        (CCD_IMAGE_STATS_PROPERTY->items + 3)
+
+/** CCD_IMAGE_STATS.STARS property item pointer.
+ */
+#define CCD_IMAGE_STATS_STARS_ITEM      (CCD_IMAGE_STATS_PROPERTY->items + 4)
+
+/** CCD_IMAGE_STATS.HFD property item pointer.
+ */
+#define CCD_IMAGE_STATS_HFD_ITEM        (CCD_IMAGE_STATS_PROPERTY->items + 5)
+
+/** CCD_IMAGE_STATS.FWHM property item pointer.
+ */
+#define CCD_IMAGE_STATS_FWHM_ITEM       (CCD_IMAGE_STATS_PROPERTY->items + 6)
+
+/** CCD_IMAGE_STATS.X property item pointer.
+ */
+#define CCD_IMAGE_STATS_X_ITEM          (CCD_IMAGE_STATS_PROPERTY->items + 7)
+
+/** CCD_IMAGE_STATS.Y property item pointer.
+ */
+#define CCD_IMAGE_STATS_Y_ITEM          (CCD_IMAGE_STATS_PROPERTY->items + 8)
+
+/** CCD_IMAGE_STATS_ENABLE property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_IMAGE_STATS_ENABLE_PROPERTY (CCD_CONTEXT->ccd_image_stats_enable_property)
+
+/** CCD_IMAGE_STATS_ENABLE.ENABLE property item pointer.
+ */
+#define CCD_IMAGE_STATS_ENABLED_ITEM    (CCD_IMAGE_STATS_ENABLE_PROPERTY->items + 0)
+
+/** CCD_IMAGE_STATS_ENABLE.DISABLE property item pointer.
+ */
+#define CCD_IMAGE_STATS_DISABLED_ITEM   (CCD_IMAGE_STATS_ENABLE_PROPERTY->items + 1)
+
+/** CCD_SOFTWARE_BIN property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_SOFTWARE_BIN_PROPERTY             (CCD_CONTEXT->ccd_software_bin_property)
+
+/** CCD_SOFTWARE_BIN.HORIZONTAL property item pointer.
+ */
+#define CCD_SOFTWARE_BIN_HORIZONTAL_ITEM      (CCD_SOFTWARE_BIN_PROPERTY->items + 0)
+
+/** CCD_SOFTWARE_BIN.VERTICAL property item pointer.
+ */
+#define CCD_SOFTWARE_BIN_VERTICAL_ITEM        (CCD_SOFTWARE_BIN_PROPERTY->items + 1)
+
+/** CCD_SOFTWARE_BIN_MODE property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_SOFTWARE_BIN_MODE_PROPERTY        (CCD_CONTEXT->ccd_software_bin_mode_property)
+
+/** CCD_SOFTWARE_BIN_MODE.SUM property item pointer.
+ */
+#define CCD_SOFTWARE_BIN_SUM_ITEM             (CCD_SOFTWARE_BIN_MODE_PROPERTY->items + 0)
+
+/** CCD_SOFTWARE_BIN_MODE.AVERAGE property item pointer.
+ */
+#define CCD_SOFTWARE_BIN_AVERAGE_ITEM         (CCD_SOFTWARE_BIN_MODE_PROPERTY->items + 1)
+
+/** CCD_SOFTWARE_FRAME property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_SOFTWARE_FRAME_PROPERTY           (CCD_CONTEXT->ccd_software_frame_property)
+
+/** CCD_SOFTWARE_FRAME.LEFT property item pointer.
+ */
+#define CCD_SOFTWARE_FRAME_LEFT_ITEM          (CCD_SOFTWARE_FRAME_PROPERTY->items + 0)
+
+/** CCD_SOFTWARE_FRAME.TOP property item pointer.
+ */
+#define CCD_SOFTWARE_FRAME_TOP_ITEM           (CCD_SOFTWARE_FRAME_PROPERTY->items + 1)
+
+/** CCD_SOFTWARE_FRAME.WIDTH property item pointer.
+ */
+#define CCD_SOFTWARE_FRAME_WIDTH_ITEM         (CCD_SOFTWARE_FRAME_PROPERTY->items + 2)
+
+/** CCD_SOFTWARE_FRAME.HEIGHT property item pointer.
+ */
+#define CCD_SOFTWARE_FRAME_HEIGHT_ITEM        (CCD_SOFTWARE_FRAME_PROPERTY->items + 3)
+
+/** CCD_DEMOSAIC property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_DEMOSAIC_PROPERTY                 (CCD_CONTEXT->ccd_demosaic_property)
+
+/** CCD_DEMOSAIC.NONE property item pointer.
+ */
+#define CCD_DEMOSAIC_NONE_ITEM                (CCD_DEMOSAIC_PROPERTY->items + 0)
+
+/** CCD_DEMOSAIC.BILINEAR property item pointer.
+ */
+#define CCD_DEMOSAIC_BILINEAR_ITEM            (CCD_DEMOSAIC_PROPERTY->items + 1)
+
+/** CCD_DEMOSAIC.VNG property item pointer.
+ */
+#define CCD_DEMOSAIC_VNG_ITEM                 (CCD_DEMOSAIC_PROPERTY->items + 2)
+
+/** CCD_PREVIEW_DEMOSAIC property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_PREVIEW_DEMOSAIC_PROPERTY         (CCD_CONTEXT->ccd_preview_demosaic_property)
+
+/** CCD_PREVIEW_DEMOSAIC.NONE property item pointer.
+ */
+#define CCD_PREVIEW_DEMOSAIC_NONE_ITEM        (CCD_PREVIEW_DEMOSAIC_PROPERTY->items + 0)
+
+/** CCD_PREVIEW_DEMOSAIC.BILINEAR property item pointer.
+ */
+#define CCD_PREVIEW_DEMOSAIC_BILINEAR_ITEM    (CCD_PREVIEW_DEMOSAIC_PROPERTY->items + 1)
+
+/** CCD_PREVIEW_DEMOSAIC.VNG property item pointer.
+ */
+#define CCD_PREVIEW_DEMOSAIC_VNG_ITEM         (CCD_PREVIEW_DEMOSAIC_PROPERTY->items + 2)
+
+/** CCD_FITS_COMPRESSION property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_FITS_COMPRESSION_PROPERTY         (CCD_CONTEXT->ccd_fits_compression_property)
+
+/** CCD_FITS_COMPRESSION.NONE property item pointer.
+ */
+#define CCD_FITS_COMPRESSION_NONE_ITEM        (CCD_FITS_COMPRESSION_PROPERTY->items + 0)
+
+/** CCD_FITS_COMPRESSION.RICE property item pointer.
+ */
+#define CCD_FITS_COMPRESSION_RICE_ITEM        (CCD_FITS_COMPRESSION_PROPERTY->items + 1)
+
+/** CCD_XISF_COMPRESSION property pointer, property is mandatory, property change request is fully handled by indigo_ccd_change_property().
+ */
+#define CCD_XISF_COMPRESSION_PROPERTY         (CCD_CONTEXT->ccd_xisf_compression_property)
+
+/** CCD_XISF_COMPRESSION.NONE property item pointer.
+ */
+#define CCD_XISF_COMPRESSION_NONE_ITEM        (CCD_XISF_COMPRESSION_PROPERTY->items + 0)
+
+/** CCD_XISF_COMPRESSION.LZ4 property item pointer.
+ */
+#define CCD_XISF_COMPRESSION_LZ4_ITEM         (CCD_XISF_COMPRESSION_PROPERTY->items + 1)
+
+/** CCD_XISF_COMPRESSION.ZLIB property item pointer.
+ */
+#define CCD_XISF_COMPRESSION_ZLIB_ITEM        (CCD_XISF_COMPRESSION_PROPERTY->items + 2)
 	
 /** RAW header.
  */
@@ -383,6 +583,9 @@ typedef struct {
 
 typedef enum { INDIGO_RAW_MONO8 = 0x31574152, INDIGO_RAW_MONO16 = 0x32574152, INDIGO_RAW_RGB24 = 0x33574152, INDIGO_RAW_RGB48 = 0x36574152 } indigo_raw_type;
 
+struct indigo_frame_stage_entry;
+struct indigo_ccd_calibration;
+
 /** CCD device context structure.
  */
 typedef struct {
@@ -392,6 +595,7 @@ typedef struct {
 	indigo_property *ccd_info_property;           ///< CCD_INFO property pointer
 	indigo_property *ccd_upload_mode_property;    ///< CCD_UPLOAD_MODE property pointer
 	indigo_property *ccd_local_mode_property;     ///< CCD_LOCAL_MODE property pointer
+	indigo_property *ccd_local_mode_write_property; ///< CCD_LOCAL_MODE_WRITE property pointer
 	indigo_property *ccd_mode_property;	          ///< CCD_MODE property pointer
 	indigo_property *ccd_read_mode_property;	  	///< CCD_READ_MODE property pointer
 	indigo_property *ccd_exposure_property;       ///< CCD_EXPOSURE property pointer
@@ -413,6 +617,22 @@ typedef struct {
 	indigo_property *ccd_jpeg_settings;						///< CCD_JPEG_SETTINGS property pointer
 	indigo_property *ccd_rbi_flush_enable_property; ///< CCD_RBI_FLUSH_ENABLE property pointer
 	indigo_property *ccd_rbi_flush_property;			///< CCD_RBI_FLUSH property pointer
+	indigo_property *ccd_calibration_property;		///< CCD_CALIBRATION property pointer
+	indigo_property *ccd_calibration_master_property; ///< CCD_CALIBRATION_MASTER property pointer
+	struct indigo_ccd_calibration *calibration;		///< master calibration frame cache
+	indigo_property *ccd_image_stats_property;		///< CCD_IMAGE_STATS property pointer
+	indigo_property *ccd_image_stats_enable_property; ///< CCD_IMAGE_STATS_ENABLE property pointer
+	indigo_property *ccd_software_bin_property;		///< CCD_SOFTWARE_BIN property pointer
+	indigo_property *ccd_software_bin_mode_property; ///< CCD_SOFTWARE_BIN_MODE property pointer
+	indigo_property *ccd_software_frame_property;	///< CCD_SOFTWARE_FRAME property pointer
+	indigo_property *ccd_demosaic_property;			///< CCD_DEMOSAIC property pointer
+	indigo_property *ccd_preview_demosaic_property; ///< CCD_PREVIEW_DEMOSAIC property pointer
+	indigo_property *ccd_fits_compression_property; ///< CCD_FITS_COMPRESSION property pointer
+	indigo_property *ccd_xisf_compression_property; ///< CCD_XISF_COMPRESSION property pointer
+	struct indigo_frame_stage_entry *frame_stages; ///< image pipeline stages
+	void *frame_buffer[2];												///< pooled frame buffers
+	unsigned long frame_buffer_size[2];						///< pooled frame buffer sizes
+	int image_writes_pending;											///< local image writes queued or in progress
 } indigo_ccd_context;
 
 /** Suspend countdown.
@@ -454,6 +674,72 @@ typedef struct {
 	const char *comment;
 } indigo_fits_keyword;
 
+/** Frame descriptor passed through image pipeline stages.
+ */
+typedef struct {
+	void *data;                      ///< image buffer, pixel data start on data + FITS_HEADER_SIZE offset
+	int width;                       ///< frame width [pixels]
+	int height;                      ///< frame height [pixels]
+	int bpp;                         ///< bits per pixel (8, 16, 24 or 48)
+	bool little_endian;              ///< 16 bit samples are little endian
+	bool byte_order_rgb;             ///< colour samples are in RGB (true) or BGR (false) order
+	int horizontal_bin;              ///< effective horizontal binning
+	int vertical_bin;                ///< effective vertical binning
+	const char *bayer_pattern;       ///< CFA pattern (e.g. "RGGB") or NULL
+	indigo_fits_keyword *keywords;   ///< driver supplied FITS keywords or NULL
+	void *blob;                      ///< encoded image (set by format stage)
+	unsigned long blob_size;         ///< encoded image size
+	void *preview;                   ///< JPEG preview (set by preview stage)
+	unsigned long preview_size;      ///< JPEG preview size
+} indigo_frame;
+
+/** Whole frame stage callback, should return false if frame was left unchanged because of error.
+ */
+typedef bool (*indigo_frame_callback)(indigo_device *device, indigo_frame *frame, void *context);
+
+/** Row band stage callback, processes rows first_row <= row < end_row and may run in parallel with other bands.
+ */
+typedef void (*indigo_frame_rows_callback)(indigo_device *device, indigo_frame *frame, int first_row, int end_row, void *context);
+
+/** Stage activity callback, should return true if stage would change the frame with current settings. Frame is NULL when
+    the image was already encoded by the camera and only settings can be checked.
+ */
+typedef bool (*indigo_frame_active_callback)(indigo_device *device, indigo_frame *frame, void *context);
+
+/** Image pipeline stage descriptor.
+ */
+typedef struct {
+	const char *name;                ///< stage name
+	int order;                       ///< stages are executed in ascending order
+	indigo_frame_callback process;   ///< whole frame callback (or NULL)
+	indigo_frame_rows_callback process_rows; ///< row band callback executed after process (or NULL)
+	indigo_frame_active_callback active; ///< activity check (or NULL if stage is always active)
+} indigo_frame_stage;
+
+/** Suggested stage order values, built-in format conversions run after all of them.
+ */
+#define INDIGO_FRAME_STAGE_CALIBRATION  100
+#define INDIGO_FRAME_STAGE_GEOMETRY     200
+#define INDIGO_FRAME_STAGE_DEMOSAIC     300
+#define INDIGO_FRAME_STAGE_ANALYSIS     400
+
+/** Add stage to device image pipeline, the same stage can't be added twice.
+ */
+extern indigo_result indigo_add_frame_stage(indigo_device *device, const indigo_frame_stage *stage, void *context);
+
+/** Remove stage from device image pipeline.
+ */
+extern indigo_result indigo_remove_frame_stage(indigo_device *device, const indigo_frame_stage *stage);
+
+/** Run row band callback over the whole frame on worker threads.
+ */
+extern void indigo_process_frame_rows(indigo_device *device, indigo_frame *frame, indigo_frame_rows_callback callback, void *context);
+
+/** Get pooled buffer with FITS_HEADER_SIZE + size bytes, buffer is never the one used as frame->data and is valid until the next call.
+    Drivers may call it with NULL frame to get capture buffer for indigo_process_image(), pipeline stages then use the other buffer.
+ */
+extern void *indigo_frame_buffer(indigo_device *device, indigo_frame *frame, unsigned long size);
+
 /** Process raw image in image buffer (starting on data + FITS_HEADER_SIZE offset).
  */
 extern void indigo_process_image(indigo_device *device, void *data, int frame_width, int frame_height, int bpp, bool little_endian, bool byte_order_rgb, indigo_fits_keyword *keywords);
@@ -462,6 +748,11 @@ extern void indigo_process_image(indigo_device *device, void *data, int frame_wi
  */
 extern void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize, const char *suffix);
 
+/** Check if JPEG image encoded by camera can be passed to indigo_process_dslr_image() as is instead of decoding it for indigo_process_image(),
+    i.e. JPEG format or preview is requested and no image pipeline stage is active for it.
+ */
+extern bool indigo_ccd_jpeg_passthrough(indigo_device *device);
+
 #ifdef __cplusplus
 }
 #endif
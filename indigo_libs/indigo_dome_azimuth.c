@@ -29,6 +29,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "indigo_dome_azimuth.h"
+
 
 double map24(double hour) {
 	double hour24;
@@ -59,27 +61,33 @@ static double map360(double angle) {
 }
 
 
-static void equatorial_to_horizontal(double ha, double dec, double site_latitude, double *azimuth, double *altitude) {
-	double phi = site_latitude*M_PI/180.0;
-
-	ha = ha * M_PI / 12.0;
-	dec = dec * M_PI / 180.0;
-	*altitude = asin(sin(phi)*sin(dec) + cos(phi)*cos(dec)*cos(ha));
-	*altitude = *altitude * 180.0 / M_PI;
-	*azimuth = atan2(-cos(dec)*sin(ha), sin(dec)*cos(phi) - sin(phi)*cos(dec)*cos(ha));
-	*azimuth = *azimuth*180.0/M_PI;
-	*azimuth = map360(*azimuth);
+bool indigo_dome_init_geometry(indigo_dome_geometry *geometry, double site_latitude, double dome_radius, double mount_dec_height, double mount_dec_length, double mount_dec_offset_NS, double mount_dec_offset_EW) {
+	if (geometry->dome_radius > 0 && geometry->site_latitude == site_latitude && geometry->dome_radius == dome_radius && geometry->mount_dec_height == mount_dec_height && geometry->mount_dec_length == mount_dec_length && geometry->mount_dec_offset_NS == mount_dec_offset_NS && geometry->mount_dec_offset_EW == mount_dec_offset_EW)
+		return false;
+	geometry->site_latitude = site_latitude;
+	geometry->dome_radius = dome_radius;
+	geometry->mount_dec_height = mount_dec_height;
+	geometry->mount_dec_length = mount_dec_length;
+	geometry->mount_dec_offset_NS = mount_dec_offset_NS;
+	geometry->mount_dec_offset_EW = mount_dec_offset_EW;
+	geometry->hemisphere = site_latitude >= 0 ? 1 : -1;
+	double phi = site_latitude * M_PI / 180.0;
+	geometry->sin_latitude = sin(phi);
+	geometry->cos_latitude = cos(phi);
+	/* theta: always positive from the horizontal plane to the pole */
+	geometry->sin_theta = fabs(geometry->sin_latitude);
+	geometry->cos_theta = geometry->cos_latitude;
+	return true;
 }
 
 
-double indigo_dome_solve_azimuth(double ha, double dec, double site_latitude, double dome_radius, double mount_dec_height, double mount_dec_length, double mount_dec_offset_NS, double mount_dec_offset_EW) {
+double indigo_dome_geometry_azimuth(indigo_dome_geometry *geometry, double ha, double dec) {
 	ha = map24(ha);
 
 	/* Map an hourangle in hours to  -12 <= ha0 < +12 */
 	double ha0 = (ha >= 12.0) ? (ha - 24.0) : ha;
-
-	double telaz, telalt;
-	equatorial_to_horizontal(ha, dec, site_latitude, &telaz, &telalt);
+	double sin_ha = sin(ha0 * M_PI / 12.0), cos_ha = cos(ha0 * M_PI / 12.0);
+	double sin_dec = sin(dec * M_PI / 180.0), cos_dec = cos(dec * M_PI / 180.0);
 
 	/*
 	Find the reference point on the optical axis in dome coordinates
@@ -99,92 +107,54 @@ double indigo_dome_solve_azimuth(double ha, double dec, double site_latitude, do
 	 and is +90 for a horizontal axis with OTA toward +x
 	 and is   0 for OTA over mount with dec axis counterweight down
 	 and is -90 for a horizontal axis with OTA toward -x
-	*/
-	double x0, y0, z0, phi = 0, theta = 0;
 
-	if (site_latitude >= 0.) {
-		theta = site_latitude * M_PI / 180.0;
-	} else {
-		theta = -1. * site_latitude * M_PI / 180.0;
-	}
-
-	/* if German equatorial the origin changes with HA */
-	if (site_latitude >= 0) {
-		if (ha0 > 0) {
-			/* Looking west with OTA east of pier */
-			phi = (6.0 - ha0) * M_PI / 12.0;
-		} else {
-			/* Looking east with OTA west of pier */
-			phi = -(6.0 + ha0) * M_PI / 12.0;
-		}
-	} else {
-		if (ha0 > 0) {
-			/* Looking west with OTA east of pier */
-			phi = -(6.0 - ha0) * M_PI / 12.0;
-		} else {
-			/* Looking east with OTA west of pier */
-			phi = (6.0 + ha0) * M_PI / 12.0;
-		}
-	}
+	German equatorial origin changes with HA, phi is (6 - ha0) looking west with OTA east of pier
+	and -(6 + ha0) looking east with OTA west of pier (negated for -lat), so its sine and cosine
+	follow from the hour angle directly.
+	*/
+	double sin_phi = (ha0 > 0 ? cos_ha : -cos_ha) * geometry->hemisphere;
+	double cos_phi = fabs(sin_ha);
 
 	/* Find the dome coordinates of the OTA reference point for a German equatorial */
-	x0 = mount_dec_length * sin(phi) + mount_dec_offset_EW;
-	y0 = -mount_dec_length * cos(phi) * sin(theta) + mount_dec_offset_NS;
-	z0 = mount_dec_length * cos(phi) * cos(theta) + mount_dec_height;
+	double x0 = geometry->mount_dec_length * sin_phi + geometry->mount_dec_offset_EW;
+	double y0 = -geometry->mount_dec_length * cos_phi * geometry->sin_theta + geometry->mount_dec_offset_NS;
+	double z0 = geometry->mount_dec_length * cos_phi * geometry->cos_theta + geometry->mount_dec_height;
 
 	/*
-	(x,y,z) is on the optical axis
-	Iterate to make this point also lie on the dome surface
-	Begin iteration assuming the zero point is at the center of the dome
-	Telescope azimuth is measured from the direction to the pole
+	Unit vector of the optical axis, horizontal components are cos(alt) * sin(az) and cos(alt) * cos(az)
+	with telescope azimuth measured from the direction to the pole, so they flip for -lat
 	*/
-	double telaz2, telalt2;
-
-	if (site_latitude >= 0) {
-		telaz2 = telaz * M_PI / 180.0;
-		telalt2 = telalt * M_PI / 180.0;
-	} else {
-		telaz2 = telaz - 180.0;
-		telaz2 = map360(telaz2);
-		telaz2 = telaz2 * M_PI / 180.0;
-		telalt2 = telalt * M_PI / 180.0;
-	}
-
-	double d = 0;
-	double r = dome_radius;
-	int n = 0;
-	double x = 0, y = 0, z = 0;
-	/* converges fast => 5 should be ok */
-	while (n < 5) {
-		d = d - (r - dome_radius);
-		double rp = dome_radius + d;
-		x = x0 + rp * cos(telalt2) * sin(telaz2);
-		y = y0 + rp * cos(telalt2) * cos(telaz2);
-		z = z0 + rp * sin(telalt2);
-		r = sqrt(x*x + y*y + z*z);
-		//printf("n, r, rp phi: %d %f %f %f\n", n, r, rp, phi);
-		n++;
+	double ux = -cos_dec * sin_ha * geometry->hemisphere;
+	double uy = (sin_dec * geometry->cos_latitude - geometry->sin_latitude * cos_dec * cos_ha) * geometry->hemisphere;
+	double uz = geometry->sin_latitude * sin_dec + geometry->cos_latitude * cos_dec * cos_ha;
+
+	/* Intersect the optical axis with the dome sphere */
+	double b = x0 * ux + y0 * uy + z0 * uz;
+	double c = x0 * x0 + y0 * y0 + z0 * z0 - geometry->dome_radius * geometry->dome_radius;
+	double discriminant = b * b - c;
+	double x = ux, y = uy;
+	if (discriminant >= 0) {
+		double t = -b + sqrt(discriminant);
+		x = x0 + t * ux;
+		y = y0 + t * uy;
 	}
 
 	/*
-	Use (x,y,0) from the interation to find the azimuth of the dome
+	Use (x,y,0) from the intersection to find the azimuth of the dome
 	Azimuth is N (0), E (90), S (180), W (270) in both hemispheres
 	However x and y are different in the hemispheres so we fix that here
 	*/
-	double zeta = atan2(x, y);
-	if ((zeta > -2 * M_PI) && (zeta < 2 * M_PI)) {
-		if (site_latitude > 0) {
-			zeta = (180.0 / M_PI) * zeta;
-			zeta = map360(zeta);
-		} else {
-			zeta = (180.0 / M_PI) * zeta;
-			zeta = zeta + 180;
-			zeta = map360(zeta);
-		}
-	} else {
-		zeta = telaz;
-	}
-	return zeta;
+	double zeta = (180.0 / M_PI) * atan2(x, y);
+	if (geometry->hemisphere < 0)
+		zeta = zeta + 180;
+	return map360(zeta);
+}
+
+
+double indigo_dome_solve_azimuth(double ha, double dec, double site_latitude, double dome_radius, double mount_dec_height, double mount_dec_length, double mount_dec_offset_NS, double mount_dec_offset_EW) {
+	indigo_dome_geometry geometry = { 0 };
+	indigo_dome_init_geometry(&geometry, site_latitude, dome_radius, mount_dec_height, mount_dec_length, mount_dec_offset_NS, mount_dec_offset_EW);
+	return indigo_dome_geometry_azimuth(&geometry, ha, dec);
 }
 
 #ifdef _TEST_
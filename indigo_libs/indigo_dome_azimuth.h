@@ -28,12 +28,36 @@
  #ifndef indigo_dome_azimuth_h
  #define indigo_dome_azimuth_h
 
+ #include <stdbool.h>
+
  #ifdef __cplusplus
  extern "C" {
  #endif
 
 extern double map24(double hour);
 
+/** Dome and mount geometry with precomputed constants.
+ */
+typedef struct {
+	double site_latitude;							///< site latitude (°)
+	double dome_radius;								///< dome radius (m)
+	double mount_dec_height;					///< height of the dec axis above dome center (m)
+	double mount_dec_length;					///< optical axis offset from the RA axis (m)
+	double mount_dec_offset_NS;				///< mount pivot offset N/S (m)
+	double mount_dec_offset_EW;				///< mount pivot offset E/W (m)
+	double hemisphere;								///< 1 for northern and -1 for southern hemisphere
+	double sin_latitude, cos_latitude;	///< site latitude sine and cosine
+	double sin_theta, cos_theta;			///< polar axis altitude sine and cosine
+} indigo_dome_geometry;
+
+/** Precompute geometry constants, returns false if geometry was already initialized with the same values.
+ */
+extern bool indigo_dome_init_geometry(indigo_dome_geometry *geometry, double site_latitude, double dome_radius, double mount_dec_height, double mount_dec_length, double mount_dec_offset_NS, double mount_dec_offset_EW);
+
+/** Solve dome azimuth for hour angle (h) and declination (°) with precomputed geometry.
+ */
+extern double indigo_dome_geometry_azimuth(indigo_dome_geometry *geometry, double ha, double dec);
+
 extern double indigo_dome_solve_azimuth (
 	double ha,
 	double dec,
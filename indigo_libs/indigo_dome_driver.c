@@ -38,13 +38,75 @@
 #include "indigo_agent.h"
 #include "indigo_novas.h"
 
-#define SYNC_INTERAL 30.0  /* in seconds */
+#define SYNC_INTERVAL					5.0  /* in seconds */
+#define SLAVING_MIN_SAMPLE		0.5  /* in seconds */
+#define SLAVING_MAX_SAMPLE		60.0 /* in seconds */
+#define SLAVING_MAX_RATE			0.1  /* in °/s, faster changes are slews, not tracking */
+#define SIDEREAL_RATE					(1.00273790935 / 3600.0) /* in h/s */
+
+// -------------------------------------------------------------------------------- dome slaving
+
+// Mount coordinates rate is estimated from consecutive snooped samples, required azimuth is predicted from the last
+// sample lead time ahead, so the dome leads the telescope and is commanded only when the slit error exceeds threshold.
+
+static double slaving_clock() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static double slaving_predict(indigo_device *device, double lead_time) {
+	indigo_dome_init_geometry(&DOME_CONTEXT->geometry, DOME_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value, DOME_RADIUS_ITEM->number.value, DOME_MOUNT_PIVOT_VERTICAL_OFFSET_ITEM->number.value, DOME_MOUNT_PIVOT_OTA_OFFSET_ITEM->number.value, DOME_MOUNT_PIVOT_OFFSET_NS_ITEM->number.value, DOME_MOUNT_PIVOT_OFFSET_EW_ITEM->number.value);
+	double delay = fmin(slaving_clock() - DOME_CONTEXT->slaving_time, SLAVING_MAX_SAMPLE) + lead_time;
+	double lst = indigo_lst(DOME_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value);
+	double ha = lst + lead_time * SIDEREAL_RATE - DOME_CONTEXT->slaving_ra - delay * DOME_CONTEXT->slaving_ra_rate;
+	double dec = DOME_CONTEXT->slaving_dec + delay * DOME_CONTEXT->slaving_dec_rate;
+	if (dec > 90)
+		dec = 90;
+	else if (dec < -90)
+		dec = -90;
+	return indigo_dome_geometry_azimuth(&DOME_CONTEXT->geometry, ha, dec);
+}
+
+static double slaving_error(indigo_device *device, double az) {
+	return fmod(az - DOME_CONTEXT->slaving_azimuth + 540, 360) - 180;
+}
+
+static void slaving_sample(indigo_device *device, double ra, double dec, double time) {
+	double delay = time - DOME_CONTEXT->slaving_time;
+	if (DOME_CONTEXT->slaving_time > 0 && delay < SLAVING_MIN_SAMPLE)
+		return;
+	// repeated coordinates come from tracking mount or sync timer, sample time is kept so the next change is measured from the original sample
+	if (DOME_CONTEXT->slaving_time > 0 && ra == DOME_CONTEXT->slaving_ra && dec == DOME_CONTEXT->slaving_dec) {
+		DOME_CONTEXT->slaving_ra_rate = DOME_CONTEXT->slaving_dec_rate = 0;
+		return;
+	}
+	if (DOME_CONTEXT->slaving_time > 0 && delay <= SLAVING_MAX_SAMPLE) {
+		double ra_rate = (fmod(ra - DOME_CONTEXT->slaving_ra + 36, 24) - 12) / delay;
+		double dec_rate = (dec - DOME_CONTEXT->slaving_dec) / delay;
+		if (fabs(ra_rate * 15) > SLAVING_MAX_RATE || fabs(dec_rate) > SLAVING_MAX_RATE)
+			ra_rate = dec_rate = 0;
+		DOME_CONTEXT->slaving_ra_rate = ra_rate;
+		DOME_CONTEXT->slaving_dec_rate = dec_rate;
+	} else {
+		DOME_CONTEXT->slaving_ra_rate = DOME_CONTEXT->slaving_dec_rate = 0;
+	}
+	DOME_CONTEXT->slaving_ra = ra;
+	DOME_CONTEXT->slaving_dec = dec;
+	DOME_CONTEXT->slaving_time = time;
+}
 
 static void sync_timer_callback(indigo_device *device) {
-	device->change_property(device, NULL, DOME_EQUATORIAL_COORDINATES_PROPERTY);
-	indigo_reschedule_timer(device, SYNC_INTERAL, &DOME_CONTEXT->sync_timer);
+	if (DOME_AUTO_SYNC_ENABLE_ITEM->sw.value && DOME_CONTEXT->slaving_time > 0 && !DOME_GEOGRAPHIC_COORDINATES_PROPERTY->hidden && !DOME_HORIZONTAL_COORDINATES_PROPERTY->hidden) {
+		double az = slaving_predict(device, DOME_SYNC_LEAD_TIME_ITEM->number.value);
+		if (!DOME_CONTEXT->slaving_synced || fabs(slaving_error(device, az)) >= DOME_SYNC_THRESHOLD_ITEM->number.value)
+			device->change_property(device, NULL, DOME_EQUATORIAL_COORDINATES_PROPERTY);
+	}
+	indigo_reschedule_timer(device, SYNC_INTERVAL, &DOME_CONTEXT->sync_timer);
 }
 
+// --------------------------------------------------------------------------------
+
 indigo_result indigo_dome_attach(indigo_device *device, unsigned version) {
 	assert(device != NULL);
 	assert(device != NULL);
@@ -90,10 +152,11 @@ indigo_result indigo_dome_attach(indigo_device *device, unsigned version) {
 			indigo_init_switch_item(DOME_AUTO_SYNC_ENABLE_ITEM, DOME_AUTO_SYNC_ENABLE_ITEM_NAME, "Enable", false);
 			indigo_init_switch_item(DOME_AUTO_SYNC_DISABLE_ITEM, DOME_AUTO_SYNC_DISABLE_ITEM_NAME, "Disable", true);
 			// -------------------------------------------------------------------------------- DOME_SYNC
-			DOME_SYNC_PARAMETERS_PROPERTY = indigo_init_number_property(NULL, device->name, DOME_SYNC_PARAMETERS_PROPERTY_NAME, DOME_MAIN_GROUP, "Auto Sync Parameteres", INDIGO_OK_STATE, INDIGO_RW_PERM, 1);
+			DOME_SYNC_PARAMETERS_PROPERTY = indigo_init_number_property(NULL, device->name, DOME_SYNC_PARAMETERS_PROPERTY_NAME, DOME_MAIN_GROUP, "Auto Sync Parameteres", INDIGO_OK_STATE, INDIGO_RW_PERM, 2);
 			if (DOME_SYNC_PARAMETERS_PROPERTY == NULL)
 				return INDIGO_FAILED;
 			indigo_init_number_item(DOME_SYNC_THRESHOLD_ITEM, DOME_SYNC_THRESHOLD_ITEM_NAME, "Sync threshold (0 to 20°)", 0, 20, 0, 1);
+			indigo_init_number_item(DOME_SYNC_LEAD_TIME_ITEM, DOME_SYNC_LEAD_TIME_ITEM_NAME, "Sync lead time (0 to 600s)", 0, 600, 0, 10);
 			// -------------------------------------------------------------------------------- DOME_ABORT_MOTION
 			DOME_ABORT_MOTION_PROPERTY = indigo_init_switch_property(NULL, device->name, DOME_ABORT_MOTION_PROPERTY_NAME, DOME_MAIN_GROUP, "Abort motion", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_AT_MOST_ONE_RULE, 1);
 			if (DOME_ABORT_MOTION_PROPERTY == NULL)
@@ -197,7 +260,9 @@ indigo_result indigo_dome_change_property(indigo_device *device, indigo_client *
 			indigo_define_property(device, DOME_SNOOP_DEVICES_PROPERTY, NULL);
 			indigo_add_snoop_rule(DOME_EQUATORIAL_COORDINATES_PROPERTY, DOME_SNOOP_MOUNT_ITEM->text.value, MOUNT_EQUATORIAL_COORDINATES_PROPERTY_NAME);
 			indigo_add_snoop_rule(DOME_GEOGRAPHIC_COORDINATES_PROPERTY, DOME_SNOOP_GPS_ITEM->text.value, GEOGRAPHIC_COORDINATES_PROPERTY_NAME);
-			DOME_CONTEXT->sync_timer = indigo_set_timer(device, SYNC_INTERAL, sync_timer_callback);
+			DOME_CONTEXT->slaving_synced = false;
+			DOME_CONTEXT->slaving_time = 0;
+			DOME_CONTEXT->sync_timer = indigo_set_timer(device, SYNC_INTERVAL, sync_timer_callback);
 		} else {
 			indigo_cancel_timer(device, &DOME_CONTEXT->sync_timer);
 			indigo_remove_snoop_rule(DOME_EQUATORIAL_COORDINATES_PROPERTY, DOME_SNOOP_MOUNT_ITEM->text.value, MOUNT_EQUATORIAL_COORDINATES_PROPERTY_NAME);
@@ -304,31 +369,18 @@ indigo_result indigo_dome_detach(indigo_device *device) {
 indigo_result indigo_fix_dome_coordinates(indigo_device *device, double ra, double dec, double *alt, double *az) {
 	if (!DOME_GEOGRAPHIC_COORDINATES_PROPERTY->hidden && !DOME_HORIZONTAL_COORDINATES_PROPERTY->hidden) {
 		double threshold = DOME_SYNC_THRESHOLD_ITEM->number.value;
-		static double az_prev = 0;
-		double az_now;
-		double lst = indigo_lst(DOME_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value);
-		double ha = map24(lst - ra);
-		az_now = indigo_dome_solve_azimuth (
-			ha,
-			dec,
-			DOME_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value,
-			DOME_RADIUS_ITEM->number.value,
-			DOME_MOUNT_PIVOT_VERTICAL_OFFSET_ITEM->number.value,
-			DOME_MOUNT_PIVOT_OTA_OFFSET_ITEM->number.value,
-			DOME_MOUNT_PIVOT_OFFSET_NS_ITEM->number.value,
-			DOME_MOUNT_PIVOT_OFFSET_EW_ITEM->number.value
-		);
-		double diff = az_prev - az_now;
-		if (fabs(diff) >= threshold) {
+		slaving_sample(device, ra, dec, slaving_clock());
+		double az_now = slaving_predict(device, DOME_SYNC_LEAD_TIME_ITEM->number.value);
+		double diff = slaving_error(device, az_now);
+		if (!DOME_CONTEXT->slaving_synced || fabs(diff) >= threshold) {
 			INDIGO_DRIVER_TRACE("dome_driver", "Update dome Az diff = %f, threshold = %f", fabs(diff), threshold);
-			*az = az_now;
-			az_prev = az_now;
+			DOME_CONTEXT->slaving_azimuth = az_now;
+			DOME_CONTEXT->slaving_synced = true;
 		} else {
 			INDIGO_DRIVER_TRACE("dome_driver", "No dome Az update needed diff = %f, threshold = %f", fabs(diff), threshold);
-			*az = az_prev;
 		}
-		*az = round(*az * 10) / 10;
-		INDIGO_DRIVER_TRACE("dome_driver","ha = %f, lst = %f, dec = %f, az = %.2f, az_now = %.3f, az_prev = %.3f ", ha, lst, dec, *az, az_now, az_prev);
+		*az = round(DOME_CONTEXT->slaving_azimuth * 10) / 10;
+		INDIGO_DRIVER_TRACE("dome_driver","ra = %f, dec = %f, ra_rate = %g, dec_rate = %g, az = %.2f, az_predicted = %.3f", ra, dec, DOME_CONTEXT->slaving_ra_rate, DOME_CONTEXT->slaving_dec_rate, *az, az_now);
 		return INDIGO_OK;
 	}
 	return INDIGO_FAILED;
@@ -114,6 +114,10 @@ extern "C" {
  */
 #define DOME_SYNC_THRESHOLD_ITEM							(DOME_SYNC_PARAMETERS_PROPERTY->items+0)
 
+/** DOME_SYNC_PARAMETERS.LEAD_TIME property item pointer.
+ */
+#define DOME_SYNC_LEAD_TIME_ITEM							(DOME_SYNC_PARAMETERS_PROPERTY->items+1)
+
 
 /** DOME_ABORT_MOTION property pointer, property is optional, property change request should be fully handled by dome driver
  */
@@ -223,6 +227,12 @@ typedef struct {
 	indigo_property *dome_geographic_coordinates_property;	///< DOME_GEOGRAPHIC_COORDINATES property pointer
 	indigo_property *dome_snoop_devices_property;								///< DOME_SNOOP_DEVICES property pointer
 	indigo_timer *sync_timer;
+	indigo_dome_geometry geometry;													///< cached dome geometry
+	bool slaving_synced;																		///< slaving_azimuth was computed
+	double slaving_azimuth;																	///< dome azimuth requested by slaving
+	double slaving_time;																		///< time of the last mount coordinates sample
+	double slaving_ra, slaving_dec;													///< last mount coordinates sample
+	double slaving_ra_rate, slaving_dec_rate;								///< mount coordinates rate estimated from samples (h/s, °/s)
 } indigo_dome_context;
 
 /** Attach callback function.
@@ -237,7 +247,8 @@ extern indigo_result indigo_dome_change_property(indigo_device *device, indigo_c
 /** Detach callback function.
  */
 extern indigo_result indigo_dome_detach(indigo_device *device);
-/** Update dome coordinates.
+/** Update dome coordinates. Azimuth is predicted DOME_SYNC_PARAMETERS.LEAD_TIME ahead from the mount coordinates rate and
+ changes only if predicted error exceeds DOME_SYNC_PARAMETERS.THRESHOLD.
  */
 extern indigo_result indigo_fix_dome_coordinates(indigo_device *device, double ra, double dec, double *alt, double *az);
 
@@ -323,8 +323,10 @@ indigo_result indigo_device_change_property(indigo_device *device, indigo_client
 			indigo_save_property(device, NULL, SIMULATION_PROPERTY);
 			indigo_save_property(device, NULL, DEVICE_PORT_PROPERTY);
 			if (DEVICE_CONTEXT->property_save_file_handle) {
-				CONFIG_PROPERTY->state = INDIGO_OK_STATE;
-				close(DEVICE_CONTEXT->property_save_file_handle);
+				if (indigo_close_config_file(DEVICE_CONTEXT->property_save_file_handle) == INDIGO_OK)
+					CONFIG_PROPERTY->state = INDIGO_OK_STATE;
+				else
+					CONFIG_PROPERTY->state = INDIGO_ALERT_STATE;
 				DEVICE_CONTEXT->property_save_file_handle = 0;
 			} else {
 				CONFIG_PROPERTY->state = INDIGO_ALERT_STATE;
@@ -434,12 +436,57 @@ static bool make_config_file_name(char *device_name, int profile, const char *su
 	return false;
 }
 
+//  Files opened for writing by indigo_open_config_file() are written to temporary file and renamed on close
+
+#define MAX_PENDING_CONFIG_FILES	32
+#define CONFIG_STORE_MAGIC				"INDIGOCS"
+#define CONFIG_STORE_VERSION			1
+
+typedef struct {
+	int handle;
+	bool store;
+	uint32_t checksum;
+	uint32_t count;
+	char path[512];
+} pending_config_file;
+
+static pending_config_file pending_config_files[MAX_PENDING_CONFIG_FILES];
+static pthread_mutex_t pending_config_files_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pending_config_file *find_pending_config_file(int handle) {
+	for (int i = 0; i < MAX_PENDING_CONFIG_FILES; i++)
+		if (pending_config_files[i].handle == handle)
+			return pending_config_files + i;
+	return NULL;
+}
+
 int indigo_open_config_file(char *device_name, int profile, int mode, const char *suffix) {
 	static char path[512];
 	if (make_config_file_name(device_name, profile, suffix, path, sizeof(path))) {
-		int handle = open(path, mode, 0644);
-		if (handle < 0)
-			INDIGO_DEBUG(indigo_debug("Can't %s %s (%s)", mode == O_RDONLY ? "open" : "create", path, strerror(errno)));
+		if ((mode & O_ACCMODE) == O_RDONLY) {
+			int handle = open(path, mode, 0644);
+			if (handle < 0)
+				INDIGO_DEBUG(indigo_debug("Can't open %s (%s)", path, strerror(errno)));
+			return handle;
+		}
+		pthread_mutex_lock(&pending_config_files_mutex);
+		pending_config_file *pending = find_pending_config_file(0);
+		if (pending == NULL) {
+			pthread_mutex_unlock(&pending_config_files_mutex);
+			INDIGO_DEBUG(indigo_debug("Can't create %s (too many open config files)", path));
+			return -1;
+		}
+		char tmp_path[520];
+		snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+		int handle = open(tmp_path, mode | O_CREAT | O_TRUNC, 0644);
+		if (handle < 0) {
+			INDIGO_DEBUG(indigo_debug("Can't create %s (%s)", tmp_path, strerror(errno)));
+		} else {
+			memset(pending, 0, sizeof(pending_config_file));
+			pending->handle = handle;
+			strncpy(pending->path, path, sizeof(pending->path));
+		}
+		pthread_mutex_unlock(&pending_config_files_mutex);
 		return handle;
 	} else {
 		INDIGO_DEBUG(indigo_debug("Can't create %s (%s)", path, strerror(errno)));
@@ -447,29 +494,364 @@ int indigo_open_config_file(char *device_name, int profile, int mode, const char
 	return -1;
 }
 
-indigo_result indigo_load_properties(indigo_device *device, bool default_properties) {
-	assert(device != NULL);
-	int profile = 0;
-	if (DEVICE_CONTEXT) {
-		for (int i = 0; i < PROFILE_COUNT; i++)
-			if (PROFILE_PROPERTY->items[i].sw.value) {
-				profile = i;
+static bool config_store_write(pending_config_file *pending, const void *data, long length) {
+	const uint8_t *bytes = data;
+	for (long i = 0; i < length; i++) {
+		pending->checksum ^= bytes[i];
+		pending->checksum *= 16777619;
+	}
+	return indigo_write(pending->handle, (const char *)data, length);
+}
+
+static uint8_t *config_store_put_string(uint8_t *out, const char *string) {
+	uint16_t length = (uint16_t)strlen(string);
+	memcpy(out, &length, sizeof(length));
+	memcpy(out + sizeof(length), string, length);
+	return out + sizeof(length) + length;
+}
+
+static bool config_store_append(int handle, indigo_property *property) {
+	pthread_mutex_lock(&pending_config_files_mutex);
+	pending_config_file *pending = find_pending_config_file(handle);
+	if (pending == NULL || !pending->store) {
+		pthread_mutex_unlock(&pending_config_files_mutex);
+		return false;
+	}
+	uint8_t *buffer = malloc(8 + INDIGO_NAME_SIZE + property->count * (4 + INDIGO_NAME_SIZE + INDIGO_VALUE_SIZE + sizeof(double)));
+	uint8_t *out = buffer;
+	uint16_t count = (uint16_t)property->count;
+	*out++ = (uint8_t)property->type;
+	memcpy(out, &count, sizeof(count));
+	out = config_store_put_string(out + sizeof(count), property->name);
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *item = property->items + i;
+		out = config_store_put_string(out, item->name);
+		switch (property->type) {
+			case INDIGO_TEXT_VECTOR:
+				out = config_store_put_string(out, item->text.value);
+				break;
+			case INDIGO_NUMBER_VECTOR:
+				memcpy(out, &item->number.value, sizeof(double));
+				out += sizeof(double);
+				break;
+			case INDIGO_SWITCH_VECTOR:
+				*out++ = item->sw.value;
 				break;
+			default:
+				break;
+		}
+	}
+	bool result = config_store_write(pending, buffer, out - buffer);
+	pending->count++;
+	pthread_mutex_unlock(&pending_config_files_mutex);
+	free(buffer);
+	return result;
+}
+
+static int open_config_store(char *device_name, int profile) {
+	int handle = indigo_open_config_file(device_name, profile, O_WRONLY, INDIGO_CONFIG_STORE_SUFFIX);
+	if (handle > 0) {
+		pthread_mutex_lock(&pending_config_files_mutex);
+		pending_config_file *pending = find_pending_config_file(handle);
+		pending->store = true;
+		pending->checksum = 2166136261;
+		uint32_t version = CONFIG_STORE_VERSION;
+		config_store_write(pending, CONFIG_STORE_MAGIC, 8);
+		config_store_write(pending, &version, sizeof(version));
+		pthread_mutex_unlock(&pending_config_files_mutex);
+	}
+	return handle;
+}
+
+indigo_result indigo_close_config_file(int handle) {
+	if (handle <= 0)
+		return INDIGO_FAILED;
+	pthread_mutex_lock(&pending_config_files_mutex);
+	pending_config_file *pending = find_pending_config_file(handle);
+	if (pending == NULL) {
+		pthread_mutex_unlock(&pending_config_files_mutex);
+		close(handle);
+		return INDIGO_OK;
+	}
+	bool result = true;
+	if (pending->store) {
+		result = config_store_write(pending, &pending->count, sizeof(pending->count));
+		uint32_t checksum = pending->checksum;
+		result = result && indigo_write(handle, (const char *)&checksum, sizeof(checksum));
+	}
+	result = result && fsync(handle) == 0;
+	close(handle);
+	char tmp_path[520];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", pending->path);
+	if (result && rename(tmp_path, pending->path) == 0) {
+		INDIGO_DEBUG(indigo_debug("%s committed", pending->path));
+	} else {
+		INDIGO_DEBUG(indigo_debug("Can't commit %s (%s)", pending->path, strerror(errno)));
+		unlink(tmp_path);
+		result = false;
+	}
+	pending->handle = 0;
+	pthread_mutex_unlock(&pending_config_files_mutex);
+	return result ? INDIGO_OK : INDIGO_FAILED;
+}
+
+static char *read_config_file(char *device_name, int profile, const char *suffix, long *size) {
+	int handle = indigo_open_config_file(device_name, profile, O_RDONLY, suffix);
+	if (handle < 0)
+		return NULL;
+	struct stat file_stat;
+	char *buffer = NULL;
+	if (fstat(handle, &file_stat) == 0 && (buffer = malloc(file_stat.st_size + 1)) != NULL) {
+		if (file_stat.st_size == 0 || indigo_read(handle, buffer, file_stat.st_size) == file_stat.st_size) {
+			buffer[file_stat.st_size] = 0;
+			*size = file_stat.st_size;
+		} else {
+			free(buffer);
+			buffer = NULL;
+		}
+	}
+	close(handle);
+	return buffer;
+}
+
+static const uint8_t *config_store_get_string(const uint8_t *in, const uint8_t *end, char *string, int size) {
+	uint16_t length;
+	if (in == NULL || in + sizeof(length) > end)
+		return NULL;
+	memcpy(&length, in, sizeof(length));
+	in += sizeof(length);
+	if (in + length > end)
+		return NULL;
+	int copy = length < size ? length : size - 1;
+	memcpy(string, in, copy);
+	string[copy] = 0;
+	return in + length;
+}
+
+static bool load_config_store(indigo_device *device, indigo_client *client, const uint8_t *buffer, long size) {
+	uint32_t version, count, checksum = 2166136261, stored_checksum;
+	if (size < 8 + 3 * sizeof(uint32_t) || memcmp(buffer, CONFIG_STORE_MAGIC, 8))
+		return false;
+	memcpy(&version, buffer + 8, sizeof(version));
+	if (version != CONFIG_STORE_VERSION)
+		return false;
+	const uint8_t *end = buffer + size - 2 * sizeof(uint32_t);
+	for (const uint8_t *p = buffer; p < end + sizeof(uint32_t); p++) {
+		checksum ^= *p;
+		checksum *= 16777619;
+	}
+	memcpy(&count, end, sizeof(count));
+	memcpy(&stored_checksum, end + sizeof(count), sizeof(stored_checksum));
+	if (checksum != stored_checksum) {
+		INDIGO_ERROR(indigo_error("%s: config store is damaged", device->name));
+		return false;
+	}
+	const uint8_t *in = buffer + 8 + sizeof(version);
+	indigo_property *property = indigo_init_text_property(NULL, device->name, "", "", "", INDIGO_IDLE_STATE, INDIGO_RW_PERM, INDIGO_MAX_ITEMS);
+	for (uint32_t i = 0; i < count && in != NULL; i++) {
+		uint16_t item_count;
+		if (in + 1 + sizeof(item_count) > end) {
+			in = NULL;
+			break;
+		}
+		property->type = *in++;
+		memcpy(&item_count, in, sizeof(item_count));
+		in = config_store_get_string(in + sizeof(item_count), end, property->name, INDIGO_NAME_SIZE);
+		if (item_count > INDIGO_MAX_ITEMS)
+			in = NULL;
+		property->count = item_count;
+		for (int j = 0; j < item_count && in != NULL; j++) {
+			indigo_item *item = property->items + j;
+			memset(item, 0, sizeof(indigo_item));
+			in = config_store_get_string(in, end, item->name, INDIGO_NAME_SIZE);
+			if (in == NULL)
+				break;
+			switch (property->type) {
+				case INDIGO_TEXT_VECTOR:
+					in = config_store_get_string(in, end, item->text.value, INDIGO_VALUE_SIZE);
+					break;
+				case INDIGO_NUMBER_VECTOR:
+					if (in + sizeof(double) > end)
+						in = NULL;
+					else
+						memcpy(&item->number.value, in, sizeof(double));
+					in = in ? in + sizeof(double) : NULL;
+					break;
+				case INDIGO_SWITCH_VECTOR:
+					if (in + 1 > end)
+						in = NULL;
+					else
+						item->sw.value = *in++;
+					break;
+				default:
+					in = NULL;
+					break;
 			}
+		}
+		if (in != NULL)
+			indigo_change_property(client, property);
 	}
+	indigo_release_property(property);
+	return in != NULL;
+}
+
+static void xml_config_unescape(char *string) {
+	static const char *entities[][2] = { { "&amp;", "&" }, { "&lt;", "<" }, { "&gt;", ">" }, { "&quot;", "\"" }, { "&apos;", "'" } };
+	char *out = string;
+	for (char *in = string; *in; ) {
+		bool found = false;
+		if (*in == '&') {
+			for (int i = 0; i < 5; i++) {
+				int length = (int)strlen(entities[i][0]);
+				if (!strncmp(in, entities[i][0], length)) {
+					*out++ = *entities[i][1];
+					in += length;
+					found = true;
+					break;
+				}
+			}
+		}
+		if (!found)
+			*out++ = *in++;
+	}
+	*out = 0;
+}
+
+static bool xml_config_attribute(char *tag, char *tag_end, const char *name, char *value, int size) {
+	int length = (int)strlen(name);
+	for (char *p = tag + 1; p + length + 2 < tag_end; p++) {
+		if ((p[-1] == ' ' || p[-1] == '\t') && !strncmp(p, name, length) && p[length] == '=' && (p[length + 1] == '\'' || p[length + 1] == '"')) {
+			char quote = p[length + 1];
+			char *begin = p + length + 2;
+			char *end = memchr(begin, quote, tag_end - begin);
+			if (end == NULL || end - begin >= size)
+				return false;
+			memcpy(value, begin, end - begin);
+			value[end - begin] = 0;
+			xml_config_unescape(value);
+			return true;
+		}
+	}
+	return false;
+}
+
+//  Reads XML config in format written by older versions of indigo_save_property(), returns false for anything else
+
+static bool load_xml_config(indigo_client *client, char *buffer, bool apply, int store_handle) {
+	static const struct { const char *tag; indigo_property_type type; } vectors[] = {
+		{ "newTextVector", INDIGO_TEXT_VECTOR }, { "newNumberVector", INDIGO_NUMBER_VECTOR }, { "newSwitchVector", INDIGO_SWITCH_VECTOR }
+	};
+	indigo_property *property = NULL;
+	char *in = buffer;
+	bool result = true;
+	while (result && (in = strchr(in, '<')) != NULL) {
+		char *tag_end = strchr(in, '>');
+		if (tag_end == NULL) {
+			result = false;
+			break;
+		}
+		if (property == NULL) {
+			result = false;
+			for (int i = 0; i < 3; i++) {
+				int length = (int)strlen(vectors[i].tag);
+				if (!strncmp(in + 1, vectors[i].tag, length) && (in[length + 1] == ' ' || in[length + 1] == '>')) {
+					property = indigo_init_text_property(NULL, "", "", "", "", INDIGO_IDLE_STATE, INDIGO_RW_PERM, INDIGO_MAX_ITEMS);
+					property->type = vectors[i].type;
+					property->count = 0;
+					result = xml_config_attribute(in, tag_end, "device", property->device, INDIGO_NAME_SIZE) && xml_config_attribute(in, tag_end, "name", property->name, INDIGO_NAME_SIZE);
+					break;
+				}
+			}
+		} else if (!strncmp(in + 1, "/new", 4)) {
+			if (apply) {
+				indigo_change_property(client, property);
+				if (store_handle > 0)
+					config_store_append(store_handle, property);
+			}
+			indigo_release_property(property);
+			property = NULL;
+		} else if (!strncmp(in + 1, "one", 3) && property->count < INDIGO_MAX_ITEMS) {
+			indigo_item *item = property->items + property->count++;
+			memset(item, 0, sizeof(indigo_item));
+			char *value_end = strchr(tag_end, '<');
+			result = value_end != NULL && xml_config_attribute(in, tag_end, "name", item->name, INDIGO_NAME_SIZE);
+			if (result) {
+				*value_end = 0;
+				char value[INDIGO_VALUE_SIZE];
+				strncpy(value, tag_end + 1, INDIGO_VALUE_SIZE - 1);
+				value[INDIGO_VALUE_SIZE - 1] = 0;
+				*value_end = '<';
+				xml_config_unescape(value);
+				switch (property->type) {
+					case INDIGO_TEXT_VECTOR:
+						strcpy(item->text.value, value);
+						break;
+					case INDIGO_NUMBER_VECTOR:
+						item->number.value = atof(value);
+						break;
+					default:
+						item->sw.value = !strcmp(value, "On");
+						break;
+				}
+				tag_end = strchr(value_end, '>');
+				result = tag_end != NULL && !strncmp(value_end + 1, "/one", 4);
+			}
+		} else {
+			result = false;
+		}
+		in = tag_end ? tag_end + 1 : in + 1;
+	}
+	if (property != NULL) {
+		indigo_release_property(property);
+		result = false;
+	}
+	return result;
+}
+
+static int selected_profile(indigo_device *device) {
+	if (DEVICE_CONTEXT) {
+		for (int i = 0; i < PROFILE_COUNT; i++)
+			if (PROFILE_PROPERTY->items[i].sw.value)
+				return i;
+	}
+	return 0;
+}
+
+indigo_result indigo_load_properties(indigo_device *device, bool default_properties) {
+	assert(device != NULL);
+	int profile = selected_profile(device);
+	indigo_client client = { 0 };
+	strcpy(client.name, CONFIG_READER);
+	client.version = INDIGO_VERSION_CURRENT;
+	long size = 0;
+	char *buffer;
+	if (!default_properties && (buffer = read_config_file(device->name, profile, INDIGO_CONFIG_STORE_SUFFIX, &size)) != NULL) {
+		bool result = load_config_store(device, &client, (uint8_t *)buffer, size);
+		free(buffer);
+		if (result)
+			return INDIGO_OK;
+	}
+	buffer = read_config_file(device->name, profile, default_properties ? ".default" : ".config", &size);
+	if (buffer == NULL)
+		return INDIGO_FAILED;
+	if (load_xml_config(&client, buffer, false, 0)) {
+		//  Import XML config into config store
+		int store_handle = default_properties ? 0 : open_config_store(device->name, profile);
+		load_xml_config(&client, buffer, true, store_handle);
+		if (store_handle > 0)
+			indigo_close_config_file(store_handle);
+		free(buffer);
+		return INDIGO_OK;
+	}
+	free(buffer);
+	//  Fall back to full XML parser for hand edited files
 	int handle = indigo_open_config_file(device->name, profile, O_RDONLY, default_properties ? ".default" : ".config");
 	if (handle > 0) {
-		indigo_client *client = malloc(sizeof(indigo_client));
-		memset(client, 0, sizeof(indigo_client));
-		strcpy(client->name, CONFIG_READER);
-		indigo_adapter_context *context = malloc(sizeof(indigo_adapter_context));
-		context->input = handle;
-		client->client_context = context;
-		client->version = INDIGO_VERSION_CURRENT;
-		indigo_xml_parse(NULL, client);
+		indigo_adapter_context context = { 0 };
+		context.input = handle;
+		client.client_context = &context;
+		indigo_xml_parse(NULL, &client);
 		close(handle);
-		free(context);
-		free(client);
 	}
 	return handle > 0 ? INDIGO_OK : INDIGO_FAILED;
 }
@@ -482,42 +864,18 @@ indigo_result indigo_save_property(indigo_device*device, int *file_handle, indig
 			file_handle = &DEVICE_CONTEXT->property_save_file_handle;
 		int handle = *file_handle;
 		if (handle == 0) {
-			int profile = 0;
-			if (DEVICE_CONTEXT) {
-				for (int i = 0; i < PROFILE_COUNT; i++)
-					if (PROFILE_PROPERTY->items[i].sw.value) {
-						profile = i;
-						break;
-					}
-			}
-			*file_handle = handle = indigo_open_config_file(property->device, profile, O_WRONLY | O_CREAT | O_TRUNC, ".config");
-			if (handle == 0)
+			*file_handle = handle = open_config_store(property->device, selected_profile(device));
+			if (handle <= 0) {
+				*file_handle = 0;
 				return INDIGO_FAILED;
+			}
 		}
 		switch (property->type) {
 		case INDIGO_TEXT_VECTOR:
-			indigo_printf(handle, "<newTextVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneText name='%s'>%s</oneText>\n", item->name, indigo_xml_escape(item->text.value));
-			}
-			indigo_printf(handle, "</newTextVector>\n");
-			break;
 		case INDIGO_NUMBER_VECTOR:
-			indigo_printf(handle, "<newNumberVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneNumber name='%s'>%g</oneNumber>\n", item->name, item->number.value);
-			}
-			indigo_printf(handle, "</newNumberVector>\n");
-			break;
 		case INDIGO_SWITCH_VECTOR:
-			indigo_printf(handle, "<newSwitchVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneSwitch name='%s'>%s</oneSwitch>\n", item->name, item->sw.value ? "On" : "Off");
-			}
-			indigo_printf(handle, "</newSwitchVector>\n");
+			if (!config_store_append(handle, property))
+				return INDIGO_FAILED;
 			break;
 		default:
 			break;
@@ -528,20 +886,14 @@ indigo_result indigo_save_property(indigo_device*device, int *file_handle, indig
 
 indigo_result indigo_remove_properties(indigo_device *device) {
 	assert(device != NULL);
-	int profile = 0;
-	if (DEVICE_CONTEXT) {
-		for (int i = 0; i < PROFILE_COUNT; i++)
-			if (PROFILE_PROPERTY->items[i].sw.value) {
-				profile = i;
-				break;
-			}
-	}
+	int profile = selected_profile(device);
 	static char path[512];
-	if (make_config_file_name(device->name, profile, ".config", path, sizeof(path))) {
-		if (unlink(path) == 0)
-			return INDIGO_OK;
-	}
-	return INDIGO_FAILED;
+	bool removed = false;
+	if (make_config_file_name(device->name, profile, INDIGO_CONFIG_STORE_SUFFIX, path, sizeof(path)))
+		removed = unlink(path) == 0;
+	if (make_config_file_name(device->name, profile, ".config", path, sizeof(path)))
+		removed = unlink(path) == 0 || removed;
+	return removed ? INDIGO_OK : INDIGO_FAILED;
 }
 
 static void *hotplug_thread(void *arg) {
@@ -560,6 +912,340 @@ void indigo_start_usb_event_handler() {
 	}
 }
 
+// -------------------------------------------------------------------------------- USB hotplug dispatcher
+
+// Single libusb hotplug callback matches events against handler VID/PID tables and queues devices per handler. Queues are
+// dispatched USB_HOTPLUG_SETTLE_TIME after the last event of a burst (but no later than USB_HOTPLUG_MAX_DELAY after the first
+// one), each handler on its own worker, so every driver enumerates once per burst and drivers enumerate in parallel.
+// Dispatcher thread sleeps on condition until the first event of a burst arrives.
+
+#define USB_HOTPLUG_MAX_HANDLERS	32
+#define USB_HOTPLUG_SETTLE_TIME		0.5
+#define USB_HOTPLUG_MAX_DELAY			2.0
+
+typedef struct {
+	libusb_device **devices;
+	int count;
+	int size;
+} usb_hotplug_queue;
+
+typedef struct {
+	bool used;
+	bool busy;
+	char name[INDIGO_NAME_SIZE];
+	int vendor_id;
+	int *product_ids;
+	int product_id_count;
+	indigo_usb_hotplug_callback callback;
+	usb_hotplug_queue arrived;
+	usb_hotplug_queue left;
+} usb_hotplug_handler;
+
+static usb_hotplug_handler usb_hotplug_handlers[USB_HOTPLUG_MAX_HANDLERS];
+static pthread_mutex_t usb_hotplug_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t usb_hotplug_cond;
+static double usb_hotplug_first = 0, usb_hotplug_last = 0;
+static libusb_hotplug_callback_handle usb_hotplug_handle;
+static bool usb_hotplug_started = false;
+
+static double usb_hotplug_time() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool usb_hotplug_match(usb_hotplug_handler *handler, libusb_device *dev) {
+	struct libusb_device_descriptor descriptor;
+	if (libusb_get_device_descriptor(dev, &descriptor) != LIBUSB_SUCCESS)
+		return false;
+	if (handler->vendor_id != INDIGO_USB_MATCH_ANY && handler->vendor_id != descriptor.idVendor)
+		return false;
+	if (handler->product_id_count == 0)
+		return true;
+	for (int i = 0; i < handler->product_id_count; i++) {
+		if (handler->product_ids[i] == descriptor.idProduct)
+			return true;
+	}
+	return false;
+}
+
+static int usb_hotplug_find(usb_hotplug_queue *queue, libusb_device *dev) {
+	for (int i = 0; i < queue->count; i++) {
+		if (queue->devices[i] == dev)
+			return i;
+	}
+	return -1;
+}
+
+static void usb_hotplug_push(usb_hotplug_queue *queue, libusb_device *dev) {
+	if (usb_hotplug_find(queue, dev) >= 0)
+		return;
+	if (queue->count == queue->size) {
+		queue->size = queue->size ? 2 * queue->size : 8;
+		queue->devices = realloc(queue->devices, queue->size * sizeof(libusb_device *));
+		assert(queue->devices != NULL);
+	}
+	queue->devices[queue->count++] = libusb_ref_device(dev);
+}
+
+static void usb_hotplug_clear(usb_hotplug_queue *queue) {
+	for (int i = 0; i < queue->count; i++)
+		libusb_unref_device(queue->devices[i]);
+	free(queue->devices);
+	memset(queue, 0, sizeof(usb_hotplug_queue));
+}
+
+static void usb_hotplug_queue_event(usb_hotplug_handler *handler, libusb_device *dev, bool arrived) {
+	if (arrived) {
+		usb_hotplug_push(&handler->arrived, dev);
+	} else {
+		// device arrived and left within the same burst is never reported
+		int index = usb_hotplug_find(&handler->arrived, dev);
+		if (index >= 0) {
+			libusb_unref_device(handler->arrived.devices[index]);
+			handler->arrived.devices[index] = handler->arrived.devices[--handler->arrived.count];
+			return;
+		}
+		usb_hotplug_push(&handler->left, dev);
+	}
+	double now = usb_hotplug_time();
+	if (usb_hotplug_first == 0) {
+		usb_hotplug_first = now;
+		pthread_cond_broadcast(&usb_hotplug_cond);
+	}
+	usb_hotplug_last = now;
+}
+
+static int usb_hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
+	pthread_mutex_lock(&usb_hotplug_mutex);
+	for (int i = 0; i < USB_HOTPLUG_MAX_HANDLERS; i++) {
+		usb_hotplug_handler *handler = usb_hotplug_handlers + i;
+		if (handler->used && usb_hotplug_match(handler, dev))
+			usb_hotplug_queue_event(handler, dev, event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED);
+	}
+	pthread_mutex_unlock(&usb_hotplug_mutex);
+	return 0;
+}
+
+static void *usb_hotplug_worker(usb_hotplug_handler *handler) {
+	pthread_mutex_lock(&usb_hotplug_mutex);
+	usb_hotplug_queue left = handler->left, arrived = handler->arrived;
+	memset(&handler->left, 0, sizeof(usb_hotplug_queue));
+	memset(&handler->arrived, 0, sizeof(usb_hotplug_queue));
+	pthread_mutex_unlock(&usb_hotplug_mutex);
+	if (left.count > 0) {
+		INDIGO_DEBUG(indigo_debug("%s: %d USB device(s) left", handler->name, left.count));
+		handler->callback(false, left.devices, left.count);
+	}
+	if (arrived.count > 0) {
+		INDIGO_DEBUG(indigo_debug("%s: %d USB device(s) arrived", handler->name, arrived.count));
+		handler->callback(true, arrived.devices, arrived.count);
+	}
+	usb_hotplug_clear(&left);
+	usb_hotplug_clear(&arrived);
+	pthread_mutex_lock(&usb_hotplug_mutex);
+	handler->busy = false;
+	// both dispatcher and indigo_remove_usb_hotplug_handler() may wait on the condition
+	pthread_cond_broadcast(&usb_hotplug_cond);
+	pthread_mutex_unlock(&usb_hotplug_mutex);
+	return NULL;
+}
+
+static void usb_hotplug_wait(double deadline) {
+#ifdef __APPLE__
+	double delay = deadline - usb_hotplug_time();
+	if (delay > 0) {
+		struct timespec timeout = { (time_t)delay, (long)((delay - (time_t)delay) * 1e9) };
+		pthread_cond_timedwait_relative_np(&usb_hotplug_cond, &usb_hotplug_mutex, &timeout);
+	}
+#else
+	struct timespec timeout = { (time_t)deadline, (long)((deadline - (time_t)deadline) * 1e9) };
+	pthread_cond_timedwait(&usb_hotplug_cond, &usb_hotplug_mutex, &timeout);
+#endif
+}
+
+static void *usb_hotplug_dispatcher(void *arg) {
+	pthread_mutex_lock(&usb_hotplug_mutex);
+	while (true) {
+		if (usb_hotplug_first == 0) {
+			pthread_cond_wait(&usb_hotplug_cond, &usb_hotplug_mutex);
+			continue;
+		}
+		double now = usb_hotplug_time();
+		double deadline = fmin(usb_hotplug_last + USB_HOTPLUG_SETTLE_TIME, usb_hotplug_first + USB_HOTPLUG_MAX_DELAY);
+		if (now < deadline) {
+			usb_hotplug_wait(deadline);
+			continue;
+		}
+		bool pending = false;
+		for (int i = 0; i < USB_HOTPLUG_MAX_HANDLERS; i++) {
+			usb_hotplug_handler *handler = usb_hotplug_handlers + i;
+			if (!handler->used || (handler->arrived.count == 0 && handler->left.count == 0))
+				continue;
+			// events for handler still busy with previous burst wait for the next round
+			if (handler->busy) {
+				pending = true;
+				continue;
+			}
+			handler->busy = true;
+			indigo_async((void *(*)(void *))usb_hotplug_worker, handler);
+		}
+		usb_hotplug_first = usb_hotplug_last = pending ? now : 0;
+	}
+	pthread_mutex_unlock(&usb_hotplug_mutex);
+	return NULL;
+}
+
+indigo_result indigo_add_usb_hotplug_handler(const char *name, int vendor_id, const int *product_ids, int product_id_count, indigo_usb_hotplug_callback callback, int *handle) {
+	assert(callback != NULL);
+	indigo_start_usb_event_handler();
+	pthread_mutex_lock(&usb_hotplug_mutex);
+	if (!usb_hotplug_started) {
+		pthread_condattr_t attr;
+		pthread_condattr_init(&attr);
+#ifndef __APPLE__
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+		pthread_cond_init(&usb_hotplug_cond, &attr);
+		pthread_condattr_destroy(&attr);
+		int rc = libusb_hotplug_register_callback(NULL, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, 0, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, usb_hotplug_callback, NULL, &usb_hotplug_handle);
+		if (rc < 0) {
+			pthread_cond_destroy(&usb_hotplug_cond);
+			pthread_mutex_unlock(&usb_hotplug_mutex);
+			INDIGO_ERROR(indigo_error("%s: libusb_hotplug_register_callback() -> %s", name, libusb_error_name(rc)));
+			return INDIGO_FAILED;
+		}
+		indigo_async(usb_hotplug_dispatcher, NULL);
+		usb_hotplug_started = true;
+	}
+	usb_hotplug_handler *handler = NULL;
+	for (int i = 0; i < USB_HOTPLUG_MAX_HANDLERS; i++) {
+		if (!usb_hotplug_handlers[i].used) {
+			handler = usb_hotplug_handlers + i;
+			*handle = i;
+			break;
+		}
+	}
+	if (handler == NULL) {
+		pthread_mutex_unlock(&usb_hotplug_mutex);
+		INDIGO_ERROR(indigo_error("%s: no USB hotplug handler slot available", name));
+		return INDIGO_FAILED;
+	}
+	memset(handler, 0, sizeof(usb_hotplug_handler));
+	handler->used = true;
+	strncpy(handler->name, name, INDIGO_NAME_SIZE - 1);
+	handler->vendor_id = vendor_id;
+	handler->callback = callback;
+	if (product_id_count > 0) {
+		handler->product_ids = malloc(product_id_count * sizeof(int));
+		assert(handler->product_ids != NULL);
+		memcpy(handler->product_ids, product_ids, product_id_count * sizeof(int));
+		handler->product_id_count = product_id_count;
+	}
+	pthread_mutex_unlock(&usb_hotplug_mutex);
+	// devices already present are reported as arrived with the first burst, device list is not read under the lock
+	// as libusb may call usb_hotplug_callback() while holding its own locks
+	libusb_device **list;
+	ssize_t count = libusb_get_device_list(NULL, &list);
+	if (count >= 0) {
+		pthread_mutex_lock(&usb_hotplug_mutex);
+		for (ssize_t i = 0; i < count; i++) {
+			if (usb_hotplug_match(handler, list[i]))
+				usb_hotplug_queue_event(handler, list[i], true);
+		}
+		pthread_mutex_unlock(&usb_hotplug_mutex);
+		libusb_free_device_list(list, 1);
+	}
+	return INDIGO_OK;
+}
+
+void indigo_remove_usb_hotplug_handler(int handle) {
+	if (handle < 0 || handle >= USB_HOTPLUG_MAX_HANDLERS)
+		return;
+	usb_hotplug_handler *handler = usb_hotplug_handlers + handle;
+	pthread_mutex_lock(&usb_hotplug_mutex);
+	while (handler->busy)
+		pthread_cond_wait(&usb_hotplug_cond, &usb_hotplug_mutex);
+	handler->used = false;
+	usb_hotplug_clear(&handler->arrived);
+	usb_hotplug_clear(&handler->left);
+	free(handler->product_ids);
+	handler->product_ids = NULL;
+	handler->product_id_count = 0;
+	pthread_mutex_unlock(&usb_hotplug_mutex);
+}
+
+void indigo_init_poll_policy(indigo_poll_policy *policy, double moving_interval, double idle_interval, double max_interval) {
+	memset(policy, 0, sizeof(indigo_poll_policy));
+	policy->moving_interval = moving_interval;
+	policy->idle_interval = idle_interval;
+	policy->max_interval = max_interval < idle_interval ? idle_interval : max_interval;
+	policy->interval = idle_interval;
+}
+
+void indigo_poll_policy_add_property(indigo_poll_policy *policy, indigo_property *property) {
+	if (property != NULL && policy->count < INDIGO_POLL_POLICY_MAX_PROPERTIES)
+		policy->properties[policy->count++] = property;
+}
+
+static uint32_t poll_policy_checksum(uint32_t checksum, const void *data, size_t size) {
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < size; i++)
+		checksum = (checksum ^ bytes[i]) * 16777619;
+	return checksum;
+}
+
+double indigo_poll_policy_interval(indigo_poll_policy *policy) {
+	uint32_t checksum = 2166136261;
+	bool moving = false;
+	for (int i = 0; i < policy->count; i++) {
+		indigo_property *property = policy->properties[i];
+		moving |= property->state == INDIGO_BUSY_STATE;
+		checksum = poll_policy_checksum(checksum, &property->state, sizeof(property->state));
+		for (int j = 0; j < property->count; j++) {
+			indigo_item *item = property->items + j;
+			switch (property->type) {
+				case INDIGO_TEXT_VECTOR:
+					checksum = poll_policy_checksum(checksum, item->text.value, strlen(item->text.value));
+					break;
+				case INDIGO_NUMBER_VECTOR:
+					checksum = poll_policy_checksum(checksum, &item->number.value, sizeof(item->number.value));
+					break;
+				case INDIGO_SWITCH_VECTOR:
+					checksum = poll_policy_checksum(checksum, &item->sw.value, sizeof(item->sw.value));
+					break;
+				case INDIGO_LIGHT_VECTOR:
+					checksum = poll_policy_checksum(checksum, &item->light.value, sizeof(item->light.value));
+					break;
+				default:
+					break;
+			}
+		}
+	}
+	if (moving)
+		policy->interval = policy->moving_interval;
+	else if (policy->refresh || checksum != policy->checksum)
+		policy->interval = policy->idle_interval;
+	else if ((policy->interval *= 2) > policy->max_interval)
+		policy->interval = policy->max_interval;
+	policy->checksum = checksum;
+	policy->refresh = false;
+	return policy->interval;
+}
+
+bool indigo_poll_policy_reschedule(indigo_device *device, indigo_poll_policy *policy, indigo_timer **timer) {
+	double interval = indigo_poll_policy_interval(policy);
+	// timer woken up by refresh while the poll was in progress keeps its short delay
+	if (*timer != NULL && (*timer)->rescheduled)
+		return true;
+	return indigo_reschedule_timer(device, interval, timer);
+}
+
+bool indigo_poll_policy_refresh(indigo_device *device, indigo_poll_policy *policy, indigo_timer **timer) {
+	policy->refresh = true;
+	return indigo_wake_timer(device, policy->moving_interval, timer);
+}
+
 double indigo_stod(char *string) {
 	char copy[128];
 	strncpy(copy, string, 128);
@@ -168,6 +168,10 @@ extern "C" {
 	
 #define CONFIG_READER								"CONFIG_READER"
 
+/** Suffix of binary config store file, XML .config files are imported on first load.
+ */
+#define INDIGO_CONFIG_STORE_SUFFIX	".store"
+
 /** Device interface (value shout be used for INFO_DEVICE_INTERFACE_ITEM->number.value
  */
 typedef enum {
@@ -227,6 +231,23 @@ typedef struct {
 	indigo_property *device_auth_property;		///< SECURITY property pointer
 } indigo_device_context;
 
+/** Maximal number of properties watched by poll policy.
+ */
+#define INDIGO_POLL_POLICY_MAX_PROPERTIES	16
+
+/** Adaptive polling policy structure.
+ */
+typedef struct {
+	double moving_interval;                   ///< interval used while any watched property is busy
+	double idle_interval;                     ///< interval used after watched values changed
+	double max_interval;                      ///< limit for exponential backoff while values are unchanged
+	double interval;                          ///< current interval
+	bool refresh;                             ///< refresh after command was requested
+	uint32_t checksum;                        ///< checksum of watched values from the last poll
+	int count;                                ///< number of watched properties
+	indigo_property *properties[INDIGO_POLL_POLICY_MAX_PROPERTIES]; ///< watched properties
+} indigo_poll_policy;
+
 /** log macros
 */
 
@@ -282,11 +303,16 @@ extern indigo_result indigo_device_change_property(indigo_device *device, indigo
  */
 extern indigo_result indigo_device_detach(indigo_device *device);
 
-/** Open config file.
+/** Open config file. Files opened for writing are created as temporary files and committed by indigo_close_config_file().
  */
 
 extern int indigo_open_config_file(char *device_name, int profile, int mode, const char *suffix);
 
+/** Close config file, file opened for writing is synced and atomically renamed to its final name.
+ */
+
+extern indigo_result indigo_close_config_file(int handle);
+
 /** Load properties.
  */
 extern indigo_result indigo_load_properties(indigo_device *device, bool default_properties);
@@ -299,10 +325,50 @@ extern indigo_result indigo_save_property(indigo_device*device, int *file_handle
  */
 extern indigo_result indigo_remove_properties(indigo_device *device);
 
+/** Initialize poll policy, interval starts at idle_interval.
+ */
+extern void indigo_init_poll_policy(indigo_poll_policy *policy, double moving_interval, double idle_interval, double max_interval);
+
+/** Add property to poll policy, its values and state are compared between polls.
+ */
+extern void indigo_poll_policy_add_property(indigo_poll_policy *policy, indigo_property *property);
+
+/** Compute next poll interval: moving_interval while any watched property is busy, idle_interval after a change, otherwise the interval is doubled up to max_interval.
+ */
+extern double indigo_poll_policy_interval(indigo_poll_policy *policy);
+
+/** Reschedule polling timer with the next interval, should be called at the end of the polling timer callback.
+ */
+extern bool indigo_poll_policy_reschedule(indigo_device *device, indigo_poll_policy *policy, indigo_timer **timer);
+
+/** Wake polling timer to poll after moving_interval and reset backoff, should be called after a command changing watched values was sent.
+ */
+extern bool indigo_poll_policy_refresh(indigo_device *device, indigo_poll_policy *policy, indigo_timer **timer);
+
 /** Start USB event handler thread.
  */
 extern void indigo_start_usb_event_handler(void);
 
+/** Match any vendor ID in USB hotplug handler.
+ */
+#define INDIGO_USB_MATCH_ANY		-1
+
+struct libusb_device;
+
+/** USB hotplug callback, called on a worker thread once per burst of hotplug events with all matching devices that arrived or left.
+ Devices are referenced only for the duration of the call.
+ */
+typedef void (*indigo_usb_hotplug_callback)(bool arrived, struct libusb_device **devices, int count);
+
+/** Register USB hotplug handler for vendor ID and table of product IDs (any product if product_id_count is 0). Devices already
+ present are reported as arrived.
+ */
+extern indigo_result indigo_add_usb_hotplug_handler(const char *name, int vendor_id, const int *product_ids, int product_id_count, indigo_usb_hotplug_callback callback, int *handle);
+
+/** Remove USB hotplug handler, waits for a running callback to finish.
+ */
+extern void indigo_remove_usb_hotplug_handler(int handle);
+
 /** Convert sexagesimal string to double.
  */
 extern double indigo_stod(char *string);
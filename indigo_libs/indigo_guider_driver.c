@@ -32,10 +32,345 @@
 #include <time.h>
 #include <math.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/stat.h>
 
 #include "indigo_guider_driver.h"
 
+// -------------------------------------------------------------------------------- guide pulse engine
+
+// Edges are applied on a single thread, the thread sleeps on condition until PULSE_SPIN_MARGIN before the deadline and spins the rest.
+// Stop deadline is counted from the moment the start edge was output, so width is not affected by output latency.
+// Engine thread only toggles outputs, finished pulses are queued and reported in order by normal priority reporter thread,
+// so real-time thread never waits for property updates or report_mutex held by client requests.
+// Final state of the pulse and busy state of the request which re-armed the axis are reported under report_mutex,
+// final state is reported only if axis generation didn't change meanwhile.
+
+#define PULSE_START_LEAD		0.001
+#define PULSE_SPIN_MARGIN		0.0005
+#define PULSE_REPORT_QUEUE		16
+
+#define DEC_AXIS	0
+#define RA_AXIS		1
+
+typedef enum {
+	PULSE_IDLE,
+	PULSE_PENDING,
+	PULSE_ACTIVE
+} pulse_state;
+
+typedef struct {
+	int mask;																	///< directions of the axis
+	pulse_state state;												///< pending start edge or active pulse
+	int direction;														///< requested direction
+	double duration;													///< requested duration in seconds
+	double deadline;													///< monotonic time of the next edge
+	double started;														///< monotonic time when start edge was output
+	bool failed;															///< output failed during the pulse
+	unsigned generation;											///< incremented by each request
+} pulse_axis;
+
+typedef struct {
+	int axis;																	///< axis of finished pulse
+	unsigned generation;											///< axis generation of finished pulse
+	double width;															///< measured width in seconds
+	bool failed;															///< output failed during the pulse
+} pulse_report;
+
+struct indigo_guider_pulse_engine {
+	indigo_device *device;
+	indigo_guider_pulse_output output;
+	pthread_t thread;
+	pthread_t reporter;
+	pthread_mutex_t mutex;
+	pthread_mutex_t report_mutex;
+	pthread_cond_t cond;
+	pthread_cond_t report_cond;
+	bool running;
+	int directions;
+	pulse_axis axis[2];
+	pulse_report reports[PULSE_REPORT_QUEUE];
+	int report_head;
+	int report_count;
+};
+
+static double monotonic_time() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void wait_until(indigo_guider_pulse_engine *engine, double deadline) {
+#ifdef __APPLE__
+	double delay = deadline - monotonic_time();
+	if (delay > 0) {
+		struct timespec timeout = { (time_t)delay, (long)((delay - (time_t)delay) * 1e9) };
+		pthread_cond_timedwait_relative_np(&engine->cond, &engine->mutex, &timeout);
+	}
+#else
+	struct timespec timeout = { (time_t)deadline, (long)((deadline - (time_t)deadline) * 1e9) };
+	pthread_cond_timedwait(&engine->cond, &engine->mutex, &timeout);
+#endif
+}
+
+static void pulse_finished(indigo_device *device, int axis, double width, bool failed, bool current) {
+	if (current) {
+		indigo_property *property = axis == DEC_AXIS ? GUIDER_GUIDE_DEC_PROPERTY : GUIDER_GUIDE_RA_PROPERTY;
+		property->items[0].number.value = property->items[1].number.value = 0;
+		property->state = failed ? INDIGO_ALERT_STATE : INDIGO_OK_STATE;
+		indigo_update_property(device, property, NULL);
+	}
+	if (!failed) {
+		(axis == DEC_AXIS ? GUIDER_PULSE_WIDTH_DEC_ITEM : GUIDER_PULSE_WIDTH_RA_ITEM)->number.value = width * 1000;
+		GUIDER_PULSE_WIDTH_PROPERTY->state = INDIGO_OK_STATE;
+		indigo_update_property(device, GUIDER_PULSE_WIDTH_PROPERTY, NULL);
+	}
+}
+
+static void queue_report(indigo_guider_pulse_engine *engine, int axis, unsigned generation, double width, bool failed) {
+	if (engine->report_count == PULSE_REPORT_QUEUE) {
+		// reporter is far behind, oldest report is dropped
+		engine->report_head = (engine->report_head + 1) % PULSE_REPORT_QUEUE;
+		engine->report_count--;
+	}
+	pulse_report *report = engine->reports + (engine->report_head + engine->report_count) % PULSE_REPORT_QUEUE;
+	report->axis = axis;
+	report->generation = generation;
+	report->width = width;
+	report->failed = failed;
+	engine->report_count++;
+	pthread_cond_signal(&engine->report_cond);
+}
+
+static void *pulse_reporter_thread(indigo_guider_pulse_engine *engine) {
+	pthread_mutex_lock(&engine->mutex);
+	while (true) {
+		while (engine->running && engine->report_count == 0)
+			pthread_cond_wait(&engine->report_cond, &engine->mutex);
+		if (engine->report_count == 0)
+			break;
+		pulse_report report = engine->reports[engine->report_head];
+		engine->report_head = (engine->report_head + 1) % PULSE_REPORT_QUEUE;
+		engine->report_count--;
+		pthread_mutex_unlock(&engine->mutex);
+		pthread_mutex_lock(&engine->report_mutex);
+		pthread_mutex_lock(&engine->mutex);
+		bool current = engine->axis[report.axis].generation == report.generation;
+		pthread_mutex_unlock(&engine->mutex);
+		pulse_finished(engine->device, report.axis, report.width, report.failed, current);
+		pthread_mutex_unlock(&engine->report_mutex);
+		pthread_mutex_lock(&engine->mutex);
+	}
+	pthread_mutex_unlock(&engine->mutex);
+	return NULL;
+}
+
+static void *pulse_engine_thread(indigo_guider_pulse_engine *engine) {
+	indigo_device *device = engine->device;
+	struct sched_param param = { 0 };
+	param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+	if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+		INDIGO_DEBUG(indigo_debug("%s: guide pulse engine runs without real-time priority", device->name));
+	pthread_mutex_lock(&engine->mutex);
+	while (engine->running) {
+		double now = monotonic_time();
+		double next = 0;
+		int directions = engine->directions;
+		bool due[2] = { false, false };
+		unsigned generation[2];
+		for (int i = 0; i < 2; i++) {
+			pulse_axis *axis = engine->axis + i;
+			if (axis->state == PULSE_IDLE)
+				continue;
+			if (axis->deadline <= now) {
+				directions &= ~axis->mask;
+				if (axis->state == PULSE_PENDING)
+					directions |= axis->direction;
+				due[i] = true;
+				generation[i] = axis->generation;
+			} else if (next == 0 || axis->deadline < next) {
+				next = axis->deadline;
+			}
+		}
+		if (due[DEC_AXIS] || due[RA_AXIS]) {
+			pthread_mutex_unlock(&engine->mutex);
+			bool result = engine->output(device, directions);
+			double time = monotonic_time();
+			if (!result)
+				INDIGO_ERROR(indigo_error("%s: failed to set guide outputs 0x%02x", device->name, directions));
+			pthread_mutex_lock(&engine->mutex);
+			engine->directions = directions;
+			for (int i = 0; i < 2; i++) {
+				pulse_axis *axis = engine->axis + i;
+				// request received during output is handled in the next round
+				if (!due[i] || axis->generation != generation[i])
+					continue;
+				if (axis->state == PULSE_PENDING) {
+					axis->state = PULSE_ACTIVE;
+					axis->started = time;
+					axis->deadline = time + axis->duration;
+					axis->failed = !result;
+				} else {
+					axis->state = PULSE_IDLE;
+					queue_report(engine, i, generation[i], time - axis->started, axis->failed || !result);
+				}
+			}
+		} else if (next == 0) {
+			pthread_cond_wait(&engine->cond, &engine->mutex);
+		} else if (next - now > PULSE_SPIN_MARGIN) {
+			wait_until(engine, next - PULSE_SPIN_MARGIN);
+		} else {
+			pthread_mutex_unlock(&engine->mutex);
+			while (monotonic_time() < next)
+				;
+			pthread_mutex_lock(&engine->mutex);
+		}
+	}
+	pthread_mutex_unlock(&engine->mutex);
+	return NULL;
+}
+
+indigo_result indigo_guider_start_pulse_engine(indigo_device *device, indigo_guider_pulse_output output) {
+	assert(device != NULL);
+	assert(output != NULL);
+	if (GUIDER_CONTEXT->pulse_engine != NULL)
+		return INDIGO_OK;
+	indigo_guider_pulse_engine *engine = malloc(sizeof(indigo_guider_pulse_engine));
+	assert(engine != NULL);
+	memset(engine, 0, sizeof(indigo_guider_pulse_engine));
+	engine->device = device;
+	engine->output = output;
+	engine->running = true;
+	engine->axis[DEC_AXIS].mask = INDIGO_GUIDE_NORTH | INDIGO_GUIDE_SOUTH;
+	engine->axis[RA_AXIS].mask = INDIGO_GUIDE_EAST | INDIGO_GUIDE_WEST;
+	pthread_mutex_init(&engine->mutex, NULL);
+	// recursive, client may request next pulse from the update of the previous one
+	pthread_mutexattr_t mutex_attr;
+	pthread_mutexattr_init(&mutex_attr);
+	pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&engine->report_mutex, &mutex_attr);
+	pthread_mutexattr_destroy(&mutex_attr);
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+#ifndef __APPLE__
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+	pthread_cond_init(&engine->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_cond_init(&engine->report_cond, NULL);
+	if (pthread_create(&engine->reporter, NULL, (void *(*)(void *))pulse_reporter_thread, engine) != 0) {
+		pthread_cond_destroy(&engine->report_cond);
+		pthread_cond_destroy(&engine->cond);
+		pthread_mutex_destroy(&engine->report_mutex);
+		pthread_mutex_destroy(&engine->mutex);
+		free(engine);
+		return INDIGO_FAILED;
+	}
+	if (pthread_create(&engine->thread, NULL, (void *(*)(void *))pulse_engine_thread, engine) != 0) {
+		pthread_mutex_lock(&engine->mutex);
+		engine->running = false;
+		pthread_cond_signal(&engine->report_cond);
+		pthread_mutex_unlock(&engine->mutex);
+		pthread_join(engine->reporter, NULL);
+		pthread_cond_destroy(&engine->report_cond);
+		pthread_cond_destroy(&engine->cond);
+		pthread_mutex_destroy(&engine->report_mutex);
+		pthread_mutex_destroy(&engine->mutex);
+		free(engine);
+		return INDIGO_FAILED;
+	}
+	GUIDER_PULSE_WIDTH_PROPERTY->hidden = false;
+	GUIDER_CONTEXT->pulse_engine = engine;
+	return INDIGO_OK;
+}
+
+void indigo_guider_stop_pulse_engine(indigo_device *device) {
+	assert(device != NULL);
+	indigo_guider_pulse_engine *engine = GUIDER_CONTEXT->pulse_engine;
+	if (engine == NULL)
+		return;
+	GUIDER_CONTEXT->pulse_engine = NULL;
+	pthread_mutex_lock(&engine->mutex);
+	engine->running = false;
+	pthread_cond_signal(&engine->cond);
+	pthread_cond_signal(&engine->report_cond);
+	pthread_mutex_unlock(&engine->mutex);
+	pthread_join(engine->thread, NULL);
+	pthread_join(engine->reporter, NULL);
+	if (engine->directions)
+		engine->output(device, 0);
+	pthread_cond_destroy(&engine->report_cond);
+	pthread_cond_destroy(&engine->cond);
+	pthread_mutex_destroy(&engine->report_mutex);
+	pthread_mutex_destroy(&engine->mutex);
+	free(engine);
+}
+
+indigo_result indigo_guider_pulse(indigo_device *device, int dec_direction, double dec_duration, int ra_direction, double ra_duration) {
+	assert(device != NULL);
+	indigo_guider_pulse_engine *engine = GUIDER_CONTEXT->pulse_engine;
+	if (engine == NULL)
+		return INDIGO_FAILED;
+	int directions[2] = { dec_direction, ra_direction };
+	double durations[2] = { dec_duration, ra_duration };
+	pthread_mutex_lock(&engine->mutex);
+	double now = monotonic_time();
+	double start = now + PULSE_START_LEAD;
+	for (int i = 0; i < 2; i++) {
+		// join start edge already pending on the other axis
+		if (engine->axis[i].state == PULSE_PENDING && engine->axis[i].deadline < start)
+			start = engine->axis[i].deadline;
+	}
+	for (int i = 0; i < 2; i++) {
+		pulse_axis *axis = engine->axis + i;
+		if ((directions[i] & axis->mask) == 0)
+			continue;
+		axis->generation++;
+		if (durations[i] > 0) {
+			axis->state = PULSE_PENDING;
+			axis->direction = directions[i] & axis->mask;
+			axis->duration = durations[i] / 1000;
+			axis->deadline = start;
+		} else if (axis->state == PULSE_ACTIVE) {
+			axis->deadline = now;
+		} else {
+			axis->state = PULSE_IDLE;
+		}
+	}
+	pthread_cond_signal(&engine->cond);
+	pthread_mutex_unlock(&engine->mutex);
+	return INDIGO_OK;
+}
+
+static void guide_axis_changed(indigo_device *device, indigo_property *property, indigo_property *new_property, int axis) {
+	indigo_property_copy_values(property, new_property, false);
+	int direction = axis == DEC_AXIS ? INDIGO_GUIDE_NORTH : INDIGO_GUIDE_EAST;
+	double duration = property->items[0].number.value;
+	if (duration <= 0) {
+		direction = axis == DEC_AXIS ? INDIGO_GUIDE_SOUTH : INDIGO_GUIDE_WEST;
+		duration = property->items[1].number.value;
+	}
+	// property is updated before the request, so short pulse can't finish before it is reported busy
+	indigo_guider_pulse_engine *engine = GUIDER_CONTEXT->pulse_engine;
+	pthread_mutex_lock(&engine->report_mutex);
+	if (duration > 0) {
+		property->state = INDIGO_BUSY_STATE;
+	} else {
+		duration = 0;
+		property->items[0].number.value = property->items[1].number.value = 0;
+		property->state = INDIGO_OK_STATE;
+	}
+	indigo_update_property(device, property, NULL);
+	if (axis == DEC_AXIS)
+		indigo_guider_pulse(device, direction, duration, 0, 0);
+	else
+		indigo_guider_pulse(device, 0, 0, direction, duration);
+	pthread_mutex_unlock(&engine->report_mutex);
+}
+
+// --------------------------------------------------------------------------------
+
 indigo_result indigo_guider_attach(indigo_device *device, unsigned version) {
 	assert(device != NULL);
 	assert(device != NULL);
@@ -66,6 +401,13 @@ indigo_result indigo_guider_attach(indigo_device *device, unsigned version) {
 			GUIDER_RATE_PROPERTY->count = 1;
 			indigo_init_number_item(GUIDER_RATE_ITEM, GUIDER_RATE_ITEM_NAME, "Guiding rate (% of sidereal)", 10, 90, 0, 50);
 			indigo_init_number_item(GUIDER_DEC_RATE_ITEM, GUIDER_DEC_RATE_ITEM_NAME, "DEC Guiding rate (% of sidereal)", 10, 90, 0, 50);
+			// -------------------------------------------------------------------------------- GUIDER_PULSE_WIDTH
+			GUIDER_PULSE_WIDTH_PROPERTY = indigo_init_number_property(NULL, device->name, GUIDER_PULSE_WIDTH_PROPERTY_NAME, GUIDER_MAIN_GROUP, "Last pulse width", INDIGO_OK_STATE, INDIGO_RO_PERM, 2);
+			if (GUIDER_PULSE_WIDTH_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			GUIDER_PULSE_WIDTH_PROPERTY->hidden = true;
+			indigo_init_number_item(GUIDER_PULSE_WIDTH_DEC_ITEM, GUIDER_PULSE_WIDTH_DEC_ITEM_NAME, "DEC pulse width (ms)", 0, 10000, 0, 0);
+			indigo_init_number_item(GUIDER_PULSE_WIDTH_RA_ITEM, GUIDER_PULSE_WIDTH_RA_ITEM_NAME, "RA pulse width (ms)", 0, 10000, 0, 0);
 			// --------------------------------------------------------------------------------
 			return INDIGO_OK;
 		}
@@ -83,6 +425,8 @@ indigo_result indigo_guider_enumerate_properties(indigo_device *device, indigo_c
 			indigo_define_property(device, GUIDER_GUIDE_RA_PROPERTY, NULL);
 		if (indigo_property_match(GUIDER_RATE_PROPERTY, property))
 			indigo_define_property(device, GUIDER_RATE_PROPERTY, NULL);
+		if (indigo_property_match(GUIDER_PULSE_WIDTH_PROPERTY, property))
+			indigo_define_property(device, GUIDER_PULSE_WIDTH_PROPERTY, NULL);
 	}
 	return indigo_device_enumerate_properties(device, client, property);
 }
@@ -97,11 +441,21 @@ indigo_result indigo_guider_change_property(indigo_device *device, indigo_client
 			indigo_define_property(device, GUIDER_GUIDE_DEC_PROPERTY, NULL);
 			indigo_define_property(device, GUIDER_GUIDE_RA_PROPERTY, NULL);
 			indigo_define_property(device, GUIDER_RATE_PROPERTY, NULL);
+			indigo_define_property(device, GUIDER_PULSE_WIDTH_PROPERTY, NULL);
 		} else {
 			indigo_delete_property(device, GUIDER_GUIDE_DEC_PROPERTY, NULL);
 			indigo_delete_property(device, GUIDER_GUIDE_RA_PROPERTY, NULL);
 			indigo_delete_property(device, GUIDER_RATE_PROPERTY, NULL);
+			indigo_delete_property(device, GUIDER_PULSE_WIDTH_PROPERTY, NULL);
 		}
+	} else if (GUIDER_CONTEXT->pulse_engine != NULL && indigo_property_match(GUIDER_GUIDE_DEC_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- GUIDER_GUIDE_DEC
+		guide_axis_changed(device, GUIDER_GUIDE_DEC_PROPERTY, property, DEC_AXIS);
+		return INDIGO_OK;
+	} else if (GUIDER_CONTEXT->pulse_engine != NULL && indigo_property_match(GUIDER_GUIDE_RA_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- GUIDER_GUIDE_RA
+		guide_axis_changed(device, GUIDER_GUIDE_RA_PROPERTY, property, RA_AXIS);
+		return INDIGO_OK;
 		// --------------------------------------------------------------------------------
 	}
 	return indigo_device_change_property(device, client, property);
@@ -109,9 +463,11 @@ indigo_result indigo_guider_change_property(indigo_device *device, indigo_client
 
 indigo_result indigo_guider_detach(indigo_device *device) {
 	assert(device != NULL);
+	indigo_guider_stop_pulse_engine(device);
 	indigo_release_property(GUIDER_GUIDE_DEC_PROPERTY);
 	indigo_release_property(GUIDER_GUIDE_RA_PROPERTY);
 	indigo_release_property(GUIDER_RATE_PROPERTY);
+	indigo_release_property(GUIDER_PULSE_WIDTH_PROPERTY);
 	return indigo_device_detach(device);
 }
 
@@ -77,6 +77,30 @@ extern "C" {
  */
 #define GUIDER_DEC_RATE_ITEM               		(GUIDER_RATE_PROPERTY->items+1)
 
+/** GUIDER_PULSE_WIDTH property pointer, property is optional, it is defined for drivers using guide pulse engine.
+ */
+#define GUIDER_PULSE_WIDTH_PROPERTY					(GUIDER_CONTEXT->guider_pulse_width_property)
+
+/** GUIDER_PULSE_WIDTH.DEC property item pointer.
+ */
+#define GUIDER_PULSE_WIDTH_DEC_ITEM					(GUIDER_PULSE_WIDTH_PROPERTY->items+0)
+
+/** GUIDER_PULSE_WIDTH.RA property item pointer.
+ */
+#define GUIDER_PULSE_WIDTH_RA_ITEM					(GUIDER_PULSE_WIDTH_PROPERTY->items+1)
+
+/** Guide pulse directions, bit mask passed to pulse engine output function.
+ */
+#define INDIGO_GUIDE_NORTH		0x01
+#define INDIGO_GUIDE_SOUTH		0x02
+#define INDIGO_GUIDE_EAST			0x04
+#define INDIGO_GUIDE_WEST			0x08
+
+/** Guide pulse engine output function prototype, called from engine thread with all directions which should be active.
+ */
+typedef bool (*indigo_guider_pulse_output)(indigo_device *device, int directions);
+
+typedef struct indigo_guider_pulse_engine indigo_guider_pulse_engine;
 
 	
 /** Guider device context structure.
@@ -86,6 +110,8 @@ typedef struct {
 	indigo_property *guider_guide_dec_property;   ///< GUIDER_GUIDE_DEC property pointer
 	indigo_property *guider_guide_ra_property;    ///< GUIDER_GUIDE_RA property pointer
 	indigo_property *guider_rate_property;  			///< GUIDER_RATE property pointer
+	indigo_property *guider_pulse_width_property;	///< GUIDER_PULSE_WIDTH property pointer
+	indigo_guider_pulse_engine *pulse_engine;			///< guide pulse engine (if started)
 } indigo_guider_context;
 
 /** Attach callback function.
@@ -101,6 +127,20 @@ extern indigo_result indigo_guider_change_property(indigo_device *device, indigo
  */
 extern indigo_result indigo_guider_detach(indigo_device *device);
 
+/** Start guide pulse engine. Pulse start and stop edges are scheduled on a single high priority thread at absolute monotonic deadlines
+ and passed to output function, GUIDER_GUIDE_DEC and GUIDER_GUIDE_RA change requests are then handled by indigo_guider_change_property().
+ */
+extern indigo_result indigo_guider_start_pulse_engine(indigo_device *device, indigo_guider_pulse_output output);
+
+/** Stop guide pulse engine, active pulses are terminated.
+ */
+extern void indigo_guider_stop_pulse_engine(indigo_device *device);
+
+/** Request guide pulses, durations are in ms. Direction 0 leaves the axis untouched, zero duration terminates pulse on the axis.
+ RA and DEC pulses requested by the same or immediately following calls start at the same edge.
+ */
+extern indigo_result indigo_guider_pulse(indigo_device *device, int dec_direction, double dec_duration, int ra_direction, double ra_duration);
+
 #ifdef __cplusplus
 }
 #endif
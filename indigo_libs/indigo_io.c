@@ -35,6 +35,9 @@
 #if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
 #include <unistd.h>
 #include <termios.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
 #include <netdb.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -225,3 +228,168 @@ int indigo_scanf(int handle, const char *format, ...) {
 	va_end(args);
 	return count;
 }
+
+#if defined(INDIGO_LINUX) || defined(INDIGO_MACOS)
+
+static long long monotonic_ms() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+static int wait_for_input(int handle, long long deadline) {
+	while (true) {
+		long long remains = deadline - monotonic_ms();
+		struct pollfd fd = { handle, POLLIN, 0 };
+		int result = poll(&fd, 1, remains > 0 ? (int)remains : 0);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result > 0 && !(fd.revents & POLLIN)) {
+			errno = ECONNRESET;
+			return -1;
+		}
+		return result;
+	}
+}
+
+static bool is_datagram(int handle) {
+	int type = 0;
+	socklen_t length = sizeof(type);
+	return getsockopt(handle, SOL_SOCKET, SO_TYPE, &type, &length) == 0 && type == SOCK_DGRAM;
+}
+
+bool indigo_drain(int handle) {
+	if (isatty(handle))
+		return tcflush(handle, TCIFLUSH) == 0;
+	char buffer[256];
+	while (true) {
+		int available = 0;
+		if (ioctl(handle, FIONREAD, &available) < 0)
+			return false;
+		if (available <= 0)
+			return true;
+		if (read(handle, buffer, available < sizeof(buffer) ? available : sizeof(buffer)) <= 0)
+			return false;
+	}
+}
+
+// Terminated responses are read byte by byte not to consume data following terminator, fixed length responses and
+// datagrams are read in one call.
+
+int indigo_read_response(int handle, char *buffer, int length, const char *terminators, int timeout, int byte_timeout) {
+	bool bulk = terminators == NULL || is_datagram(handle);
+	long long deadline = monotonic_ms() + timeout;
+	int count = 0;
+	bool terminated = false;
+	while (!terminated && count < length - 1) {
+		int result = wait_for_input(handle, deadline);
+		if (result == 0) {
+			if (count > 0 && byte_timeout > 0)
+				break;
+			errno = ETIMEDOUT;
+		}
+		long bytes_read = result > 0 ? read(handle, buffer + count, bulk ? length - 1 - count : 1) : -1;
+		if (bytes_read == 0)
+			errno = ECONNRESET;
+		if (bytes_read <= 0) {
+			buffer[count] = 0;
+			INDIGO_TRACE_PROTOCOL(indigo_trace("%d → %s", handle, errno == ETIMEDOUT ? "TIMEOUT" : "ERROR"));
+			return -1;
+		}
+		if (terminators != NULL) {
+			for (int i = count; i < count + bytes_read; i++) {
+				if (buffer[i] && strchr(terminators, buffer[i])) {
+					bytes_read = i - count;
+					terminated = true;
+					break;
+				}
+			}
+		}
+		count += bytes_read;
+		if (byte_timeout > 0)
+			deadline = monotonic_ms() + byte_timeout;
+	}
+	buffer[count] = 0;
+	INDIGO_TRACE_PROTOCOL(indigo_trace("%d → %s", handle, buffer));
+	return count;
+}
+
+int indigo_transact(int handle, pthread_mutex_t *mutex, const indigo_transaction *transaction, const char *command, char *response, int length) {
+	int result = -1;
+	if (mutex != NULL)
+		pthread_mutex_lock(mutex);
+	for (int attempt = 0; attempt <= transaction->retries; attempt++) {
+		if (!indigo_drain(handle))
+			break;
+		if (command != NULL) {
+			INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s", handle, command));
+			if (!indigo_write(handle, command, strlen(command)))
+				break;
+		}
+		if (transaction->delay > 0)
+			usleep(transaction->delay);
+		if (response == NULL) {
+			result = 0;
+			break;
+		}
+		result = indigo_read_response(handle, response, length, transaction->terminators, transaction->timeout, transaction->byte_timeout);
+		if (result >= 0 || errno != ETIMEDOUT)
+			break;
+	}
+	if (mutex != NULL)
+		pthread_mutex_unlock(mutex);
+	return result;
+}
+
+// Commands are concatenated to as few writes as possible (one datagram per command on datagram sockets), responses
+// must be framed by terminator or fixed length so they can be split, only the last one may be ended by byte_timeout gap.
+
+int indigo_transact_batch(int handle, pthread_mutex_t *mutex, const indigo_transaction *transaction, indigo_batch_command *commands, int count) {
+	int completed = 0;
+	bool datagram = is_datagram(handle);
+	for (int i = 0; i < count; i++)
+		commands[i].result = -1;
+	if (mutex != NULL)
+		pthread_mutex_lock(mutex);
+	for (int attempt = 0; attempt <= transaction->retries && completed < count; attempt++) {
+		if (!indigo_drain(handle))
+			break;
+		char buffer[1024];
+		long length = 0;
+		bool failed = false;
+		for (int i = completed; i < count && !failed; i++) {
+			long command_length = strlen(commands[i].command);
+			if (length > 0 && (datagram || length + command_length > sizeof(buffer))) {
+				failed = !indigo_write(handle, buffer, length);
+				length = 0;
+			}
+			INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s", handle, commands[i].command));
+			if (command_length > sizeof(buffer)) {
+				failed = failed || !indigo_write(handle, commands[i].command, command_length);
+			} else {
+				memcpy(buffer + length, commands[i].command, command_length);
+				length += command_length;
+			}
+		}
+		if (failed || (length > 0 && !indigo_write(handle, buffer, length)))
+			break;
+		if (transaction->delay > 0)
+			usleep(transaction->delay);
+		for (; completed < count; completed++) {
+			indigo_batch_command *command = commands + completed;
+			if (command->response == NULL) {
+				command->result = 0;
+				continue;
+			}
+			command->result = indigo_read_response(handle, command->response, command->length, transaction->terminators, transaction->timeout, transaction->byte_timeout);
+			if (command->result < 0)
+				break;
+		}
+		if (completed < count && errno != ETIMEDOUT)
+			break;
+	}
+	if (mutex != NULL)
+		pthread_mutex_unlock(mutex);
+	return completed;
+}
+#endif
@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -72,7 +73,42 @@ extern bool indigo_printf(int handle, const char *format, ...);
  */
 
 extern int indigo_scanf(int handle, const char *format, ...);
-	
+
+/** Command/response transaction framing and timing.
+ */
+typedef struct {
+	const char *terminators;	///< characters terminating response (not stored), NULL for fixed length response
+	int timeout;							///< time to wait for response [ms]
+	int byte_timeout;					///< if > 0, gap between bytes ending unterminated response [ms], otherwise whole response must arrive within timeout
+	int delay;								///< delay between command and response [us]
+	int retries;							///< number of repeated attempts if response times out
+} indigo_transaction;
+
+/** Discard pending input without waiting (tcflush() on serial ports, FIONREAD sized reads on sockets).
+ */
+extern bool indigo_drain(int handle);
+
+/** Read NUL terminated response framed by terminators or buffer length with deadline, returns response length or -1 (errno is ETIMEDOUT if response didn't arrive in time).
+ */
+extern int indigo_read_response(int handle, char *buffer, int length, const char *terminators, int timeout, int byte_timeout);
+
+/** Drain input, write command, read response and retry on timeout, all with mutex locked (if not NULL), returns response length or -1.
+ */
+extern int indigo_transact(int handle, pthread_mutex_t *mutex, const indigo_transaction *transaction, const char *command, char *response, int length);
+
+/** Command of transaction batch.
+ */
+typedef struct {
+	const char *command;			///< command
+	char *response;						///< response buffer, NULL if command has no response
+	int length;								///< response buffer size, response without terminator must fill it exactly
+	int result;								///< response length or -1 if response was not received
+} indigo_batch_command;
+
+/** Write all commands back to back and demultiplex their responses in order, commands without response are resent on retry only if they follow timed out one, returns number of completed commands.
+ */
+extern int indigo_transact_batch(int handle, pthread_mutex_t *mutex, const indigo_transaction *transaction, indigo_batch_command *commands, int count);
+
 #ifdef __cplusplus
 }
 #endif
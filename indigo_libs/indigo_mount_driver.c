@@ -40,6 +40,8 @@
 #include "indigo_agent.h"
 
 
+#define DEG2RAD (M_PI / 180.0)
+
 static double indigo_range24(double ha) {
 	if (ha < 0.0)
 		ha += 24.0;
@@ -48,6 +50,137 @@ static double indigo_range24(double ha) {
 	return ha;
 }
 
+// Kinematic model used to publish predicted position between polls. While mount is slewing or moving, rates are measured
+// from successive reported positions, otherwise they follow tracking state (RA of stopped mount drifts with LST).
+
+#define SIDEREAL_RATE						(1.00273790935 / 3600.0)
+#define SOLAR_RATE							(24.0 / 365.2422 / 86400.0)
+#define LUNAR_RATE							(24.0 / 27.321662 / 86400.0)
+#define MIN_RATE_INTERVAL				0.1
+#define MIN_PREDICTION_CHANGE		(0.05 / 3600.0)
+
+static double indigo_monotonic_time() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static double indigo_range12(double delta) {
+	if (delta > 12.0)
+		delta -= 24.0;
+	if (delta < -12.0)
+		delta += 24.0;
+	return delta;
+}
+
+static void indigo_update_kinematic_model(indigo_device *device) {
+	double now = indigo_monotonic_time();
+	double ra = MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value;
+	double dec = MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value;
+	pthread_mutex_lock(&MOUNT_CONTEXT->interpolation_mutex);
+	if (MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state == INDIGO_BUSY_STATE || MOUNT_MOTION_NORTH_ITEM->sw.value || MOUNT_MOTION_SOUTH_ITEM->sw.value || MOUNT_MOTION_WEST_ITEM->sw.value || MOUNT_MOTION_EAST_ITEM->sw.value) {
+		double elapsed = now - MOUNT_CONTEXT->fix_time;
+		if (MOUNT_CONTEXT->fix_time == 0) {
+			MOUNT_CONTEXT->ra_rate = MOUNT_CONTEXT->dec_rate = 0;
+		} else if (elapsed >= MIN_RATE_INTERVAL) {
+			MOUNT_CONTEXT->ra_rate = indigo_range12(ra - MOUNT_CONTEXT->fix_ra) / elapsed;
+			MOUNT_CONTEXT->dec_rate = (dec - MOUNT_CONTEXT->fix_dec) / elapsed;
+		}
+	} else {
+		if (MOUNT_TRACKING_OFF_ITEM->sw.value)
+			MOUNT_CONTEXT->ra_rate = SIDEREAL_RATE;
+		else if (MOUNT_TRACK_RATE_SOLAR_ITEM->sw.value)
+			MOUNT_CONTEXT->ra_rate = SOLAR_RATE;
+		else if (MOUNT_TRACK_RATE_LUNAR_ITEM->sw.value)
+			MOUNT_CONTEXT->ra_rate = LUNAR_RATE;
+		else
+			MOUNT_CONTEXT->ra_rate = 0;
+		MOUNT_CONTEXT->dec_rate = 0;
+	}
+	MOUNT_CONTEXT->fix_ra = MOUNT_CONTEXT->predicted_ra = ra;
+	MOUNT_CONTEXT->fix_dec = MOUNT_CONTEXT->predicted_dec = dec;
+	MOUNT_CONTEXT->fix_time = now;
+	pthread_mutex_unlock(&MOUNT_CONTEXT->interpolation_mutex);
+}
+
+static bool indigo_predict_coordinates(indigo_device *device, double *ra, double *dec) {
+	bool result = false;
+	pthread_mutex_lock(&MOUNT_CONTEXT->interpolation_mutex);
+	double elapsed = indigo_monotonic_time() - MOUNT_CONTEXT->fix_time;
+	if (MOUNT_CONTEXT->fix_time > 0 && elapsed <= MOUNT_INTERPOLATION_LIMIT_ITEM->number.value) {
+		double delta_ra = MOUNT_CONTEXT->ra_rate * elapsed;
+		double delta_dec = MOUNT_CONTEXT->dec_rate * elapsed;
+		if (MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state == INDIGO_BUSY_STATE) {
+			//  Slew to target doesn't overshoot, manual motion has no target
+			if (!MOUNT_MOTION_WEST_ITEM->sw.value && !MOUNT_MOTION_EAST_ITEM->sw.value) {
+				double remaining = indigo_range12(MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.target - MOUNT_CONTEXT->fix_ra);
+				if (remaining * delta_ra >= 0 && fabs(delta_ra) > fabs(remaining))
+					delta_ra = remaining;
+			}
+			if (!MOUNT_MOTION_NORTH_ITEM->sw.value && !MOUNT_MOTION_SOUTH_ITEM->sw.value) {
+				double remaining = MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.target - MOUNT_CONTEXT->fix_dec;
+				if (remaining * delta_dec >= 0 && fabs(delta_dec) > fabs(remaining))
+					delta_dec = remaining;
+			}
+		}
+		*ra = indigo_range24(MOUNT_CONTEXT->fix_ra + indigo_range12(delta_ra));
+		*dec = fmax(-90.0, fmin(90.0, MOUNT_CONTEXT->fix_dec + delta_dec));
+		if (fabs(indigo_range12(*ra - MOUNT_CONTEXT->predicted_ra)) * 15.0 >= MIN_PREDICTION_CHANGE || fabs(*dec - MOUNT_CONTEXT->predicted_dec) >= MIN_PREDICTION_CHANGE) {
+			MOUNT_CONTEXT->predicted_ra = *ra;
+			MOUNT_CONTEXT->predicted_dec = *dec;
+			result = true;
+		}
+	}
+	pthread_mutex_unlock(&MOUNT_CONTEXT->interpolation_mutex);
+	return result;
+}
+
+static void mount_interpolation_timer_callback(indigo_device *device) {
+	if (!IS_CONNECTED || MOUNT_INTERPOLATION_RATE_ITEM->number.value <= 0)
+		return;
+	double ra, dec;
+	if (indigo_predict_coordinates(device, &ra, &dec)) {
+		//  Predicted position is published from copies, so the values reported by mount are left untouched
+		indigo_property *equatorial = MOUNT_CONTEXT->interpolated_equatorial_property;
+		memcpy(equatorial, MOUNT_EQUATORIAL_COORDINATES_PROPERTY, sizeof(indigo_property) + equatorial->count * sizeof(indigo_item));
+		equatorial->items[0].number.value = ra;
+		equatorial->items[1].number.value = dec;
+		indigo_update_property(device, equatorial, NULL);
+		if (!MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY->hidden && !MOUNT_HORIZONTAL_COORDINATES_PROPERTY->hidden) {
+			indigo_property *horizontal = MOUNT_CONTEXT->interpolated_horizontal_property;
+			memcpy(horizontal, MOUNT_HORIZONTAL_COORDINATES_PROPERTY, sizeof(indigo_property) + horizontal->count * sizeof(indigo_item));
+			indigo_eq2hor(MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value, MOUNT_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value, MOUNT_GEOGRAPHIC_COORDINATES_ELEVATION_ITEM->number.value, ra, dec, &horizontal->items[1].number.value, &horizontal->items[0].number.value);
+			horizontal->state = equatorial->state;
+			indigo_update_property(device, horizontal, NULL);
+		}
+	}
+	indigo_reschedule_timer(device, 1 / MOUNT_INTERPOLATION_RATE_ITEM->number.value, &MOUNT_CONTEXT->interpolation_timer);
+}
+
+static bool indigo_reserve_alignment_points(indigo_device *device, int count) {
+	if (count <= MOUNT_CONTEXT->alignment_point_capacity)
+		return true;
+	if (count > MOUNT_MAX_ALIGNMENT_POINTS)
+		return false;
+	int capacity = MOUNT_CONTEXT->alignment_point_capacity;
+	while (capacity < count)
+		capacity += MOUNT_ALIGNMENT_POINTS_BLOCK;
+	if (capacity > MOUNT_MAX_ALIGNMENT_POINTS)
+		capacity = MOUNT_MAX_ALIGNMENT_POINTS;
+	indigo_alignment_point *points = realloc(MOUNT_CONTEXT->alignment_points, capacity * sizeof(indigo_alignment_point));
+	if (points == NULL)
+		return false;
+	MOUNT_CONTEXT->alignment_points = points;
+	int select_count = MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY->count;
+	MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY = indigo_resize_property(MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY, capacity);
+	MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY->count = select_count;
+	int delete_count = MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY->count;
+	MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY = indigo_resize_property(MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY, capacity);
+	MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY->count = delete_count;
+	MOUNT_CONTEXT->alignment_point_capacity = capacity;
+	return true;
+}
+
 indigo_result indigo_mount_attach(indigo_device *device, unsigned version) {
 	assert(device != NULL);
 	assert(device != NULL);
@@ -204,7 +337,7 @@ indigo_result indigo_mount_attach(indigo_device *device, unsigned version) {
 			MOUNT_ALIGNMENT_MODE_PROPERTY->hidden = true;
 			indigo_init_switch_item(MOUNT_ALIGNMENT_MODE_SINGLE_POINT_ITEM, MOUNT_ALIGNMENT_MODE_SINGLE_POINT_ITEM_NAME, "Single point", false);
 			indigo_init_switch_item(MOUNT_ALIGNMENT_MODE_NEAREST_POINT_ITEM, MOUNT_ALIGNMENT_MODE_NEAREST_POINT_ITEM_NAME, "Nearest point", false);
-			indigo_init_switch_item(MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM, MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM_NAME, "Multi point", false);
+			indigo_init_switch_item(MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM, MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM_NAME, "Multi point (fitted model)", false);
 			indigo_init_switch_item(MOUNT_ALIGNMENT_MODE_CONTROLLER_ITEM, MOUNT_ALIGNMENT_MODE_CONTROLLER_ITEM_NAME, "Mount controller", true); // check MOUNT_ALIGNMENT_SELECT_POINTS and MOUNT_ALIGNMENT_DELETE_POINTS if default is changed
 			// -------------------------------------------------------------------------------- MOUNT_RAW_COORDINATES
 			MOUNT_RAW_COORDINATES_PROPERTY = indigo_init_number_property(NULL, device->name, MOUNT_RAW_COORDINATES_PROPERTY_NAME, MOUNT_ALIGNMENT_GROUP, "Raw coordinates", INDIGO_OK_STATE, INDIGO_RO_PERM, 2);
@@ -214,13 +347,17 @@ indigo_result indigo_mount_attach(indigo_device *device, unsigned version) {
 			indigo_init_sexagesimal_number_item(MOUNT_RAW_COORDINATES_RA_ITEM, MOUNT_RAW_COORDINATES_RA_ITEM_NAME, "Raw right ascension (0 to 24 hrs)", 0, 24, 0, 0);
 			indigo_init_sexagesimal_number_item(MOUNT_RAW_COORDINATES_DEC_ITEM, MOUNT_RAW_COORDINATES_DEC_ITEM_NAME, "Raw declination (-90 to 90°)", -90, 90, 0, 90);
 			// -------------------------------------------------------------------------------- MOUNT_ALIGNMENT_SELECT_POINTS
-			MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY = indigo_init_switch_property(NULL, device->name, MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY_NAME, MOUNT_ALIGNMENT_GROUP, "Select alignment points", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, MOUNT_MAX_ALIGNMENT_POINTS);
+			MOUNT_CONTEXT->alignment_points = malloc(MOUNT_ALIGNMENT_POINTS_BLOCK * sizeof(indigo_alignment_point));
+			if (MOUNT_CONTEXT->alignment_points == NULL)
+				return INDIGO_FAILED;
+			MOUNT_CONTEXT->alignment_point_capacity = MOUNT_ALIGNMENT_POINTS_BLOCK;
+			MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY = indigo_init_switch_property(NULL, device->name, MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY_NAME, MOUNT_ALIGNMENT_GROUP, "Select alignment points", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, MOUNT_ALIGNMENT_POINTS_BLOCK);
 			if (MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY == NULL)
 				return INDIGO_FAILED;
 			MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY->hidden = MOUNT_ALIGNMENT_MODE_CONTROLLER_ITEM->sw.value;
 			MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY->count = 0;
 			// -------------------------------------------------------------------------------- MOUNT_ALIGNMENT_DELETE_POINTS
-			MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY = indigo_init_switch_property(NULL, device->name, MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY_NAME, MOUNT_ALIGNMENT_GROUP, "Delete alignment point", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, MOUNT_MAX_ALIGNMENT_POINTS);
+			MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY = indigo_init_switch_property(NULL, device->name, MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY_NAME, MOUNT_ALIGNMENT_GROUP, "Delete alignment point", INDIGO_OK_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, MOUNT_ALIGNMENT_POINTS_BLOCK);
 			if (MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY == NULL)
 				return INDIGO_FAILED;
 			MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY->hidden = MOUNT_ALIGNMENT_MODE_CONTROLLER_ITEM->sw.value;
@@ -239,6 +376,17 @@ indigo_result indigo_mount_attach(indigo_device *device, unsigned version) {
 			MOUNT_SIDE_OF_PIER_PROPERTY->hidden = true;
 			indigo_init_switch_item(MOUNT_SIDE_OF_PIER_EAST_ITEM, MOUNT_SIDE_OF_PIER_EAST_ITEM_NAME, "East", true);
 			indigo_init_switch_item(MOUNT_SIDE_OF_PIER_WEST_ITEM, MOUNT_SIDE_OF_PIER_WEST_ITEM_NAME, "West", false);
+			// -------------------------------------------------------------------------------- MOUNT_INTERPOLATION
+			MOUNT_INTERPOLATION_PROPERTY = indigo_init_number_property(NULL, device->name, MOUNT_INTERPOLATION_PROPERTY_NAME, MOUNT_MAIN_GROUP, "Coordinates interpolation", INDIGO_OK_STATE, INDIGO_RW_PERM, 2);
+			if (MOUNT_INTERPOLATION_PROPERTY == NULL)
+				return INDIGO_FAILED;
+			indigo_init_number_item(MOUNT_INTERPOLATION_RATE_ITEM, MOUNT_INTERPOLATION_RATE_ITEM_NAME, "Update rate (0 = off, Hz)", 0, 20, 1, 0);
+			indigo_init_number_item(MOUNT_INTERPOLATION_LIMIT_ITEM, MOUNT_INTERPOLATION_LIMIT_ITEM_NAME, "Max. prediction (s)", 1, 60, 1, 5);
+			MOUNT_CONTEXT->interpolated_equatorial_property = indigo_init_number_property(NULL, device->name, MOUNT_EQUATORIAL_COORDINATES_PROPERTY_NAME, MOUNT_MAIN_GROUP, "", INDIGO_OK_STATE, INDIGO_RW_PERM, MOUNT_EQUATORIAL_COORDINATES_PROPERTY->count);
+			MOUNT_CONTEXT->interpolated_horizontal_property = indigo_init_number_property(NULL, device->name, MOUNT_HORIZONTAL_COORDINATES_PROPERTY_NAME, MOUNT_MAIN_GROUP, "", INDIGO_OK_STATE, INDIGO_RO_PERM, MOUNT_HORIZONTAL_COORDINATES_PROPERTY->count);
+			if (MOUNT_CONTEXT->interpolated_equatorial_property == NULL || MOUNT_CONTEXT->interpolated_horizontal_property == NULL)
+				return INDIGO_FAILED;
+			pthread_mutex_init(&MOUNT_CONTEXT->interpolation_mutex, NULL);
 			// -------------------------------------------------------------------------------- SNOOP_DEVICES
 			MOUNT_SNOOP_DEVICES_PROPERTY = indigo_init_text_property(NULL, device->name, SNOOP_DEVICES_PROPERTY_NAME, MAIN_GROUP, "Snoop devices", INDIGO_OK_STATE, INDIGO_RW_PERM, 2);
 			if (MOUNT_SNOOP_DEVICES_PROPERTY == NULL)
@@ -259,6 +407,10 @@ void indigo_mount_load_alignment_points(indigo_device *device) {
 		char buffer[1024], name[INDIGO_NAME_SIZE], label[INDIGO_VALUE_SIZE];
 		indigo_read_line(handle, buffer, sizeof(buffer));
 		sscanf(buffer, "%d", &count);
+		if (count > MOUNT_MAX_ALIGNMENT_POINTS)
+			count = MOUNT_MAX_ALIGNMENT_POINTS;
+		if (!indigo_reserve_alignment_points(device, count))
+			count = MOUNT_CONTEXT->alignment_point_capacity;
 		MOUNT_CONTEXT->alignment_point_count = count;
 		MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY->count = count;
 		MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY->count = count;
@@ -273,6 +425,7 @@ void indigo_mount_load_alignment_points(indigo_device *device) {
 			indigo_init_switch_item(MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY->items + i, name, label, false);
 		}
 		close(handle);
+		indigo_mount_fit_alignment_model(device);
 		if (IS_CONNECTED) {
 			MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY->state = INDIGO_OK_STATE;
 			indigo_update_property(device, MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY, NULL);
@@ -286,17 +439,22 @@ void indigo_mount_save_alignment_points(indigo_device *device) {
 	int handle = indigo_open_config_file(device->name, 0, O_WRONLY | O_CREAT | O_TRUNC, ".alignment");
 	if (handle > 0) {
 		int count = MOUNT_CONTEXT->alignment_point_count;
-		indigo_printf(handle, "%d\n", count);
+		int size = 16 + count * 128;
+		char *buffer = malloc(size);
+		int length = snprintf(buffer, size, "%d\n", count);
 		for (int i = 0; i < count; i++) {
 			indigo_alignment_point *point =  MOUNT_CONTEXT->alignment_points + i;
-			indigo_printf(handle, "%d %g %g %g %g %g %d\n", point->used, point->ra, point->dec, point->raw_ra, point->raw_dec, point->lst, point->side_of_pier);
+			length += snprintf(buffer + length, size - length, "%d %.10g %.10g %.10g %.10g %.10g %d\n", point->used, point->ra, point->dec, point->raw_ra, point->raw_dec, point->lst, point->side_of_pier);
 		}
-		close(handle);
+		indigo_write(handle, buffer, length);
+		free(buffer);
+		indigo_close_config_file(handle);
 	}
 }
 
 void indigo_mount_update_alignment_points(indigo_device *device) {
 	indigo_mount_save_alignment_points(device);
+	indigo_mount_fit_alignment_model(device);
 	char label[INDIGO_VALUE_SIZE];
 	for (int i = 0; i < MOUNT_CONTEXT->alignment_point_count; i++) {
 		indigo_alignment_point *point =  MOUNT_CONTEXT->alignment_points + i;
@@ -374,6 +532,8 @@ indigo_result indigo_mount_enumerate_properties(indigo_device *device, indigo_cl
 			indigo_define_property(device, MOUNT_EPOCH_PROPERTY, NULL);
 		if (indigo_property_match(MOUNT_SIDE_OF_PIER_PROPERTY, property))
 			indigo_define_property(device, MOUNT_SIDE_OF_PIER_PROPERTY, NULL);
+		if (indigo_property_match(MOUNT_INTERPOLATION_PROPERTY, property))
+			indigo_define_property(device, MOUNT_INTERPOLATION_PROPERTY, NULL);
 		if (indigo_property_match(MOUNT_SNOOP_DEVICES_PROPERTY, property))
 			indigo_define_property(device, MOUNT_SNOOP_DEVICES_PROPERTY, NULL);
 	}
@@ -416,7 +576,11 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 			indigo_define_property(device, MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY, NULL);
 			indigo_define_property(device, MOUNT_EPOCH_PROPERTY, NULL);
 			indigo_define_property(device, MOUNT_SIDE_OF_PIER_PROPERTY, NULL);
+			indigo_define_property(device, MOUNT_INTERPOLATION_PROPERTY, NULL);
 			indigo_define_property(device, MOUNT_SNOOP_DEVICES_PROPERTY, NULL);
+			MOUNT_CONTEXT->fix_time = 0;
+			if (MOUNT_INTERPOLATION_RATE_ITEM->number.value > 0 && MOUNT_CONTEXT->interpolation_timer == NULL)
+				MOUNT_CONTEXT->interpolation_timer = indigo_set_timer(device, 1 / MOUNT_INTERPOLATION_RATE_ITEM->number.value, mount_interpolation_timer_callback);
 			indigo_add_snoop_rule(MOUNT_PARK_PROPERTY, MOUNT_SNOOP_JOYSTICK_ITEM->text.value, MOUNT_PARK_PROPERTY_NAME);
 			indigo_add_snoop_rule(MOUNT_SLEW_RATE_PROPERTY, MOUNT_SNOOP_JOYSTICK_ITEM->text.value, MOUNT_SLEW_RATE_PROPERTY_NAME);
 			indigo_add_snoop_rule(MOUNT_TRACKING_PROPERTY, MOUNT_SNOOP_JOYSTICK_ITEM->text.value, MOUNT_TRACKING_PROPERTY_NAME);
@@ -460,7 +624,9 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 			indigo_delete_property(device, MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY, NULL);
 			indigo_delete_property(device, MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY, NULL);
 			indigo_delete_property(device, MOUNT_EPOCH_PROPERTY, NULL);
+			indigo_cancel_timer(device, &MOUNT_CONTEXT->interpolation_timer);
 			indigo_delete_property(device, MOUNT_SIDE_OF_PIER_PROPERTY, NULL);
+			indigo_delete_property(device, MOUNT_INTERPOLATION_PROPERTY, NULL);
 			indigo_delete_property(device, MOUNT_SNOOP_DEVICES_PROPERTY, NULL);
 		}
 	} else if (indigo_property_match(MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY, property)) {
@@ -468,6 +634,7 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 		indigo_property_copy_values(MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY, property, false);
 		if (MOUNT_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value < 0)
 			MOUNT_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value += 360;
+		indigo_mount_fit_alignment_model(device);
 		indigo_update_coordinates(device, NULL);
 		MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
 		if (IS_CONNECTED) {
@@ -576,6 +743,7 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 			indigo_save_property(device, NULL, MOUNT_ALIGNMENT_MODE_PROPERTY);
 			indigo_save_property(device, NULL, MOUNT_PARK_POSITION_PROPERTY);
 			indigo_save_property(device, NULL, MOUNT_EPOCH_PROPERTY);
+			indigo_save_property(device, NULL, MOUNT_INTERPOLATION_PROPERTY);
 			indigo_mount_save_alignment_points(device);
 		} else if (indigo_switch_match(CONFIG_LOAD_ITEM, property)) {
 			indigo_mount_load_alignment_points(device);
@@ -586,7 +754,7 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 			if (MOUNT_ALIGNMENT_MODE_CONTROLLER_ITEM->sw.value) {
 				MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 				indigo_update_coordinates(device, "SYNC in CONTROLLER mode passed to indigo_mount_change_property");
-			} else if (MOUNT_CONTEXT->alignment_point_count >= MOUNT_MAX_ALIGNMENT_POINTS) {
+			} else if (!indigo_reserve_alignment_points(device, MOUNT_CONTEXT->alignment_point_count + 1)) {
 				MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_ALERT_STATE;
 				indigo_update_coordinates(device, "Too many alignment points");
 			} else {
@@ -624,6 +792,7 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 				}
 
 				indigo_mount_save_alignment_points(device);
+				indigo_mount_fit_alignment_model(device);
 				MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY->count = MOUNT_CONTEXT->alignment_point_count;
 				MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY->state = INDIGO_OK_STATE;
 				indigo_delete_property(device, MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY, NULL);
@@ -702,6 +871,7 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 			}
 		}
 		indigo_mount_save_alignment_points(device);
+		indigo_mount_fit_alignment_model(device);
 		indigo_raw_to_translated(device, MOUNT_RAW_COORDINATES_RA_ITEM->number.value, MOUNT_RAW_COORDINATES_DEC_ITEM->number.value, &MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value, &MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value);
 		indigo_raw_to_translated(device, MOUNT_RAW_COORDINATES_RA_ITEM->number.target, MOUNT_RAW_COORDINATES_DEC_ITEM->number.target, &MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.target, &MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.target);
 		MOUNT_EQUATORIAL_COORDINATES_PROPERTY->state = INDIGO_OK_STATE;
@@ -745,6 +915,18 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 		MOUNT_SIDE_OF_PIER_PROPERTY->state = INDIGO_OK_STATE;
 		indigo_update_property(device, MOUNT_SIDE_OF_PIER_PROPERTY, NULL);
 		return INDIGO_OK;
+	} else if (indigo_property_match(MOUNT_INTERPOLATION_PROPERTY, property)) {
+		// -------------------------------------------------------------------------------- MOUNT_INTERPOLATION
+		indigo_property_copy_values(MOUNT_INTERPOLATION_PROPERTY, property, false);
+		MOUNT_INTERPOLATION_PROPERTY->state = INDIGO_OK_STATE;
+		if (IS_CONNECTED) {
+			if (MOUNT_INTERPOLATION_RATE_ITEM->number.value <= 0)
+				indigo_cancel_timer(device, &MOUNT_CONTEXT->interpolation_timer);
+			else if (MOUNT_CONTEXT->interpolation_timer == NULL)
+				MOUNT_CONTEXT->interpolation_timer = indigo_set_timer(device, 1 / MOUNT_INTERPOLATION_RATE_ITEM->number.value, mount_interpolation_timer_callback);
+			indigo_update_property(device, MOUNT_INTERPOLATION_PROPERTY, NULL);
+		}
+		return INDIGO_OK;
 		// -------------------------------------------------------------------------------- SNOOP_DEVICES
 	} else if (indigo_property_match(MOUNT_SNOOP_DEVICES_PROPERTY, property)) {
 		indigo_remove_snoop_rule(MOUNT_PARK_PROPERTY, MOUNT_SNOOP_JOYSTICK_ITEM->text.value, MOUNT_PARK_PROPERTY_NAME);
@@ -775,6 +957,7 @@ indigo_result indigo_mount_change_property(indigo_device *device, indigo_client
 
 indigo_result indigo_mount_detach(indigo_device *device) {
 	assert(device != NULL);
+	indigo_cancel_timer(device, &MOUNT_CONTEXT->interpolation_timer);
 	indigo_release_property(MOUNT_INFO_PROPERTY);
 	indigo_release_property(MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY);
 	indigo_release_property(MOUNT_LST_TIME_PROPERTY);
@@ -800,7 +983,12 @@ indigo_result indigo_mount_detach(indigo_device *device) {
 	indigo_release_property(MOUNT_RAW_COORDINATES_PROPERTY);
 	indigo_release_property(MOUNT_ALIGNMENT_SELECT_POINTS_PROPERTY);
 	indigo_release_property(MOUNT_ALIGNMENT_DELETE_POINTS_PROPERTY);
+	indigo_release_property(MOUNT_INTERPOLATION_PROPERTY);
+	indigo_release_property(MOUNT_CONTEXT->interpolated_equatorial_property);
+	indigo_release_property(MOUNT_CONTEXT->interpolated_horizontal_property);
 	indigo_release_property(MOUNT_SNOOP_DEVICES_PROPERTY);
+	free(MOUNT_CONTEXT->alignment_points);
+	pthread_mutex_destroy(&MOUNT_CONTEXT->interpolation_mutex);
 	return indigo_device_detach(device);
 }
 
@@ -916,12 +1104,9 @@ static indigo_alignment_point* indigo_nearest_alignment_point(indigo_device* dev
 		if (!point->used)
 			continue;
 
-		//  Compute virtual encoder angles for alignment point
-		double enc_p_ra, enc_p_dec;
-		if (raw)
-			indigo_eq_to_encoder(device, indigo_range24(point->lst - point->raw_ra), point->raw_dec, point->side_of_pier, &enc_p_ra, &enc_p_dec);
-		else
-			indigo_eq_to_encoder(device, indigo_range24(point->lst - point->ra), point->dec, point->side_of_pier, &enc_p_ra, &enc_p_dec);
+		//  Use virtual encoder angles for alignment point cached by indigo_mount_fit_alignment_model()
+		double enc_p_ra = raw ? point->enc_raw_ha : point->enc_ha;
+		double enc_p_dec = raw ? point->enc_raw_dec : point->enc_dec;
 
 		//  Compute separation of encoder angles of RA/DEC and alignment point
 		//  Determine nearest point
@@ -938,24 +1123,188 @@ static indigo_alignment_point* indigo_nearest_alignment_point(indigo_device* dev
 	return nearest_point;
 }
 
+static void indigo_alignment_model_basis(double ha, double dec, double *row_ha, double *row_dec) {
+	//  Keep sec(dec) and tan(dec) terms finite near the pole
+	if (dec > 89.0)
+		dec = 89.0;
+	if (dec < -89.0)
+		dec = -89.0;
+	double sin_ha = sin(ha * DEG2RAD), cos_ha = cos(ha * DEG2RAD);
+	double tan_dec = tan(dec * DEG2RAD), sec_dec = 1.0 / cos(dec * DEG2RAD);
+	//  Terms: IH, ID, CH, NP, MA, ME
+	row_ha[0] = 1;
+	row_ha[1] = 0;
+	row_ha[2] = sec_dec;
+	row_ha[3] = tan_dec;
+	row_ha[4] = -cos_ha * tan_dec;
+	row_ha[5] = sin_ha * tan_dec;
+	row_dec[0] = 0;
+	row_dec[1] = 1;
+	row_dec[2] = 0;
+	row_dec[3] = 0;
+	row_dec[4] = sin_ha;
+	row_dec[5] = cos_ha;
+}
+
+static void indigo_alignment_model_correction(indigo_alignment_model *model, double ha, double dec, double *delta_ha, double *delta_dec) {
+	double row_ha[6], row_dec[6];
+	indigo_alignment_model_basis(ha, dec, row_ha, row_dec);
+	double terms[6] = { model->ih, model->id, model->ch, model->np, model->ma, model->me };
+	*delta_ha = *delta_dec = 0;
+	for (int i = 0; i < 6; i++) {
+		*delta_ha += row_ha[i] * terms[i];
+		*delta_dec += row_dec[i] * terms[i];
+	}
+}
+
+static bool indigo_alignment_model_solve(double a[6][6], double b[6], int n, double *x) {
+	//  Gaussian elimination with partial pivoting on normal equations
+	for (int i = 0; i < n; i++) {
+		int pivot = i;
+		for (int j = i + 1; j < n; j++)
+			if (fabs(a[j][i]) > fabs(a[pivot][i]))
+				pivot = j;
+		if (fabs(a[pivot][i]) < 1e-12)
+			return false;
+		if (pivot != i) {
+			for (int k = 0; k < n; k++) {
+				double tmp = a[i][k]; a[i][k] = a[pivot][k]; a[pivot][k] = tmp;
+			}
+			double tmp = b[i]; b[i] = b[pivot]; b[pivot] = tmp;
+		}
+		for (int j = i + 1; j < n; j++) {
+			double f = a[j][i] / a[i][i];
+			for (int k = i; k < n; k++)
+				a[j][k] -= f * a[i][k];
+			b[j] -= f * b[i];
+		}
+	}
+	for (int i = n - 1; i >= 0; i--) {
+		double sum = b[i];
+		for (int k = i + 1; k < n; k++)
+			sum -= a[i][k] * x[k];
+		x[i] = sum / a[i][i];
+	}
+	return true;
+}
+
+static void indigo_alignment_point_residuals(indigo_alignment_point *point, double *ha, double *delta_ha, double *delta_dec) {
+	*ha = (point->lst - point->ra) * 15.0;
+	double delta = point->ra - point->raw_ra;
+	if (delta > 12.0)
+		delta -= 24.0;
+	if (delta < -12.0)
+		delta += 24.0;
+	*delta_ha = delta * 15.0;
+	*delta_dec = point->raw_dec - point->dec;
+}
+
+static void indigo_fit_alignment_model(indigo_device *device, int side_of_pier, indigo_alignment_model *model) {
+	double ata[6][6] = { 0 }, atb[6] = { 0 }, x[6] = { 0 };
+	int count = 0;
+	memset(model, 0, sizeof(indigo_alignment_model));
+	for (int i = 0; i < MOUNT_CONTEXT->alignment_point_count; i++) {
+		indigo_alignment_point *point = MOUNT_CONTEXT->alignment_points + i;
+		if (!point->used || (side_of_pier >= 0 && point->side_of_pier != side_of_pier))
+			continue;
+		double ha, delta_ha, delta_dec, row_ha[6], row_dec[6];
+		indigo_alignment_point_residuals(point, &ha, &delta_ha, &delta_dec);
+		indigo_alignment_model_basis(ha, point->dec, row_ha, row_dec);
+		for (int j = 0; j < 6; j++) {
+			for (int k = 0; k < 6; k++)
+				ata[j][k] += row_ha[j] * row_ha[k] + row_dec[j] * row_dec[k];
+			atb[j] += row_ha[j] * delta_ha + row_dec[j] * delta_dec;
+		}
+		count++;
+	}
+	if (count == 0)
+		return;
+	//  Full model needs at least 3 points, fall back to index terms only for fewer points or degenerate geometry
+	bool solved = false;
+	if (count >= 3) {
+		double a[6][6], b[6];
+		memcpy(a, ata, sizeof(a));
+		memcpy(b, atb, sizeof(b));
+		solved = indigo_alignment_model_solve(a, b, 6, x);
+	}
+	if (!solved) {
+		memset(x, 0, sizeof(x));
+		if (!indigo_alignment_model_solve(ata, atb, 2, x))
+			return;
+	}
+	model->ih = x[0];
+	model->id = x[1];
+	model->ch = x[2];
+	model->np = x[3];
+	model->ma = x[4];
+	model->me = x[5];
+	model->count = count;
+	model->valid = true;
+	double sum = 0;
+	for (int i = 0; i < MOUNT_CONTEXT->alignment_point_count; i++) {
+		indigo_alignment_point *point = MOUNT_CONTEXT->alignment_points + i;
+		if (!point->used || (side_of_pier >= 0 && point->side_of_pier != side_of_pier))
+			continue;
+		double ha, delta_ha, delta_dec, model_ha, model_dec;
+		indigo_alignment_point_residuals(point, &ha, &delta_ha, &delta_dec);
+		indigo_alignment_model_correction(model, ha, point->dec, &model_ha, &model_dec);
+		delta_ha = (delta_ha - model_ha) * cos(point->dec * DEG2RAD);
+		delta_dec -= model_dec;
+		sum += delta_ha * delta_ha + delta_dec * delta_dec;
+	}
+	model->rms = sqrt(sum / count) * 3600.0;
+}
+
+void indigo_mount_fit_alignment_model(indigo_device *device) {
+	for (int i = 0; i < MOUNT_CONTEXT->alignment_point_count; i++) {
+		indigo_alignment_point *point = MOUNT_CONTEXT->alignment_points + i;
+		indigo_eq_to_encoder(device, indigo_range24(point->lst - point->ra), point->dec, point->side_of_pier, &point->enc_ha, &point->enc_dec);
+		indigo_eq_to_encoder(device, indigo_range24(point->lst - point->raw_ra), point->raw_dec, point->side_of_pier, &point->enc_raw_ha, &point->enc_raw_dec);
+	}
+	indigo_alignment_model common;
+	indigo_fit_alignment_model(device, -1, &common);
+	for (int side_of_pier = MOUNT_SIDE_EAST; side_of_pier <= MOUNT_SIDE_WEST; side_of_pier++) {
+		indigo_alignment_model *model = MOUNT_CONTEXT->alignment_models + side_of_pier;
+		indigo_fit_alignment_model(device, side_of_pier, model);
+		if (model->count < 3)
+			*model = common;
+		if (model->valid)
+			INDIGO_DEBUG(indigo_debug("%s: %c model from %d points, IH = %g, ID = %g, CH = %g, NP = %g, MA = %g, ME = %g, RMS = %.1f\"", device->name, side_of_pier == MOUNT_SIDE_EAST ? 'E' : 'W', model->count, model->ih, model->id, model->ch, model->np, model->ma, model->me, model->rms));
+	}
+}
+
+static void indigo_normalize_coordinates(double *ra, double *dec) {
+	if (*ra < 0.0)
+		*ra += 24.0;
+	if (*ra >= 24.0)
+		*ra -= 24.0;
+	if (*dec > 90.0) {
+		*dec = 180.0 - *dec;
+		*ra += 12.0;
+		if (*ra >= 24.0)
+			*ra -= 24.0;
+	}
+	if (*dec < -90.0) {
+		*dec = -180.0 - *dec;
+		*ra += 12.0;
+		if (*ra >= 24.0)
+			*ra -= 24.0;
+	}
+}
+
 //  Called to transform an observed position into a position for mount
 indigo_result indigo_translated_to_raw(indigo_device *device, double ra, double dec, double *raw_ra, double *raw_dec) {
 	if (MOUNT_ALIGNMENT_MODE_CONTROLLER_ITEM->sw.value) {
 		*raw_ra = ra;
 		*raw_dec = dec;
 		return INDIGO_OK;
-	} else if (MOUNT_ALIGNMENT_MODE_NEAREST_POINT_ITEM->sw.value || MOUNT_ALIGNMENT_MODE_SINGLE_POINT_ITEM->sw.value) {
+	} else if (MOUNT_ALIGNMENT_MODE_NEAREST_POINT_ITEM->sw.value || MOUNT_ALIGNMENT_MODE_SINGLE_POINT_ITEM->sw.value || MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM->sw.value) {
 		double lst = indigo_lst(MOUNT_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value);
 		double ha = indigo_range24(lst - ra);
 		if (ha > 12.0)
 			ha -= 24.0;
 		int side_of_pier = (ha >= 0.0) ? MOUNT_SIDE_WEST : MOUNT_SIDE_EAST;
 		return indigo_translated_to_raw_with_lst(device, lst, ra, dec, side_of_pier, raw_ra, raw_dec);
-	} else if (MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM->sw.value) {
-
-		// TBD Rumen
-
-		return INDIGO_OK;
 	}
 	return INDIGO_FAILED;
 }
@@ -1003,9 +1352,16 @@ indigo_result indigo_translated_to_raw_with_lst(indigo_device *device, double ls
 		}
 		return INDIGO_OK;
 	} else if (MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM->sw.value) {
-
-		// TBD Rumen
-
+		indigo_alignment_model *model = MOUNT_CONTEXT->alignment_models + (side_of_pier == MOUNT_SIDE_WEST ? MOUNT_SIDE_WEST : MOUNT_SIDE_EAST);
+		*raw_ra = ra;
+		*raw_dec = dec;
+		if (model->valid) {
+			double delta_ha, delta_dec;
+			indigo_alignment_model_correction(model, (lst - ra) * 15.0, dec, &delta_ha, &delta_dec);
+			*raw_ra = ra - delta_ha / 15.0;
+			*raw_dec = dec + delta_dec;
+			indigo_normalize_coordinates(raw_ra, raw_dec);
+		}
 		return INDIGO_OK;
 	}
 	return INDIGO_FAILED;
@@ -1017,18 +1373,13 @@ indigo_result indigo_raw_to_translated(indigo_device *device, double raw_ra, dou
 		*ra = raw_ra;
 		*dec = raw_dec;
 		return INDIGO_OK;
-	} else if (MOUNT_ALIGNMENT_MODE_NEAREST_POINT_ITEM->sw.value || MOUNT_ALIGNMENT_MODE_SINGLE_POINT_ITEM->sw.value) {
+	} else if (MOUNT_ALIGNMENT_MODE_NEAREST_POINT_ITEM->sw.value || MOUNT_ALIGNMENT_MODE_SINGLE_POINT_ITEM->sw.value || MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM->sw.value) {
 		double lst = indigo_lst(MOUNT_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value);
 		double ha = indigo_range24(lst - raw_ra);
 		if (ha > 12.0)
 			ha -= 24.0;
 		int side_of_pier = (ha >= 0.0) ? MOUNT_SIDE_WEST : MOUNT_SIDE_EAST;
 		return indigo_raw_to_translated_with_lst(device, lst, raw_ra, raw_dec, side_of_pier, ra, dec);
-	} else if (MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM->sw.value) {
-
-		// TBD Rumen
-
-		return INDIGO_OK;
 	}
 	return INDIGO_FAILED;
 }
@@ -1077,15 +1428,28 @@ indigo_result indigo_raw_to_translated_with_lst(indigo_device *device, double ls
 		}
 		return INDIGO_OK;
 	} else if (MOUNT_ALIGNMENT_MODE_MULTI_POINT_ITEM->sw.value) {
-
-		// TBD Rumen
-
+		indigo_alignment_model *model = MOUNT_CONTEXT->alignment_models + (side_of_pier == MOUNT_SIDE_WEST ? MOUNT_SIDE_WEST : MOUNT_SIDE_EAST);
+		*ra = raw_ra;
+		*dec = raw_dec;
+		if (model->valid) {
+			//  Model is defined in observed coordinates, invert it by fixed point iteration
+			double raw_ha = (lst - raw_ra) * 15.0, ha = raw_ha, delta_ha, delta_dec;
+			*dec = raw_dec;
+			for (int i = 0; i < 4; i++) {
+				indigo_alignment_model_correction(model, ha, *dec, &delta_ha, &delta_dec);
+				ha = raw_ha - delta_ha;
+				*dec = raw_dec - delta_dec;
+			}
+			*ra = raw_ra + delta_ha / 15.0;
+			indigo_normalize_coordinates(ra, dec);
+		}
 		return INDIGO_OK;
 	}
 	return INDIGO_FAILED;
 }
 
 void indigo_update_coordinates(indigo_device *device, const char *message) {
+	indigo_update_kinematic_model(device);
 	indigo_update_property(device, MOUNT_EQUATORIAL_COORDINATES_PROPERTY, message);
 	if (!MOUNT_GEOGRAPHIC_COORDINATES_PROPERTY->hidden && !MOUNT_HORIZONTAL_COORDINATES_PROPERTY->hidden) {
 		indigo_eq2hor(MOUNT_GEOGRAPHIC_COORDINATES_LATITUDE_ITEM->number.value, MOUNT_GEOGRAPHIC_COORDINATES_LONGITUDE_ITEM->number.value, MOUNT_GEOGRAPHIC_COORDINATES_ELEVATION_ITEM->number.value, MOUNT_EQUATORIAL_COORDINATES_RA_ITEM->number.value, MOUNT_EQUATORIAL_COORDINATES_DEC_ITEM->number.value, &MOUNT_HORIZONTAL_COORDINATES_ALT_ITEM->number.value, &MOUNT_HORIZONTAL_COORDINATES_AZ_ITEM->number.value);
@@ -407,6 +407,19 @@ extern "C" {
  */
 #define MOUNT_SIDE_OF_PIER_WEST_ITEM									(MOUNT_SIDE_OF_PIER_PROPERTY->items+1)
 
+//------------------------------------------------
+/** MOUNT_INTERPOLATION property pointer, property is optional.
+ */
+#define MOUNT_INTERPOLATION_PROPERTY									(MOUNT_CONTEXT->mount_interpolation_property)
+
+/** MOUNT_INTERPOLATION.RATE property item pointer.
+ */
+#define MOUNT_INTERPOLATION_RATE_ITEM									(MOUNT_INTERPOLATION_PROPERTY->items+0)
+
+/** MOUNT_INTERPOLATION.LIMIT property item pointer.
+ */
+#define MOUNT_INTERPOLATION_LIMIT_ITEM								(MOUNT_INTERPOLATION_PROPERTY->items+1)
+
 //------------------------------------------------
 /** MOUNT_SNOOP_DEVICES property pointer, property is optional.
 */
@@ -425,7 +438,12 @@ extern "C" {
 /** Max number of alignment points.
  */
 
-#define MOUNT_MAX_ALIGNMENT_POINTS										100
+#define MOUNT_MAX_ALIGNMENT_POINTS										1000
+
+/** Number of alignment points allocated at once.
+ */
+
+#define MOUNT_ALIGNMENT_POINTS_BLOCK									100
 
 //------------------------------------------------
 /** Definition of side of pier
@@ -443,15 +461,34 @@ typedef struct {
 	double ra, dec;						//  Where user says it is really pointing
 	double raw_ra, raw_dec;		//  Where mount says it is pointing
 	int side_of_pier;					//  East or West DEC slew?
+	double enc_ha, enc_dec;		//  Cached virtual encoder angles of ra/dec
+	double enc_raw_ha, enc_raw_dec;	//  Cached virtual encoder angles of raw_ra/raw_dec
 } indigo_alignment_point;
 
+/** Fitted pointing model structure (TPOINT-style terms, all values in degrees).
+ */
+
+typedef struct {
+	bool valid;								//  Model is fitted
+	int count;								//  Number of points used for the fit
+	double ih;								//  HA index error
+	double id;								//  DEC index error
+	double ch;								//  Collimation error
+	double np;								//  HA/DEC non-perpendicularity
+	double ma;								//  Polar axis azimuth misalignment
+	double me;								//  Polar axis elevation misalignment
+	double rms;								//  RMS residual of the fit in arcseconds
+} indigo_alignment_model;
+
 //------------------------------------------------
 /** Mount device context structure.
  */
 typedef struct {
 	indigo_device_context device_context;										///< device context base
 	int alignment_point_count;															///< number of defined alignment points
-	indigo_alignment_point alignment_points[MOUNT_MAX_ALIGNMENT_POINTS]; ///< alignment points
+	int alignment_point_capacity;														///< number of allocated alignment points
+	indigo_alignment_point *alignment_points;								///< alignment points
+	indigo_alignment_model alignment_models[2];							///< pointing models fitted for east and west side of pier
 	indigo_property *mount_geographic_coordinates_property;	///< MOUNT_GEOGRAPHIC_COORDINATES property pointer
 	indigo_property *mount_info_property;                   ///< MOUNT_INFO property pointer
 	indigo_property *mount_lst_time_property;								///< MOUNT_LST_TIME property pointer
@@ -480,6 +517,15 @@ typedef struct {
 	indigo_property *mount_epoch_property;									///< MOUNT_EPOCH property pointer
 	indigo_property *mount_side_of_pier_property;						///< MOUNT_SIDE_OF_PIER property pointer
 	indigo_property *mount_snoop_devices_property;					///< MOUNT_SNOOP_DEVICES property pointer
+	indigo_property *mount_interpolation_property;					///< MOUNT_INTERPOLATION property pointer
+	indigo_property *interpolated_equatorial_property;			///< copy of MOUNT_EQUATORIAL_COORDINATES used to publish predicted position
+	indigo_property *interpolated_horizontal_property;			///< copy of MOUNT_HORIZONTAL_COORDINATES used to publish predicted position
+	indigo_timer *interpolation_timer;											///< timer publishing predicted position
+	pthread_mutex_t interpolation_mutex;										///< kinematic model mutex
+	double fix_ra, fix_dec;																	///< last position reported by mount
+	double fix_time;																				///< monotonic time of last reported position (0 if unknown)
+	double ra_rate, dec_rate;																///< predicted motion [h/s, °/s]
+	double predicted_ra, predicted_dec;											///< last published predicted position
 } indigo_mount_context;
 
 /** Attach callback function.
@@ -527,6 +573,11 @@ extern void indigo_mount_save_alignment_points(indigo_device *device);
 
 extern void indigo_mount_update_alignment_points(indigo_device *device);
 
+/** Fit pointing models and cache encoder angles of alignment points, called whenever points are changed.
+ */
+
+extern void indigo_mount_fit_alignment_model(indigo_device *device);
+
 #ifdef __cplusplus
 }
 #endif
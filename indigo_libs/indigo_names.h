@@ -280,6 +280,22 @@
  */
 #define CCD_LOCAL_MODE_PREFIX_ITEM_NAME       "PREFIX"
 
+/** CCD_LOCAL_MODE_WRITE property name.
+ */
+#define CCD_LOCAL_MODE_WRITE_PROPERTY_NAME    "CCD_LOCAL_MODE_WRITE"
+
+/** CCD_LOCAL_MODE_WRITE.BUFFERED property item name.
+ */
+#define CCD_LOCAL_MODE_WRITE_BUFFERED_ITEM_NAME	"BUFFERED"
+
+/** CCD_LOCAL_MODE_WRITE.SYNC property item name.
+ */
+#define CCD_LOCAL_MODE_WRITE_SYNC_ITEM_NAME   "SYNC"
+
+/** CCD_LOCAL_MODE_WRITE.DIRECT property item name.
+ */
+#define CCD_LOCAL_MODE_WRITE_DIRECT_ITEM_NAME	"DIRECT"
+
 //----------------------------------------------------------------------
 /** CCD_EXPOSURE property name.
  */
@@ -543,6 +559,190 @@
  */
 #define CCD_RBI_FLUSH_DISABLED_ITEM_NAME     "DISABLE"
 
+/** CCD_CALIBRATION property name.
+ */
+#define CCD_CALIBRATION_PROPERTY_NAME        "CCD_CALIBRATION"
+
+/** CCD_CALIBRATION.DARK property item name.
+ */
+#define CCD_CALIBRATION_DARK_ITEM_NAME       "DARK"
+
+/** CCD_CALIBRATION.FLAT property item name.
+ */
+#define CCD_CALIBRATION_FLAT_ITEM_NAME       "FLAT"
+
+/** CCD_CALIBRATION_MASTER property name.
+ */
+#define CCD_CALIBRATION_MASTER_PROPERTY_NAME "CCD_CALIBRATION_MASTER"
+
+/** CCD_CALIBRATION_MASTER.NONE property item name.
+ */
+#define CCD_CALIBRATION_MASTER_NONE_ITEM_NAME "NONE"
+
+/** CCD_CALIBRATION_MASTER.DARK property item name.
+ */
+#define CCD_CALIBRATION_MASTER_DARK_ITEM_NAME "DARK"
+
+/** CCD_CALIBRATION_MASTER.FLAT property item name.
+ */
+#define CCD_CALIBRATION_MASTER_FLAT_ITEM_NAME "FLAT"
+
+/** CCD_IMAGE_STATS property name.
+ */
+#define CCD_IMAGE_STATS_PROPERTY_NAME        "CCD_IMAGE_STATS"
+
+/** CCD_IMAGE_STATS.MEAN property item name.
+ */
+#define CCD_IMAGE_STATS_MEAN_ITEM_NAME       "MEAN"
+
+/** CCD_IMAGE_STATS.MEDIAN property item name.
+ */
+#define CCD_IMAGE_STATS_MEDIAN_ITEM_NAME     "MEDIAN"
+
+/** CCD_IMAGE_STATS.NOISE property item name.
+ */
+#define CCD_IMAGE_STATS_NOISE_ITEM_NAME      "NOISE"
+
+/** CCD_IMAGE_STATS.MAX property item name.
+ */
+#define CCD_IMAGE_STATS_MAX_ITEM_NAME        "MAX"
+
+/** CCD_IMAGE_STATS.STARS property item name.
+ */
+#define CCD_IMAGE_STATS_STARS_ITEM_NAME      "STARS"
+
+/** CCD_IMAGE_STATS.HFD property item name.
+ */
+#define CCD_IMAGE_STATS_HFD_ITEM_NAME        "HFD"
+
+/** CCD_IMAGE_STATS.FWHM property item name.
+ */
+#define CCD_IMAGE_STATS_FWHM_ITEM_NAME       "FWHM"
+
+/** CCD_IMAGE_STATS.X property item name.
+ */
+#define CCD_IMAGE_STATS_X_ITEM_NAME          "X"
+
+/** CCD_IMAGE_STATS.Y property item name.
+ */
+#define CCD_IMAGE_STATS_Y_ITEM_NAME          "Y"
+
+/** CCD_IMAGE_STATS_ENABLE property name.
+ */
+#define CCD_IMAGE_STATS_ENABLE_PROPERTY_NAME "CCD_IMAGE_STATS_ENABLE"
+
+/** CCD_IMAGE_STATS_ENABLE.ENABLE property item name.
+ */
+#define CCD_IMAGE_STATS_ENABLED_ITEM_NAME    "ENABLE"
+
+/** CCD_IMAGE_STATS_ENABLE.DISABLE property item name.
+ */
+#define CCD_IMAGE_STATS_DISABLED_ITEM_NAME   "DISABLE"
+
+/** CCD_SOFTWARE_BIN property name.
+ */
+#define CCD_SOFTWARE_BIN_PROPERTY_NAME        "CCD_SOFTWARE_BIN"
+
+/** CCD_SOFTWARE_BIN.HORIZONTAL property item name.
+ */
+#define CCD_SOFTWARE_BIN_HORIZONTAL_ITEM_NAME "HORIZONTAL"
+
+/** CCD_SOFTWARE_BIN.VERTICAL property item name.
+ */
+#define CCD_SOFTWARE_BIN_VERTICAL_ITEM_NAME   "VERTICAL"
+
+/** CCD_SOFTWARE_BIN_MODE property name.
+ */
+#define CCD_SOFTWARE_BIN_MODE_PROPERTY_NAME   "CCD_SOFTWARE_BIN_MODE"
+
+/** CCD_SOFTWARE_BIN_MODE.SUM property item name.
+ */
+#define CCD_SOFTWARE_BIN_SUM_ITEM_NAME        "SUM"
+
+/** CCD_SOFTWARE_BIN_MODE.AVERAGE property item name.
+ */
+#define CCD_SOFTWARE_BIN_AVERAGE_ITEM_NAME    "AVERAGE"
+
+/** CCD_SOFTWARE_FRAME property name.
+ */
+#define CCD_SOFTWARE_FRAME_PROPERTY_NAME      "CCD_SOFTWARE_FRAME"
+
+/** CCD_SOFTWARE_FRAME.LEFT property item name.
+ */
+#define CCD_SOFTWARE_FRAME_LEFT_ITEM_NAME     "LEFT"
+
+/** CCD_SOFTWARE_FRAME.TOP property item name.
+ */
+#define CCD_SOFTWARE_FRAME_TOP_ITEM_NAME      "TOP"
+
+/** CCD_SOFTWARE_FRAME.WIDTH property item name.
+ */
+#define CCD_SOFTWARE_FRAME_WIDTH_ITEM_NAME    "WIDTH"
+
+/** CCD_SOFTWARE_FRAME.HEIGHT property item name.
+ */
+#define CCD_SOFTWARE_FRAME_HEIGHT_ITEM_NAME   "HEIGHT"
+
+/** CCD_DEMOSAIC property name.
+ */
+#define CCD_DEMOSAIC_PROPERTY_NAME            "CCD_DEMOSAIC"
+
+/** CCD_DEMOSAIC.NONE property item name.
+ */
+#define CCD_DEMOSAIC_NONE_ITEM_NAME           "NONE"
+
+/** CCD_DEMOSAIC.BILINEAR property item name.
+ */
+#define CCD_DEMOSAIC_BILINEAR_ITEM_NAME       "BILINEAR"
+
+/** CCD_DEMOSAIC.VNG property item name.
+ */
+#define CCD_DEMOSAIC_VNG_ITEM_NAME            "VNG"
+
+/** CCD_PREVIEW_DEMOSAIC property name.
+ */
+#define CCD_PREVIEW_DEMOSAIC_PROPERTY_NAME    "CCD_PREVIEW_DEMOSAIC"
+
+/** CCD_PREVIEW_DEMOSAIC.NONE property item name.
+ */
+#define CCD_PREVIEW_DEMOSAIC_NONE_ITEM_NAME   "NONE"
+
+/** CCD_PREVIEW_DEMOSAIC.BILINEAR property item name.
+ */
+#define CCD_PREVIEW_DEMOSAIC_BILINEAR_ITEM_NAME "BILINEAR"
+
+/** CCD_PREVIEW_DEMOSAIC.VNG property item name.
+ */
+#define CCD_PREVIEW_DEMOSAIC_VNG_ITEM_NAME    "VNG"
+
+/** CCD_FITS_COMPRESSION property name.
+ */
+#define CCD_FITS_COMPRESSION_PROPERTY_NAME    "CCD_FITS_COMPRESSION"
+
+/** CCD_FITS_COMPRESSION.NONE property item name.
+ */
+#define CCD_FITS_COMPRESSION_NONE_ITEM_NAME   "NONE"
+
+/** CCD_FITS_COMPRESSION.RICE property item name.
+ */
+#define CCD_FITS_COMPRESSION_RICE_ITEM_NAME   "RICE"
+
+/** CCD_XISF_COMPRESSION property name.
+ */
+#define CCD_XISF_COMPRESSION_PROPERTY_NAME    "CCD_XISF_COMPRESSION"
+
+/** CCD_XISF_COMPRESSION.NONE property item name.
+ */
+#define CCD_XISF_COMPRESSION_NONE_ITEM_NAME   "NONE"
+
+/** CCD_XISF_COMPRESSION.LZ4 property item name.
+ */
+#define CCD_XISF_COMPRESSION_LZ4_ITEM_NAME    "LZ4"
+
+/** CCD_XISF_COMPRESSION.ZLIB property item name.
+ */
+#define CCD_XISF_COMPRESSION_ZLIB_ITEM_NAME   "ZLIB"
+
 //----------------------------------------------------------------------
 /** DSLR_PROGRAM property name.
  */
@@ -766,6 +966,19 @@
 #define GUIDER_RATE_ITEM_NAME           			"RATE"
 #define GUIDER_DEC_RATE_ITEM_NAME           	"DEC_RATE"
 
+//----------------------------------------------------------------------
+/** GUIDER_PULSE_WIDTH property name.
+ */
+#define GUIDER_PULSE_WIDTH_PROPERTY_NAME			"GUIDER_PULSE_WIDTH"
+
+/** GUIDER_PULSE_WIDTH.DEC property item name.
+ */
+#define GUIDER_PULSE_WIDTH_DEC_ITEM_NAME			"DEC"
+
+/** GUIDER_PULSE_WIDTH.RA property item name.
+ */
+#define GUIDER_PULSE_WIDTH_RA_ITEM_NAME				"RA"
+
 //----------------------------------------------------------------------
 /** AO_GUIDE_DEC property name
  */
@@ -1467,6 +1680,19 @@
  */
 #define MOUNT_SIDE_OF_PIER_WEST_ITEM_NAME             		"WEST"
 
+//----------------------------------------------------------------------
+/** MOUNT_INTERPOLATION property name.
+ */
+#define MOUNT_INTERPOLATION_PROPERTY_NAME							"MOUNT_INTERPOLATION"
+
+/** MOUNT_INTERPOLATION.RATE property item name.
+ */
+#define MOUNT_INTERPOLATION_RATE_ITEM_NAME             		"RATE"
+
+/** MOUNT_INTERPOLATION.LIMIT property item name.
+ */
+#define MOUNT_INTERPOLATION_LIMIT_ITEM_NAME             	"LIMIT"
+
 //----------------------------------------------------------------------
 /** MOUNT_ALIGNMENT_DELETE_POINTS property name.
  */
@@ -1620,6 +1846,10 @@
  */
 #define DOME_SYNC_THRESHOLD_ITEM_NAME						"SYNC_THRESHOLD"
 
+/** DOME_SYNC_PROPERTY.SYNC_LEAD_TIME property item name.
+ */
+#define DOME_SYNC_LEAD_TIME_ITEM_NAME						"SYNC_LEAD_TIME"
+
 //----------------------------------------------------------------------
 /** DOME_ABORT_MOTION property name.
  */
@@ -24,7 +24,11 @@
  */
 
 #include <time.h>
+#include <math.h>
+#include <string.h>
+#include <pthread.h>
 #include <novas.h>
+#include <novascon.h>
 //#include <eph_manager.h>
 
 #include "indigo_novas.h"
@@ -32,6 +36,13 @@
 static double DELTA_T = 34+32.184+0.477677;
 static double DELTA_UTC_UT1 = -0.477677/86400.0;
 
+#define SIDEREAL_RATE	1.00273790935
+#define DEG2RAD				(M_PI / 180.0)
+#define RAD2DEG				(180.0 / M_PI)
+
+static indigo_novas_context shared_context = { INDIGO_NOVAS_CONTEXT_WINDOW };
+static pthread_mutex_t shared_context_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static void init() {
 //  TBD
 //	static int do_init = 1;
@@ -42,35 +53,175 @@ static void init() {
 //	}
 }
 
+static object earth, sun;
+static pthread_once_t objects_once = PTHREAD_ONCE_INIT;
+
+static void init_objects() {
+	cat_entry dummy;
+	make_cat_entry("DUMMY", "   ", 0, 0, 0, 0, 0, 0, 0, &dummy);
+	make_object(0, 3, "Earth", &dummy, &earth);
+	make_object(0, 10, "Sun", &dummy, &sun);
+}
+
+void indigo_novas_init_context(indigo_novas_context *context, double window) {
+	memset(context, 0, sizeof(indigo_novas_context));
+	context->window = window;
+}
+
+void indigo_novas_update_context(indigo_novas_context *context, double utc) {
+	if (context->valid && fabs(utc - context->utc) <= context->window)
+		return;
+	init();
+	// contexts are updated from many threads, objects must be complete before first use
+	pthread_once(&objects_once, init_objects);
+	double x, secdiff;
+	context->utc = utc;
+	context->jd_ut1 = utc / 86400.0 + 2440587.5 + DELTA_UTC_UT1;
+	context->jd_tt = context->jd_ut1 + DELTA_T / 86400.0;
+	tdb2tt(context->jd_tt, &x, &secdiff);
+	context->jd_tdb = context->jd_tt + secdiff / 86400.0;
+	sidereal_time(context->jd_ut1, 0.0, DELTA_T, 0, 0, 0, &context->gmst);
+	sidereal_time(context->jd_ut1, 0.0, DELTA_T, 1, 1, 1, &context->gast);
+	double jd[2] = { context->jd_tdb, 0.0 };
+	ephemeris(jd, &earth, 0, 1, context->peb, context->veb);
+	ephemeris(jd, &sun, 0, 1, context->psb, context->vsb);
+	// GCRS -> true equator and equinox of date, columns are images of the unit vectors
+	for (int i = 0; i < 3; i++) {
+		double pos1[3] = { 0, 0, 0 }, pos2[3], pos3[3], pos4[3];
+		pos1[i] = 1;
+		frame_tie(pos1, 1, pos2);
+		precession(T0, pos2, context->jd_tdb, pos3);
+		nutation(context->jd_tdb, 0, 1, pos3, pos4);
+		for (int j = 0; j < 3; j++)
+			context->rotation[j][i] = pos4[j];
+	}
+	context->location_valid = false;
+	context->valid = true;
+}
+
+static void update_location(indigo_novas_context *context, double latitude, double longitude, double elevation) {
+	if (context->location_valid && context->latitude == latitude && context->longitude == longitude && context->elevation == elevation)
+		return;
+	observer location;
+	make_observer_on_surface(latitude, longitude, elevation, 0.0, 0.0, &location);
+	geo_posvel(context->jd_tt, DELTA_T, 1, &location, context->pog, context->vog);
+	context->latitude = latitude;
+	context->longitude = longitude;
+	context->elevation = elevation;
+	context->location_valid = true;
+}
+
+static double utc_now() {
+	return (double)time(NULL);
+}
+
+double indigo_lst_with_context(indigo_novas_context *context, double longitude, double utc) {
+	indigo_novas_update_context(context, utc);
+	double gst = context->gmst + (utc - context->utc) * SIDEREAL_RATE / 3600.0;
+	return fmod(fmod(gst + longitude / 15.0, 24.0) + 24.0, 24.0);
+}
+
+void indigo_eq2hor_with_context(indigo_novas_context *context, double latitude, double longitude, double utc, int count, const double *ra, const double *dec, double *alt, double *az) {
+	indigo_novas_update_context(context, utc);
+	double last = (context->gast + (utc - context->utc) * SIDEREAL_RATE / 3600.0) * 15.0 + longitude;
+	double sinlat = sin(latitude * DEG2RAD);
+	double coslat = cos(latitude * DEG2RAD);
+	for (int i = 0; i < count; i++) {
+		double ha = (last - ra[i] * 15.0) * DEG2RAD;
+		double sinha = sin(ha), cosha = cos(ha);
+		double sindec = sin(dec[i] * DEG2RAD), cosdec = cos(dec[i] * DEG2RAD);
+		double pz = sinlat * sindec + coslat * cosdec * cosha;
+		double pn = coslat * sindec - sinlat * cosdec * cosha;
+		double pw = cosdec * sinha;
+		double a = 0;
+		if (pn != 0 || pw != 0) {
+			a = -atan2(pw, pn) * RAD2DEG;
+			if (a < 0.0)
+				a += 360.0;
+			if (a >= 360.0)
+				a -= 360.0;
+		}
+		az[i] = a;
+		alt[i] = 90 - atan2(sqrt(pn * pn + pw * pw), pz) * RAD2DEG;
+	}
+}
+
+static void place_stars(indigo_novas_context *context, bool topocentric, int count, const double *promora, const double *promodec, const double *parallax, const double *rv, double *ra, double *dec) {
+	double pob[3], vob[3];
+	for (int j = 0; j < 3; j++) {
+		pob[j] = context->peb[j] + (topocentric ? context->pog[j] : 0);
+		vob[j] = context->veb[j] + (topocentric ? context->vog[j] : 0);
+	}
+	double psbo[3];
+	for (int j = 0; j < 3; j++)
+		psbo[j] = context->psb[j] - pob[j];
+	cat_entry star;
+	memset(&star, 0, sizeof(star));
+	for (int i = 0; i < count; i++) {
+		double pos1[3], vel1[3], pos2[3], pos3[3], pos4[3], pos5[3], pos8[3], t_light, psun[3];
+		star.ra = ra[i];
+		star.dec = dec[i];
+		star.promora = promora ? promora[i] : 0;
+		star.promodec = promodec ? promodec[i] : 0;
+		star.parallax = parallax ? parallax[i] : 0;
+		star.radialvelocity = rv ? rv[i] : 0;
+		starvectors(&star, pos1, vel1);
+		proper_motion(T0, pos1, vel1, context->jd_tdb + d_light(pos1, pob), pos2);
+		bary2obs(pos2, pob, pos3, &t_light);
+		// deflection by the Sun, Sun is moved back to the time of closest approach along its velocity
+		double tlt = sqrt(pos3[0] * pos3[0] + pos3[1] * pos3[1] + pos3[2] * pos3[2]) / C_AUDAY;
+		double dlt = d_light(pos3, psbo);
+		double dt = dlt > 0.0 ? dlt : 0.0;
+		if (tlt < dlt)
+			dt = tlt;
+		for (int j = 0; j < 3; j++)
+			psun[j] = context->psb[j] - context->vsb[j] * dt;
+		grav_vec(pos3, pob, psun, RMASS[10], pos4);
+		if (topocentric) {
+			double limb, frlimb;
+			limb_angle(pos3, context->pog, &limb, &frlimb);
+			if (frlimb >= 0.8)
+				grav_vec(pos4, pob, context->peb, RMASS[3], pos4);
+		}
+		aberration(pos4, vob, t_light, pos5);
+		for (int j = 0; j < 3; j++)
+			pos8[j] = context->rotation[j][0] * pos5[0] + context->rotation[j][1] * pos5[1] + context->rotation[j][2] * pos5[2];
+		vector2radec(pos8, ra + i, dec + i);
+	}
+}
+
+void indigo_app_star_with_context(indigo_novas_context *context, double utc, int count, const double *promora, const double *promodec, const double *parallax, const double *rv, double *ra, double *dec) {
+	indigo_novas_update_context(context, utc);
+	place_stars(context, false, count, promora, promodec, parallax, rv, ra, dec);
+}
+
+void indigo_topo_star_with_context(indigo_novas_context *context, double latitude, double longitude, double elevation, double utc, int count, const double *promora, const double *promodec, const double *parallax, const double *rv, double *ra, double *dec) {
+	indigo_novas_update_context(context, utc);
+	update_location(context, latitude, longitude, elevation);
+	place_stars(context, true, count, promora, promodec, parallax, rv, ra, dec);
+}
+
 double indigo_lst(double longitude) {
-	double ut1_now = time(NULL) / 86400.0 + 2440587.5 + DELTA_UTC_UT1;
-	double gst;
-	sidereal_time(ut1_now, 0.0, DELTA_T, 0, 0, 0, &gst);
-	return fmod(gst + longitude/15.0 + 24.0, 24.0);
+	pthread_mutex_lock(&shared_context_mutex);
+	double lst = indigo_lst_with_context(&shared_context, longitude, utc_now());
+	pthread_mutex_unlock(&shared_context_mutex);
+	return lst;
 }
 
 void indigo_eq2hor(double latitude, double longitude, double elevation, double ra, double dec, double *alt, double *az) {
-	double ut1_now = time(NULL) / 86400.0 + 2440587.5 + DELTA_UTC_UT1;
-	on_surface position = { latitude, longitude, elevation, 0.0, 0.0 };
-	equ2hor(ut1_now, DELTA_T, 1, 0.0, 0.0, &position, ra, dec, 0, alt, az, &ra, &dec);
-	*alt = 90-*alt;
+	pthread_mutex_lock(&shared_context_mutex);
+	indigo_eq2hor_with_context(&shared_context, latitude, longitude, utc_now(), 1, &ra, &dec, alt, az);
+	pthread_mutex_unlock(&shared_context_mutex);
 }
 
 void indigo_app_star(double promora, double promodec, double parallax, double rv, double *ra, double *dec) {
-	double ut1_now = time(NULL) / 86400.0 + 2440587.5 + DELTA_UTC_UT1;
-	double tt_now = ut1_now + DELTA_T / 86400.0;
-	cat_entry star;
-	init();
-	make_cat_entry("HIP 1", "HP2", 1, *ra, *dec, promora, promodec, parallax, rv, &star);
-	app_star(tt_now, &star, 1, ra, dec);
+	pthread_mutex_lock(&shared_context_mutex);
+	indigo_app_star_with_context(&shared_context, utc_now(), 1, &promora, &promodec, &parallax, &rv, ra, dec);
+	pthread_mutex_unlock(&shared_context_mutex);
 }
 
 void indigo_topo_star(double latitude, double longitude, double elevation, double promora, double promodec, double parallax, double rv, double *ra, double *dec) {
-	double ut1_now = time(NULL) / 86400.0 + 2440587.5 + DELTA_UTC_UT1;
-	double tt_now = ut1_now + DELTA_T / 86400.0;
-	cat_entry star;
-	init();
-	make_cat_entry("HIP1", "HP2", 1, *ra, *dec, promora, promodec, parallax, rv, &star);
-	on_surface position = { latitude, longitude, elevation, 0.0, 0.0 };
-	topo_star(tt_now, DELTA_T, &star, &position, 1, ra, dec);
+	pthread_mutex_lock(&shared_context_mutex);
+	indigo_topo_star_with_context(&shared_context, latitude, longitude, elevation, utc_now(), 1, &promora, &promodec, &parallax, &rv, ra, dec);
+	pthread_mutex_unlock(&shared_context_mutex);
 }
@@ -27,6 +27,53 @@
 #define indigo_novas_h
 
 #include <stdio.h>
+#include <stdbool.h>
+
+/** Default validity window of cached time dependent values in seconds.
+ */
+#define INDIGO_NOVAS_CONTEXT_WINDOW	1.0
+
+/** Transformation context.
+ Time dependent part of NOVAS reduction (sidereal time, Earth and Sun ephemeris, frame tie, precession and nutation) is computed once per epoch window, so that transformation of each object reduces to a few vector operations.
+ */
+typedef struct {
+	double window;                      ///< validity of cached values in seconds
+	bool valid;                         ///< cached values are initialized
+	double utc;                         ///< UNIX time of cached epoch
+	double jd_ut1, jd_tt, jd_tdb;       ///< cached epoch
+	double gmst;                        ///< Greenwich mean sidereal time at epoch (hours)
+	double gast;                        ///< Greenwich apparent sidereal time at epoch (hours)
+	double peb[3], veb[3];              ///< barycentric position and velocity of the Earth
+	double psb[3], vsb[3];              ///< barycentric position and velocity of the Sun
+	double rotation[3][3];              ///< GCRS to true equator and equinox of date rotation matrix
+	bool location_valid;                ///< cached observer location is initialized
+	double latitude, longitude, elevation; ///< cached observer location
+	double pog[3], vog[3];              ///< geocentric position and velocity of observer
+} indigo_novas_context;
+
+/** Initialize transformation context with given validity window.
+ */
+extern void indigo_novas_init_context(indigo_novas_context *context, double window);
+
+/** Recompute cached values if UNIX time utc is out of context validity window.
+ */
+extern void indigo_novas_update_context(indigo_novas_context *context, double utc);
+
+/** Local mean sidereal time for UNIX time utc.
+ */
+extern double indigo_lst_with_context(indigo_novas_context *context, double longitude, double utc);
+
+/** Transform count objects from equatorial coordinates of date to altitude and azimuth.
+ */
+extern void indigo_eq2hor_with_context(indigo_novas_context *context, double latitude, double longitude, double utc, int count, const double *ra, const double *dec, double *alt, double *az);
+
+/** Transform count objects from J2000 catalog coordinates to apparent coordinates in place, promora, promodec, parallax and rv arrays can be NULL.
+ */
+extern void indigo_app_star_with_context(indigo_novas_context *context, double utc, int count, const double *promora, const double *promodec, const double *parallax, const double *rv, double *ra, double *dec);
+
+/** Transform count objects from J2000 catalog coordinates to topocentric coordinates in place, promora, promodec, parallax and rv arrays can be NULL.
+ */
+extern void indigo_topo_star_with_context(indigo_novas_context *context, double latitude, double longitude, double elevation, double utc, int count, const double *promora, const double *promodec, const double *parallax, const double *rv, double *ra, double *dec);
 
 extern double indigo_lst(double longitude);
 extern void indigo_eq2hor(double latitude, double longitude, double elevation, double ra, double dec, double *alt, double *az);
@@ -72,13 +72,18 @@ static void *timer_func(indigo_timer *timer) {
 				normalize_timespec(&end);
 				while (!timer->canceled) {
 					pthread_mutex_lock(&timer->mutex);
-					int rc = pthread_cond_timedwait(&timer->cond, &timer->mutex, &end);
+					int rc = timer->rescheduled ? 0 : pthread_cond_timedwait(&timer->cond, &timer->mutex, &end);
 					pthread_mutex_unlock(&timer->mutex);
-					if (rc == ETIMEDOUT)
+					if (rc == ETIMEDOUT || timer->rescheduled)
 						break;
 				}
+				if (timer->rescheduled && !timer->canceled) {
+					timer->rescheduled = false;
+					continue;
+				}
 			}
 
+			timer->rescheduled = false;
 			timer->scheduled = false;
 			if (!timer->canceled) {
 				timer->callback(timer->device);
@@ -128,6 +133,7 @@ indigo_timer *indigo_set_timer(indigo_device *device, double delay, indigo_timer
 		timer->wake = true;
 		timer->canceled = false;
 		timer->scheduled = true;
+		timer->rescheduled = false;
 		timer->delay = delay;
 		if ((timer->device = device) != NULL) {
 			timer->next = DEVICE_CONTEXT->timers;
@@ -146,6 +152,7 @@ indigo_timer *indigo_set_timer(indigo_device *device, double delay, indigo_timer
 		pthread_cond_init(&timer->cond, NULL);
 		timer->canceled = false;
 		timer->scheduled = true;
+		timer->rescheduled = false;
 		if ((timer->device = device) != NULL) {
 			timer->next = DEVICE_CONTEXT->timers;
 			DEVICE_CONTEXT->timers = timer;
@@ -174,6 +181,22 @@ bool indigo_reschedule_timer(indigo_device *device, double delay, indigo_timer *
 	return result;
 }
 
+bool indigo_wake_timer(indigo_device *device, double delay, indigo_timer **timer) {
+	bool result = false;
+	pthread_mutex_lock(&cancel_timer_mutex);
+	if (*timer != NULL) {
+		pthread_mutex_lock(&(*timer)->mutex);
+		(*timer)->delay = delay;
+		(*timer)->scheduled = true;
+		(*timer)->rescheduled = true;
+		pthread_cond_signal(&(*timer)->cond);
+		pthread_mutex_unlock(&(*timer)->mutex);
+		result = true;
+	}
+	pthread_mutex_unlock(&cancel_timer_mutex);
+	return result;
+}
+
 // TODO: do we need device?
 
 bool indigo_cancel_timer(indigo_device *device, indigo_timer **timer) {
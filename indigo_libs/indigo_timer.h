@@ -46,6 +46,7 @@ typedef struct indigo_timer {
 	indigo_timer_callback callback;           ///< callback function pointer
 	bool canceled;                            ///< timer is canceled (darwin only)
 	bool scheduled;
+	bool rescheduled;                         ///< timer was woken up with new delay
 	double delay;
 	bool wake;
 	int timer_id;
@@ -87,6 +88,10 @@ extern indigo_timer *indigo_set_timer(indigo_device *device, double delay, indig
  */
 extern bool indigo_reschedule_timer(indigo_device *device, double delay, indigo_timer **timer);
 
+/** Rescheduled timer (if not null) and wake it up, so new delay is counted from now even if timer is sleeping.
+ */
+extern bool indigo_wake_timer(indigo_device *device, double delay, indigo_timer **timer);
+
 /** Cancel timer.
  */
 extern bool indigo_cancel_timer(indigo_device *device, indigo_timer **timer);
@@ -24,6 +24,7 @@
  */
 
 #include <string.h>
+#include <pthread.h>
 
 #include "indigo_version.h"
 #include "indigo_names.h"
@@ -418,16 +419,124 @@ static struct property_mapping legacy[] = {
 	NULL
 };
 
+#define LEGACY_COUNT	((int)(sizeof(legacy) / sizeof(struct property_mapping)) - 1)
+#define MAX_LEGACY_ITEMS	25
+
+//  Sorted views of legacy[] for binary search in both directions, built once on first use
+
+static struct property_index {
+	int item_count;
+	const char *legacy_names[MAX_LEGACY_ITEMS];
+	const char *current_names[MAX_LEGACY_ITEMS];
+	struct item_mapping *by_legacy[MAX_LEGACY_ITEMS];
+	struct item_mapping *by_current[MAX_LEGACY_ITEMS];
+} property_index[sizeof(legacy) / sizeof(struct property_mapping)];
+
+static const char *property_legacy_names[sizeof(legacy) / sizeof(struct property_mapping)];
+static const char *property_current_names[sizeof(legacy) / sizeof(struct property_mapping)];
+static int property_by_legacy[sizeof(legacy) / sizeof(struct property_mapping)];
+static int property_by_current[sizeof(legacy) / sizeof(struct property_mapping)];
+static int property_current_position[sizeof(legacy) / sizeof(struct property_mapping)];
+static pthread_once_t index_once = PTHREAD_ONCE_INIT;
+
+static void sort_names(const char **names, void **values, int count) {
+	for (int i = 1; i < count; i++) {
+		const char *name = names[i];
+		void *value = values[i];
+		int j = i - 1;
+		while (j >= 0 && strcmp(names[j], name) > 0) {
+			names[j + 1] = names[j];
+			values[j + 1] = values[j];
+			j--;
+		}
+		names[j + 1] = name;
+		values[j + 1] = value;
+	}
+}
+
+static void build_index(void) {
+	void *values[sizeof(legacy) / sizeof(struct property_mapping)];
+	for (int i = 0; i < LEGACY_COUNT; i++) {
+		property_legacy_names[i] = legacy[i].legacy;
+		values[i] = legacy + i;
+	}
+	sort_names(property_legacy_names, values, LEGACY_COUNT);
+	for (int i = 0; i < LEGACY_COUNT; i++)
+		property_by_legacy[i] = (int)((struct property_mapping *)values[i] - legacy);
+	for (int i = 0; i < LEGACY_COUNT; i++) {
+		property_current_names[i] = legacy[i].current;
+		values[i] = legacy + i;
+	}
+	sort_names(property_current_names, values, LEGACY_COUNT);
+	for (int i = 0; i < LEGACY_COUNT; i++) {
+		property_by_current[i] = (int)((struct property_mapping *)values[i] - legacy);
+		property_current_position[property_by_current[i]] = i;
+	}
+	for (int i = 0; i < LEGACY_COUNT; i++) {
+		struct property_index *index = property_index + i;
+		struct item_mapping *item_mapping = legacy[i].items;
+		while (index->item_count < MAX_LEGACY_ITEMS && item_mapping->legacy) {
+			index->legacy_names[index->item_count] = item_mapping->legacy;
+			index->current_names[index->item_count] = item_mapping->current;
+			index->by_legacy[index->item_count] = index->by_current[index->item_count] = item_mapping;
+			index->item_count++;
+			item_mapping++;
+		}
+		sort_names(index->legacy_names, (void **)index->by_legacy, index->item_count);
+		sort_names(index->current_names, (void **)index->by_current, index->item_count);
+	}
+}
+
+//  Returns position of name in sorted names or -(insertion position) - 1 if not found
+
+static int search_name(const char **names, int count, const char *name) {
+	int low = 0, high = count - 1;
+	while (low <= high) {
+		int middle = (low + high) / 2;
+		int result = strcmp(names[middle], name);
+		if (result == 0)
+			return middle;
+		if (result < 0)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+	return -low - 1;
+}
+
+//  Same as search_name(), but validates and updates cached result (0 = unknown, n > 0 = position n - 1, n < 0 = same as search_name())
+
+static int cached_search_name(const char **names, int count, const char *name, short *cache) {
+	int cached = *cache;
+	if (cached > 0 && cached <= count && !strcmp(names[cached - 1], name))
+		return cached - 1;
+	if (cached < 0) {
+		int position = -cached - 1;
+		if (position <= count && (position == 0 || strcmp(names[position - 1], name) < 0) && (position == count || strcmp(name, names[position]) < 0))
+			return cached;
+	}
+	int result = search_name(names, count, name);
+	*cache = (short)(result >= 0 ? result + 1 : result);
+	return result;
+}
+
+static int current_property_mapping(indigo_property *property) {
+	pthread_once(&index_once, build_index);
+	int position = cached_search_name(property_current_names, LEGACY_COUNT, property->name, &property->version_mapping);
+	return position >= 0 ? property_by_current[position] : -1;
+}
+
 void indigo_copy_property_name(indigo_version version, indigo_property *property, const char *name) {
 	if (version == INDIGO_VERSION_LEGACY) {
-		struct property_mapping *property_mapping = legacy;
-		while (property_mapping->legacy) {
-			if (!strcmp(name, property_mapping->legacy)) {
-				INDIGO_TRACE(indigo_trace("version: %s -> %s (current)", property_mapping->legacy, property_mapping->current));
-				strcpy(property->name, property_mapping->current);
-				return;
-			}
-			property_mapping++;
+		pthread_once(&index_once, build_index);
+		int position = search_name(property_legacy_names, LEGACY_COUNT, name);
+		if (position >= 0) {
+			int index = property_by_legacy[position];
+			struct property_mapping *property_mapping = legacy + index;
+			INDIGO_TRACE(indigo_trace("version: %s -> %s (current)", property_mapping->legacy, property_mapping->current));
+			strcpy(property->name, property_mapping->current);
+			property->version_mapping = (short)(property_current_position[index] + 1);
+			return;
 		}
 	}
 	strncpy(property->name, name, INDIGO_NAME_SIZE);
@@ -435,22 +544,16 @@ void indigo_copy_property_name(indigo_version version, indigo_property *property
 
 void indigo_copy_item_name(indigo_version version, indigo_property *property, indigo_item *item, const char *name) {
 	if (version == INDIGO_VERSION_LEGACY) {
-		struct property_mapping *property_mapping = legacy;
-		while (property_mapping->legacy) {
-			if (!strcmp(property->name, property_mapping->current)) {
-				struct item_mapping *item_mapping = property_mapping->items;
-				while (item_mapping->legacy) {
-					if (!strcmp(name, item_mapping->legacy)) {
-						INDIGO_TRACE(indigo_trace("version: %s.%s -> %s.%s (current)", property_mapping->legacy, item_mapping->legacy, property_mapping->current, item_mapping->current));
-						strncpy(item->name, item_mapping->current, INDIGO_NAME_SIZE);
-						return;
-					}
-					item_mapping++;
-				}
-				strncpy(item->name, name, INDIGO_NAME_SIZE);
+		int index = current_property_mapping(property);
+		if (index >= 0) {
+			struct property_index *items = property_index + index;
+			int position = search_name(items->legacy_names, items->item_count, name);
+			if (position >= 0) {
+				struct item_mapping *item_mapping = items->by_legacy[position];
+				INDIGO_TRACE(indigo_trace("version: %s.%s -> %s.%s (current)", legacy[index].legacy, item_mapping->legacy, legacy[index].current, item_mapping->current));
+				strncpy(item->name, item_mapping->current, INDIGO_NAME_SIZE);
 				return;
 			}
-			property_mapping++;
 		}
 	}
 	strncpy(item->name, name, INDIGO_NAME_SIZE);
@@ -458,13 +561,10 @@ void indigo_copy_item_name(indigo_version version, indigo_property *property, in
 
 const char *indigo_property_name(indigo_version version, indigo_property *property) {
 	if (version == INDIGO_VERSION_LEGACY) {
-		struct property_mapping *property_mapping = legacy;
-		while (property_mapping->legacy) {
-			if (!strcmp(property->name, property_mapping->current)) {
-				INDIGO_TRACE(indigo_trace("version: %s -> %s (legacy)", property_mapping->current, property_mapping->legacy));
-				return property_mapping->legacy;
-			}
-			property_mapping++;
+		int index = current_property_mapping(property);
+		if (index >= 0) {
+			INDIGO_TRACE(indigo_trace("version: %s -> %s (legacy)", legacy[index].current, legacy[index].legacy));
+			return legacy[index].legacy;
 		}
 	}
 	return property->name;
@@ -472,20 +572,15 @@ const char *indigo_property_name(indigo_version version, indigo_property *proper
 
 const char *indigo_item_name(indigo_version version, indigo_property *property, indigo_item *item) {
 	if (version == INDIGO_VERSION_LEGACY) {
-		struct property_mapping *property_mapping = legacy;
-		while (property_mapping->legacy) {
-			if (!strcmp(property->name, property_mapping->current)) {
-				struct item_mapping *item_mapping = property_mapping->items;
-				while (item_mapping->legacy) {
-					if (!strcmp(item->name, item_mapping->current)) {
-						INDIGO_TRACE(indigo_trace("version: %s.%s -> %s.%s (legacy)", property_mapping->current, item_mapping->current, property_mapping->legacy, item_mapping->legacy));
-						return item_mapping->legacy;
-					}
-					item_mapping++;
-				}
-				return item->name;
+		int index = current_property_mapping(property);
+		if (index >= 0) {
+			struct property_index *items = property_index + index;
+			int position = cached_search_name(items->current_names, items->item_count, item->name, &item->version_mapping);
+			if (position >= 0) {
+				struct item_mapping *item_mapping = items->by_current[position];
+				INDIGO_TRACE(indigo_trace("version: %s.%s -> %s.%s (legacy)", legacy[index].current, item_mapping->current, legacy[index].legacy, item_mapping->legacy));
+				return item_mapping->legacy;
 			}
-			property_mapping++;
 		}
 	}
 	return item->name;
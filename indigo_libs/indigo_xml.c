@@ -52,7 +52,10 @@
 
 #define BUFFER_SIZE 524288  /* BUFFER_SIZE % 4 == 0, inportant for base64 */
 
-#define PROPERTY_SIZE sizeof(indigo_property)+INDIGO_MAX_ITEMS*(sizeof(indigo_item))
+#define READ_BUFFER_SIZE 4096
+#define VALUE_BUFFER_SIZE 1024 /* VALUE_BUFFER_SIZE % 4 == 0, inportant for base64 */
+#define PROPERTY_ITEMS 4
+#define PARSER_POOL_SIZE 16
 
 typedef enum {
 	ERROR,
@@ -124,13 +127,37 @@ static indigo_rule parse_rule(char *value) {
 }
 
 typedef struct {
-	char property_buffer[PROPERTY_SIZE];
+	indigo_property *property;
+	int property_capacity;
 	indigo_device *device;
 	indigo_client *client;
 	int count;
 	indigo_property **properties;
 } parser_context;
 
+//  Property buffer starts small and grows on demand up to INDIGO_MAX_ITEMS items, items above count are always zeroed
+
+static indigo_item *add_item(parser_context *context) {
+	indigo_property *property = context->property;
+	if (property->count >= INDIGO_MAX_ITEMS)
+		return NULL;
+	if (property->count == context->property_capacity) {
+		int capacity = context->property_capacity * 2;
+		if (capacity > INDIGO_MAX_ITEMS)
+			capacity = INDIGO_MAX_ITEMS;
+		property = realloc(property, sizeof(indigo_property) + capacity * sizeof(indigo_item));
+		assert(property != NULL);
+		memset(property->items + context->property_capacity, 0, (capacity - context->property_capacity) * sizeof(indigo_item));
+		context->property = property;
+		context->property_capacity = capacity;
+	}
+	return property->items + property->count++;
+}
+
+static void reset_property(parser_context *context) {
+	memset(context->property, 0, sizeof(indigo_property) + context->property->count * sizeof(indigo_item));
+}
+
 bool indigo_use_blob_urls = true;
 
 typedef void *(* parser_handler)(parser_state state, parser_context *context, char *name, char *value, char *message);
@@ -151,7 +178,7 @@ static void *set_light_vector_handler(parser_state state, parser_context *contex
 static void *set_blob_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message);
 
 static void *enable_blob_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	assert(client != NULL);
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: enable_blob_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
@@ -195,14 +222,14 @@ static void *enable_blob_handler(parser_state state, parser_context *context, ch
 			indigo_enable_blob(client, property, INDIGO_ENABLE_BLOB_NEVER);
 		}		
 	} else if (state == END_TAG) {
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return enable_blob_handler;
 }
 
 static void *get_properties_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	assert(client != NULL);
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: get_properties_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
@@ -233,14 +260,14 @@ static void *get_properties_handler(parser_state state, parser_context *context,
 		}
 	} else if (state == END_TAG) {
 		indigo_enumerate_properties(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return get_properties_handler;
 }
 
 static void *new_one_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_one_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -256,13 +283,12 @@ static void *new_one_text_vector_handler(parser_state state, parser_context *con
 }
 
 static void *new_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneText")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return new_one_text_vector_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -275,14 +301,14 @@ static void *new_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return new_text_vector_handler;
 }
 
 static void *new_one_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_one_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -298,13 +324,12 @@ static void *new_one_number_vector_handler(parser_state state, parser_context *c
 }
 
 static void *new_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneNumber")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return new_one_number_vector_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -317,14 +342,14 @@ static void *new_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return new_number_vector_handler;
 }
 
 static void *new_one_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_one_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -340,13 +365,12 @@ static void *new_one_switch_vector_handler(parser_state state, parser_context *c
 }
 
 static void *new_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneSwitch")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return new_one_switch_vector_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -360,7 +384,7 @@ static void *new_switch_vector_handler(parser_state state, parser_context *conte
 		return new_switch_vector_handler;
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return new_switch_vector_handler;
@@ -448,7 +472,7 @@ static void set_property(parser_context *context, indigo_property *other, char *
 }
 
 static void *set_one_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -464,13 +488,12 @@ static void *set_one_text_vector_handler(parser_state state, parser_context *con
 }
 
 static void *set_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneText")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return set_one_text_vector_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -488,14 +511,14 @@ static void *set_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_text_vector_handler;
 }
 
 static void *set_one_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -521,16 +544,16 @@ static void *set_one_number_vector_handler(parser_state state, parser_context *c
 }
 
 static void *set_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneNumber")) {
-			if (property->count < INDIGO_MAX_ITEMS) {
-				property->items[property->count].number.min = NAN;
-				property->items[property->count].number.max = NAN;
-				property->items[property->count].number.step = NAN;
-				property->count++;
+			indigo_item *item = add_item(context);
+			if (item != NULL) {
+				item->number.min = NAN;
+				item->number.max = NAN;
+				item->number.step = NAN;
 			}
 			return set_one_number_vector_handler;
 		}
@@ -549,14 +572,14 @@ static void *set_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_number_vector_handler;
 }
 
 static void *set_one_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -572,13 +595,12 @@ static void *set_one_switch_vector_handler(parser_state state, parser_context *c
 }
 
 static void *set_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneSwitch")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return set_one_switch_vector_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -596,14 +618,14 @@ static void *set_switch_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_switch_vector_handler;
 }
 
 static void *set_one_light_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_light_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -619,13 +641,12 @@ static void *set_one_light_vector_handler(parser_state state, parser_context *co
 }
 
 static void *set_light_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_light_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneLight")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return set_one_light_vector_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -643,14 +664,14 @@ static void *set_light_vector_handler(parser_state state, parser_context *contex
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_light_vector_handler;
 }
 
 static void *set_one_blob_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_DEBUG_PROTOCOL(if (state == BLOB))
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_blob_vector_handler %s '%s' DATA", parser_state_name[state], name != NULL ? name : ""));
@@ -677,13 +698,12 @@ static void *set_one_blob_vector_handler(parser_state state, parser_context *con
 }
 
 static void *set_blob_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_blob_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneBLOB")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return set_one_blob_vector_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -701,7 +721,7 @@ static void *set_blob_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_blob_vector_handler;
@@ -761,7 +781,7 @@ static void def_property(parser_context *context, indigo_property *other, char *
 }
 
 static void *def_text_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_text_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -781,13 +801,12 @@ static void *def_text_handler(parser_state state, parser_context *context, char
 }
 
 static void *def_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defText")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return def_text_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -813,14 +832,14 @@ static void *def_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_text_vector_handler;
 }
 
 static void *def_number_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_number_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -850,13 +869,12 @@ static void *def_number_handler(parser_state state, parser_context *context, cha
 }
 
 static void *def_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defNumber")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return def_number_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -882,14 +900,14 @@ static void *def_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_number_vector_handler;
 }
 
 static void *def_switch_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_switch_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -909,13 +927,12 @@ static void *def_switch_handler(parser_state state, parser_context *context, cha
 }
 
 static void *def_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defSwitch")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return def_switch_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -943,14 +960,14 @@ static void *def_switch_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_switch_vector_handler;
 }
 
 static void *def_light_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_light_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -970,13 +987,12 @@ static void *def_light_handler(parser_state state, parser_context *context, char
 }
 
 static void *def_light_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_light_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defLight")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return def_light_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -1000,14 +1016,14 @@ static void *def_light_vector_handler(parser_state state, parser_context *contex
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_light_vector_handler;
 }
 
 static void *def_blob_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_blob_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -1029,13 +1045,12 @@ static void *def_blob_handler(parser_state state, parser_context *context, char
 }
 
 static void *def_blob_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_blob_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defBLOB")) {
-			if (property->count < INDIGO_MAX_ITEMS)
-				property->count++;
+			add_item(context);
 			return def_blob_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -1061,14 +1076,14 @@ static void *def_blob_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_blob_vector_handler;
 }
 
 static void *del_property_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: del_property_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -1103,14 +1118,13 @@ static void *del_property_handler(parser_state state, parser_context *context, c
 				}
 			}
 		}
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return del_property_handler;
 }
 
 static void *message_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: message_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -1119,14 +1133,14 @@ static void *message_handler(parser_state state, parser_context *context, char *
 		}
 	} else if (state == END_TAG) {
 		indigo_send_message(device, *message ? message : NULL);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return message_handler;
 }
 
 static void *top_level_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: top_level_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
@@ -1197,33 +1211,58 @@ static void *top_level_handler(parser_state state, parser_context *context, char
 	return top_level_handler;
 }
 
-void indigo_xml_parse(indigo_device *device, indigo_client *client) {
-	char *buffer = malloc(BUFFER_SIZE+3); /* BUFFER_SIZE % 4 == 0 and keep always +3 for base64 alignmet */
-	assert(buffer != NULL);
-	char *value_buffer = malloc(BUFFER_SIZE+1); /* +1 to accomodate \0" */
-	assert(value_buffer != NULL);
-	char name_buffer[INDIGO_NAME_SIZE];
-	unsigned char *blob_buffer = NULL;
-	char *pointer = buffer;
-	char *buffer_end = NULL;
-	char *name_pointer = name_buffer;
-	char *value_pointer = value_buffer;
-	unsigned char *blob_pointer = NULL;
-	long blob_size = 0;
+struct indigo_xml_parser {
+	parser_context context;
+	parser_handler handler;
+	parser_state state;
+	char name_buffer[INDIGO_NAME_SIZE + 1];
+	char *name_pointer;
+	char *value_buffer;
+	char *value_pointer;
 	char message[INDIGO_VALUE_SIZE];
-	char q = '"';
-	int depth = 0;
-	char c = 0;
+	char q;
+	int depth;
 	char entity_buffer[8];
-	char *entity_pointer = NULL;
-	bool is_escaped = false;
-	/* (void)parser_state_name; */
+	char *entity_pointer;
+	bool is_escaped;
+	unsigned char *blob_buffer;
+	unsigned char *blob_pointer;
+	long blob_size;
+	long blob_remaining;
+	bool blob_skip_space;
+	unsigned char blob_quad[4];
+	int blob_quad_count;
+	char *read_buffer;
+	long read_buffer_size;
+	indigo_xml_parser *next;
+};
 
-	parser_handler handler = top_level_handler;
+//  Released parsers are kept in a pool and reused by next connection, their buffers are shrunk to initial sizes
 
-	parser_state state = IDLE;
+static indigo_xml_parser *parser_pool = NULL;
+static int parser_pool_count = 0;
+static pthread_mutex_t parser_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-	parser_context *context = malloc(sizeof(parser_context));
+indigo_xml_parser *indigo_xml_parser_create(indigo_device *device, indigo_client *client) {
+	pthread_mutex_lock(&parser_pool_mutex);
+	indigo_xml_parser *parser = parser_pool;
+	if (parser != NULL) {
+		parser_pool = parser->next;
+		parser_pool_count--;
+	}
+	pthread_mutex_unlock(&parser_pool_mutex);
+	if (parser == NULL) {
+		parser = malloc(sizeof(indigo_xml_parser));
+		assert(parser != NULL);
+		memset(parser, 0, sizeof(indigo_xml_parser));
+		parser->value_buffer = malloc(VALUE_BUFFER_SIZE + 1); /* +1 to accomodate \0" */
+		assert(parser->value_buffer != NULL);
+		parser->context.property_capacity = PROPERTY_ITEMS;
+		parser->context.property = malloc(sizeof(indigo_property) + PROPERTY_ITEMS * sizeof(indigo_item));
+		assert(parser->context.property != NULL);
+	}
+	parser_context *context = &parser->context;
+	memset(context->property, 0, sizeof(indigo_property) + context->property_capacity * sizeof(indigo_item));
 	context->client = client;
 	context->device = device;
 	if (device != NULL) {
@@ -1234,36 +1273,114 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 		context->count = 0;
 		context->properties = NULL;
 	}
+	parser->handler = top_level_handler;
+	parser->state = IDLE;
+	parser->name_pointer = parser->name_buffer;
+	parser->value_pointer = parser->value_buffer;
+	parser->q = '"';
+	parser->depth = 0;
+	parser->entity_pointer = NULL;
+	parser->is_escaped = false;
+	parser->blob_size = 0;
+	parser->blob_remaining = 0;
+	parser->blob_quad_count = 0;
+	parser->next = NULL;
+	if (device != NULL)
+		device->enumerate_properties(device, client, NULL);
+	return parser;
+}
 
-	indigo_property *property = (indigo_property *)&context->property_buffer;
-	memset(context->property_buffer, 0, PROPERTY_SIZE);
+static void decode_blob(indigo_xml_parser *parser, const unsigned char *data, long length) {
+	if (length > 0)
+		parser->blob_pointer += base64_decode_fast(parser->blob_pointer, data, length);
+}
 
-	int handle = 0;
-	if (device != NULL) {
-		handle = ((indigo_adapter_context *)device->device_context)->input;
-		device->enumerate_properties(device, client, NULL);
-	} else {
-		handle = ((indigo_adapter_context *)client->client_context)->input;
+//  Consumes base64 encoded BLOB data of INDIGO 2.0 protocol directly from input, returns number of bytes consumed
+
+static long feed_blob(indigo_xml_parser *parser, const char *data, long length) {
+	const char *pointer = data;
+	const char *end = data + length;
+	if (parser->blob_skip_space) {
+		while (pointer < end && isspace(*pointer))
+			pointer++;
+		if (pointer == end)
+			return pointer - data;
+		parser->blob_skip_space = false;
+	}
+	long available = end - pointer;
+	if (available > parser->blob_remaining)
+		available = parser->blob_remaining;
+	if (parser->blob_quad_count > 0) {
+		while (available > 0 && parser->blob_quad_count < 4) {
+			parser->blob_quad[parser->blob_quad_count++] = *pointer++;
+			available--;
+			parser->blob_remaining--;
+		}
+		if (parser->blob_quad_count < 4)
+			return pointer - data;
+		decode_blob(parser, parser->blob_quad, 4);
+		parser->blob_quad_count = 0;
+	}
+	long whole = available / 4 * 4;
+	decode_blob(parser, (const unsigned char *)pointer, whole);
+	pointer += whole;
+	available -= whole;
+	parser->blob_remaining -= whole;
+	while (available > 0) {
+		parser->blob_quad[parser->blob_quad_count++] = *pointer++;
+		available--;
+		parser->blob_remaining--;
 	}
-	*pointer = 0;
+	return pointer - data;
+}
+
+bool indigo_xml_parser_feed(indigo_xml_parser *parser, const char *data, long length) {
+	parser_context *context = &parser->context;
+	indigo_device *device = context->device;
+	parser_handler handler = parser->handler;
+	parser_state state = parser->state;
+	char *name_buffer = parser->name_buffer;
+	char *name_pointer = parser->name_pointer;
+	char *value_buffer = parser->value_buffer;
+	char *value_pointer = parser->value_pointer;
+	char *message = parser->message;
+	char q = parser->q;
+	int depth = parser->depth;
+	char *entity_buffer = parser->entity_buffer;
+	char *entity_pointer = parser->entity_pointer;
+	bool is_escaped = parser->is_escaped;
+	unsigned char *blob_buffer = parser->blob_buffer;
+	long blob_size = parser->blob_size;
+	unsigned char *blob_pointer = parser->blob_pointer;
+	long blob_remaining = parser->blob_remaining;
+	const char *pointer = data;
+	const char *buffer_end = data + length;
+	char c = 0;
 	while (true) {
-		assert(pointer - buffer <= BUFFER_SIZE);
-		assert(value_pointer - value_buffer <= BUFFER_SIZE);
+		assert(value_pointer - value_buffer <= VALUE_BUFFER_SIZE);
 		assert(name_pointer - name_buffer <= INDIGO_NAME_SIZE);
 		if (state == ERROR) {
 			indigo_error("XML Parser: syntax error");
-			goto exit_loop;
+			break;
 		}
-		while ((c = *pointer++) == 0) {
-			ssize_t count = (int)read(handle, (void *)buffer, (ssize_t)BUFFER_SIZE);
-			if (count <= 0) {
-				goto exit_loop;
+		if (state == BLOB && device != NULL && device->version >= INDIGO_VERSION_2_0) {
+			parser->blob_pointer = blob_pointer;
+			parser->blob_remaining = blob_remaining;
+			pointer += feed_blob(parser, pointer, buffer_end - pointer);
+			blob_pointer = parser->blob_pointer;
+			blob_remaining = parser->blob_remaining;
+			if (blob_remaining == 0) {
+				handler = handler(BLOB, context, NULL, (char *)blob_buffer, message);
+				state = BLOB_END;
+				INDIGO_TRACE_PARSER(indigo_trace("XML Parser: %d BLOB -> BLOB_END", depth));
+				continue;
 			}
-			pointer = buffer;
-			buffer_end = buffer + count;
-			buffer[count] = 0;
-			INDIGO_TRACE_PROTOCOL(indigo_trace("%d → %s", handle, buffer));
+			break;
 		}
+		if (pointer >= buffer_end)
+			break;
+		if ((c = *pointer++) == 0)
+			continue;
 		if (c == '&') {
 			entity_pointer = entity_buffer;
 			continue;
@@ -1283,7 +1400,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					c = '\'';
 				entity_pointer = NULL;
 				is_escaped = true;
-			} else if (isalpha(c) && entity_pointer - entity_buffer < sizeof(entity_buffer)) {
+			} else if (isalpha(c) && entity_pointer - entity_buffer < sizeof(parser->entity_buffer) - 1) {
 				*entity_pointer++ = c;
 				continue;
 			} else {
@@ -1427,73 +1544,31 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					state = TEXT1;
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' BLOB_END -> TEXT1", c));
 				}
-				*name_pointer++ = c;
+				if (name_pointer - name_buffer < INDIGO_NAME_SIZE)
+					*name_pointer++ = c;
 				break;
 			case BLOB:
-				if (device->version >= INDIGO_VERSION_2_0) {
-					ssize_t count;
-					pointer--;
-					while (isspace(*pointer)) pointer++;
-					unsigned long blob_len = (blob_size + 2) / 3 * 4;
-					unsigned long len = (long)(buffer_end - pointer);
-					len = (len < blob_len) ? len : blob_len;
-					ssize_t bytes_needed = len % 4;
-					if(bytes_needed) bytes_needed = 4 - bytes_needed;
-					while (bytes_needed) {
-						count = (int)read(handle, (void *)buffer_end, bytes_needed);
-						if (count <= 0)
-							goto exit_loop;
-						len += count;
-						bytes_needed -= count;
-						buffer_end += count;
-					}
-					blob_pointer += base64_decode_fast((unsigned char*)blob_pointer, (unsigned char*)pointer, len);
-					pointer += len;
-					blob_len -= len;
-					while(blob_len) {
-						len = ((BUFFER_SIZE) < blob_len) ? (BUFFER_SIZE) : blob_len;
-						ssize_t to_read = len;
-						char *ptr = buffer;
-						while(to_read) {
-							count = (int)read(handle, (void *)ptr, to_read);
-							if (count <= 0)
-								goto exit_loop;
-							ptr += count;
-							to_read -= count;
-						}
-						blob_pointer += base64_decode_fast((unsigned char*)blob_pointer, (unsigned char*)buffer, len);
-						blob_len -= len;
+				if (c == '<') {
+					if (depth == 2) {
+						*value_pointer = 0;
+						blob_pointer += base64_decode_fast((unsigned char*)blob_pointer, (unsigned char*)value_buffer, (int)(value_pointer-value_buffer));
+						handler = handler(BLOB, context, NULL, (char *)blob_buffer, message);
 					}
-
-					handler = handler(BLOB, context, NULL, (char *)blob_buffer, message);
-					pointer = buffer;
-					*pointer = 0;
-					state = BLOB_END;
-					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' %d BLOB -> BLOB_END", c, depth));
+					state = TEXT1;
+					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' %d BLOB -> TEXT1", c, depth));
 					break;
-				} else {
-					if (c == '<') {
-						if (depth == 2) {
+				} else if (c != '\n') {
+					if (depth == 2) {
+						if (value_pointer - value_buffer < VALUE_BUFFER_SIZE) {
+							*value_pointer++ = c;
+						} else {
 							*value_pointer = 0;
 							blob_pointer += base64_decode_fast((unsigned char*)blob_pointer, (unsigned char*)value_buffer, (int)(value_pointer-value_buffer));
-							handler = handler(BLOB, context, NULL, (char *)blob_buffer, message);
-						}
-						state = TEXT1;
-						INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' %d BLOB -> TEXT1", c, depth));
-						break;
-					} else if (c != '\n') {
-						if (depth == 2) {
-							if (value_pointer - value_buffer < BUFFER_SIZE) {
-								*value_pointer++ = c;
-							} else {
-								*value_pointer = 0;
-								blob_pointer += base64_decode_fast((unsigned char*)blob_pointer, (unsigned char*)value_buffer, (int)(value_pointer-value_buffer));
-								value_pointer = value_buffer;
-								*value_pointer++ = c;
-							}
+							value_pointer = value_buffer;
+							*value_pointer++ = c;
 						}
-						INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' %d BLOB", c, depth));
 					}
+					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' %d BLOB", c, depth));
 				}
 				break;
 			case ATTRIBUTE_NAME1:
@@ -1509,9 +1584,12 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				} else if (c == '>') {
 					value_pointer = value_buffer;
 					if (handler == set_one_blob_vector_handler) {
-						blob_size = property->items[property->count-1].blob.size;
+						blob_size = context->property->items[context->property->count-1].blob.size;
 						if (blob_size > 0) {
 							state = BLOB;
+							blob_remaining = (blob_size + 2) / 3 * 4;
+							parser->blob_skip_space = true;
+							parser->blob_quad_count = 0;
 							if (blob_buffer != NULL) {
 								unsigned char *ptmp = realloc(blob_buffer, blob_size);
 								assert(ptmp != NULL);
@@ -1563,7 +1641,8 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					handler = handler(ATTRIBUTE_VALUE, context, name_buffer, value_buffer, message);
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' ATTRIBUTE_VALUE -> ATTRIBUTE_NAME1", c));
 				} else {
-					*value_pointer++ = c;
+					if (value_pointer - value_buffer < VALUE_BUFFER_SIZE)
+						*value_pointer++ = c;
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' ATTRIBUTE_VALUE", c));
 				}
 				break;
@@ -1571,7 +1650,24 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				break;
 		}
 	}
-exit_loop:
+
+	parser->handler = handler;
+	parser->state = state;
+	parser->name_pointer = name_pointer;
+	parser->value_pointer = value_pointer;
+	parser->q = q;
+	parser->depth = depth;
+	parser->entity_pointer = entity_pointer;
+	parser->is_escaped = is_escaped;
+	parser->blob_buffer = blob_buffer;
+	parser->blob_pointer = blob_pointer;
+	parser->blob_size = blob_size;
+	parser->blob_remaining = blob_remaining;
+	return state != ERROR;
+}
+
+void indigo_xml_parser_release(indigo_xml_parser *parser) {
+	parser_context *context = &parser->context;
 	while (true) {
 		indigo_property *property = NULL;
 		int index;
@@ -1603,11 +1699,71 @@ exit_loop:
 			}
 		}
 	}
-	if (blob_buffer != NULL)
-		free(blob_buffer);
-	free(context);
-	free(buffer);
-	free(value_buffer);
+	if (context->properties != NULL)
+		free(context->properties);
+	context->properties = NULL;
+	context->count = 0;
+	if (parser->blob_buffer != NULL)
+		free(parser->blob_buffer);
+	parser->blob_buffer = NULL;
+	if (parser->read_buffer != NULL && parser->read_buffer_size > READ_BUFFER_SIZE) {
+		free(parser->read_buffer);
+		parser->read_buffer = NULL;
+		parser->read_buffer_size = 0;
+	}
+	if (context->property_capacity > PROPERTY_ITEMS) {
+		context->property = realloc(context->property, sizeof(indigo_property) + PROPERTY_ITEMS * sizeof(indigo_item));
+		assert(context->property != NULL);
+		context->property_capacity = PROPERTY_ITEMS;
+	}
+	pthread_mutex_lock(&parser_pool_mutex);
+	if (parser_pool_count < PARSER_POOL_SIZE) {
+		parser->next = parser_pool;
+		parser_pool = parser;
+		parser_pool_count++;
+		parser = NULL;
+	}
+	pthread_mutex_unlock(&parser_pool_mutex);
+	if (parser != NULL) {
+		if (parser->read_buffer != NULL)
+			free(parser->read_buffer);
+		free(parser->value_buffer);
+		free(context->property);
+		free(parser);
+	}
+}
+
+void indigo_xml_parse(indigo_device *device, indigo_client *client) {
+	int handle = 0;
+	if (device != NULL) {
+		handle = ((indigo_adapter_context *)device->device_context)->input;
+	} else {
+		handle = ((indigo_adapter_context *)client->client_context)->input;
+	}
+	indigo_xml_parser *parser = indigo_xml_parser_create(device, client);
+	//  Read buffer starts small and grows while reads fill it up completely (e.g. BLOB transfers)
+	if (parser->read_buffer == NULL) {
+		parser->read_buffer_size = READ_BUFFER_SIZE;
+		parser->read_buffer = malloc(parser->read_buffer_size + 1);
+		assert(parser->read_buffer != NULL);
+	}
+	while (true) {
+		ssize_t count = (int)read(handle, (void *)parser->read_buffer, (ssize_t)parser->read_buffer_size);
+		if (count <= 0)
+			break;
+		parser->read_buffer[count] = 0;
+		INDIGO_TRACE_PROTOCOL(indigo_trace("%d → %s", handle, parser->read_buffer));
+		if (!indigo_xml_parser_feed(parser, parser->read_buffer, count))
+			break;
+		if (count == parser->read_buffer_size && parser->read_buffer_size < BUFFER_SIZE) {
+			char *tmp = realloc(parser->read_buffer, 2 * parser->read_buffer_size + 1);
+			if (tmp != NULL) {
+				parser->read_buffer = tmp;
+				parser->read_buffer_size *= 2;
+			}
+		}
+	}
+	indigo_xml_parser_release(parser);
 	close(handle);
 	indigo_log("XML Parser: parser finished");
 }
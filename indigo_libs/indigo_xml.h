@@ -42,6 +42,22 @@ extern bool indigo_use_blob_urls;
  */
 extern void indigo_xml_parse(indigo_device *device, indigo_client *client);
 
+/** Incremental XML wire protocol parser.
+ */
+typedef struct indigo_xml_parser indigo_xml_parser;
+
+/** Get parser from pool (or allocate new one) for remote device (client side) or client (server side).
+ */
+extern indigo_xml_parser *indigo_xml_parser_create(indigo_device *device, indigo_client *client);
+
+/** Feed parser with next chunk of input, returns false on syntax error.
+ */
+extern bool indigo_xml_parser_feed(indigo_xml_parser *parser, const char *buffer, long length);
+
+/** Remove properties of remote devices and return parser to pool.
+ */
+extern void indigo_xml_parser_release(indigo_xml_parser *parser);
+
 /** Escape XML string.
  */
 extern char *indigo_xml_escape(char *string);
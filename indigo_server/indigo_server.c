@@ -406,7 +406,7 @@ static indigo_result change_property(indigo_device *device, indigo_client *clien
 		int handle = 0;
 		if (!command_line_drivers)
 			indigo_save_property(device, &handle, drivers_property);
-		close(handle);
+		indigo_close_config_file(handle);
 		return INDIGO_OK;
 	} else if (indigo_property_match(load_property, property)) {
 		// -------------------------------------------------------------------------------- LOAD
@@ -28,6 +28,7 @@
 #include <string.h>
 #include <zlib.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include "indigo_server_tcp.h"
 #include "indigo_novas.h"
@@ -41830,12 +41831,15 @@ void indigo_add_star_json_resource(int max_mag) {
 	strcpy(buffer, "{\"type\":\"FeatureCollection\",\"features\": [");
 	unsigned size = (unsigned)strlen(buffer);
 	char *sep = "";
+	indigo_novas_context context;
+	indigo_novas_init_context(&context, INDIGO_NOVAS_CONTEXT_WINDOW);
+	double utc = time(NULL);
 	for (int i = 0; star_data[i].hip; i++) {
 		if (star_data[i].mag > max_mag)
 			continue;
 		double ra = star_data[i].ra;
 		double dec = star_data[i].dec;
-		indigo_app_star(star_data[i].promora, star_data[i].promodec, star_data[i].px, star_data[i].rv, &ra, &dec);
+		indigo_app_star_with_context(&context, utc, 1, &star_data[i].promora, &star_data[i].promodec, &star_data[i].px, &star_data[i].rv, &ra, &dec);
 		size += sprintf(buffer + size, "%s{\"type\":\"Feature\",\"id\":%d,\"properties\":{\"name\": \"%s\",\"desig\":\"%s\",\"mag\": %.2f,\"con\":\"\",\"bv\":0},\"geometry\":{\"type\":\"Point\",\"coordinates\":[%.4f,%.4f]}}", sep, star_data[i].hip, star_data[i].name, star_data[i].desig, star_data[i].mag, h2deg(star_data[i].ra = ra), star_data[i].dec = dec);
 		if (buffer_size - size < 1024) {
 			buffer = realloc(buffer, buffer_size *= 2);
@@ -41855,12 +41859,15 @@ void indigo_add_dso_json_resource(int max_mag) {
 	strcpy(buffer, "{\"type\":\"FeatureCollection\",\"features\": [");
 	unsigned size = (unsigned)strlen(buffer);
 	char *sep = "";
+	indigo_novas_context context;
+	indigo_novas_init_context(&context, INDIGO_NOVAS_CONTEXT_WINDOW);
+	double utc = time(NULL);
 	for (int i = 0; dso_data[i].id; i++) {
 		if (dso_data[i].mag > max_mag)
 			continue;
 		double ra = dso_data[i].ra;
 		double dec = dso_data[i].dec;
-		indigo_app_star(0, 0, 0, 0, &ra, &dec);
+		indigo_app_star_with_context(&context, utc, 1, NULL, NULL, NULL, NULL, &ra, &dec);
 		size += sprintf(buffer + size, "%s{\"type\":\"Feature\",\"id\":\"%s\",\"properties\":{\"name\": \"%s\",\"desig\": \"%s\",\"type\":\"%s\",\"mag\": %.2f},\"geometry\":{\"type\":\"Point\",\"coordinates\":[%.4f,%.4f]}}", sep, dso_data[i].id, dso_data[i].id, dso_data[i].name, dso_data[i].type, dso_data[i].mag, h2deg(dso_data[i].ra = ra), dso_data[i].dec = dec);
 		if (buffer_size - size < 1024) {
 			buffer = realloc(buffer, buffer_size *= 2);
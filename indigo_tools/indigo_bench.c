@@ -0,0 +1,987 @@
+// Copyright (c) 2018 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// version history
+// 2.0 by agent <agent@local>
+
+/** INDIGO end-to-end throughput benchmark
+ \file indigo_bench.c
+
+ Starts an in-process bus with the CCD, mount and dome simulators behind the regular TCP server,
+ attaches a number of synthetic XML, JSON and JSON-over-WebSocket clients over loopback and drives
+ scripted workloads through them. Results are written as JSON.
+
+ Workloads run one after another, each for the given duration:
+ - storm: every client toggles MOUNT_SLEW_RATE as fast as the server confirms it
+ - exposure: back-to-back zero length exposures fanned out to all clients as BLOB URLs
+ - stream: CCD_STREAMING with unlimited count, frames/s depends on driver support
+ - blob: exposure loop with every client downloading each frame over HTTP keep-alive
+ - chain: exposure loop with the CCD simulator served by an upstream server on port + 1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "indigo_bus.h"
+#include "indigo_client.h"
+#include "indigo_server_tcp.h"
+#include "indigo_names.h"
+
+#include "ccd_simulator/indigo_ccd_simulator.h"
+#include "mount_simulator/indigo_mount_simulator.h"
+#include "dome_simulator/indigo_dome_simulator.h"
+
+#define BENCH_DEFAULT_PORT		7650
+#define BENCH_DEFAULT_CLIENTS	6
+#define BENCH_DEFAULT_DURATION	10
+#define BENCH_MAX_CLIENTS			256
+#define BENCH_BUFFER_SIZE			(256 * 1024)
+#define BENCH_READY_TIMEOUT		15
+#define BENCH_EVENT_TIMEOUT		5000
+
+typedef enum {
+	BENCH_XML,
+	BENCH_JSON,
+	BENCH_WS
+} bench_protocol;
+
+static const char *bench_protocol_name[] = { "xml", "json", "ws" };
+
+typedef enum {
+	BENCH_STORM,
+	BENCH_EXPOSURE,
+	BENCH_STREAM,
+	BENCH_BLOB,
+	BENCH_CHAIN,
+	BENCH_WORKLOAD_COUNT
+} bench_workload;
+
+static const char *bench_workload_name[] = { "storm", "exposure", "stream", "blob", "chain" };
+
+typedef struct {
+	uint64_t messages;						///< messages received by all clients
+	uint64_t frames;							///< image notifications received by all clients
+	uint64_t bytes;								///< protocol bytes received by all clients
+	uint64_t blob_bytes;					///< BLOB bytes downloaded over HTTP
+	uint64_t errors;							///< timeouts and protocol errors
+	double *latencies;						///< latency samples in ms
+	int latency_count;						///< number of latency samples
+	int latency_capacity;					///< allocated latency samples
+	double elapsed;								///< wall clock duration in s
+	long rss;											///< resident set size at the end of the workload in kB
+	long rss_peak;								///< peak resident set size in kB
+	bool executed;								///< workload was run
+} bench_result;
+
+typedef struct {
+	int index;										///< client index
+	bench_protocol protocol;			///< wire protocol
+	int socket;										///< protocol socket
+	int blob_socket;							///< keep-alive HTTP socket for BLOB downloads
+	int blob_socket_port;					///< port blob_socket is connected to
+	char *buffer;									///< receive buffer
+	int buffer_used;							///< bytes pending in receive buffer
+	int depth;										///< JSON framing depth
+	bool in_string;								///< JSON framing inside string
+	bool escaped;									///< JSON framing after backslash
+	int scanned;									///< JSON framing scan position
+	const char *storm_target;			///< requested MOUNT_SLEW_RATE item
+	bool in_set;									///< XML framing inside set*Vector
+	bool in_storm;								///< XML framing inside MOUNT_SLEW_RATE update
+	bool storm_event;							///< MOUNT_SLEW_RATE update with requested item seen
+	bool frame_event;							///< CCD_IMAGE update seen
+	bool exposure_event;					///< CCD_EXPOSURE finished
+	char blob_path[INDIGO_VALUE_SIZE];	///< last BLOB path
+	int blob_port;								///< port serving last BLOB
+	uint64_t messages;						///< per workload counters
+	uint64_t frames;
+	uint64_t bytes;
+	uint64_t blob_bytes;
+	uint64_t errors;
+} bench_client;
+
+static int port = BENCH_DEFAULT_PORT;
+static int client_count = BENCH_DEFAULT_CLIENTS;
+static int duration = BENCH_DEFAULT_DURATION;
+static int protocol_mask = (1 << BENCH_XML) | (1 << BENCH_JSON) | (1 << BENCH_WS);
+static bool workload_enabled[BENCH_WORKLOAD_COUNT];
+static bool chained = false;
+static const char *output_file = NULL;
+
+static bench_client clients[BENCH_MAX_CLIENTS];
+static bench_result results[BENCH_WORKLOAD_COUNT];
+static pthread_mutex_t phase_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t phase_cond = PTHREAD_COND_INITIALIZER;
+static int phase = 0;
+static int phase_done = 0;
+static pthread_mutex_t result_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile bench_workload current_workload;
+static volatile bool finished = false;
+static double workload_deadline;
+
+static volatile bool ccd_ready = false;
+static volatile bool mount_ready = false;
+static volatile bool dome_ready = false;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void read_rss(long *rss, long *peak) {
+	*rss = *peak = 0;
+	FILE *file = fopen("/proc/self/status", "r");
+	if (file) {
+		char line[128];
+		while (fgets(line, sizeof(line), file)) {
+			if (!strncmp(line, "VmRSS:", 6))
+				*rss = atol(line + 6);
+			else if (!strncmp(line, "VmHWM:", 6))
+				*peak = atol(line + 6);
+		}
+		fclose(file);
+	}
+	if (*peak == 0) {
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+#ifdef INDIGO_MACOS
+		*peak = usage.ru_maxrss / 1024;
+#else
+		*peak = usage.ru_maxrss;
+#endif
+		if (*rss == 0)
+			*rss = *peak;
+	}
+}
+
+static void add_latency(bench_workload workload, double ms) {
+	bench_result *result = &results[workload];
+	pthread_mutex_lock(&result_mutex);
+	if (result->latency_count == result->latency_capacity) {
+		result->latency_capacity = result->latency_capacity ? 2 * result->latency_capacity : 1024;
+		result->latencies = realloc(result->latencies, result->latency_capacity * sizeof(double));
+	}
+	result->latencies[result->latency_count++] = ms;
+	pthread_mutex_unlock(&result_mutex);
+}
+
+static int compare_double(const void *a, const void *b) {
+	double da = *(const double *)a, db = *(const double *)b;
+	return da < db ? -1 : da > db;
+}
+
+static double percentile(bench_result *result, double p) {
+	if (result->latency_count == 0)
+		return 0;
+	int index = (int)(p * (result->latency_count - 1) + 0.5);
+	return result->latencies[index];
+}
+
+// pthread barriers are not available on macOS, so workloads are sequenced by generation counter
+
+static void client_phase_done(int *seen) {
+	pthread_mutex_lock(&phase_mutex);
+	phase_done++;
+	pthread_cond_broadcast(&phase_cond);
+	while (phase == *seen)
+		pthread_cond_wait(&phase_cond, &phase_mutex);
+	*seen = phase;
+	pthread_mutex_unlock(&phase_mutex);
+}
+
+static void wait_for_clients() {
+	pthread_mutex_lock(&phase_mutex);
+	while (phase_done < client_count)
+		pthread_cond_wait(&phase_cond, &phase_mutex);
+	pthread_mutex_unlock(&phase_mutex);
+}
+
+static void start_phase() {
+	pthread_mutex_lock(&phase_mutex);
+	phase_done = 0;
+	phase++;
+	pthread_cond_broadcast(&phase_cond);
+	pthread_mutex_unlock(&phase_mutex);
+}
+
+// -------------------------------------------------------------------------------- in-process setup client
+
+static bool is_bench_device(const char *name) {
+	return !strcmp(name, CCD_SIMULATOR_IMAGER_CAMERA_NAME) || !strcmp(name, MOUNT_SIMULATOR_NAME) || !strcmp(name, DOME_SIMULATOR_NAME);
+}
+
+static void mark_ready(indigo_property *property) {
+	if (property->state != INDIGO_OK_STATE || !indigo_get_switch(property, CONNECTION_CONNECTED_ITEM_NAME))
+		return;
+	if (!strcmp(property->device, CCD_SIMULATOR_IMAGER_CAMERA_NAME))
+		ccd_ready = true;
+	else if (!strcmp(property->device, MOUNT_SIMULATOR_NAME))
+		mount_ready = true;
+	else if (!strcmp(property->device, DOME_SIMULATOR_NAME))
+		dome_ready = true;
+}
+
+static indigo_result bench_attach(indigo_client *client) {
+	indigo_enumerate_properties(client, &INDIGO_ALL_PROPERTIES);
+	return INDIGO_OK;
+}
+
+static indigo_result bench_define_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	if (!is_bench_device(property->device) || strcmp(property->name, CONNECTION_PROPERTY_NAME))
+		return INDIGO_OK;
+	if (indigo_get_switch(property, CONNECTION_CONNECTED_ITEM_NAME))
+		mark_ready(property);
+	else
+		indigo_device_connect(client, property->device);
+	return INDIGO_OK;
+}
+
+static indigo_result bench_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	if (is_bench_device(property->device) && !strcmp(property->name, CONNECTION_PROPERTY_NAME))
+		mark_ready(property);
+	return INDIGO_OK;
+}
+
+static indigo_client bench_client_entry = {
+	"Bench", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
+	bench_attach,
+	bench_define_property,
+	bench_update_property,
+	NULL,
+	NULL,
+	NULL
+};
+
+// -------------------------------------------------------------------------------- synthetic network clients
+
+static int connect_loopback(int port) {
+	int handle = socket(AF_INET, SOCK_STREAM, 0);
+	if (handle < 0)
+		return -1;
+	struct sockaddr_in address = { 0 };
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(handle, (struct sockaddr *)&address, sizeof(address)) < 0) {
+		close(handle);
+		return -1;
+	}
+	int val = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+	return handle;
+}
+
+static bool write_all(int handle, const char *buffer, long length) {
+	while (length > 0) {
+		long written = send(handle, buffer, length, MSG_NOSIGNAL);
+		if (written <= 0)
+			return false;
+		buffer += written;
+		length -= written;
+	}
+	return true;
+}
+
+static bool send_message(bench_client *client, const char *message) {
+	long length = strlen(message);
+	if (client->protocol != BENCH_WS)
+		return write_all(client->socket, message, length);
+	// client to server frames must be masked, the mask is fixed as the server doesn't care
+	uint8_t header[8] = { 0x81, 0x80 };
+	int header_size = 2;
+	if (length <= 0x7D) {
+		header[1] |= length;
+	} else {
+		header[1] |= 0x7E;
+		header[2] = (length >> 8) & 0xFF;
+		header[3] = length & 0xFF;
+		header_size = 4;
+	}
+	uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+	memcpy(header + header_size, mask, 4);
+	header_size += 4;
+	char *frame = malloc(header_size + length);
+	memcpy(frame, header, header_size);
+	for (long i = 0; i < length; i++)
+		frame[header_size + i] = message[i] ^ mask[i % 4];
+	bool result = write_all(client->socket, frame, header_size + length);
+	free(frame);
+	return result;
+}
+
+static bool send_switch(bench_client *client, const char *device, const char *property, const char *item) {
+	char message[512];
+	if (client->protocol == BENCH_XML)
+		snprintf(message, sizeof(message), "<newSwitchVector device='%s' name='%s'>\n<oneSwitch name='%s'>On</oneSwitch>\n</newSwitchVector>\n", device, property, item);
+	else
+		snprintf(message, sizeof(message), "{ \"newSwitchVector\": { \"device\": \"%s\", \"name\": \"%s\", \"items\": [ { \"name\": \"%s\", \"value\": true } ] } }\n", device, property, item);
+	return send_message(client, message);
+}
+
+static bool send_numbers(bench_client *client, const char *device, const char *property, int count, const char **items, const double *values) {
+	char message[1024];
+	int size;
+	if (client->protocol == BENCH_XML) {
+		size = snprintf(message, sizeof(message), "<newNumberVector device='%s' name='%s'>\n", device, property);
+		for (int i = 0; i < count; i++)
+			size += snprintf(message + size, sizeof(message) - size, "<oneNumber name='%s'>%g</oneNumber>\n", items[i], values[i]);
+		snprintf(message + size, sizeof(message) - size, "</newNumberVector>\n");
+	} else {
+		size = snprintf(message, sizeof(message), "{ \"newNumberVector\": { \"device\": \"%s\", \"name\": \"%s\", \"items\": [ ", device, property);
+		for (int i = 0; i < count; i++)
+			size += snprintf(message + size, sizeof(message) - size, "%s{ \"name\": \"%s\", \"value\": %g }", i > 0 ? ", " : "", items[i], values[i]);
+		snprintf(message + size, sizeof(message) - size, " ] } }\n");
+	}
+	return send_message(client, message);
+}
+
+static void process_unit(bench_client *client, char *unit, int length) {
+	unit[length] = 0;
+	const char *tag = client->protocol == BENCH_XML ? "<set" : "\"set";
+	bool is_set = strstr(unit, tag) != NULL;
+	if (is_set || strstr(unit, client->protocol == BENCH_XML ? "<def" : "\"def") || strstr(unit, client->protocol == BENCH_XML ? "<message" : "\"message") || strstr(unit, client->protocol == BENCH_XML ? "<del" : "\"delete"))
+		client->messages++;
+	if (client->in_set) {
+		// XML items come on separate lines
+		if (strstr(unit, "</set")) {
+			client->in_set = client->in_storm = false;
+			return;
+		}
+		if (client->in_storm) {
+			char pattern[INDIGO_NAME_SIZE + 16];
+			snprintf(pattern, sizeof(pattern), "name='%s'>On<", client->storm_target);
+			if (strstr(unit, pattern))
+				client->storm_event = true;
+		}
+	} else if (is_set && client->protocol == BENCH_XML && !strstr(unit, "/>")) {
+		client->in_set = true;
+	} else if (!is_set) {
+		return;
+	}
+	if (is_set && client->storm_target && strstr(unit, MOUNT_SLEW_RATE_PROPERTY_NAME)) {
+		if (client->protocol == BENCH_XML) {
+			client->in_storm = true;
+		} else {
+			char pattern[INDIGO_NAME_SIZE + 32];
+			snprintf(pattern, sizeof(pattern), "\"name\": \"%s\", \"value\": true", client->storm_target);
+			if (strstr(unit, pattern))
+				client->storm_event = true;
+		}
+	}
+	if (is_set && (client->protocol == BENCH_XML ? strstr(unit, "name='" CCD_EXPOSURE_PROPERTY_NAME "'") && !strstr(unit, "state='Busy'") : strstr(unit, "\"name\": \"" CCD_EXPOSURE_PROPERTY_NAME "\"") && !strstr(unit, "\"state\": \"Busy\"")))
+		client->exposure_event = true;
+	char *blob = strstr(unit, "/blob/");
+	if (blob != NULL) {
+		// chained BLOBs are announced with upstream URL
+		char *url = strstr(unit, "://");
+		if (url == NULL || url > blob || sscanf(url + 3, "%*[^:/]:%d", &client->blob_port) != 1)
+			client->blob_port = port;
+		char *end = blob;
+		while (*end && *end != '\'' && *end != '"' && !(end - blob >= INDIGO_VALUE_SIZE - 1))
+			end++;
+		memcpy(client->blob_path, blob, end - blob);
+		client->blob_path[end - blob] = 0;
+		client->frames++;
+		client->frame_event = true;
+	}
+}
+
+static void process_buffer(bench_client *client) {
+	char *buffer = client->buffer;
+	int start = 0;
+	if (client->protocol == BENCH_XML) {
+		for (int i = 0; i < client->buffer_used; i++) {
+			if (buffer[i] == '\n') {
+				process_unit(client, buffer + start, i - start);
+				start = i + 1;
+			}
+		}
+	} else if (client->protocol == BENCH_JSON) {
+		// the JSON adapter doesn't delimit messages, so they are framed by brace depth
+		for (int i = client->scanned; i < client->buffer_used; i++) {
+			char c = buffer[i];
+			if (client->in_string) {
+				if (client->escaped)
+					client->escaped = false;
+				else if (c == '\\')
+					client->escaped = true;
+				else if (c == '"')
+					client->in_string = false;
+			} else if (c == '"') {
+				client->in_string = true;
+			} else if (c == '{') {
+				if (client->depth++ == 0)
+					start = i;
+			} else if (c == '}' && client->depth > 0 && --client->depth == 0) {
+				char saved = buffer[i + 1];
+				process_unit(client, buffer + start, i + 1 - start);
+				buffer[i + 1] = saved;
+				start = i + 1;
+			}
+		}
+		if (client->depth == 0)
+			start = client->buffer_used;
+	} else {
+		while (client->buffer_used - start >= 2) {
+			uint8_t *header = (uint8_t *)buffer + start;
+			uint64_t length = header[1] & 0x7F;
+			int header_size = 2;
+			if (length == 0x7E) {
+				if (client->buffer_used - start < 4)
+					break;
+				length = (header[2] << 8) | header[3];
+				header_size = 4;
+			} else if (length == 0x7F) {
+				if (client->buffer_used - start < 10)
+					break;
+				length = 0;
+				for (int i = 2; i < 10; i++)
+					length = (length << 8) | header[i];
+				header_size = 10;
+			}
+			if (header_size + length >= BENCH_BUFFER_SIZE) {
+				client->errors++;
+				start = client->buffer_used;
+				break;
+			}
+			if (client->buffer_used - start < header_size + length)
+				break;
+			char saved = buffer[start + header_size + length];
+			process_unit(client, buffer + start + header_size, (int)length);
+			buffer[start + header_size + length] = saved;
+			start += header_size + length;
+		}
+	}
+	if (start > 0) {
+		client->buffer_used -= start;
+		memmove(buffer, buffer + start, client->buffer_used);
+	}
+	if (client->protocol == BENCH_JSON)
+		client->scanned = client->depth > 0 ? client->buffer_used : 0;
+	if (client->buffer_used >= BENCH_BUFFER_SIZE - 1) {
+		// message larger than the buffer, drop it and resynchronise
+		client->errors++;
+		client->buffer_used = 0;
+		client->scanned = 0;
+		client->depth = 0;
+		client->in_string = client->escaped = false;
+	}
+}
+
+static bool receive(bench_client *client, int timeout) {
+	struct pollfd fd = { client->socket, POLLIN, 0 };
+	int result = poll(&fd, 1, timeout);
+	if (result <= 0)
+		return result == 0;
+	long count = recv(client->socket, client->buffer + client->buffer_used, BENCH_BUFFER_SIZE - 1 - client->buffer_used, 0);
+	if (count <= 0)
+		return false;
+	client->bytes += count;
+	client->buffer_used += count;
+	process_buffer(client);
+	return true;
+}
+
+static bool wait_for(bench_client *client, volatile bool *event, double deadline) {
+	while (!*event) {
+		double remaining = deadline - now();
+		if (remaining <= 0)
+			return false;
+		if (!receive(client, (int)(remaining * 1000) + 1))
+			return false;
+	}
+	return true;
+}
+
+static void drain(bench_client *client, double quiet, double limit) {
+	double deadline = now() + limit;
+	while (now() < deadline) {
+		uint64_t bytes = client->bytes;
+		if (!receive(client, (int)(quiet * 1000)) || client->bytes == bytes)
+			break;
+	}
+}
+
+static bool download_blob(bench_client *client) {
+	if (*client->blob_path == 0)
+		return false;
+	if (client->blob_socket >= 0 && client->blob_socket_port != client->blob_port) {
+		close(client->blob_socket);
+		client->blob_socket = -1;
+	}
+	if (client->blob_socket < 0) {
+		if ((client->blob_socket = connect_loopback(client->blob_port)) < 0)
+			return false;
+		client->blob_socket_port = client->blob_port;
+	}
+	char request[INDIGO_VALUE_SIZE + 128];
+	snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nConnection: keep-alive\r\n\r\n", client->blob_path);
+	if (!write_all(client->blob_socket, request, strlen(request)))
+		goto failure;
+	char header[4096];
+	int header_used = 0;
+	char *body = NULL;
+	while (body == NULL) {
+		if (header_used == sizeof(header) - 1)
+			goto failure;
+		long count = recv(client->blob_socket, header + header_used, sizeof(header) - 1 - header_used, 0);
+		if (count <= 0)
+			goto failure;
+		header_used += count;
+		header[header_used] = 0;
+		if ((body = strstr(header, "\r\n\r\n")) != NULL)
+			body += 4;
+	}
+	if (strncmp(header, "HTTP/1.1 200", 12))
+		goto failure;
+	char *length_header = strstr(header, "Content-Length: ");
+	if (length_header == NULL)
+		goto failure;
+	long length = atol(length_header + 16);
+	long received = header_used - (body - header);
+	static __thread char chunk[64 * 1024];
+	while (received < length) {
+		long count = recv(client->blob_socket, chunk, sizeof(chunk) < length - received ? sizeof(chunk) : length - received, 0);
+		if (count <= 0)
+			goto failure;
+		received += count;
+	}
+	client->blob_bytes += length;
+	return true;
+failure:
+	close(client->blob_socket);
+	client->blob_socket = -1;
+	client->errors++;
+	return false;
+}
+
+static bool open_client(bench_client *client) {
+	if ((client->socket = connect_loopback(port)) < 0)
+		return false;
+	if (client->protocol == BENCH_WS) {
+		char request[256];
+		snprintf(request, sizeof(request), "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+		if (!write_all(client->socket, request, strlen(request)))
+			return false;
+		char response[1024];
+		int used = 0;
+		while (used < sizeof(response) - 1) {
+			if (recv(client->socket, response + used, 1, 0) != 1)
+				return false;
+			response[++used] = 0;
+			if (used >= 4 && !strcmp(response + used - 4, "\r\n\r\n"))
+				break;
+		}
+		if (strncmp(response, "HTTP/1.1 101", 12))
+			return false;
+	}
+	if (client->protocol == BENCH_XML) {
+		send_message(client, "<getProperties version='2.0'/>\n");
+		send_message(client, "<enableBLOB device='" CCD_SIMULATOR_IMAGER_CAMERA_NAME "'>URL</enableBLOB>\n");
+	} else {
+		send_message(client, "{ \"getProperties\": { \"version\": 512 } }\n");
+	}
+	return true;
+}
+
+static void run_storm(bench_client *client) {
+	static const char *rates[] = { MOUNT_SLEW_RATE_GUIDE_ITEM_NAME, MOUNT_SLEW_RATE_CENTERING_ITEM_NAME, MOUNT_SLEW_RATE_FIND_ITEM_NAME, MOUNT_SLEW_RATE_MAX_ITEM_NAME };
+	int i = client->index;
+	while (now() < workload_deadline) {
+		// latency is measured to the first update showing the requested rate, consecutive requests always differ
+		client->storm_target = rates[i++ % 4];
+		client->storm_event = client->in_storm = false;
+		double start = now();
+		if (!send_switch(client, MOUNT_SIMULATOR_NAME, MOUNT_SLEW_RATE_PROPERTY_NAME, client->storm_target))
+			break;
+		if (wait_for(client, &client->storm_event, start + BENCH_EVENT_TIMEOUT / 1000.0))
+			add_latency(BENCH_STORM, (now() - start) * 1000);
+		else
+			client->errors++;
+	}
+	client->storm_target = NULL;
+}
+
+static void run_exposure(bench_client *client, bench_workload workload) {
+	static const char *items[] = { CCD_EXPOSURE_ITEM_NAME };
+	static const double values[] = { 0 };
+	if (client->index != 0) {
+		// other clients just fan out the images, downloading them if requested
+		while (now() < workload_deadline) {
+			client->frame_event = false;
+			if (!wait_for(client, &client->frame_event, workload_deadline))
+				continue;
+			if (workload == BENCH_BLOB)
+				download_blob(client);
+		}
+		return;
+	}
+	while (now() < workload_deadline) {
+		client->frame_event = client->exposure_event = false;
+		double start = now();
+		if (!send_numbers(client, CCD_SIMULATOR_IMAGER_CAMERA_NAME, CCD_EXPOSURE_PROPERTY_NAME, 1, items, values))
+			break;
+		if (!wait_for(client, &client->frame_event, start + BENCH_EVENT_TIMEOUT / 1000.0)) {
+			client->errors++;
+			continue;
+		}
+		double frame = now();
+		// CCD_IMAGE is updated before CCD_EXPOSURE goes idle and the driver ignores requests while it is busy
+		wait_for(client, &client->exposure_event, start + BENCH_EVENT_TIMEOUT / 1000.0);
+		if (workload == BENCH_BLOB) {
+			double download = now();
+			if (download_blob(client))
+				add_latency(workload, (now() - download) * 1000);
+		} else {
+			add_latency(workload, (frame - start) * 1000);
+		}
+	}
+}
+
+static void run_stream(bench_client *client) {
+	static const char *items[] = { CCD_STREAMING_EXPOSURE_ITEM_NAME, CCD_STREAMING_COUNT_ITEM_NAME };
+	static const double values[] = { 0, -1 };
+	if (client->index == 0)
+		send_numbers(client, CCD_SIMULATOR_IMAGER_CAMERA_NAME, CCD_STREAMING_PROPERTY_NAME, 2, items, values);
+	double last = now();
+	while (now() < workload_deadline) {
+		client->frame_event = false;
+		if (wait_for(client, &client->frame_event, workload_deadline)) {
+			double frame = now();
+			add_latency(BENCH_STREAM, (frame - last) * 1000);
+			last = frame;
+		}
+	}
+	if (client->index == 0) {
+		send_switch(client, CCD_SIMULATOR_IMAGER_CAMERA_NAME, CCD_ABORT_EXPOSURE_PROPERTY_NAME, CCD_ABORT_EXPOSURE_ITEM_NAME);
+	}
+}
+
+static void *client_thread(bench_client *client) {
+	client->buffer = malloc(BENCH_BUFFER_SIZE);
+	client->blob_socket = -1;
+	if (!open_client(client)) {
+		indigo_error("Client #%d can't connect to localhost:%d", client->index, port);
+		client->socket = -1;
+	} else {
+		drain(client, 0.5, BENCH_READY_TIMEOUT);
+	}
+	int seen = 0;
+	client_phase_done(&seen);
+	while (!finished) {
+		bench_workload workload = current_workload;
+		client->messages = client->frames = client->bytes = client->blob_bytes = client->errors = 0;
+		if (client->socket >= 0) {
+			switch (workload) {
+				case BENCH_STORM:
+					run_storm(client);
+					break;
+				case BENCH_EXPOSURE:
+				case BENCH_BLOB:
+				case BENCH_CHAIN:
+					run_exposure(client, workload);
+					break;
+				case BENCH_STREAM:
+					run_stream(client);
+					break;
+				default:
+					break;
+			}
+			// wait until the server goes quiet so in-flight responses don't leak into the next workload
+			drain(client, 0.5, BENCH_EVENT_TIMEOUT / 1000.0);
+		}
+		pthread_mutex_lock(&result_mutex);
+		results[workload].messages += client->messages;
+		results[workload].frames += client->frames;
+		results[workload].bytes += client->bytes;
+		results[workload].blob_bytes += client->blob_bytes;
+		results[workload].errors += client->errors;
+		pthread_mutex_unlock(&result_mutex);
+		client_phase_done(&seen);
+	}
+	if (client->socket >= 0)
+		close(client->socket);
+	if (client->blob_socket >= 0)
+		close(client->blob_socket);
+	free(client->buffer);
+	return NULL;
+}
+
+// -------------------------------------------------------------------------------- server and chaining
+
+static volatile int server_client_count = 0;
+
+static void server_callback(int count) {
+	server_client_count = count;
+}
+
+static void *server_thread(void *data) {
+	indigo_server_start(server_callback);
+	return NULL;
+}
+
+static bool wait_for_port(int port) {
+	for (int i = 0; i < BENCH_READY_TIMEOUT * 10; i++) {
+		int handle = connect_loopback(port);
+		if (handle >= 0) {
+			close(handle);
+			return true;
+		}
+		usleep(100000);
+	}
+	return false;
+}
+
+static int run_upstream(int upstream_port) {
+	indigo_driver_entry *driver;
+	indigo_server_tcp_port = upstream_port;
+	indigo_start();
+	indigo_add_driver(&indigo_ccd_simulator, true, &driver);
+	indigo_server_start(server_callback);
+	indigo_stop();
+	return 0;
+}
+
+static pid_t spawn_upstream(const char *self, int upstream_port) {
+	pid_t pid = fork();
+	if (pid == 0) {
+		char port_arg[16];
+		snprintf(port_arg, sizeof(port_arg), "%d", upstream_port);
+		execl(self, self, "--upstream", port_arg, NULL);
+		_exit(1);
+	}
+	return pid;
+}
+
+// -------------------------------------------------------------------------------- results
+
+static void write_results(FILE *file) {
+	fprintf(file, "{\n");
+	fprintf(file, "  \"version\": \"%d.%d-%d\",\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD);
+	fprintf(file, "  \"clients\": %d,\n", client_count);
+	fprintf(file, "  \"protocols\": [");
+	bool first = true;
+	for (int i = BENCH_XML; i <= BENCH_WS; i++)
+		if (protocol_mask & (1 << i)) {
+			fprintf(file, "%s\"%s\"", first ? " " : ", ", bench_protocol_name[i]);
+			first = false;
+		}
+	fprintf(file, " ],\n");
+	fprintf(file, "  \"duration\": %d,\n", duration);
+	fprintf(file, "  \"chained\": %s,\n", chained ? "true" : "false");
+	fprintf(file, "  \"workloads\": [");
+	first = true;
+	for (int i = 0; i < BENCH_WORKLOAD_COUNT; i++) {
+		bench_result *result = &results[i];
+		if (!result->executed)
+			continue;
+		qsort(result->latencies, result->latency_count, sizeof(double), compare_double);
+		double elapsed = result->elapsed > 0 ? result->elapsed : 1;
+		fprintf(file, "%s\n    {\n", first ? "" : ",");
+		fprintf(file, "      \"name\": \"%s\",\n", bench_workload_name[i]);
+		fprintf(file, "      \"elapsed\": %.3f,\n", result->elapsed);
+		fprintf(file, "      \"messages\": %llu,\n", (unsigned long long)result->messages);
+		fprintf(file, "      \"messages_per_second\": %.1f,\n", result->messages / elapsed);
+		fprintf(file, "      \"frames\": %llu,\n", (unsigned long long)result->frames);
+		fprintf(file, "      \"frames_per_second\": %.2f,\n", result->frames / elapsed);
+		fprintf(file, "      \"protocol_mb_per_second\": %.3f,\n", result->bytes / elapsed / 1048576.0);
+		fprintf(file, "      \"blob_mb_per_second\": %.3f,\n", result->blob_bytes / elapsed / 1048576.0);
+		fprintf(file, "      \"samples\": %d,\n", result->latency_count);
+		fprintf(file, "      \"latency_p50_ms\": %.3f,\n", percentile(result, 0.50));
+		fprintf(file, "      \"latency_p99_ms\": %.3f,\n", percentile(result, 0.99));
+		fprintf(file, "      \"errors\": %llu,\n", (unsigned long long)result->errors);
+		fprintf(file, "      \"rss_kb\": %ld,\n", result->rss);
+		fprintf(file, "      \"rss_peak_kb\": %ld\n", result->rss_peak);
+		fprintf(file, "    }");
+		first = false;
+	}
+	fprintf(file, "\n  ]\n}\n");
+}
+
+static void print_help(const char *name) {
+	printf("INDIGO end-to-end benchmark v.%d.%d-%d built on %s %s.\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD, __DATE__, __TIME__);
+	printf("usage: %s [-c clients] [-d seconds] [-p port] [-P xml|json|ws] [-o file.json] [workload ...]\n", name);
+	printf("workloads: storm exposure stream blob chain (default storm exposure blob)\n");
+	printf("       -c | --clients   number of synthetic clients (default %d, max %d)\n", BENCH_DEFAULT_CLIENTS, BENCH_MAX_CLIENTS);
+	printf("       -d | --duration  duration of each workload in seconds (default %d)\n", BENCH_DEFAULT_DURATION);
+	printf("       -p | --port      server port (default %d, chained upstream uses port + 1)\n", BENCH_DEFAULT_PORT);
+	printf("       -P | --protocol  use only given protocol (default round robin of xml, json and ws)\n");
+	printf("       -o | --output    write JSON results to file (default stdout)\n");
+	printf("       -v | --enable-info\n");
+	printf("       -vv| --enable-debug\n");
+}
+
+int main(int argc, const char * argv[]) {
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	bool any_workload = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--upstream") && i < argc - 1) {
+			return run_upstream(atoi(argv[i + 1]));
+		} else if ((!strcmp(argv[i], "-c") || !strcmp(argv[i], "--clients")) && i < argc - 1) {
+			client_count = atoi(argv[++i]);
+		} else if ((!strcmp(argv[i], "-d") || !strcmp(argv[i], "--duration")) && i < argc - 1) {
+			duration = atoi(argv[++i]);
+		} else if ((!strcmp(argv[i], "-p") || !strcmp(argv[i], "--port")) && i < argc - 1) {
+			port = atoi(argv[++i]);
+		} else if ((!strcmp(argv[i], "-o") || !strcmp(argv[i], "--output")) && i < argc - 1) {
+			output_file = argv[++i];
+		} else if ((!strcmp(argv[i], "-P") || !strcmp(argv[i], "--protocol")) && i < argc - 1) {
+			protocol_mask = 0;
+			i++;
+			for (int j = BENCH_XML; j <= BENCH_WS; j++)
+				if (!strcmp(argv[i], bench_protocol_name[j]))
+					protocol_mask = 1 << j;
+		} else if (!strcmp(argv[i], "-v") || !strcmp(argv[i], "--enable-info") || !strcmp(argv[i], "-vv") || !strcmp(argv[i], "--enable-debug")) {
+			// handled by indigo_start()
+		} else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+			print_help(argv[0]);
+			return 0;
+		} else {
+			int j;
+			for (j = 0; j < BENCH_WORKLOAD_COUNT; j++)
+				if (!strcmp(argv[i], bench_workload_name[j]))
+					break;
+			if (j == BENCH_WORKLOAD_COUNT) {
+				print_help(argv[0]);
+				return 1;
+			}
+			workload_enabled[j] = any_workload = true;
+		}
+	}
+	if (client_count < 1 || client_count > BENCH_MAX_CLIENTS || duration < 1 || protocol_mask == 0) {
+		print_help(argv[0]);
+		return 1;
+	}
+	if (!any_workload)
+		workload_enabled[BENCH_STORM] = workload_enabled[BENCH_EXPOSURE] = workload_enabled[BENCH_BLOB] = true;
+	// with chaining, the CCD is served by an upstream server, so every imaging workload crosses two hops
+	chained = workload_enabled[BENCH_CHAIN];
+	indigo_reshare_remote_devices = chained;
+	signal(SIGPIPE, SIG_IGN);
+
+	pid_t upstream = -1;
+	indigo_server_entry *upstream_server = NULL;
+	indigo_driver_entry *ccd_driver = NULL, *mount_driver = NULL, *dome_driver = NULL;
+	indigo_server_tcp_port = port;
+	indigo_use_host_suffix = false;
+	indigo_start();
+	if (chained) {
+#ifdef INDIGO_LINUX
+		const char *self = "/proc/self/exe";
+#else
+		const char *self = argv[0];
+#endif
+		if ((upstream = spawn_upstream(self, port + 1)) < 0 || !wait_for_port(port + 1)) {
+			indigo_error("Can't start upstream server on port %d", port + 1);
+			return 1;
+		}
+		indigo_connect_server("upstream", "localhost", port + 1, &upstream_server);
+	} else {
+		indigo_add_driver(&indigo_ccd_simulator, true, &ccd_driver);
+	}
+	indigo_add_driver(&indigo_mount_simulator, true, &mount_driver);
+	indigo_add_driver(&indigo_dome_simulator, true, &dome_driver);
+	indigo_attach_client(&bench_client_entry);
+	indigo_async(server_thread, NULL);
+	if (!wait_for_port(port)) {
+		indigo_error("Can't start server on port %d", port);
+		return 1;
+	}
+	for (int i = 0; i < BENCH_READY_TIMEOUT * 10 && !(ccd_ready && mount_ready && dome_ready); i++)
+		usleep(100000);
+	if (!(ccd_ready && mount_ready && dome_ready)) {
+		indigo_error("Simulators didn't connect (ccd %d, mount %d, dome %d)", ccd_ready, mount_ready, dome_ready);
+		return 1;
+	}
+
+	pthread_t threads[BENCH_MAX_CLIENTS];
+	int protocol = 0;
+	for (int i = 0; i < client_count; i++) {
+		while (!(protocol_mask & (1 << protocol)))
+			protocol = (protocol + 1) % 3;
+		clients[i].index = i;
+		clients[i].protocol = protocol;
+		protocol = (protocol + 1) % 3;
+		pthread_create(&threads[i], NULL, (void * (*)(void *))client_thread, &clients[i]);
+	}
+	for (int i = 0; i < BENCH_WORKLOAD_COUNT; i++) {
+		if (!workload_enabled[i])
+			continue;
+		wait_for_clients();
+		current_workload = i;
+		double start = now();
+		workload_deadline = start + duration;
+		start_phase();
+		wait_for_clients();
+		results[i].elapsed = now() - start;
+		results[i].executed = true;
+		read_rss(&results[i].rss, &results[i].rss_peak);
+		INDIGO_LOG(indigo_log("Workload %s finished: %llu messages, %llu frames", bench_workload_name[i], (unsigned long long)results[i].messages, (unsigned long long)results[i].frames));
+	}
+	wait_for_clients();
+	finished = true;
+	start_phase();
+	for (int i = 0; i < client_count; i++)
+		pthread_join(threads[i], NULL);
+
+	FILE *file = output_file ? fopen(output_file, "w") : stdout;
+	if (file == NULL) {
+		indigo_error("Can't create %s (%s)", output_file, strerror(errno));
+		file = stdout;
+	}
+	write_results(file);
+	if (file != stdout)
+		fclose(file);
+
+	// server workers still own the bus until they see their sockets closed
+	for (int i = 0; i < BENCH_READY_TIMEOUT * 10 && server_client_count > 0; i++)
+		usleep(100000);
+	indigo_detach_client(&bench_client_entry);
+	if (upstream_server)
+		indigo_disconnect_server(upstream_server);
+	if (upstream > 0) {
+		kill(upstream, SIGTERM);
+		waitpid(upstream, NULL, 0);
+	}
+	indigo_server_shutdown();
+	if (dome_driver)
+		indigo_remove_driver(dome_driver);
+	if (mount_driver)
+		indigo_remove_driver(mount_driver);
+	if (ccd_driver)
+		indigo_remove_driver(ccd_driver);
+	indigo_stop();
+	return 0;
+}
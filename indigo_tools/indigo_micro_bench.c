@@ -0,0 +1,729 @@
+// Copyright (c) 2018 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// version history
+// 2.0 by agent <agent@local>
+
+/** INDIGO micro-benchmarks for image processing and codec paths
+ \file indigo_micro_bench.c
+
+ Runs indigo_process_image() for every output format (JPEG covers raw_to_jpeg()) on synthetic
+ 8/16-bit mono and 24/48-bit RGB frames in both byte orders, base64 codecs, indigo_xml_escape()
+ and the XML and JSON parsers on synthetic protocol streams. Each kernel reports ns/pixel (image
+ kernels) and MB/s of input, and is verified against golden output on a fixed 320x240 frame or
+ fixed stream, so changes of these paths are both measurable and safe.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#include "indigo_bus.h"
+#include "indigo_ccd_driver.h"
+#include "indigo_base64.h"
+#include "indigo_xml.h"
+#include "indigo_json.h"
+#include "indigo_driver_xml.h"
+#include "indigo_driver_json.h"
+#include "indigo_client_xml.h"
+
+#define GOLDEN_WIDTH			320
+#define GOLDEN_HEIGHT			240
+#define DEFAULT_MIN_TIME	0.3
+#define MIN_ITERATIONS		3
+#define MAX_SIZES					8
+#define MAX_SAMPLES				4096
+
+#define BENCH_CCD_NAME		"Bench CCD"
+#define BENCH_SINK_NAME		"Bench Sink"
+#define STREAM_MESSAGES		2000
+#define BASE64_SIZE				(4 * 1024 * 1024)
+
+typedef enum {
+	MONO8,
+	MONO16_LE,
+	MONO16_BE,
+	RGB24,
+	BGR24,
+	RGB48_LE,
+	RGB48_BE,
+	FRAME_TYPE_COUNT
+} frame_type;
+
+static struct {
+	const char *name;
+	int bpp;
+	bool little_endian;
+	bool byte_order_rgb;
+} frame_types[] = {
+	{ "mono8", 8, true, true },
+	{ "mono16le", 16, true, true },
+	{ "mono16be", 16, false, true },
+	{ "rgb24", 24, true, true },
+	{ "bgr24", 24, true, false },
+	{ "rgb48le", 48, true, true },
+	{ "rgb48be", 48, false, true }
+};
+
+typedef enum {
+	FORMAT_FITS,
+	FORMAT_XISF,
+	FORMAT_RAW,
+	FORMAT_JPEG,
+	FORMAT_COUNT
+} output_format;
+
+static const char *format_names[] = { "fits", "xisf", "raw", "jpeg" };
+
+typedef struct {
+	const char *name;
+	uint32_t hash;
+} golden_entry;
+
+/* FNV-1a of pixel data produced from the 320x240 golden frames, header excluded for FITS and XISF
+   as it carries time stamps. JPEG output depends on libjpeg version and is verified structurally. */
+static golden_entry golden[] = {
+	{ "fits/mono8", 0x422bed13 },
+	{ "fits/mono16le", 0xc60f1558 },
+	{ "fits/mono16be", 0xc60f1558 },
+	{ "fits/rgb24", 0x97ba1f79 },
+	{ "fits/bgr24", 0xbb84b195 },
+	{ "fits/rgb48le", 0x016470d9 },
+	{ "fits/rgb48be", 0xecdfbcd9 },
+	{ "xisf/mono8", 0xa2580813 },
+	{ "xisf/mono16le", 0x0774396e },
+	{ "xisf/mono16be", 0x0774396e },
+	{ "xisf/rgb24", 0xdf5d4c67 },
+	{ "xisf/bgr24", 0x75b81543 },
+	{ "xisf/rgb48le", 0x2ccb3a39 },
+	{ "xisf/rgb48be", 0x6d494109 },
+	{ "raw/mono8", 0x513f258d },
+	{ "raw/mono16le", 0x6b9d0b2d },
+	{ "raw/mono16be", 0x6b9d0b2d },
+	{ "raw/rgb24", 0xba21c5db },
+	{ "raw/bgr24", 0x6ec1dee7 },
+	{ "raw/rgb48le", 0x0f59909a },
+	{ "raw/rgb48be", 0xe750d5f2 },
+	{ "base64_encode", 0x8771d244 },
+	{ "indigo_xml_escape", 0x0fbb2d3d },
+	{ NULL, 0 }
+};
+
+typedef struct {
+	char name[64];
+	char size[24];
+	long iterations;
+	double best;
+	double median;
+	long pixels;
+	long bytes;
+	const char *golden;
+} bench_result;
+
+static bench_result results[1024];
+static int result_count = 0;
+static double min_time = DEFAULT_MIN_TIME;
+static const char *kernel_filter = NULL;
+static bool print_golden = false;
+static int golden_failures = 0;
+
+static indigo_device *ccd_device = NULL;
+static long sink_changes = 0;
+static double sink_sum = 0;
+static long client_updates = 0;
+static double client_sum = 0;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t fnv1a(const void *data, long size, uint32_t hash) {
+	const unsigned char *bytes = data;
+	for (long i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static uint32_t xorshift(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static int compare_double(const void *a, const void *b) {
+	double da = *(const double *)a, db = *(const double *)b;
+	return da < db ? -1 : da > db;
+}
+
+static bool selected(const char *name) {
+	return kernel_filter == NULL || strstr(name, kernel_filter) != NULL;
+}
+
+static const char *check_golden(const char *name, uint32_t hash) {
+	if (print_golden)
+		printf("\t{ \"%s\", 0x%08x },\n", name, hash);
+	for (golden_entry *entry = golden; entry->name; entry++) {
+		if (!strcmp(entry->name, name)) {
+			if (entry->hash == hash)
+				return "ok";
+			indigo_error("%s: golden hash mismatch (0x%08x, expected 0x%08x)", name, hash, entry->hash);
+			golden_failures++;
+			return "FAILED";
+		}
+	}
+	return "-";
+}
+
+static const char *check(const char *name, bool condition) {
+	if (condition)
+		return "ok";
+	indigo_error("%s: golden check failed", name);
+	golden_failures++;
+	return "FAILED";
+}
+
+/* Runs kernel repeatedly with optional untimed preparation until min_time is spent, keeps per-iteration times. */
+
+static bench_result *measure(const char *name, const char *size, long pixels, long bytes, void (*prepare)(void *), void (*kernel)(void *), void *data) {
+	static double samples[MAX_SAMPLES];
+	bench_result *result = &results[result_count++];
+	strncpy(result->name, name, sizeof(result->name) - 1);
+	strncpy(result->size, size, sizeof(result->size) - 1);
+	result->pixels = pixels;
+	result->bytes = bytes;
+	result->golden = "-";
+	int count = 0;
+	double total = 0;
+	while ((total < min_time || count < MIN_ITERATIONS) && count < MAX_SAMPLES) {
+		if (prepare)
+			prepare(data);
+		double start = now();
+		kernel(data);
+		double elapsed = now() - start;
+		samples[count++] = elapsed;
+		total += elapsed;
+	}
+	qsort(samples, count, sizeof(double), compare_double);
+	result->iterations = count;
+	result->best = samples[0];
+	result->median = samples[count / 2];
+	return result;
+}
+
+// -------------------------------------------------------------------------------- synthetic frames
+
+static void generate_frame(void *data, frame_type type, int width, int height) {
+	int bpp = frame_types[type].bpp;
+	int channels = bpp == 24 || bpp == 48 ? 3 : 1;
+	int max = bpp == 8 || bpp == 24 ? 255 : 65535;
+	uint32_t state = 0x1D1C0 + width * 31 + height;
+	unsigned char *b8 = (unsigned char *)data + FITS_HEADER_SIZE;
+	unsigned short *b16 = (unsigned short *)b8;
+	int star_x[16], star_y[16];
+	for (int i = 0; i < 16; i++) {
+		star_x[i] = xorshift(&state) % width;
+		star_y[i] = xorshift(&state) % height;
+	}
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			// sky gradient, noise and a few gaussian-ish stars
+			double value = 0.05 + 0.1 * x / width + 0.05 * y / height + (xorshift(&state) & 0xFF) / 8192.0;
+			for (int i = 0; i < 16; i++) {
+				int dx = x - star_x[i], dy = y - star_y[i];
+				int d2 = dx * dx + dy * dy;
+				if (d2 < 25)
+					value += 0.8 / (1 + d2);
+			}
+			if (value > 1)
+				value = 1;
+			for (int c = 0; c < channels; c++) {
+				int v = (int)(value * max * (1 - 0.1 * c));
+				if (max == 255) {
+					*b8++ = v;
+				} else {
+					if (!frame_types[type].little_endian)
+						v = (v & 0xff) << 8 | (v & 0xff00) >> 8;
+					*b16++ = v;
+				}
+			}
+		}
+	}
+}
+
+static indigo_result bench_ccd_attach(indigo_device *device) {
+	if (indigo_ccd_attach(device, INDIGO_VERSION_CURRENT) == INDIGO_OK) {
+		CCD_INFO_PIXEL_SIZE_ITEM->number.value = CCD_INFO_PIXEL_WIDTH_ITEM->number.value = CCD_INFO_PIXEL_HEIGHT_ITEM->number.value = 5.2;
+		CCD_EXPOSURE_ITEM->number.target = 1;
+		return indigo_ccd_enumerate_properties(device, NULL, NULL);
+	}
+	return INDIGO_FAILED;
+}
+
+typedef struct {
+	frame_type type;
+	output_format format;
+	int width, height;
+	long buffer_size;
+	void *source;
+	void *work;
+} image_job;
+
+static void select_format(output_format format) {
+	indigo_device *device = ccd_device;
+	switch (format) {
+		case FORMAT_FITS:
+			indigo_set_switch(CCD_IMAGE_FORMAT_PROPERTY, CCD_IMAGE_FORMAT_FITS_ITEM, true);
+			break;
+		case FORMAT_XISF:
+			indigo_set_switch(CCD_IMAGE_FORMAT_PROPERTY, CCD_IMAGE_FORMAT_XISF_ITEM, true);
+			break;
+		case FORMAT_RAW:
+			indigo_set_switch(CCD_IMAGE_FORMAT_PROPERTY, CCD_IMAGE_FORMAT_RAW_ITEM, true);
+			break;
+		case FORMAT_JPEG:
+			indigo_set_switch(CCD_IMAGE_FORMAT_PROPERTY, CCD_IMAGE_FORMAT_JPEG_ITEM, true);
+			break;
+		default:
+			break;
+	}
+}
+
+static void image_prepare(void *data) {
+	image_job *job = data;
+	memcpy(job->work, job->source, job->buffer_size);
+}
+
+static void image_kernel(void *data) {
+	image_job *job = data;
+	indigo_process_image(ccd_device, job->work, job->width, job->height, frame_types[job->type].bpp, frame_types[job->type].little_endian, frame_types[job->type].byte_order_rgb, NULL);
+}
+
+static void alloc_job(image_job *job, frame_type type, output_format format, int width, int height) {
+	job->type = type;
+	job->format = format;
+	job->width = width;
+	job->height = height;
+	job->buffer_size = FITS_HEADER_SIZE + (long)width * height * frame_types[type].bpp / 8 + 2880;
+	job->source = calloc(1, job->buffer_size);
+	job->work = malloc(job->buffer_size);
+	generate_frame(job->source, type, width, height);
+}
+
+static const char *verify_image(image_job *job, const char *name) {
+	indigo_device *device = ccd_device;
+	unsigned char *blob = CCD_IMAGE_ITEM->blob.value;
+	long size = CCD_IMAGE_ITEM->blob.size;
+	if (blob == NULL || size <= 0)
+		return check(name, false);
+	switch (job->format) {
+		case FORMAT_FITS:
+			if (strncmp((char *)blob, "SIMPLE  =", 9) || size % 2880)
+				return check(name, false);
+			return check_golden(name, fnv1a(blob + FITS_HEADER_SIZE, size - FITS_HEADER_SIZE, 2166136261u));
+		case FORMAT_XISF:
+			if (strncmp((char *)blob, "XISF0100", 8))
+				return check(name, false);
+			return check_golden(name, fnv1a(blob + FITS_HEADER_SIZE, size - FITS_HEADER_SIZE, 2166136261u));
+		case FORMAT_RAW:
+			return check_golden(name, fnv1a(blob, size, 2166136261u));
+		case FORMAT_JPEG:
+			// SOI and EOI markers, sensible size and black/white points from the histogram stretch
+			return check(name, blob[0] == 0xFF && blob[1] == 0xD8 && blob[size - 2] == 0xFF && blob[size - 1] == 0xD9 && size < job->buffer_size && CCD_JPEG_SETTINGS_BLACK_ITEM->number.value < CCD_JPEG_SETTINGS_WHITE_ITEM->number.value);
+		default:
+			return "-";
+	}
+}
+
+static void run_images(int sizes[][2], int size_count) {
+	for (int format = 0; format < FORMAT_COUNT; format++) {
+		select_format(format);
+		for (int type = 0; type < FRAME_TYPE_COUNT; type++) {
+			char name[64];
+			snprintf(name, sizeof(name), "%s/%s", format_names[format], frame_types[type].name);
+			if (!selected(name))
+				continue;
+			image_job job;
+			alloc_job(&job, type, format, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+			image_prepare(&job);
+			image_kernel(&job);
+			const char *golden_status = verify_image(&job, name);
+			free(job.source);
+			free(job.work);
+			for (int s = 0; s < size_count; s++) {
+				char size[24];
+				snprintf(size, sizeof(size), "%dx%d", sizes[s][0], sizes[s][1]);
+				alloc_job(&job, type, format, sizes[s][0], sizes[s][1]);
+				bench_result *result = measure(name, size, (long)job.width * job.height, (long)job.width * job.height * frame_types[type].bpp / 8, image_prepare, image_kernel, &job);
+				result->golden = golden_status;
+				free(job.source);
+				free(job.work);
+			}
+		}
+	}
+}
+
+// -------------------------------------------------------------------------------- base64 and escaping
+
+typedef struct {
+	unsigned char *raw;
+	unsigned char *encoded;
+	unsigned char *decoded;
+	long raw_size;
+	long encoded_size;
+} base64_job;
+
+static void base64_encode_kernel(void *data) {
+	base64_job *job = data;
+	job->encoded_size = base64_encode(job->encoded, job->raw, job->raw_size);
+}
+
+static void base64_decode_kernel(void *data) {
+	base64_job *job = data;
+	base64_decode_fast(job->decoded, job->encoded, job->encoded_size);
+}
+
+static void run_base64() {
+	base64_job job;
+	job.raw_size = BASE64_SIZE;
+	job.raw = malloc(job.raw_size);
+	job.encoded = malloc(job.raw_size * 4 / 3 + 8);
+	job.decoded = malloc(job.raw_size + 8);
+	uint32_t state = 0xB64;
+	for (long i = 0; i < job.raw_size; i++)
+		job.raw[i] = xorshift(&state);
+	// RFC 4648 test vector first, then round trip of the random buffer
+	unsigned char vector[16];
+	long vector_size = base64_encode(vector, (const unsigned char *)"foobar", 6);
+	base64_encode_kernel(&job);
+	bool ok = vector_size == 8 && !memcmp(vector, "Zm9vYmFy", 8) && job.encoded_size == job.raw_size * 4 / 3 + (job.raw_size % 3 ? 4 - job.raw_size % 3 : 0);
+	if (selected("base64_encode")) {
+		const char *status = ok ? check_golden("base64_encode", fnv1a(job.encoded, job.encoded_size, 2166136261u)) : check("base64_encode", false);
+		measure("base64_encode", "4MB", 0, job.raw_size, NULL, base64_encode_kernel, &job)->golden = status;
+	}
+	if (selected("base64_decode_fast")) {
+		memset(job.decoded, 0, job.raw_size);
+		long decoded_size = base64_decode_fast(job.decoded, job.encoded, job.encoded_size);
+		const char *status = check("base64_decode_fast", decoded_size == job.raw_size && !memcmp(job.decoded, job.raw, job.raw_size));
+		measure("base64_decode_fast", "4MB", 0, job.encoded_size, NULL, base64_decode_kernel, &job)->golden = status;
+	}
+	free(job.raw);
+	free(job.encoded);
+	free(job.decoded);
+}
+
+static char *escape_input[] = {
+	"CCD Imager Simulator",
+	"MOUNT_EQUATORIAL_COORDINATES",
+	"Exposure done, image saved to '/home/user/image_001.fits'",
+	"<b>Bold</b> & \"quoted\" 100% text",
+	NULL
+};
+
+static void escape_kernel(void *data) {
+	for (int r = 0; r < 10000; r++)
+		for (char **input = escape_input; *input; input++)
+			indigo_xml_escape(*input);
+}
+
+static void run_escape() {
+	if (!selected("indigo_xml_escape"))
+		return;
+	long bytes = 0;
+	uint32_t hash = 2166136261u;
+	for (char **input = escape_input; *input; input++) {
+		bytes += strlen(*input) * 10000;
+		char *output = indigo_xml_escape(*input);
+		hash = fnv1a(output, strlen(output), hash);
+	}
+	bool ok = !strcmp(indigo_xml_escape("a<b>&'\"%"), "a&lt;b&gt;&amp;&apos;&quot;%");
+	const char *status = ok ? check_golden("indigo_xml_escape", hash) : check("indigo_xml_escape", false);
+	measure("indigo_xml_escape", "4 strings", 0, bytes, NULL, escape_kernel, NULL)->golden = status;
+}
+
+// -------------------------------------------------------------------------------- protocol parsers
+
+static indigo_result sink_change_property(indigo_device *device, indigo_client *client, indigo_property *property) {
+	if (strcmp(property->device, BENCH_SINK_NAME))
+		return INDIGO_OK;
+	sink_changes++;
+	if (property->type == INDIGO_NUMBER_VECTOR)
+		for (int i = 0; i < property->count; i++)
+			sink_sum += property->items[i].number.value;
+	return INDIGO_OK;
+}
+
+static indigo_result counter_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	// remote device names may carry host suffix
+	if (strncmp(property->device, BENCH_SINK_NAME, strlen(BENCH_SINK_NAME)))
+		return INDIGO_OK;
+	client_updates++;
+	if (property->type == INDIGO_NUMBER_VECTOR)
+		for (int i = 0; i < property->count; i++)
+			client_sum += property->items[i].number.value;
+	return INDIGO_OK;
+}
+
+static indigo_client counter_client = {
+	"Bench Counter", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
+	NULL,
+	NULL,
+	counter_update_property,
+	NULL,
+	NULL,
+	NULL
+};
+
+typedef struct {
+	char *stream;
+	long length;
+	char file_name[64];
+	indigo_client *client;
+	indigo_device *device;
+} parser_job;
+
+static double expected_sum() {
+	double sum = 0;
+	for (int i = 0; i < STREAM_MESSAGES; i++)
+		sum += i * 0.5 + (i % 7) + 3;
+	return sum;
+}
+
+static char *xml_new_stream(long *length) {
+	char *stream = malloc(STREAM_MESSAGES * 512);
+	long size = 0;
+	for (int i = 0; i < STREAM_MESSAGES; i++) {
+		if (i % 2)
+			size += sprintf(stream + size, "<newNumberVector device='%s' name='NUMBER_%d'>\n<oneNumber name='A'>%g</oneNumber>\n<oneNumber name='B'>%d</oneNumber>\n<oneNumber name='C'>3</oneNumber>\n</newNumberVector>\n", BENCH_SINK_NAME, i % 16, i * 0.5, i % 7);
+		else
+			size += sprintf(stream + size, "<newNumberVector device='%s' name='NUMBER_%d'><oneNumber name='A'>%g</oneNumber><oneNumber name='B'>%d</oneNumber><oneNumber name='C'>3</oneNumber></newNumberVector>", BENCH_SINK_NAME, i % 16, i * 0.5, i % 7);
+	}
+	*length = size;
+	return stream;
+}
+
+static char *xml_set_stream(long *length) {
+	char *stream = malloc(STREAM_MESSAGES * 512 + 16 * 1024);
+	long size = 0;
+	for (int i = 0; i < 16; i++)
+		size += sprintf(stream + size, "<defNumberVector device='%s' name='NUMBER_%d' label='Number %d' group='Main' state='Idle' perm='rw' timeout='0'>\n<defNumber name='A' label='A' format='%%g' min='0' max='100000' step='0'>0</defNumber>\n<defNumber name='B' label='B' format='%%g' min='0' max='100' step='1'>0</defNumber>\n<defNumber name='C' label='C' format='%%g' min='0' max='100' step='1'>0</defNumber>\n</defNumberVector>\n", BENCH_SINK_NAME, i, i);
+	for (int i = 0; i < STREAM_MESSAGES; i++)
+		size += sprintf(stream + size, "<setNumberVector device='%s' name='NUMBER_%d' state='Ok'>\n<oneNumber name='A'>%g</oneNumber>\n<oneNumber name='B'>%d</oneNumber>\n<oneNumber name='C'>3</oneNumber>\n</setNumberVector>\n", BENCH_SINK_NAME, i % 16, i * 0.5, i % 7);
+	*length = size;
+	return stream;
+}
+
+static char *json_new_stream(long *length) {
+	char *stream = malloc(STREAM_MESSAGES * 512);
+	long size = 0;
+	for (int i = 0; i < STREAM_MESSAGES; i++)
+		size += sprintf(stream + size, "{ \"newNumberVector\": { \"device\": \"%s\", \"name\": \"NUMBER_%d\", \"items\": [ { \"name\": \"A\", \"value\": %g }, { \"name\": \"B\", \"value\": %d }, { \"name\": \"C\", \"value\": 3 } ] } }\n", BENCH_SINK_NAME, i % 16, i * 0.5, i % 7);
+	*length = size;
+	return stream;
+}
+
+static void xml_new_kernel(void *data) {
+	parser_job *job = data;
+	indigo_xml_parser *parser = indigo_xml_parser_create(NULL, job->client);
+	indigo_xml_parser_feed(parser, job->stream, job->length);
+	indigo_xml_parser_release(parser);
+}
+
+static void xml_set_kernel(void *data) {
+	parser_job *job = data;
+	indigo_xml_parser *parser = indigo_xml_parser_create(job->device, NULL);
+	indigo_xml_parser_feed(parser, job->stream, job->length);
+	indigo_xml_parser_release(parser);
+}
+
+static void json_new_kernel(void *data) {
+	parser_job *job = data;
+	// indigo_json_parse() reads from a handle and closes it when done
+	((indigo_adapter_context *)job->client->client_context)->input = open(job->file_name, O_RDONLY);
+	indigo_json_parse(NULL, job->client);
+}
+
+static void run_parsers() {
+	parser_job job = { 0 };
+	double sum = expected_sum();
+	if (selected("xml_parser/new")) {
+		job.stream = xml_new_stream(&job.length);
+		job.client = indigo_xml_device_adapter(-1, -1);
+		job.client->version = INDIGO_VERSION_CURRENT;
+		sink_changes = 0;
+		sink_sum = 0;
+		xml_new_kernel(&job);
+		const char *status = check("xml_parser/new", sink_changes == STREAM_MESSAGES && sink_sum == sum);
+		measure("xml_parser/new", "2000 msgs", 0, job.length, NULL, xml_new_kernel, &job)->golden = status;
+		indigo_release_xml_device_adapter(job.client);
+		free(job.stream);
+	}
+	if (selected("xml_parser/set")) {
+		job.stream = xml_set_stream(&job.length);
+		job.device = indigo_xml_client_adapter("Bench Adapter", "", -1, -1);
+		job.device->version = INDIGO_VERSION_CURRENT;
+		indigo_attach_client(&counter_client);
+		client_updates = 0;
+		client_sum = 0;
+		xml_set_kernel(&job);
+		const char *status = check("xml_parser/set", client_updates == STREAM_MESSAGES && client_sum == sum);
+		measure("xml_parser/set", "2000 msgs", 0, job.length, NULL, xml_set_kernel, &job)->golden = status;
+		indigo_detach_client(&counter_client);
+		free(job.device->device_context);
+		free(job.device);
+		free(job.stream);
+	}
+	if (selected("json_parser/new")) {
+		job.stream = json_new_stream(&job.length);
+		strcpy(job.file_name, "/tmp/indigo_micro_bench_XXXXXX");
+		int handle = mkstemp(job.file_name);
+		if (handle < 0 || write(handle, job.stream, job.length) != job.length) {
+			indigo_error("Can't create %s (%s)", job.file_name, strerror(errno));
+		} else {
+			close(handle);
+			job.client = indigo_json_device_adapter(-1, -1, false);
+			sink_changes = 0;
+			sink_sum = 0;
+			json_new_kernel(&job);
+			const char *status = check("json_parser/new", sink_changes == STREAM_MESSAGES && sink_sum == sum);
+			measure("json_parser/new", "2000 msgs", 0, job.length, NULL, json_new_kernel, &job)->golden = status;
+			indigo_release_json_device_adapter(job.client);
+		}
+		unlink(job.file_name);
+		free(job.stream);
+	}
+}
+
+// -------------------------------------------------------------------------------- reporting
+
+static void print_results(FILE *file, bool json) {
+	if (json) {
+		fprintf(file, "{\n  \"version\": \"%d.%d-%d\",\n  \"kernels\": [", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD);
+	} else {
+		fprintf(file, "%-24s %-12s %8s %12s %12s %10s %8s\n", "kernel", "size", "iter", "median [ms]", "ns/pixel", "MB/s", "golden");
+	}
+	for (int i = 0; i < result_count; i++) {
+		bench_result *result = &results[i];
+		double ns_per_pixel = result->pixels ? result->median * 1e9 / result->pixels : 0;
+		double mb_per_second = result->median > 0 ? result->bytes / result->median / 1048576.0 : 0;
+		if (json) {
+			fprintf(file, "%s\n    { \"name\": \"%s\", \"size\": \"%s\", \"iterations\": %ld, \"best_ms\": %.4f, \"median_ms\": %.4f, \"ns_per_pixel\": %.3f, \"mb_per_second\": %.2f, \"golden\": \"%s\" }", i ? "," : "", result->name, result->size, result->iterations, result->best * 1000, result->median * 1000, ns_per_pixel, mb_per_second, result->golden);
+		} else {
+			fprintf(file, "%-24s %-12s %8ld %12.3f %12.3f %10.1f %8s\n", result->name, result->size, result->iterations, result->median * 1000, ns_per_pixel, mb_per_second, result->golden);
+		}
+	}
+	if (json)
+		fprintf(file, "\n  ],\n  \"golden_failures\": %d\n}\n", golden_failures);
+}
+
+static void print_help(const char *name) {
+	printf("INDIGO micro-benchmarks v.%d.%d-%d built on %s %s.\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD, __DATE__, __TIME__);
+	printf("usage: %s [-s WxH[,WxH...]] [-t seconds] [-k filter] [-o file.json] [-g]\n", name);
+	printf("       -s | --sizes     frame sizes for image kernels (default 640x480,1600x1200,4096x3072)\n");
+	printf("       -t | --time      minimal time spent in each kernel (default %g)\n", DEFAULT_MIN_TIME);
+	printf("       -k | --kernel    run only kernels containing given string (e.g. fits/, jpeg/rgb24, parser)\n");
+	printf("       -o | --output    write JSON results to file\n");
+	printf("       -g | --golden    print golden hashes of current implementation\n");
+	printf("exit status is 1 if any golden check fails\n");
+}
+
+int main(int argc, const char * argv[]) {
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	int sizes[MAX_SIZES][2] = { { 640, 480 }, { 1600, 1200 }, { 4096, 3072 } };
+	int size_count = 3;
+	const char *output_file = NULL;
+	for (int i = 1; i < argc; i++) {
+		if ((!strcmp(argv[i], "-s") || !strcmp(argv[i], "--sizes")) && i < argc - 1) {
+			const char *spec = argv[++i];
+			size_count = 0;
+			while (*spec && size_count < MAX_SIZES) {
+				if (sscanf(spec, "%dx%d", &sizes[size_count][0], &sizes[size_count][1]) == 2 && sizes[size_count][0] > 0 && sizes[size_count][1] > 0)
+					size_count++;
+				spec = strchr(spec, ',');
+				if (spec == NULL)
+					break;
+				spec++;
+			}
+		} else if ((!strcmp(argv[i], "-t") || !strcmp(argv[i], "--time")) && i < argc - 1) {
+			min_time = atof(argv[++i]);
+		} else if ((!strcmp(argv[i], "-k") || !strcmp(argv[i], "--kernel")) && i < argc - 1) {
+			kernel_filter = argv[++i];
+		} else if ((!strcmp(argv[i], "-o") || !strcmp(argv[i], "--output")) && i < argc - 1) {
+			output_file = argv[++i];
+		} else if (!strcmp(argv[i], "-g") || !strcmp(argv[i], "--golden")) {
+			print_golden = true;
+		} else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+			print_help(argv[0]);
+			return 0;
+		} else if (strcmp(argv[i], "-v") && strcmp(argv[i], "--enable-info") && strcmp(argv[i], "-vv") && strcmp(argv[i], "--enable-debug")) {
+			print_help(argv[0]);
+			return 1;
+		}
+	}
+	indigo_start();
+	static indigo_device ccd_template = INDIGO_DEVICE_INITIALIZER(
+		BENCH_CCD_NAME,
+		bench_ccd_attach,
+		indigo_ccd_enumerate_properties,
+		indigo_ccd_change_property,
+		NULL,
+		indigo_ccd_detach
+	);
+	static indigo_device sink_template = INDIGO_DEVICE_INITIALIZER(
+		BENCH_SINK_NAME,
+		NULL,
+		NULL,
+		sink_change_property,
+		NULL,
+		NULL
+	);
+	ccd_device = &ccd_template;
+	indigo_attach_device(ccd_device);
+	indigo_attach_device(&sink_template);
+
+	run_images(sizes, size_count);
+	run_base64();
+	run_escape();
+	run_parsers();
+
+	print_results(stdout, false);
+	if (output_file) {
+		FILE *file = fopen(output_file, "w");
+		if (file) {
+			print_results(file, true);
+			fclose(file);
+		} else {
+			indigo_error("Can't create %s (%s)", output_file, strerror(errno));
+		}
+	}
+	indigo_detach_device(&sink_template);
+	indigo_detach_device(ccd_device);
+	indigo_stop();
+	return golden_failures ? 1 : 0;
+}